@@ -18,6 +18,8 @@
 
 #include "cJSON.h"
 #include "cJSON_os.h"
+#include <json_writer.h>
+#include <cbor_writer.h>
 #include "cloud_codec.h"
 
 #include "service_info.h"
@@ -200,6 +202,15 @@ static CMD_NEW_GROUP(group_command, CLOUD_CMD_GROUP_COMMAND, CMD_ARRAY(
 struct cmd *cmd_groups[] = { &group_cfg_set, &group_get, &group_data,
 			      &group_command };
 static cloud_cmd_cb_t cloud_command_cb;
+
+#if CONFIG_CLOUD_CODEC_PARSE_ARENA_SIZE > 0
+/* Incoming commands and shadow deltas are parsed into this arena, which is
+ * reset after each message instead of freeing every node.
+ */
+static uint8_t parse_arena_buf[CONFIG_CLOUD_CODEC_PARSE_ARENA_SIZE]
+	__aligned(sizeof(double));
+static struct cJSON_Arena parse_arena;
+#endif
 struct cloud_command cmd_parsed;
 
 static const char *const channel_type_str[] = {
@@ -280,28 +291,141 @@ static int json_add_obj(cJSON *parent, const char *str, cJSON *item)
 	return 0;
 }
 
-static int json_add_str(cJSON *parent, const char *str, const char *item)
+/* Format-neutral front end for the streaming writers, so that the same
+ * encoder produces either JSON or CBOR. The CBOR branches are compiled out
+ * unless CBOR is enabled.
+ */
+struct msg_writer {
+	enum cloud_codec_format format;
+	union {
+		struct json_writer json;
+		struct cbor_writer cbor;
+	};
+};
+
+#define IS_CBOR(_writer) (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR) && \
+			  ((_writer)->format == CLOUD_CODEC_FORMAT_CBOR))
+
+static void msg_writer_init(struct msg_writer *writer,
+			    enum cloud_codec_format format,
+			    char *buf, size_t size)
 {
-	cJSON *json_str;
+	writer->format = format;
 
-	json_str = cJSON_CreateString(item);
-	if (json_str == NULL) {
-		return -ENOMEM;
+	if (IS_CBOR(writer)) {
+		cbor_writer_init(&writer->cbor, (uint8_t *)buf, size);
+	} else {
+		json_writer_init(&writer->json, buf, size);
 	}
+}
 
-	return json_add_obj(parent, str, json_str);
+static void msg_writer_obj_start(struct msg_writer *writer, const char *key)
+{
+	if (IS_CBOR(writer)) {
+		cbor_writer_obj_start(&writer->cbor, key);
+	} else {
+		json_writer_obj_start(&writer->json, key);
+	}
 }
 
-static int json_add_bool(cJSON *parent, const char *str, const bool value)
+static void msg_writer_obj_end(struct msg_writer *writer)
 {
-	cJSON *json_bool;
+	if (IS_CBOR(writer)) {
+		cbor_writer_obj_end(&writer->cbor);
+	} else {
+		json_writer_obj_end(&writer->json);
+	}
+}
 
-	json_bool = cJSON_CreateBool(value);
-	if (json_bool == NULL) {
-		return -ENOMEM;
+static void msg_writer_str(struct msg_writer *writer, const char *key,
+			   const char *value)
+{
+	if (IS_CBOR(writer)) {
+		cbor_writer_str(&writer->cbor, key, value);
+	} else {
+		json_writer_str(&writer->json, key, value);
 	}
+}
 
-	return json_add_obj(parent, str, json_bool);
+static void msg_writer_bool(struct msg_writer *writer, const char *key,
+			    bool value)
+{
+	if (IS_CBOR(writer)) {
+		cbor_writer_bool(&writer->cbor, key, value);
+	} else {
+		json_writer_bool(&writer->json, key, value);
+	}
+}
+
+/* Returns the encoded length. JSON output is null-terminated, but the
+ * terminator is not part of the length.
+ */
+static int msg_writer_finish(struct msg_writer *writer)
+{
+	if (IS_CBOR(writer)) {
+		return cbor_writer_finish(&writer->cbor);
+	}
+
+	return json_writer_finish(&writer->json);
+}
+
+/* Encode a message with the streaming writer of the format. */
+typedef void (*msg_encoder_t)(struct msg_writer *writer, const void *ctx);
+
+struct msg_encoding {
+	enum cloud_codec_format format;
+	msg_encoder_t encode;
+	const void *ctx;
+};
+
+static int msg_encode_pass(char *buf, size_t size, const void *ctx)
+{
+	const struct msg_encoding *encoding = ctx;
+	struct msg_writer writer;
+
+	msg_writer_init(&writer, encoding->format, buf, size);
+	encoding->encode(&writer, encoding->ctx);
+
+	return msg_writer_finish(&writer);
+}
+
+static const struct json_writer_allocator msg_allocator = {
+	.alloc = k_malloc,
+	.free = k_free,
+};
+
+static int msg_encode_alloc(enum cloud_codec_format format,
+			    msg_encoder_t encode, const void *ctx,
+			    struct cloud_msg *output)
+{
+	struct msg_encoding encoding = {
+		.format = format,
+		.encode = encode,
+		.ctx = ctx,
+	};
+	char *buffer;
+	int len;
+
+	len = json_writer_encode_alloc(msg_encode_pass, &encoding,
+				       &msg_allocator, &buffer);
+	if (len < 0) {
+		return len;
+	}
+
+	output->buf = buffer;
+	output->len = len;
+
+	return 0;
+}
+
+enum cloud_codec_format cloud_codec_format_get(enum cloud_endpoint_type endpoint)
+{
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_CBOR) &&
+	    (endpoint == CLOUD_EP_TOPIC_MSG)) {
+		return CLOUD_CODEC_FORMAT_CBOR;
+	}
+
+	return CLOUD_CODEC_FORMAT_JSON;
 }
 
 static cJSON *json_object_decode(cJSON *obj, const char *str)
@@ -320,11 +444,31 @@ static bool json_value_string_compare(cJSON *obj, const char *const str)
 	return (strcmp(json_str, str) == 0);
 }
 
+struct data_msg {
+	const struct cloud_channel_data *channel;
+	enum cloud_cmd_group group;
+};
+
+static void data_msg_encode(struct msg_writer *writer, const void *ctx)
+{
+	const struct data_msg *msg = ctx;
+
+	msg_writer_obj_start(writer, NULL);
+	msg_writer_str(writer, CMD_CHAN_KEY_STR,
+		       channel_type_str[msg->channel->type]);
+	msg_writer_str(writer, CMD_DATA_TYPE_KEY_STR, msg->channel->data.buf);
+	msg_writer_str(writer, CMD_GROUP_KEY_STR, cmd_group_str[msg->group]);
+	msg_writer_obj_end(writer);
+}
+
 int cloud_encode_data(const struct cloud_channel_data *channel,
 		      const enum cloud_cmd_group group,
 		      struct cloud_msg *output)
 {
-	int ret;
+	struct data_msg msg = {
+		.channel = channel,
+		.group = group,
+	};
 
 	if (channel == NULL || channel->data.buf == NULL ||
 	    channel->data.len == 0 || output == NULL ||
@@ -332,30 +476,8 @@ int cloud_encode_data(const struct cloud_channel_data *channel,
 		return -EINVAL;
 	}
 
-	cJSON *root_obj = cJSON_CreateObject();
-	if (root_obj == NULL) {
-		cJSON_Delete(root_obj);
-		return -ENOMEM;
-	}
-
-	ret = json_add_str(root_obj, CMD_CHAN_KEY_STR,
-			   channel_type_str[channel->type]);
-	ret += json_add_str(root_obj, CMD_DATA_TYPE_KEY_STR, channel->data.buf);
-	ret += json_add_str(root_obj, CMD_GROUP_KEY_STR, cmd_group_str[group]);
-	if (ret != 0) {
-		cJSON_Delete(root_obj);
-		return -ENOMEM;
-	}
-
-	char *buffer;
-
-	buffer = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-	return 0;
+	return msg_encode_alloc(cloud_codec_format_get(CLOUD_EP_TOPIC_MSG),
+				data_msg_encode, &msg, output);
 }
 
 int cloud_encode_env_sensors_data(const env_sensor_data_t *sensor_data,
@@ -472,25 +594,28 @@ int cloud_encode_light_sensor_data(const struct light_sensor_data *sensor_data,
 }
 #endif /* CONFIG_LIGHT_SENSOR */
 
+static void config_msg_encode(struct msg_writer *writer, const void *ctx)
+{
+	const enum cloud_cmd_state *gps_state = ctx;
+
+	msg_writer_obj_start(writer, NULL);
+	msg_writer_obj_start(writer, "state");
+	msg_writer_obj_start(writer, "reported");
+	msg_writer_obj_start(writer, "config");
+	msg_writer_obj_start(writer, channel_type_str[CLOUD_CHANNEL_GPS]);
+	msg_writer_bool(writer, cmd_type_str[CLOUD_CMD_ENABLE],
+			*gps_state == CLOUD_CMD_STATE_TRUE);
+	msg_writer_obj_end(writer);
+	msg_writer_obj_end(writer);
+	msg_writer_obj_end(writer);
+	msg_writer_obj_end(writer);
+	msg_writer_obj_end(writer);
+}
+
 int cloud_encode_config_data(struct cloud_msg *output)
 {
 	__ASSERT_NO_MSG(output != NULL);
 
-	cJSON *chan_obj = cJSON_CreateObject();
-	cJSON *state_obj = cJSON_CreateObject();
-	cJSON *reported_obj = cJSON_CreateObject();
-	cJSON *config_obj = cJSON_CreateObject();
-	cJSON *root_obj = cJSON_CreateObject();
-	int ret = 0;
-	char *buffer;
-
-	if (chan_obj == NULL || state_obj == NULL ||
-	    reported_obj == NULL || config_obj == NULL ||
-		root_obj == NULL) {
-		ret = -ENOMEM;
-		goto cleanup;
-	}
-
 	/* Currently, the only value that can be changed from
 	 * the device is GPS enable, so it is the only
 	 * one that needs to be sent.
@@ -498,45 +623,18 @@ int cloud_encode_config_data(struct cloud_msg *output)
 	enum cloud_cmd_state gps_state =
 		cloud_get_channel_enable_state(CLOUD_CHANNEL_GPS);
 
-	if (gps_state != CLOUD_CMD_STATE_UNDEFINED) {
-		ret = json_add_bool(chan_obj, cmd_type_str[CLOUD_CMD_ENABLE],
-				gps_state == CLOUD_CMD_STATE_TRUE);
-		if (ret != 0) {
-			ret = -ENOMEM;
-			goto cleanup;
-		}
-	}
+	output->buf = NULL;
+	output->len = 0;
 
-	/* No items in chan_obj is not an error, there
+	/* Undefined state is not an error, there
 	 * is just nothing to report
 	 */
-	if (cJSON_GetArraySize(chan_obj) == 0) {
-		goto cleanup;
+	if (gps_state == CLOUD_CMD_STATE_UNDEFINED) {
+		return 0;
 	}
 
-	cJSON_AddItemToObject(config_obj, channel_type_str[CLOUD_CHANNEL_GPS],
-			      chan_obj);
-	cJSON_AddItemToObject(reported_obj, "config", config_obj);
-	cJSON_AddItemToObject(state_obj, "reported", reported_obj);
-	cJSON_AddItemToObject(root_obj, "state", state_obj);
-
-	buffer = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-	return 0;
-
-cleanup:
-	output->buf = NULL;
-	output->len = 0;
-	cJSON_Delete(chan_obj);
-	cJSON_Delete(state_obj);
-	cJSON_Delete(reported_obj);
-	cJSON_Delete(config_obj);
-	cJSON_Delete(root_obj);
-
-	return ret;
+	return msg_encode_alloc(cloud_codec_format_get(CLOUD_EP_TOPIC_STATE),
+				config_msg_encode, &gps_state, output);
 }
 
 int cloud_encode_device_status_data(
@@ -935,7 +1033,11 @@ int cloud_decode_command(char const *input)
 		return -EINVAL;
 	}
 
+#if CONFIG_CLOUD_CODEC_PARSE_ARENA_SIZE > 0
+	root_obj = cJSON_ArenaParse(&parse_arena, input);
+#else
 	root_obj = cJSON_Parse(input);
+#endif
 	if (root_obj == NULL) {
 		LOG_DBG("[%s:%d] Unable to parse input", __func__, __LINE__);
 		return -ENOENT;
@@ -947,12 +1049,21 @@ int cloud_decode_command(char const *input)
 
 	cJSON_Delete(root_obj);
 
+#if CONFIG_CLOUD_CODEC_PARSE_ARENA_SIZE > 0
+	LOG_DBG("Parse arena high-water mark: %d bytes",
+		(int)parse_arena.high_water);
+	cJSON_ArenaReset(&parse_arena);
+#endif
+
 	return 0;
 }
 
 int cloud_decode_init(cloud_cmd_cb_t cb)
 {
 	cJSON_Init();
+#if CONFIG_CLOUD_CODEC_PARSE_ARENA_SIZE > 0
+	cJSON_ArenaInit(&parse_arena, parse_arena_buf, sizeof(parse_arena_buf));
+#endif
 	cloud_command_cb = cb;
 	for (int i = 0; i < ARRAY_SIZE(sensor_cfg); ++i) {
 		/* Enable values should be undefined by default */
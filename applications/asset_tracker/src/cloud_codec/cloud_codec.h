@@ -191,6 +191,25 @@ struct cloud_command {
 
 typedef void (*cloud_cmd_cb_t)(struct cloud_command *cmd);
 
+/** @brief Payload formats that the cloud codec can encode messages in. */
+enum cloud_codec_format {
+	CLOUD_CODEC_FORMAT_JSON,
+	CLOUD_CODEC_FORMAT_CBOR,
+};
+
+/**
+ * @brief Get the payload format used for messages to a cloud endpoint.
+ *
+ * Data messages use the format selected in the configuration. Digital twin
+ * (shadow) documents are always encoded as JSON, because the cloud services
+ * do not accept any other format for them.
+ *
+ * @param endpoint Endpoint type that the message is sent to.
+ *
+ * @return Payload format.
+ */
+enum cloud_codec_format cloud_codec_format_get(enum cloud_endpoint_type endpoint);
+
 /**
  * @brief Encode cloud data.
  *
@@ -22,7 +22,7 @@
 extern "C" {
 #endif
 
-/** Peer connection event. */
+/** UART data event. */
 struct uart_data_event {
 	struct event_header header;
 
@@ -33,6 +33,23 @@ struct uart_data_event {
 
 EVENT_TYPE_DECLARE(uart_data_event);
 
+/** @brief Take a reference to the data of a UART data event.
+ *
+ * The data is valid while the event is processed. A subscriber that takes a
+ * reference can keep using the data after that, until it releases the
+ * reference with @ref uart_data_event_buf_unref. UART RX is stopped when
+ * all RX buffers are referenced.
+ *
+ * @param buf Data buffer from the event.
+ */
+void uart_data_event_buf_ref(const uint8_t *buf);
+
+/** @brief Release a reference taken with @ref uart_data_event_buf_ref.
+ *
+ * @param buf Data buffer from the event.
+ */
+void uart_data_event_buf_unref(const uint8_t *buf);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,7 +6,7 @@
 
 #include <zephyr.h>
 #include <zephyr/types.h>
-#include <sys/ring_buffer.h>
+#include <string.h>
 
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/uuid.h>
@@ -28,16 +28,19 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_BRIDGE_BLE_LOG_LEVEL);
 #define BLE_RX_BUF_COUNT 4
 #define BLE_SLAB_ALIGNMENT 4
 
-#define BLE_TX_BUF_SIZE (CONFIG_BRIDGE_BUF_SIZE * 2)
-
 #define ATT_MIN_PAYLOAD 20 /* Minimum L2CAP MTU minus ATT header */
 
+/* UART data sent directly from the UART RX buffer */
+struct ble_tx_chunk {
+	const uint8_t *buf;
+	size_t len;
+};
+
 static void bt_send_work_handler(struct k_work *work);
 
 K_MEM_SLAB_DEFINE(ble_rx_slab, BLE_RX_BLOCK_SIZE, BLE_RX_BUF_COUNT, BLE_SLAB_ALIGNMENT);
-RING_BUF_DECLARE(ble_tx_ring_buf, BLE_TX_BUF_SIZE);
-
-static K_SEM_DEFINE(ble_tx_sem, 0, 1);
+K_MSGQ_DEFINE(ble_tx_queue, sizeof(struct ble_tx_chunk),
+	      CONFIG_BRIDGE_BLE_TX_QUEUE_SIZE, 4);
 
 static K_WORK_DEFINE(bt_send_work, bt_send_work_handler);
 
@@ -46,6 +49,21 @@ static struct bt_gatt_exchange_params exchange_params;
 static uint32_t nus_max_send_len;
 static atomic_t ready;
 static atomic_t active;
+static atomic_t tx_in_flight;
+/* Bytes of the chunk at the head of the queue already sent */
+static size_t tx_offset;
+
+#if CONFIG_BRIDGE_BLE_STATS
+/* Updated from the event manager and the system workqueue */
+static struct {
+	atomic_t bytes;
+	atomic_t notifications;
+	atomic_t throttled;
+	atomic_t dropped;
+} stats;
+
+static struct k_delayed_work stats_work;
+#endif
 
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -84,7 +102,7 @@ static void connected(struct bt_conn *conn, uint8_t err)
 		LOG_WRN("bt_gatt_exchange_mtu: %d", err);
 	}
 
-	ring_buf_reset(&ble_tx_ring_buf);
+	atomic_set(&tx_in_flight, 0);
 
 	struct peer_conn_event *event = new_peer_conn_event();
 
@@ -107,6 +125,9 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 		current_conn = NULL;
 	}
 
+	/* Release queued UART data */
+	k_work_submit(&bt_send_work);
+
 	struct peer_conn_event *event = new_peer_conn_event();
 
 	event->peer_id = PEER_ID_BLE;
@@ -121,34 +142,66 @@ static struct bt_conn_cb conn_callbacks = {
 	.disconnected = disconnected,
 };
 
+static void tx_queue_drop(void)
+{
+	struct ble_tx_chunk chunk;
+
+	while (k_msgq_get(&ble_tx_queue, &chunk, K_NO_WAIT) == 0) {
+		uart_data_event_buf_unref(chunk.buf);
+	}
+
+	tx_offset = 0;
+}
+
 static void bt_send_work_handler(struct k_work *work)
 {
-	uint16_t len;
-	uint8_t *buf;
+	struct ble_tx_chunk chunk;
 	int err;
-	bool notif_disabled = false;
 
-	do {
-		len = ring_buf_get_claim(&ble_tx_ring_buf, &buf, nus_max_send_len);
-
-		err = bt_gatt_nus_send(current_conn, buf, len);
-		if (err == -EINVAL) {
-			notif_disabled = true;
-			len = 0;
-		} else if (err) {
-			len = 0;
+	if (current_conn == NULL) {
+		tx_queue_drop();
+		return;
+	}
+
+	while (k_msgq_peek(&ble_tx_queue, &chunk) == 0) {
+		size_t len = MIN(chunk.len - tx_offset, nus_max_send_len);
+
+		/* Keep the data queued, and the UART RX buffer referenced,
+		 * until the stack can take more notifications.
+		 */
+		if (atomic_inc(&tx_in_flight) >= CONFIG_BRIDGE_BLE_TX_IN_FLIGHT) {
+			atomic_dec(&tx_in_flight);
+#if CONFIG_BRIDGE_BLE_STATS
+			atomic_inc(&stats.throttled);
+#endif
+			break;
 		}
 
-		err = ring_buf_get_finish(&ble_tx_ring_buf, len);
+		err = bt_gatt_nus_send(current_conn, &chunk.buf[tx_offset], len);
 		if (err) {
-			LOG_ERR("ring_buf_get_finish: %d", err);
+			atomic_dec(&tx_in_flight);
+
+			if (err == -EINVAL) {
+				/* Peer has not enabled notifications:
+				 * don't accumulate data
+				 */
+				tx_queue_drop();
+			}
 			break;
 		}
-	} while (len != 0 && !ring_buf_is_empty(&ble_tx_ring_buf));
 
-	if (notif_disabled) {
-		/* Peer has not enabled notifications: don't accumulate data */
-		ring_buf_reset(&ble_tx_ring_buf);
+#if CONFIG_BRIDGE_BLE_STATS
+		atomic_add(&stats.bytes, len);
+		atomic_inc(&stats.notifications);
+#endif
+
+		/* Notification data is copied by the stack */
+		tx_offset += len;
+		if (tx_offset == chunk.len) {
+			(void)k_msgq_get(&ble_tx_queue, &chunk, K_NO_WAIT);
+			uart_data_event_buf_unref(chunk.buf);
+			tx_offset = 0;
+		}
 	}
 }
 
@@ -185,13 +238,37 @@ static void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data,
 
 static void bt_sent_cb(struct bt_conn *conn)
 {
-	if (ring_buf_is_empty(&ble_tx_ring_buf)) {
+	if (atomic_get(&tx_in_flight) > 0) {
+		atomic_dec(&tx_in_flight);
+	}
+
+	if (k_msgq_num_used_get(&ble_tx_queue) == 0) {
 		return;
 	}
 
 	k_work_submit(&bt_send_work);
 }
 
+#if CONFIG_BRIDGE_BLE_STATS
+static void stats_work_handler(struct k_work *work)
+{
+	uint32_t interval_s = CONFIG_BRIDGE_BLE_STATS_INTERVAL / 1000;
+	uint32_t bytes = atomic_clear(&stats.bytes);
+	uint32_t notifications = atomic_clear(&stats.notifications);
+
+	LOG_INF("BLE TX: %u B/s, %u notifications, avg %u B, "
+		"throttled %u, dropped %u",
+		bytes / MAX(interval_s, 1),
+		notifications,
+		notifications ? bytes / notifications : 0,
+		(uint32_t)atomic_clear(&stats.throttled),
+		(uint32_t)atomic_clear(&stats.dropped));
+
+	k_delayed_work_submit(&stats_work,
+			      K_MSEC(CONFIG_BRIDGE_BLE_STATS_INTERVAL));
+}
+#endif
+
 static struct bt_gatt_nus_cb nus_cb = {
 	.received_cb = bt_receive_cb,
 	.sent_cb = bt_sent_cb,
@@ -271,23 +348,25 @@ static bool event_handler(const struct event_header *eh)
 			return false;
 		}
 
-		uint32_t written = ring_buf_put(
-			&ble_tx_ring_buf,
-			event->buf,
-			event->len);
-		if (written != event->len) {
+		struct ble_tx_chunk chunk = {
+			.buf = event->buf,
+			.len = event->len,
+		};
+
+		/* Data is sent from the UART RX buffer, without a copy */
+		uart_data_event_buf_ref(chunk.buf);
+
+		if (k_msgq_put(&ble_tx_queue, &chunk, K_NO_WAIT)) {
+			uart_data_event_buf_unref(chunk.buf);
 			LOG_WRN("UART_%d -> BLE overflow", event->dev_idx);
+#if CONFIG_BRIDGE_BLE_STATS
+			atomic_inc(&stats.dropped);
+#endif
+			return false;
 		}
 
-		uint32_t buf_utilization =
-			(ring_buf_capacity_get(&ble_tx_ring_buf) -
-			ring_buf_space_get(&ble_tx_ring_buf));
-
-		/* Simple check to start transmission. */
 		/* If bt_send_work is already running, this has no effect */
-		if (buf_utilization == written) {
-			k_work_submit(&bt_send_work);
-		}
+		k_work_submit(&bt_send_work);
 
 		return false;
 	}
@@ -344,6 +423,12 @@ static bool event_handler(const struct event_header *eh)
 			}
 
 			bt_conn_cb_register(&conn_callbacks);
+
+#if CONFIG_BRIDGE_BLE_STATS
+			k_delayed_work_init(&stats_work, stats_work_handler);
+			k_delayed_work_submit(&stats_work,
+				K_MSEC(CONFIG_BRIDGE_BLE_STATS_INTERVAL));
+#endif
 		}
 
 		return false;
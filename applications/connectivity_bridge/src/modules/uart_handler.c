@@ -77,6 +77,21 @@ static uint32_t uart_default_baudrate[UART_DEVICE_COUNT];
 static int subscriber_count[UART_DEVICE_COUNT];
 static bool enable_rx_retry[UART_DEVICE_COUNT];
 static atomic_t uart_tx_started[UART_DEVICE_COUNT];
+/* RX stopped because all buffer blocks are in use */
+static atomic_t rx_stalled[UART_DEVICE_COUNT];
+static atomic_t rx_suspended[UART_DEVICE_COUNT];
+
+/* Received data not yet forwarded, contiguous within one RX block */
+struct uart_rx_pending {
+	uint8_t *buf;
+	size_t len;
+	struct k_timer timer;
+};
+
+static struct uart_rx_pending rx_pending[UART_DEVICE_COUNT];
+
+static void rx_resume_work_handler(struct k_work *work);
+static K_WORK_DEFINE(rx_resume_work, rx_resume_work_handler);
 
 static void enable_uart_rx(uint8_t dev_idx);
 static void disable_uart_rx(uint8_t dev_idx);
@@ -134,28 +149,115 @@ static void uart_rx_buf_unref(void *buf)
 	/* ref_counter is the uart_buf->ref_counter value prior to decrement */
 	if (ref_counter == 1) {
 		k_mem_slab_free(&uart_rx_slab, (void **)&uart_buf);
+
+		for (int i = 0; i < UART_DEVICE_COUNT; ++i) {
+			if (atomic_get(&rx_suspended[i])) {
+				k_work_submit(&rx_resume_work);
+				break;
+			}
+		}
+	}
+}
+
+void uart_data_event_buf_ref(const uint8_t *buf)
+{
+	uart_rx_buf_ref((void *)buf);
+}
+
+void uart_data_event_buf_unref(const uint8_t *buf)
+{
+	uart_rx_buf_unref((void *)buf);
+}
+
+static void rx_pending_flush(int dev_idx)
+{
+	struct uart_rx_pending *pending = &rx_pending[dev_idx];
+	struct uart_data_event *event;
+
+	if (pending->len == 0) {
+		return;
 	}
+
+	k_timer_stop(&pending->timer);
+
+	/* The reference taken for pending data is passed to the event */
+	event = new_uart_data_event();
+	event->dev_idx = dev_idx;
+	event->buf = pending->buf;
+	event->len = pending->len;
+	EVENT_SUBMIT(event);
+
+	pending->len = 0;
+}
+
+static void rx_pending_timeout(struct k_timer *timer)
+{
+	int dev_idx = (struct uart_rx_pending *)CONTAINER_OF(
+		timer, struct uart_rx_pending, timer) - rx_pending;
+	int key = irq_lock();
+
+	rx_pending_flush(dev_idx);
+
+	irq_unlock(key);
+}
+
+/* Bursts of received data are coalesced until there is enough data, or
+ * until the oldest data has waited long enough. Chunks that are contiguous
+ * in the RX block are forwarded in one event.
+ */
+static void rx_data_add(int dev_idx, uint8_t *buf, size_t len)
+{
+	struct uart_rx_pending *pending = &rx_pending[dev_idx];
+	int key = irq_lock();
+
+	if ((pending->len > 0) && (&pending->buf[pending->len] == buf)) {
+		pending->len += len;
+	} else {
+		rx_pending_flush(dev_idx);
+
+		uart_rx_buf_ref(buf);
+		pending->buf = buf;
+		pending->len = len;
+
+		if (CONFIG_BRIDGE_UART_AGGREGATION_SIZE > 0) {
+			k_timer_start(&pending->timer,
+				K_MSEC(CONFIG_BRIDGE_UART_AGGREGATION_TIMEOUT),
+				K_NO_WAIT);
+		}
+	}
+
+	if (pending->len >= CONFIG_BRIDGE_UART_AGGREGATION_SIZE) {
+		rx_pending_flush(dev_idx);
+	}
+
+	irq_unlock(key);
+}
+
+static void rx_flush(int dev_idx)
+{
+	int key = irq_lock();
+
+	rx_pending_flush(dev_idx);
+
+	irq_unlock(key);
 }
 
 static void uart_callback(struct device *dev, struct uart_event *evt,
 			  void *user_data)
 {
 	int dev_idx = (int) user_data;
-	struct uart_data_event *event;
 	struct uart_rx_buf *buf;
 	int err;
 
 	switch (evt->type) {
 	case UART_RX_RDY:
-		uart_rx_buf_ref(evt->data.rx.buf);
-
-		event = new_uart_data_event();
-		event->dev_idx = dev_idx;
-		event->buf = &evt->data.rx.buf[evt->data.rx.offset];
-		event->len = evt->data.rx.len;
-		EVENT_SUBMIT(event);
+		rx_data_add(dev_idx, &evt->data.rx.buf[evt->data.rx.offset],
+			    evt->data.rx.len);
 		break;
 	case UART_RX_BUF_RELEASED:
+		/* No more data will be appended to the released block */
+		rx_flush(dev_idx);
+
 		if (evt->data.rx_buf.buf) {
 			uart_rx_buf_unref(evt->data.rx_buf.buf);
 		}
@@ -163,7 +265,13 @@ static void uart_callback(struct device *dev, struct uart_event *evt,
 	case UART_RX_BUF_REQUEST:
 		buf = uart_rx_buf_alloc();
 		if (buf == NULL) {
-			LOG_WRN("UART_%d RX overflow", dev_idx);
+			/* All blocks are held by the receivers of the data.
+			 * RX stops when the current block is full, and is
+			 * resumed when a block is freed. With hardware flow
+			 * control, the peer is stopped in the meantime.
+			 */
+			LOG_DBG("UART_%d RX stalled", dev_idx);
+			atomic_set(&rx_stalled[dev_idx], true);
 			break;
 		}
 
@@ -174,7 +282,12 @@ static void uart_callback(struct device *dev, struct uart_event *evt,
 		}
 		break;
 	case UART_RX_DISABLED:
-		if (enable_rx_retry[dev_idx]) {
+		rx_flush(dev_idx);
+
+		if (atomic_set(&rx_stalled[dev_idx], false)) {
+			atomic_set(&rx_suspended[dev_idx], true);
+			k_work_submit(&rx_resume_work);
+		} else if (enable_rx_retry[dev_idx]) {
 			enable_uart_rx(dev_idx);
 			enable_rx_retry[dev_idx] = false;
 		} else if (UART_SET_PM_STATE) {
@@ -297,11 +410,36 @@ static void enable_uart_rx(uint8_t dev_idx)
 	}
 }
 
+static void rx_resume_work_handler(struct k_work *work)
+{
+	for (int i = 0; i < UART_DEVICE_COUNT; ++i) {
+		if (!atomic_get(&rx_suspended[i])) {
+			continue;
+		}
+
+		if (subscriber_count[i] == 0) {
+			atomic_set(&rx_suspended[i], false);
+			continue;
+		}
+
+		if (k_mem_slab_num_free_get(&uart_rx_slab) == 0) {
+			/* Retried when a block is freed */
+			continue;
+		}
+
+		atomic_set(&rx_suspended[i], false);
+		LOG_DBG("UART_%d RX resumed", i);
+		enable_uart_rx(i);
+	}
+}
+
 static void disable_uart_rx(uint8_t dev_idx)
 {
 	struct device *dev = devices[dev_idx];
 	int err;
 
+	atomic_set(&rx_suspended[dev_idx], false);
+
 	err = uart_rx_disable(dev);
 	if (err) {
 		LOG_ERR("uart_rx_disable: %d", err);
@@ -494,6 +632,10 @@ static bool event_handler(const struct event_header *eh)
 				enable_rx_retry[i] = false;
 
 				atomic_set(&uart_tx_started[i], false);
+				atomic_set(&rx_stalled[i], false);
+				atomic_set(&rx_suspended[i], false);
+				k_timer_init(&rx_pending[i].timer,
+					     rx_pending_timeout, NULL);
 
 				ring_buf_init(
 					&uart_tx_ringbufs[i].rb,
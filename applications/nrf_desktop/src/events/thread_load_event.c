@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+
+#include <stdio.h>
+
+#include "thread_load_event.h"
+
+
+static int log_thread_load_event(const struct event_header *eh, char *buf,
+				 size_t buf_len)
+{
+	const struct thread_load_event *event = cast_thread_load_event(eh);
+
+	return snprintf(buf, buf_len, "thread: %p load: %03u,%03u%% switches: %u",
+			event->thread, event->load / 1000, event->load % 1000,
+			event->switches);
+}
+
+static void profile_thread_load_event(struct log_event_buf *buf,
+				      const struct event_header *eh)
+{
+	const struct thread_load_event *event = cast_thread_load_event(eh);
+
+	profiler_log_encode_u32(buf, (uint32_t)event->thread);
+	profiler_log_encode_u32(buf, event->load);
+	profiler_log_encode_u32(buf, event->switches);
+}
+
+EVENT_INFO_DEFINE(thread_load_event,
+		  ENCODE(PROFILER_ARG_U32, PROFILER_ARG_U32, PROFILER_ARG_U32),
+		  ENCODE("thread", "load", "switches"),
+		  profile_thread_load_event);
+
+EVENT_TYPE_DEFINE(thread_load_event,
+		  IS_ENABLED(CONFIG_DESKTOP_INIT_LOG_THREAD_LOAD_EVENT),
+		  log_thread_load_event,
+		  &thread_load_event_info);
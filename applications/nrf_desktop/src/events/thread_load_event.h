@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _THREAD_LOAD_EVENT_H_
+#define _THREAD_LOAD_EVENT_H_
+
+/**
+ * @brief Thread Load Event
+ * @defgroup thread_load_event Thread Load Event
+ * @{
+ */
+
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Thread load event. */
+struct thread_load_event {
+	struct event_header header; /**< Event header. */
+
+	const void *thread; /**< Thread. */
+	uint32_t load; /**< CPU load of the thread [in 0,001% units]. */
+	uint32_t switches; /**< Number of times the thread was switched in. */
+};
+
+EVENT_TYPE_DECLARE(thread_load_event);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* _THREAD_LOAD_EVENT_H_ */
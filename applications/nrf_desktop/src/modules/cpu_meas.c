@@ -11,6 +11,7 @@
 #include "module_state_event.h"
 
 #include "cpu_load_event.h"
+#include "thread_load_event.h"
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CPU_MEAS_LOG_LEVEL);
@@ -26,11 +27,27 @@ static void send_cpu_load_event(uint32_t load)
 	EVENT_SUBMIT(event);
 }
 
+static void send_thread_load_event(const struct cpu_load_thread_info *info,
+				   void *user_data)
+{
+	struct thread_load_event *event = new_thread_load_event();
+
+	event->thread = info->thread;
+	event->load = info->load;
+	event->switches = info->switches;
+	EVENT_SUBMIT(event);
+}
+
 static void cpu_load_read_fn(struct k_work *work)
 {
 	send_cpu_load_event(cpu_load_get());
 	cpu_load_reset();
 
+	if (IS_ENABLED(CONFIG_DESKTOP_CPU_MEAS_THREADS)) {
+		cpu_load_threads_foreach(send_thread_load_event, NULL);
+		cpu_load_threads_reset();
+	}
+
 	k_delayed_work_submit(&cpu_load_read,
 		K_MSEC(CONFIG_DESKTOP_CPU_MEAS_PERIOD));
 }
@@ -8,6 +8,7 @@
 
 #include <zephyr/types.h>
 #include <sys/byteorder.h>
+#include <sys/crc.h>
 #include <storage/flash_map.h>
 #include <pm_config.h>
 
@@ -30,6 +31,9 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_LOG_LEVEL);
 #define FLASH_CLEAN_VAL		UINT32_MAX
 #define FLASH_READ_CHUNK_SIZE	(FLASH_PAGE_SIZE / 8)
 
+#define DFU_START_FLAG_WINDOW	BIT(0)
+#define DFU_WINDOW_SIZE		CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_WINDOW_SIZE
+
 #define DFU_TIMEOUT			K_SECONDS(2)
 #define REBOOT_REQUEST_TIMEOUT		K_MSEC(250)
 #define BACKGROUND_FLASH_ERASE_TIMEOUT	K_SECONDS(15)
@@ -62,12 +66,23 @@ static uint32_t img_length;
 static bool device_in_use;
 static bool is_flash_area_clean;
 
+#if DFU_WINDOW_SIZE > 0
+/* In the windowed mode, data is collected here and written to flash only
+ * after the host confirms the window CRC.
+ */
+static uint8_t window_buf[DFU_WINDOW_SIZE];
+#endif
+static size_t window_len;
+static bool window_mode;
+static bool window_overflow;
+
 enum dfu_opt {
 	DFU_OPT_START,
 	DFU_OPT_DATA,
 	DFU_OPT_SYNC,
 	DFU_OPT_REBOOT,
 	DFU_OPT_FWINFO,
+	DFU_OPT_WINDOW,
 
 	DFU_OPT_COUNT
 };
@@ -77,7 +92,8 @@ const static char * const opt_descr[] = {
 	[DFU_OPT_DATA] = "data",
 	[DFU_OPT_SYNC] = "sync",
 	[DFU_OPT_REBOOT] = "reboot",
-	[DFU_OPT_FWINFO] = "fwinfo"
+	[DFU_OPT_FWINFO] = "fwinfo",
+	[DFU_OPT_WINDOW] = "window"
 };
 
 static uint8_t dfu_slot_id(void)
@@ -134,6 +150,10 @@ static void dfu_timeout_handler(struct k_work *work)
 		flash_area_close(flash_area);
 		flash_area = NULL;
 	}
+
+	/* Data of an unfinished window is sent again on restart. */
+	window_len = 0;
+	window_overflow = false;
 }
 
 static void reboot_request_handler(struct k_work *work)
@@ -204,6 +224,50 @@ static void background_erase_handler(struct k_work *work)
 	}
 }
 
+static void dfu_finish(void)
+{
+	flash_area_close(flash_area);
+	flash_area = NULL;
+	window_len = 0;
+	window_overflow = false;
+	k_delayed_work_cancel(&dfu_timeout);
+}
+
+static void handle_dfu_written(void)
+{
+	if (img_length == cur_offset) {
+		LOG_INF("DFU image written");
+#ifdef CONFIG_BOOTLOADER_MCUBOOT
+		int err = boot_request_upgrade(false);
+
+		if (err) {
+			LOG_ERR("Cannot request the DFU (%d)", err);
+		}
+#endif
+		dfu_finish();
+	} else {
+		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
+	}
+}
+
+static void window_data_store(const uint8_t *data, const size_t size)
+{
+#if DFU_WINDOW_SIZE > 0
+	/* Data past a lost or excess chunk is dropped, the window is rejected
+	 * when the host closes it.
+	 */
+	if (window_overflow ||
+	    (window_len + size > sizeof(window_buf)) ||
+	    (cur_offset + window_len + size > img_length)) {
+		window_overflow = true;
+		return;
+	}
+
+	memcpy(&window_buf[window_len], data, size);
+	window_len += size;
+#endif
+}
+
 static void handle_dfu_data(const uint8_t *data, const size_t size)
 {
 	int err;
@@ -222,38 +286,90 @@ static void handle_dfu_data(const uint8_t *data, const size_t size)
 
 	if (size == 0) {
 		LOG_WRN("Invalid DFU data header");
-		goto dfu_finish;
+		dfu_finish();
+		return;
+	}
+
+	if (window_mode) {
+		window_data_store(data, size);
+		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
+		return;
 	}
 
 	err = flash_area_write(flash_area, cur_offset, data, size);
 	if (err) {
 		LOG_ERR("Cannot write data (%d)", err);
-		goto dfu_finish;
+		dfu_finish();
+		return;
 	}
 
 	cur_offset += size;
 
 	LOG_DBG("DFU chunk written");
 
-	if (img_length == cur_offset) {
-		LOG_INF("DFU image written");
-#ifdef CONFIG_BOOTLOADER_MCUBOOT
-		err = boot_request_upgrade(false);
-		if (err) {
-			LOG_ERR("Cannot request the DFU (%d)", err);
-		}
-#endif
-		goto dfu_finish;
-	} else {
+	handle_dfu_written();
+}
+
+static void handle_dfu_window(const uint8_t *data, const size_t size)
+{
+#if DFU_WINDOW_SIZE > 0
+	uint32_t offset;
+	uint32_t length;
+	uint32_t csum;
+	size_t data_size = sizeof(offset) + sizeof(length) + sizeof(csum);
+	size_t pos = 0;
+	int err;
+
+	if (!flash_area || !window_mode) {
+		LOG_WRN("Windowed DFU was not started");
+		return;
+	}
+
+	if (size < data_size) {
+		LOG_WRN("Invalid DFU window header");
+		return;
+	}
+
+	offset = sys_get_le32(&data[pos]);
+	pos += sizeof(offset);
+
+	length = sys_get_le32(&data[pos]);
+	pos += sizeof(length);
+
+	csum = sys_get_le32(&data[pos]);
+	pos += sizeof(csum);
+
+	/* A rejected window is not acknowledged, so the host sees the
+	 * unchanged offset on sync and sends the window again.
+	 */
+	if (window_overflow || (offset != cur_offset) ||
+	    (length != window_len) ||
+	    (crc32_ieee(window_buf, window_len) != csum)) {
+		LOG_WRN("DFU window rejected offset:%" PRIu32
+			" length:%" PRIu32 " %zu",
+			offset, length, window_len);
+		window_len = 0;
+		window_overflow = false;
 		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
+		return;
 	}
 
-	return;
+	err = flash_area_write(flash_area, cur_offset, window_buf, window_len);
+	if (err) {
+		LOG_ERR("Cannot write data (%d)", err);
+		dfu_finish();
+		return;
+	}
 
-dfu_finish:
-	flash_area_close(flash_area);
-	flash_area = NULL;
-	k_delayed_work_cancel(&dfu_timeout);
+	cur_offset += window_len;
+	window_len = 0;
+
+	LOG_DBG("DFU window written cur_offset:%" PRIu32, cur_offset);
+
+	handle_dfu_written();
+#else
+	LOG_WRN("Windowed DFU not supported");
+#endif
 }
 
 static void handle_dfu_start(const uint8_t *data, const size_t size)
@@ -299,9 +415,12 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 	offset = sys_get_le32(&data[pos]);
 	pos += sizeof(offset);
 
+	/* Flags are optional, older host tools do not send them. */
+	uint8_t flags = (size > pos) ? data[pos] : 0;
+
 	LOG_INF("DFU start received img_length:%" PRIu32
-		" img_csum:0x%" PRIx32 " offset:%" PRIu32,
-		length, csum, offset);
+		" img_csum:0x%" PRIx32 " offset:%" PRIu32 " flags:0x%" PRIx8,
+		length, csum, offset, flags);
 
 	if (offset != 0) {
 		if ((offset != cur_offset) ||
@@ -351,7 +470,12 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 		flash_area = NULL;
 		dfu_unlock(MODULE_ID(MODULE));
 	} else {
-		LOG_INF("DFU started");
+		window_mode = (DFU_WINDOW_SIZE > 0) &&
+			      (flags & DFU_START_FLAG_WINDOW);
+		window_len = 0;
+		window_overflow = false;
+
+		LOG_INF("DFU started%s", window_mode ? " (windowed)" : "");
 		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
 	}
 }
@@ -362,8 +486,11 @@ static void handle_dfu_sync(uint8_t *data, size_t *size)
 
 	uint8_t dfu_active = (flash_area != NULL) ? 0x01 : 0x00;
 
+	uint16_t window_size = DFU_WINDOW_SIZE;
+
 	size_t data_size = sizeof(dfu_active) + sizeof(img_length) +
-			   sizeof(img_csum) + sizeof(cur_offset);
+			   sizeof(img_csum) + sizeof(cur_offset) +
+			   sizeof(window_size);
 
 	*size = data_size;
 
@@ -380,6 +507,10 @@ static void handle_dfu_sync(uint8_t *data, size_t *size)
 
 	sys_put_le32(cur_offset, &data[pos]);
 	pos += sizeof(cur_offset);
+
+	/* Appended to the original sync data, older host tools ignore it. */
+	sys_put_le16(window_size, &data[pos]);
+	pos += sizeof(window_size);
 }
 
 static void handle_reboot_request(uint8_t *data, size_t *size)
@@ -519,6 +650,10 @@ static void update_config(const uint8_t opt_id, const uint8_t *data,
 		handle_dfu_start(data, size);
 		break;
 
+	case DFU_OPT_WINDOW:
+		handle_dfu_window(data, size);
+		break;
+
 	default:
 		/* Ignore unknown event. */
 		LOG_WRN("Unknown DFU event");
@@ -196,12 +196,16 @@ int config_channel_transport_set(struct config_channel_transport *transport,
 	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
 
 	if (transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) {
-		LOG_WRN("Transport %p busy", transport);
+		/* Expected when the host streams data, the host retries. */
+		LOG_DBG("Transport %p busy", transport);
 		return -EBUSY;
 	}
 
 	if (transport->state == CONFIG_CHANNEL_TRANSPORT_RSP_READY) {
-		LOG_WRN("Host ignored previous response (transport: %p)",
+		/* Expected when the host streams data without fetching
+		 * responses, for example during windowed DFU.
+		 */
+		LOG_DBG("Host ignored previous response (transport: %p)",
 			transport);
 	}
 
@@ -50,6 +50,9 @@ enum slm_ftp_operation {
 	FTP_OP_DELETE,
 	FTP_OP_GET,
 	FTP_OP_PUT,
+	FTP_OP_PUTOPEN,
+	FTP_OP_PUTDATA,
+	FTP_OP_PUTCLOSE,
 	FTP_OP_MAX
 };
 
@@ -78,6 +81,9 @@ static int do_ftp_rename(void);
 static int do_ftp_delete(void);
 static int do_ftp_get(void);
 static int do_ftp_put(void);
+static int do_ftp_putopen(void);
+static int do_ftp_putdata(void);
+static int do_ftp_putclose(void);
 
 /**@brief SLM AT Command list type. */
 static ftp_op_list_t ftp_op_list[FTP_OP_MAX] = {
@@ -95,10 +101,16 @@ static ftp_op_list_t ftp_op_list[FTP_OP_MAX] = {
 	{FTP_OP_DELETE, "delete", do_ftp_delete},
 	{FTP_OP_GET, "get", do_ftp_get},
 	{FTP_OP_PUT, "put", do_ftp_put},
+	{FTP_OP_PUTOPEN, "putopen", do_ftp_putopen},
+	{FTP_OP_PUTDATA, "putdata", do_ftp_putdata},
+	{FTP_OP_PUTCLOSE, "putclose", do_ftp_putclose},
 };
 
 RING_BUF_DECLARE(ftp_data_buf, CONFIG_AT_CMD_RESPONSE_MAX_LEN / 2);
 
+/* Received file data, at most half of rsp_buf for hexadecimal conversion */
+static uint8_t ftp_get_buf[CONFIG_AT_CMD_RESPONSE_MAX_LEN / 2];
+
 /* global functions defined in different files */
 void rsp_send(const uint8_t *str, size_t len);
 
@@ -423,12 +435,13 @@ static int do_ftp_delete(void)
 	return (ret == FTP_CODE_250) ? 0 : -1;
 }
 
-/* AT#XFTP="get",<file> */
+/* AT#XFTP="get",<file>[,<offset>] */
 static int do_ftp_get(void)
 {
 	int ret;
 	char file[FTP_MAX_FILEPATH];
 	int sz_file = FTP_MAX_FILEPATH;
+	uint32_t offset = 0;
 	int param_count;
 
 	/* Parse AT command */
@@ -441,15 +454,78 @@ static int do_ftp_get(void)
 		return ret;
 	}
 	file[sz_file] = '\0';
+	if (param_count > 3) {
+		ret = at_params_int_get(&at_param_list, 3, &offset);
+		if (ret) {
+			return ret;
+		}
+	}
 
-	ring_buf_reset(&ftp_data_buf);
-	ret = ftp_get(file);
-	if (ret == FTP_CODE_226) {
-		ftp_data_send();
-		return 0;
-	} else {
+	ret = ftp_get_start(file, offset);
+	if (!FTP_PRELIMINARY_POS(ret)) {
 		return -1;
 	}
+
+	/* Forward file data as it is received, so the file size is not
+	 * limited by the buffer size
+	 */
+	do {
+		ret = ftp_get_data(ftp_get_buf, sizeof(ftp_get_buf));
+		if (ret <= 0) {
+			break;
+		}
+		if (slm_util_hex_check(ftp_get_buf, ret)) {
+			ret = slm_util_htoa(ftp_get_buf, ret, rsp_buf, ret * 2);
+			if (ret < 0) {
+				LOG_WRN("hex convert error: %d", ret);
+				break;
+			}
+			rsp_send(rsp_buf, ret);
+		} else {
+			rsp_send(ftp_get_buf, ret);
+		}
+	} while (true);
+	rsp_send("\r\n", 2);
+
+	if (ret < 0) {
+		(void)ftp_get_end();
+		return ret;
+	}
+
+	ret = ftp_get_end();
+	return (ret == FTP_CODE_226) ? 0 : -1;
+}
+
+/**@brief Send data given in the AT command parameters
+ */
+static int ftp_put_param_data(size_t index)
+{
+	int ret;
+	uint16_t type;
+	char data[NET_IPV4_MTU];
+	int size;
+
+	ret = at_params_short_get(&at_param_list, index, &type);
+	if (ret) {
+		return ret;
+	}
+	size = NET_IPV4_MTU;
+	ret = at_params_string_get(&at_param_list, index + 1, data, &size);
+	if (ret) {
+		return ret;
+	}
+	if (type == DATATYPE_HEXADECIMAL) {
+		uint8_t data_hex[size / 2];
+
+		ret = slm_util_atoh(data, size, data_hex, size / 2);
+		if (ret > 0) {
+			ret = ftp_put_data(data_hex, ret);
+		}
+	} else {
+		ret = ftp_put_data(data, size);
+	}
+
+	return ret;
 }
 
 /* AT#XFTP="put",<file>[<datatype>,<data>] */
@@ -471,34 +547,68 @@ static int do_ftp_put(void)
 	}
 	file[sz_file] = '\0';
 
-	if (param_count > 4) {
-		uint16_t type;
-		char data[NET_IPV4_MTU];
-		int size;
+	ret = ftp_put_start(file, FTP_PUT_NORMAL);
+	if (!FTP_PRELIMINARY_POS(ret)) {
+		return -1;
+	}
 
-		ret = at_params_short_get(&at_param_list, 3, &type);
+	if (param_count > 4) {
+		ret = ftp_put_param_data(3);
 		if (ret) {
+			(void)ftp_put_end();
 			return ret;
 		}
-		size = NET_IPV4_MTU;
-		ret = at_params_string_get(&at_param_list, 4, data, &size);
+	}
+
+	ret = ftp_put_end();
+	return (ret == FTP_CODE_226) ? 0 : -1;
+}
+
+/* AT#XFTP="putopen",<file>[,<append>] */
+static int do_ftp_putopen(void)
+{
+	int ret;
+	char file[FTP_MAX_FILEPATH];
+	int sz_file = FTP_MAX_FILEPATH;
+	uint16_t append = 0;
+	int param_count;
+
+	/* Parse AT command */
+	param_count = at_params_valid_count_get(&at_param_list);
+	if (param_count < 3) {
+		return -EINVAL;
+	}
+	ret = at_params_string_get(&at_param_list, 2, file, &sz_file);
+	if (ret) {
+		return ret;
+	}
+	file[sz_file] = '\0';
+	if (param_count > 3) {
+		ret = at_params_short_get(&at_param_list, 3, &append);
 		if (ret) {
 			return ret;
 		}
-		if (type == DATATYPE_HEXADECIMAL) {
-			uint8_t data_hex[size / 2];
+	}
 
-			ret = slm_util_atoh(data, size, data_hex, size / 2);
-			if (ret > 0) {
-				ret = ftp_put(file, data_hex, ret);
-			}
-		} else {
-			ret = ftp_put(file, data, size);
-		}
-	} else {
-		ret = ftp_put(file, NULL, 0);
+	ret = ftp_put_start(file, append ? FTP_PUT_APPEND : FTP_PUT_NORMAL);
+	return FTP_PRELIMINARY_POS(ret) ? 0 : -1;
+}
+
+/* AT#XFTP="putdata",<datatype>,<data> */
+static int do_ftp_putdata(void)
+{
+	if (at_params_valid_count_get(&at_param_list) < 4) {
+		return -EINVAL;
 	}
 
+	return ftp_put_param_data(2);
+}
+
+/* AT#XFTP="putclose" */
+static int do_ftp_putclose(void)
+{
+	int ret = ftp_put_end();
+
 	return (ret == FTP_CODE_226) ? 0 : -1;
 }
 
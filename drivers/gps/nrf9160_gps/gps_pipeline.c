@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <logging/log.h>
+
+#include "gps_pipeline.h"
+#include "nmea.h"
+
+LOG_MODULE_DECLARE(nrf9160_gps, CONFIG_NRF9160_GPS_LOG_LEVEL);
+
+BUILD_ASSERT((CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE &
+	      (CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE - 1)) == 0,
+	     "Frame queue size must be a power of two");
+
+#define FRAME_INDEX(i) ((i) & (CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE - 1))
+
+/* Aligned strings describing sattelite states based on flags */
+#define sv_used_str(x) ((x)?"    used":"not used")
+#define sv_unhealthy_str(x) ((x)?"not healthy":"    healthy")
+
+static void copy_pvt(struct gps_pvt *dest, nrf_gnss_pvt_data_frame_t *src)
+{
+	dest->latitude = src->latitude;
+	dest->longitude = src->longitude;
+	dest->altitude = src->altitude;
+	dest->accuracy = src->accuracy;
+	dest->speed = src->speed;
+	dest->heading = src->heading;
+	dest->datetime.year = src->datetime.year;
+	dest->datetime.month = src->datetime.month;
+	dest->datetime.day = src->datetime.day;
+	dest->datetime.hour = src->datetime.hour;
+	dest->datetime.minute = src->datetime.minute;
+	dest->datetime.seconds = src->datetime.seconds;
+	dest->datetime.ms = src->datetime.ms;
+	dest->pdop = src->pdop;
+	dest->hdop = src->hdop;
+	dest->vdop = src->vdop;
+	dest->tdop = src->tdop;
+
+	for (size_t i = 0;
+	     i < MIN(NRF_GNSS_MAX_SATELLITES, GPS_PVT_MAX_SV_COUNT); i++) {
+		dest->sv[i].sv = src->sv[i].sv;
+		dest->sv[i].cn0 = src->sv[i].cn0;
+		dest->sv[i].elevation = src->sv[i].elevation;
+		dest->sv[i].azimuth = src->sv[i].azimuth;
+		dest->sv[i].signal = src->sv[i].signal;
+	}
+}
+
+static bool is_fix(nrf_gnss_pvt_data_frame_t *pvt)
+{
+	return ((pvt->flags & NRF_GNSS_PVT_FLAG_FIX_VALID_BIT)
+		== NRF_GNSS_PVT_FLAG_FIX_VALID_BIT);
+}
+
+/**@brief Checks if GPS operation is blocked due to insufficient time windows */
+static bool has_no_time_window(nrf_gnss_pvt_data_frame_t *pvt)
+{
+	return ((pvt->flags & NRF_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME)
+		== NRF_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME);
+}
+
+/**@brief Checks if PVT frame is invalid due to missed processing deadline */
+static bool pvt_deadline_missed(nrf_gnss_pvt_data_frame_t *pvt)
+{
+	return ((pvt->flags & NRF_GNSS_PVT_FLAG_DEADLINE_MISSED)
+		== NRF_GNSS_PVT_FLAG_DEADLINE_MISSED);
+}
+
+static void print_satellite_stats(struct gps_pipeline *pipeline,
+				  nrf_gnss_data_frame_t *pvt_data)
+{
+	uint8_t  n_tracked = 0;
+	uint8_t  n_used = 0;
+	uint8_t  n_unhealthy = 0;
+
+	for (int i = 0; i < NRF_GNSS_MAX_SATELLITES; ++i) {
+		uint8_t sv = pvt_data->pvt.sv[i].sv;
+		bool used = (pvt_data->pvt.sv[i].flags &
+			     NRF_GNSS_SV_FLAG_USED_IN_FIX) ? true : false;
+		bool unhealthy = (pvt_data->pvt.sv[i].flags &
+				  NRF_GNSS_SV_FLAG_UNHEALTHY) ? true : false;
+
+		if (sv) { /* SV number 0 indicates no satellite */
+			n_tracked++;
+			if (used) {
+				n_used++;
+			}
+			if (unhealthy) {
+				n_unhealthy++;
+			}
+
+			LOG_DBG("Tracking SV %2u: %s, %s", sv,
+				sv_used_str(used),
+				sv_unhealthy_str(unhealthy));
+		}
+	}
+
+	LOG_DBG("Tracking: %d Using: %d Unhealthy: %d", n_tracked,
+							n_used,
+							n_unhealthy);
+	LOG_DBG("Seconds since last fix %lld",
+			(k_uptime_get() - pipeline->fix_timestamp) / 1000);
+}
+
+static void notify_event(struct gps_pipeline *pipeline, struct gps_event *evt)
+{
+	pipeline->handler(pipeline, evt);
+}
+
+static void process_pvt(struct gps_pipeline *pipeline, struct gps_frame *frame)
+{
+	nrf_gnss_pvt_data_frame_t *pvt = &frame->data.pvt;
+	struct gps_event evt = {0};
+
+	pipeline->has_fix = false;
+
+	if (has_no_time_window(pvt) || pvt_deadline_missed(pvt)) {
+		if (pipeline->operation_blocked) {
+			/* Avoid spamming the logs and app. */
+			return;
+		}
+
+		/* If LTE is used alongside GPS, PSM, eDRX or DRX needs to be
+		 * enabled for the GPS to operate. If PSM is used, the GPS will
+		 * normally operate when active time expires.
+		 */
+		LOG_DBG("Waiting for time window to operate");
+
+		pipeline->operation_blocked = true;
+		evt.type = GPS_EVT_OPERATION_BLOCKED;
+
+		notify_event(pipeline, &evt);
+
+		return;
+	} else if (pipeline->operation_blocked) {
+		/* GPS has been unblocked. */
+		LOG_DBG("GPS has time window to operate");
+
+		pipeline->operation_blocked = false;
+		evt.type = GPS_EVT_OPERATION_UNBLOCKED;
+
+		notify_event(pipeline, &evt);
+	}
+
+	copy_pvt(&evt.pvt, pvt);
+
+	if (is_fix(pvt)) {
+		LOG_DBG("PVT: Position fix");
+
+		evt.type = GPS_EVT_PVT_FIX;
+		pipeline->fix_timestamp = k_uptime_get();
+		pipeline->has_fix = true;
+	} else {
+		evt.type = GPS_EVT_PVT;
+	}
+
+	notify_event(pipeline, &evt);
+	print_satellite_stats(pipeline, &frame->data);
+}
+
+static void process_nmea(struct gps_pipeline *pipeline, struct gps_frame *frame)
+{
+	/* Don't count null terminator. */
+	size_t len = MIN(frame->len - 1, GPS_NMEA_SENTENCE_MAX_LENGTH);
+	struct gps_event evt = {0};
+
+	if (pipeline->operation_blocked) {
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_NRF9160_GPS_NMEA_CHECK)) {
+		enum nmea_type type = nmea_parse(frame->data.nmea, len);
+
+		if (type == NMEA_TYPE_INVALID) {
+			LOG_WRN("Invalid NMEA sentence");
+			pipeline->metrics.nmea_invalid++;
+			return;
+		}
+
+		if (!nmea_type_is_enabled(type)) {
+			pipeline->metrics.nmea_filtered++;
+			return;
+		}
+	}
+
+	memcpy(evt.nmea.buf, frame->data.nmea, len);
+	evt.nmea.len = len;
+
+	if (pipeline->has_fix) {
+		LOG_DBG("NMEA: Position fix");
+
+		evt.type = GPS_EVT_NMEA_FIX;
+	} else {
+		evt.type = GPS_EVT_NMEA;
+	}
+
+	notify_event(pipeline, &evt);
+}
+
+static void process_agps(struct gps_pipeline *pipeline, struct gps_frame *frame)
+{
+	nrf_gnss_agps_data_frame_t *agps = &frame->data.agps;
+	struct gps_event evt = {
+		.type = GPS_EVT_AGPS_DATA_NEEDED,
+	};
+
+	LOG_DBG("A-GPS data update needed");
+
+	evt.agps_request.sv_mask_ephe = agps->sv_mask_ephe;
+	evt.agps_request.sv_mask_alm = agps->sv_mask_alm;
+	evt.agps_request.utc =
+		agps->data_flags & BIT(NRF_GNSS_AGPS_GPS_UTC_REQUEST) ? 1 : 0;
+	evt.agps_request.klobuchar =
+		agps->data_flags & BIT(NRF_GNSS_AGPS_KLOBUCHAR_REQUEST) ? 1 : 0;
+	evt.agps_request.nequick =
+		agps->data_flags & BIT(NRF_GNSS_AGPS_NEQUICK_REQUEST) ? 1 : 0;
+	evt.agps_request.system_time_tow =
+		agps->data_flags &
+		BIT(NRF_GNSS_AGPS_SYS_TIME_AND_SV_TOW_REQUEST) ? 1 : 0;
+	evt.agps_request.position =
+		agps->data_flags & BIT(NRF_GNSS_AGPS_POSITION_REQUEST) ? 1 : 0;
+	evt.agps_request.integrity =
+		agps->data_flags & BIT(NRF_GNSS_AGPS_INTEGRITY_REQUEST) ? 1 : 0;
+
+	notify_event(pipeline, &evt);
+}
+
+void gps_pipeline_init(struct gps_pipeline *pipeline,
+		       gps_pipeline_handler_t handler)
+{
+	memset(pipeline, 0, sizeof(*pipeline));
+	k_sem_init(&pipeline->queued, 0, CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE);
+	pipeline->handler = handler;
+}
+
+struct gps_frame *gps_pipeline_frame_alloc(struct gps_pipeline *pipeline)
+{
+	atomic_val_t head = atomic_get(&pipeline->head);
+	atomic_val_t tail = atomic_get(&pipeline->tail);
+
+	if (head - tail >= CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE) {
+		return NULL;
+	}
+
+	return &pipeline->frames[FRAME_INDEX(head)];
+}
+
+void gps_pipeline_frame_put(struct gps_pipeline *pipeline,
+			    enum gps_frame_type type, int len)
+{
+	atomic_val_t head = atomic_get(&pipeline->head);
+	struct gps_frame *frame = &pipeline->frames[FRAME_INDEX(head)];
+	uint32_t queued = head + 1 - atomic_get(&pipeline->tail);
+
+	frame->type = type;
+	frame->len = len;
+	frame->timestamp = k_uptime_get();
+
+	if (type == GPS_FRAME_GNSS) {
+		pipeline->metrics.frames++;
+	}
+
+	if (queued > pipeline->metrics.queue_max) {
+		pipeline->metrics.queue_max = queued;
+	}
+
+	/* Publish the frame to the consumer */
+	atomic_set(&pipeline->head, head + 1);
+	k_sem_give(&pipeline->queued);
+}
+
+void gps_pipeline_frame_drop(struct gps_pipeline *pipeline,
+			     const nrf_gnss_data_frame_t *data)
+{
+	pipeline->metrics.frames++;
+	pipeline->metrics.dropped++;
+
+	LOG_WRN("GPS frame queue full, frame dropped (data ID %d)",
+		data->data_id);
+}
+
+int gps_pipeline_process(struct gps_pipeline *pipeline, k_timeout_t timeout)
+{
+	atomic_val_t tail;
+	struct gps_frame *frame;
+
+	if (k_sem_take(&pipeline->queued, timeout) != 0) {
+		return -EAGAIN;
+	}
+
+	tail = atomic_get(&pipeline->tail);
+	frame = &pipeline->frames[FRAME_INDEX(tail)];
+
+	if (k_uptime_get() - frame->timestamp >
+	    CONFIG_NRF9160_GPS_FRAME_LATE_MS) {
+		pipeline->metrics.late++;
+	}
+
+	if (frame->type == GPS_FRAME_SEARCH_STARTED) {
+		struct gps_event evt = {
+			.type = GPS_EVT_SEARCH_STARTED
+		};
+
+		notify_event(pipeline, &evt);
+	} else {
+		switch (frame->data.data_id) {
+		case NRF_GNSS_PVT_DATA_ID:
+			process_pvt(pipeline, frame);
+			break;
+		case NRF_GNSS_NMEA_DATA_ID:
+			process_nmea(pipeline, frame);
+			break;
+		case NRF_GNSS_AGPS_DATA_ID:
+			process_agps(pipeline, frame);
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* The frame can be reused by the reader only when processed. */
+	atomic_set(&pipeline->tail, tail + 1);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef GPS_PIPELINE_H__
+#define GPS_PIPELINE_H__
+
+#include <zephyr.h>
+#include <drivers/gps.h>
+#include <drivers/gps/nrf9160_gps.h>
+#include <nrf_socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* GNSS frames are received by a reader thread into a single-producer,
+ * single-consumer ring, and converted to GPS events by a consumer thread.
+ * A slow event handler therefore delays the consumer only, and frames are
+ * dropped, and counted, only when the ring is full.
+ */
+
+enum gps_frame_type {
+	/* Frame received from the GNSS socket. */
+	GPS_FRAME_GNSS,
+	/* GPS search started, queued to keep the order of events. */
+	GPS_FRAME_SEARCH_STARTED,
+};
+
+struct gps_frame {
+	enum gps_frame_type type;
+	/* Uptime when the frame was received, in milliseconds. */
+	int64_t timestamp;
+	/* Length of the received data. */
+	int len;
+	nrf_gnss_data_frame_t data;
+};
+
+struct gps_pipeline;
+
+typedef void (*gps_pipeline_handler_t)(struct gps_pipeline *pipeline,
+				       struct gps_event *evt);
+
+struct gps_pipeline {
+	struct gps_frame frames[CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE];
+	/* Free-running indexes, written by the reader and consumer. */
+	atomic_t head;
+	atomic_t tail;
+	/* Number of frames in the ring. */
+	struct k_sem queued;
+	gps_pipeline_handler_t handler;
+	struct nrf9160_gps_metrics metrics;
+	/* Consumer state */
+	bool operation_blocked;
+	bool has_fix;
+	int64_t fix_timestamp;
+};
+
+void gps_pipeline_init(struct gps_pipeline *pipeline,
+		       gps_pipeline_handler_t handler);
+
+/* Reader: get the next free frame, or NULL if the ring is full. */
+struct gps_frame *gps_pipeline_frame_alloc(struct gps_pipeline *pipeline);
+
+/* Reader: queue a frame that was received into the frame from
+ * gps_pipeline_frame_alloc().
+ */
+void gps_pipeline_frame_put(struct gps_pipeline *pipeline,
+			    enum gps_frame_type type, int len);
+
+/* Reader: count a frame that was received while the ring was full. */
+void gps_pipeline_frame_drop(struct gps_pipeline *pipeline,
+			     const nrf_gnss_data_frame_t *data);
+
+/* Consumer: convert and dispatch the oldest frame.
+ *
+ * Returns 0 when a frame was processed, -EAGAIN if no frame was queued
+ * within the timeout.
+ */
+int gps_pipeline_process(struct gps_pipeline *pipeline, k_timeout_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GPS_PIPELINE_H__ */
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include "nmea.h"
+
+/* "$", talker ID and sentence type */
+#define NMEA_ADDRESS_LEN	6
+/* "*" and two hex digits */
+#define NMEA_CHECKSUM_LEN	3
+
+static const struct {
+	const char *name;
+	enum nmea_type type;
+} nmea_types[] = {
+	{ "GGA", NMEA_TYPE_GGA },
+	{ "GLL", NMEA_TYPE_GLL },
+	{ "GSA", NMEA_TYPE_GSA },
+	{ "GSV", NMEA_TYPE_GSV },
+	{ "RMC", NMEA_TYPE_RMC },
+};
+
+static int hex_to_int(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+enum nmea_type nmea_parse(const char *buf, size_t len)
+{
+	unsigned int checksum = 0;
+	int hi, lo;
+	size_t i;
+
+	/* Line ending is optional */
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) {
+		len--;
+	}
+
+	if (len < NMEA_ADDRESS_LEN + NMEA_CHECKSUM_LEN || buf[0] != '$' ||
+	    buf[len - NMEA_CHECKSUM_LEN] != '*') {
+		return NMEA_TYPE_INVALID;
+	}
+
+	for (i = 1; i < len - NMEA_CHECKSUM_LEN; i++) {
+		if (buf[i] == '$' || buf[i] == '*') {
+			return NMEA_TYPE_INVALID;
+		}
+		checksum ^= (unsigned char)buf[i];
+	}
+
+	hi = hex_to_int(buf[len - 2]);
+	lo = hex_to_int(buf[len - 1]);
+	if (hi < 0 || lo < 0 || checksum != (unsigned int)(hi << 4 | lo)) {
+		return NMEA_TYPE_INVALID;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(nmea_types); i++) {
+		if (memcmp(&buf[3], nmea_types[i].name, 3) == 0) {
+			return nmea_types[i].type;
+		}
+	}
+
+	return NMEA_TYPE_UNKNOWN;
+}
+
+bool nmea_type_is_enabled(enum nmea_type type)
+{
+	switch (type) {
+	case NMEA_TYPE_GGA:
+		return IS_ENABLED(CONFIG_NRF9160_GPS_NMEA_GGA);
+	case NMEA_TYPE_GLL:
+		return IS_ENABLED(CONFIG_NRF9160_GPS_NMEA_GLL);
+	case NMEA_TYPE_GSA:
+		return IS_ENABLED(CONFIG_NRF9160_GPS_NMEA_GSA);
+	case NMEA_TYPE_GSV:
+		return IS_ENABLED(CONFIG_NRF9160_GPS_NMEA_GSV);
+	case NMEA_TYPE_RMC:
+		return IS_ENABLED(CONFIG_NRF9160_GPS_NMEA_RMC);
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef NMEA_H__
+#define NMEA_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum nmea_type {
+	NMEA_TYPE_INVALID = -1,
+	NMEA_TYPE_UNKNOWN,
+	NMEA_TYPE_GGA,
+	NMEA_TYPE_GLL,
+	NMEA_TYPE_GSA,
+	NMEA_TYPE_GSV,
+	NMEA_TYPE_RMC,
+};
+
+/**@brief Validate an NMEA sentence and get its type.
+ *
+ * The sentence must be on the form "$ttsss,...*hh", optionally followed by
+ * CR and LF, where tt is the talker ID, sss is the sentence type and hh is
+ * the checksum of the characters between '$' and '*'.
+ *
+ * @param buf Sentence.
+ * @param len Length of the sentence, without any null terminator.
+ *
+ * @return Sentence type, or NMEA_TYPE_INVALID if the sentence is malformed
+ *	   or the checksum does not match.
+ */
+enum nmea_type nmea_parse(const char *buf, size_t len);
+
+/**@brief Check if sentences of a type are enabled in the configuration. */
+bool nmea_type_is_enabled(enum nmea_type type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NMEA_H__ */
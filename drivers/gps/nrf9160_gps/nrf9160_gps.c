@@ -22,6 +22,8 @@
 #endif
 #include <modem/bsdlib.h>
 
+#include "gps_pipeline.h"
+
 LOG_MODULE_REGISTER(nrf9160_gps, CONFIG_NRF9160_GPS_LOG_LEVEL);
 
 #ifdef CONFIG_NRF9160_GPS_HANDLE_MODEM_CONFIGURATION
@@ -38,10 +40,6 @@ LOG_MODULE_REGISTER(nrf9160_gps, CONFIG_NRF9160_GPS_LOG_LEVEL);
 #define FUNCTIONAL_MODE_ENABLED		1
 #endif
 
-/* Aligned strings describing sattelite states based on flags */
-#define sv_used_str(x) ((x)?"    used":"not used")
-#define sv_unhealthy_str(x) ((x)?"not healthy":"    healthy")
-
 struct gps_drv_data {
 	struct device *dev;
 	gps_event_handler_t handler;
@@ -54,7 +52,14 @@ struct gps_drv_data {
 			      CONFIG_NRF9160_GPS_THREAD_STACK_SIZE);
 	struct k_thread thread;
 	k_tid_t thread_id;
+	K_THREAD_STACK_MEMBER(reader_thread_stack,
+			      CONFIG_NRF9160_GPS_READER_THREAD_STACK_SIZE);
+	struct k_thread reader_thread;
+	k_tid_t reader_thread_id;
 	struct k_sem thread_run_sem;
+	struct gps_pipeline pipeline;
+	/* Frame received while the pipeline is full */
+	nrf_gnss_data_frame_t dropped_frame;
 	struct k_delayed_work start_work;
 	struct k_delayed_work stop_work;
 	struct k_delayed_work timeout_work;
@@ -71,8 +76,6 @@ struct nrf9160_gps_config {
 
 static int stop_gps(struct device *dev, bool is_timeout);
 
-static uint64_t fix_timestamp;
-
 static nrf_gnss_agps_data_type_t type_lookup_gps2socket[] = {
 	[GPS_AGPS_UTC_PARAMETERS]	= NRF_GNSS_AGPS_UTC_PARAMETERS,
 	[GPS_AGPS_EPHEMERIDES]		= NRF_GNSS_AGPS_EPHEMERIDES,
@@ -87,91 +90,6 @@ static nrf_gnss_agps_data_type_t type_lookup_gps2socket[] = {
 	[GPS_AGPS_INTEGRITY]		= NRF_GNSS_AGPS_INTEGRITY,
 };
 
-static void copy_pvt(struct gps_pvt *dest, nrf_gnss_pvt_data_frame_t *src)
-{
-	dest->latitude = src->latitude;
-	dest->longitude = src->longitude;
-	dest->altitude = src->altitude;
-	dest->accuracy = src->accuracy;
-	dest->speed = src->speed;
-	dest->heading = src->heading;
-	dest->datetime.year = src->datetime.year;
-	dest->datetime.month = src->datetime.month;
-	dest->datetime.day = src->datetime.day;
-	dest->datetime.hour = src->datetime.hour;
-	dest->datetime.minute = src->datetime.minute;
-	dest->datetime.seconds = src->datetime.seconds;
-	dest->datetime.ms = src->datetime.ms;
-	dest->pdop = src->pdop;
-	dest->hdop = src->hdop;
-	dest->vdop = src->vdop;
-	dest->tdop = src->tdop;
-
-	for (size_t i = 0;
-	     i < MIN(NRF_GNSS_MAX_SATELLITES, GPS_PVT_MAX_SV_COUNT); i++) {
-		dest->sv[i].sv = src->sv[i].sv;
-		dest->sv[i].cn0 = src->sv[i].cn0;
-		dest->sv[i].elevation = src->sv[i].elevation;
-		dest->sv[i].azimuth = src->sv[i].azimuth;
-		dest->sv[i].signal = src->sv[i].signal;
-	}
-}
-
-static bool is_fix(nrf_gnss_pvt_data_frame_t *pvt)
-{
-	return ((pvt->flags & NRF_GNSS_PVT_FLAG_FIX_VALID_BIT)
-		== NRF_GNSS_PVT_FLAG_FIX_VALID_BIT);
-}
-
-/**@brief Checks if GPS operation is blocked due to insufficient time windows */
-static bool has_no_time_window(nrf_gnss_pvt_data_frame_t *pvt)
-{
-	return ((pvt->flags & NRF_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME)
-		== NRF_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME);
-}
-
-/**@brief Checks if PVT frame is invalid due to missed processing deadline */
-static bool pvt_deadline_missed(nrf_gnss_pvt_data_frame_t *pvt)
-{
-	return ((pvt->flags & NRF_GNSS_PVT_FLAG_DEADLINE_MISSED)
-		== NRF_GNSS_PVT_FLAG_DEADLINE_MISSED);
-}
-
-static void print_satellite_stats(nrf_gnss_data_frame_t *pvt_data)
-{
-	uint8_t  n_tracked = 0;
-	uint8_t  n_used = 0;
-	uint8_t  n_unhealthy = 0;
-
-	for (int i = 0; i < NRF_GNSS_MAX_SATELLITES; ++i) {
-		uint8_t sv = pvt_data->pvt.sv[i].sv;
-		bool used = (pvt_data->pvt.sv[i].flags &
-			     NRF_GNSS_SV_FLAG_USED_IN_FIX) ? true : false;
-		bool unhealthy = (pvt_data->pvt.sv[i].flags &
-				  NRF_GNSS_SV_FLAG_UNHEALTHY) ? true : false;
-
-		if (sv) { /* SV number 0 indicates no satellite */
-			n_tracked++;
-			if (used) {
-				n_used++;
-			}
-			if (unhealthy) {
-				n_unhealthy++;
-			}
-
-			LOG_DBG("Tracking SV %2u: %s, %s", sv,
-				sv_used_str(used),
-				sv_unhealthy_str(unhealthy));
-		}
-	}
-
-	LOG_DBG("Tracking: %d Using: %d Unhealthy: %d", n_tracked,
-							n_used,
-							n_unhealthy);
-	LOG_DBG("Seconds since last fix %lld",
-			(k_uptime_get() - fix_timestamp) / 1000);
-}
-
 static void notify_event(struct device *dev, struct gps_event *evt)
 {
 	struct gps_drv_data *drv_data = dev->data;
@@ -216,28 +134,35 @@ static int open_socket(struct gps_drv_data *drv_data)
 	return 0;
 }
 
-static void gps_thread(int dev_ptr)
+/* Receives frames from the GNSS socket into the pipeline. Only as much work as
+ * needed to keep up with the socket is done here, conversion and dispatching
+ * of events is done by gps_thread.
+ */
+static void reader_thread(int dev_ptr)
 {
 	struct device *dev = INT_TO_POINTER(dev_ptr);
 	struct gps_drv_data *drv_data = dev->data;
+	struct gps_pipeline *pipeline = &drv_data->pipeline;
+	struct gps_frame *frame;
+	nrf_gnss_data_frame_t *data;
 	int len;
-	bool operation_blocked = false;
-	bool has_fix = false;
-	struct gps_event evt = {
-		.type = GPS_EVT_SEARCH_STARTED
-	};
 
 wait:
 	k_sem_take(&drv_data->thread_run_sem, K_FOREVER);
 
-	notify_event(dev, &evt);
+	/* Queued to be dispatched before any of the received frames. */
+	if (gps_pipeline_frame_alloc(pipeline) != NULL) {
+		gps_pipeline_frame_put(pipeline, GPS_FRAME_SEARCH_STARTED, 0);
+	} else {
+		LOG_WRN("GPS frame queue full, search start not notified");
+	}
 
 	while (true) {
-		nrf_gnss_data_frame_t raw_gps_data = {0};
-		struct gps_event evt = {0};
+		frame = gps_pipeline_frame_alloc(pipeline);
+		data = frame ? &frame->data : &drv_data->dropped_frame;
 
-		len = nrf_recv(drv_data->socket, &raw_gps_data,
-			   sizeof(nrf_gnss_data_frame_t), 0);
+		len = nrf_recv(drv_data->socket, data,
+			       sizeof(nrf_gnss_data_frame_t), 0);
 		if (len <= 0) {
 			/* Is the GPS stopped, causing this error? */
 			if (!atomic_get(&drv_data->is_active)) {
@@ -270,110 +195,37 @@ wait:
 			continue;
 		}
 
-		switch (raw_gps_data.data_id) {
-		case NRF_GNSS_PVT_DATA_ID:
-			has_fix = false;
-
-			if (has_no_time_window(&raw_gps_data.pvt) ||
-			    pvt_deadline_missed(&raw_gps_data.pvt)) {
-				if (operation_blocked) {
-					/* Avoid spamming the logs and app. */
-					continue;
-				}
-
-				/* If LTE is used alongside GPS, PSM, eDRX or
-				 * DRX needs to be enabled for the GPS to
-				 * operate. If PSM is used, the GPS will
-				 * normally operate when active time expires.
-				 */
-				LOG_DBG("Waiting for time window to operate");
-
-				operation_blocked = true;
-				evt.type = GPS_EVT_OPERATION_BLOCKED;
-
-				notify_event(dev, &evt);
-
-				continue;
-			} else if (operation_blocked) {
-				/* GPS has been unblocked. */
-				LOG_DBG("GPS has time window to operate");
-
-				operation_blocked = false;
-				evt.type = GPS_EVT_OPERATION_UNBLOCKED;
-
-				notify_event(dev, &evt);
-			}
-
-			copy_pvt(&evt.pvt, &raw_gps_data.pvt);
-
-			if (is_fix(&raw_gps_data.pvt)) {
-				LOG_DBG("PVT: Position fix");
-
-				evt.type = GPS_EVT_PVT_FIX;
-				fix_timestamp = k_uptime_get();
-				has_fix = true;
-				on_fix(dev);
-			} else {
-				evt.type = GPS_EVT_PVT;
-			}
-
-			notify_event(dev, &evt);
-			print_satellite_stats(&raw_gps_data);
+		if (frame == NULL) {
+			gps_pipeline_frame_drop(pipeline, data);
+			continue;
+		}
 
-			break;
-		case NRF_GNSS_NMEA_DATA_ID:
-			if (operation_blocked) {
-				continue;
-			}
+		gps_pipeline_frame_put(pipeline, GPS_FRAME_GNSS, len);
+	}
+}
 
-			memcpy(evt.nmea.buf, raw_gps_data.nmea, len);
+static void pipeline_handler(struct gps_pipeline *pipeline,
+			     struct gps_event *evt)
+{
+	struct gps_drv_data *drv_data =
+		CONTAINER_OF(pipeline, struct gps_drv_data, pipeline);
+	struct device *dev = drv_data->dev;
 
-			/* Don't count null terminator. */
-			evt.nmea.len = len - 1;
+	if (evt->type == GPS_EVT_PVT_FIX) {
+		on_fix(dev);
+	}
 
-			if (has_fix) {
-				LOG_DBG("NMEA: Position fix");
+	notify_event(dev, evt);
+}
 
-				evt.type = GPS_EVT_NMEA_FIX;
-			} else {
-				evt.type = GPS_EVT_NMEA;
-			}
+/* Converts the received frames to events and dispatches them. */
+static void gps_thread(int dev_ptr)
+{
+	struct device *dev = INT_TO_POINTER(dev_ptr);
+	struct gps_drv_data *drv_data = dev->data;
 
-			notify_event(dev, &evt);
-			break;
-		case NRF_GNSS_AGPS_DATA_ID:
-			LOG_DBG("A-GPS data update needed");
-
-			evt.type = GPS_EVT_AGPS_DATA_NEEDED;
-			evt.agps_request.sv_mask_ephe =
-				raw_gps_data.agps.sv_mask_ephe;
-			evt.agps_request.sv_mask_alm =
-				raw_gps_data.agps.sv_mask_alm;
-			evt.agps_request.utc =
-				raw_gps_data.agps.data_flags &
-				BIT(NRF_GNSS_AGPS_GPS_UTC_REQUEST) ? 1 : 0;
-			evt.agps_request.klobuchar =
-				raw_gps_data.agps.data_flags &
-				BIT(NRF_GNSS_AGPS_KLOBUCHAR_REQUEST) ? 1 : 0;
-			evt.agps_request.nequick =
-				raw_gps_data.agps.data_flags &
-				BIT(NRF_GNSS_AGPS_NEQUICK_REQUEST) ? 1 : 0;
-			evt.agps_request.system_time_tow =
-				raw_gps_data.agps.data_flags &
-				BIT(NRF_GNSS_AGPS_SYS_TIME_AND_SV_TOW_REQUEST) ?
-				1 : 0;
-			evt.agps_request.position =
-				raw_gps_data.agps.data_flags &
-				BIT(NRF_GNSS_AGPS_POSITION_REQUEST) ? 1 : 0;
-			evt.agps_request.integrity =
-				raw_gps_data.agps.data_flags &
-				BIT(NRF_GNSS_AGPS_INTEGRITY_REQUEST) ? 1 : 0;
-
-			notify_event(dev, &evt);
-			continue;
-		default:
-			continue;
-		}
+	while (true) {
+		gps_pipeline_process(&drv_data->pipeline, K_FOREVER);
 	}
 }
 
@@ -388,6 +240,14 @@ static int init_thread(struct device *dev)
 			K_PRIO_PREEMPT(CONFIG_NRF9160_GPS_THREAD_PRIORITY),
 			0, K_NO_WAIT);
 
+	drv_data->reader_thread_id = k_thread_create(
+			&drv_data->reader_thread, drv_data->reader_thread_stack,
+			K_THREAD_STACK_SIZEOF(drv_data->reader_thread_stack),
+			(k_thread_entry_t)reader_thread, dev, NULL, NULL,
+			K_PRIO_PREEMPT(
+				CONFIG_NRF9160_GPS_READER_THREAD_PRIORITY),
+			0, K_NO_WAIT);
+
 	return 0;
 }
 
@@ -864,6 +724,7 @@ static int init(struct device *dev, gps_event_handler_t handler)
 	k_delayed_work_init(&drv_data->stop_work, stop_work_fn);
 	k_delayed_work_init(&drv_data->timeout_work, timeout_work_fn);
 	k_sem_init(&drv_data->thread_run_sem, 0, 1);
+	gps_pipeline_init(&drv_data->pipeline, pipeline_handler);
 
 	err = init_thread(dev);
 	if (err) {
@@ -877,6 +738,13 @@ static int init(struct device *dev, gps_event_handler_t handler)
 	return 0;
 }
 
+void nrf9160_gps_metrics_get(struct device *dev,
+			     struct nrf9160_gps_metrics *metrics)
+{
+	struct gps_drv_data *drv_data = dev->data;
+
+	memcpy(metrics, &drv_data->pipeline.metrics, sizeof(*metrics));
+}
 
 static struct gps_drv_data gps_drv_data;
 
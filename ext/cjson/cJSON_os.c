@@ -11,11 +11,66 @@
 
 static cJSON_Hooks _cjson_hooks;
 
+/* Arenas that pointers passed to the free hook may belong to. */
+static sys_slist_t arenas;
+/* Arena used by the malloc hook, and the thread it is used for. */
+static struct cJSON_Arena *active_arena;
+static k_tid_t active_thread;
+static bool active_exhausted;
+static K_MUTEX_DEFINE(arena_mutex);
+
+static void *arena_alloc(struct cJSON_Arena *arena, size_t sz)
+{
+	uintptr_t next = (uintptr_t)&arena->buf[arena->used];
+	size_t pad = ROUND_UP(next, sizeof(double)) - next;
+
+	if ((arena->used + pad > arena->size) ||
+	    (sz > arena->size - arena->used - pad)) {
+		active_exhausted = true;
+		return NULL;
+	}
+
+	next += pad;
+	arena->used += pad + sz;
+	arena->high_water = MAX(arena->high_water, arena->used);
+
+	return (void *)next;
+}
+
+static bool arena_owns(const void *ptr)
+{
+	struct cJSON_Arena *arena;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&arenas, arena, node) {
+		if (((const uint8_t *)ptr >= arena->buf) &&
+		    ((const uint8_t *)ptr < &arena->buf[arena->size])) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /**@brief malloc() function definition. */
-static void *malloc_fn_hook(size_t sz) { return k_malloc(sz); }
+static void *malloc_fn_hook(size_t sz)
+{
+	if ((active_arena != NULL) && (active_thread == k_current_get())) {
+		return arena_alloc(active_arena, sz);
+	}
+
+	return k_malloc(sz);
+}
 
 /**@brief free() function definition. */
-static void free_fn_hook(void *p_ptr) { k_free(p_ptr); }
+static void free_fn_hook(void *p_ptr)
+{
+	/* Arena memory is released all at once by cJSON_ArenaReset(). */
+	if (arena_owns(p_ptr)) {
+		return;
+	}
+
+	k_free(p_ptr);
+}
 
 /**@brief Initialize cJSON by assigning function hooks. */
 void cJSON_Init(void)
@@ -30,3 +85,59 @@ void cJSON_FreeString(char *ptr)
 {
 	free_fn_hook(ptr);
 }
+
+void cJSON_ArenaInit(struct cJSON_Arena *arena, void *buf, size_t size)
+{
+	__ASSERT_NO_MSG(arena != NULL);
+	__ASSERT_NO_MSG(buf != NULL);
+
+	k_mutex_lock(&arena_mutex, K_FOREVER);
+
+	/* Allow re-initialization without adding the arena twice. */
+	sys_slist_find_and_remove(&arenas, &arena->node);
+
+	arena->buf = buf;
+	arena->size = size;
+	arena->used = 0;
+	arena->high_water = 0;
+
+	sys_slist_append(&arenas, &arena->node);
+
+	k_mutex_unlock(&arena_mutex);
+}
+
+cJSON *cJSON_ArenaParse(struct cJSON_Arena *arena, const char *value)
+{
+	cJSON *root;
+	bool exhausted;
+
+	__ASSERT_NO_MSG(arena != NULL);
+
+	k_mutex_lock(&arena_mutex, K_FOREVER);
+
+	active_arena = arena;
+	active_thread = k_current_get();
+	active_exhausted = false;
+
+	root = cJSON_Parse(value);
+
+	exhausted = active_exhausted;
+	active_arena = NULL;
+	active_thread = NULL;
+
+	k_mutex_unlock(&arena_mutex);
+
+	if ((root == NULL) && exhausted) {
+		cJSON_ArenaReset(arena);
+		root = cJSON_Parse(value);
+	}
+
+	return root;
+}
+
+void cJSON_ArenaReset(struct cJSON_Arena *arena)
+{
+	__ASSERT_NO_MSG(arena != NULL);
+
+	arena->used = 0;
+}
@@ -8,6 +8,9 @@
 #define cJSON_OS_H__
 
 #include <stdint.h>
+#include <stddef.h>
+#include <sys/slist.h>
+#include "cJSON.h"
 
 /**
  * @brief Initialize cJSON with OS hooks.
@@ -21,4 +24,95 @@ void cJSON_Init(void);
  */
 void cJSON_FreeString(char *ptr);
 
+/**
+ * @brief Bump allocator that a whole parsed tree is allocated from.
+ *
+ * Parsing into an arena replaces one heap allocation per node with a pointer
+ * increment, and releasing the tree is a single reset. Nodes allocated from
+ * an arena are ignored by cJSON_Delete(), so code that deletes the tree or
+ * detached parts of it works unchanged.
+ *
+ * The members are internal and must not be accessed directly, except for
+ * reading @c high_water.
+ */
+struct cJSON_Arena {
+	sys_snode_t node;
+	uint8_t *buf;
+	size_t size;
+	size_t used;
+	/** Largest number of bytes used since the arena was initialized. */
+	size_t high_water;
+};
+
+/**
+ * @brief Initialize an arena and make it known to the cJSON hooks.
+ *
+ * @param arena IN -- arena to initialize
+ * @param buf IN -- memory to allocate from, must stay valid as long as the
+ *                  arena is used
+ * @param size IN -- size of the memory
+ */
+void cJSON_ArenaInit(struct cJSON_Arena *arena, void *buf, size_t size);
+
+/**
+ * @brief Parse a null-terminated JSON string into an arena.
+ *
+ * If the arena is too small for the document, the arena is reset and the
+ * document is parsed on the heap instead, so the result can always be
+ * released with cJSON_Delete() followed by cJSON_ArenaReset().
+ *
+ * Only the calling thread allocates from the arena during the parse.
+ * An arena must not be used by several threads at the same time.
+ *
+ * @return parsed tree, or NULL if the input is not valid JSON
+ * @param arena IN -- arena to allocate from
+ * @param value IN -- JSON string
+ */
+cJSON *cJSON_ArenaParse(struct cJSON_Arena *arena, const char *value);
+
+/**
+ * @brief Release everything allocated from an arena.
+ *
+ * Any tree parsed into the arena must not be used afterwards.
+ *
+ * @param arena IN -- arena to reset
+ */
+void cJSON_ArenaReset(struct cJSON_Arena *arena);
+
+/**
+ * @brief One value to extract with cJSON_Query().
+ */
+struct cJSON_QueryItem {
+	/** Dot-separated path of object keys, for example "state.config". */
+	const char *path;
+	/** cJSON type of the value found, or cJSON_Invalid if not found. */
+	int type;
+	/** Start of the value in the input. Strings are returned without the
+	 *  quotes and without unescaping. Objects and arrays are returned as
+	 *  the raw JSON text.
+	 */
+	const char *value;
+	/** Length of the value in the input. */
+	size_t value_len;
+};
+
+/**
+ * @brief Extract values from a JSON document without building a tree.
+ *
+ * The document is scanned once, and the value at each of the requested paths
+ * is located in place. No memory is allocated. Keys are compared without
+ * unescaping, and ignoring ASCII case like cJSON_GetObjectItem(). Values
+ * inside arrays can not be addressed. The contents of objects and arrays
+ * nested deeper than CONFIG_CJSON_QUERY_MAX_DEPTH are skipped: they can not
+ * be addressed, and only their strings and brackets are validated.
+ *
+ * @return number of items found, or -EINVAL if the input is not valid JSON
+ * @param json IN -- JSON document, does not need to be null-terminated
+ * @param len IN -- length of the document
+ * @param items IN/OUT -- paths to look for, and the values found
+ * @param count IN -- number of items
+ */
+int cJSON_Query(const char *json, size_t len,
+		struct cJSON_QueryItem *items, size_t count);
+
 #endif /* cJSON_OS_H__ */
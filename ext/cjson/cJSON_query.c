@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include "cJSON_os.h"
+#include "cJSON.h"
+#include <string.h>
+#include <stdbool.h>
+#include <zephyr.h>
+
+/* Key of one level of the current position, NULL for array elements. */
+struct segment {
+	const char *key;
+	size_t len;
+};
+
+struct scanner {
+	const char *pos;
+	const char *end;
+	struct cJSON_QueryItem *items;
+	size_t count;
+	size_t found;
+	struct segment path[CONFIG_CJSON_QUERY_MAX_DEPTH];
+};
+
+static int scan_value(struct scanner *s, size_t depth);
+
+static void skip_whitespace(struct scanner *s)
+{
+	while ((s->pos < s->end) &&
+	       ((*s->pos == ' ') || (*s->pos == '\t') ||
+		(*s->pos == '\n') || (*s->pos == '\r'))) {
+		s->pos++;
+	}
+}
+
+static bool consume(struct scanner *s, char c)
+{
+	skip_whitespace(s);
+
+	if ((s->pos < s->end) && (*s->pos == c)) {
+		s->pos++;
+		return true;
+	}
+
+	return false;
+}
+
+/* Keys are compared like cJSON_GetObjectItem() does, ignoring ASCII case. */
+static bool key_equal(const char *a, const char *b, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		char ca = a[i];
+		char cb = b[i];
+
+		if ((ca >= 'A') && (ca <= 'Z')) {
+			ca += 'a' - 'A';
+		}
+
+		if ((cb >= 'A') && (cb <= 'Z')) {
+			cb += 'a' - 'A';
+		}
+
+		if (ca != cb) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool path_matches(const char *path, const struct segment *segments,
+			 size_t depth)
+{
+	bool more = false;
+
+	for (size_t i = 0; i < depth; i++) {
+		const char *dot;
+		size_t len;
+
+		if ((segments[i].key == NULL) || (*path == '\0')) {
+			return false;
+		}
+
+		dot = strchr(path, '.');
+		len = dot ? (size_t)(dot - path) : strlen(path);
+
+		if ((len != segments[i].len) ||
+		    !key_equal(path, segments[i].key, len)) {
+			return false;
+		}
+
+		more = (dot != NULL);
+		path += len + (more ? 1 : 0);
+	}
+
+	return !more && (*path == '\0');
+}
+
+static void match(struct scanner *s, size_t depth, int type,
+		  const char *value, size_t value_len)
+{
+	for (size_t i = 0; i < s->count; i++) {
+		struct cJSON_QueryItem *item = &s->items[i];
+
+		/* The first occurrence of a duplicate key wins. */
+		if ((item->type != cJSON_Invalid) ||
+		    !path_matches(item->path, s->path, depth)) {
+			continue;
+		}
+
+		item->type = type;
+		item->value = value;
+		item->value_len = value_len;
+		s->found++;
+	}
+}
+
+/* Scan a string, leaving its contents, without quotes, in start and len. */
+static int scan_string(struct scanner *s, const char **start, size_t *len)
+{
+	if (!consume(s, '"')) {
+		return -EINVAL;
+	}
+
+	*start = s->pos;
+
+	while (s->pos < s->end) {
+		unsigned char c = (unsigned char)*s->pos;
+
+		if (c == '"') {
+			*len = s->pos - *start;
+			s->pos++;
+			return 0;
+		}
+
+		if (c < 0x20) {
+			return -EINVAL;
+		}
+
+		/* The escaped character can not end the string. */
+		s->pos += (c == '\\') ? 2 : 1;
+	}
+
+	return -EINVAL;
+}
+
+static int scan_literal(struct scanner *s, const char *literal)
+{
+	size_t len = strlen(literal);
+
+	if (((size_t)(s->end - s->pos) < len) ||
+	    (memcmp(s->pos, literal, len) != 0)) {
+		return -EINVAL;
+	}
+
+	s->pos += len;
+
+	return 0;
+}
+
+/* Skip digits, returning the number of digits skipped. */
+static size_t scan_digits(struct scanner *s)
+{
+	const char *start = s->pos;
+
+	while ((s->pos < s->end) && (*s->pos >= '0') && (*s->pos <= '9')) {
+		s->pos++;
+	}
+
+	return s->pos - start;
+}
+
+/* Scan a number as defined in RFC 8259 section 6:
+ * [ minus ] int [ frac ] [ exp ]
+ */
+static int scan_number(struct scanner *s)
+{
+	const char *start;
+
+	if ((s->pos < s->end) && (*s->pos == '-')) {
+		s->pos++;
+	}
+
+	start = s->pos;
+	if (scan_digits(s) == 0) {
+		return -EINVAL;
+	}
+
+	/* No leading zeros */
+	if ((*start == '0') && (s->pos - start > 1)) {
+		return -EINVAL;
+	}
+
+	if ((s->pos < s->end) && (*s->pos == '.')) {
+		s->pos++;
+
+		if (scan_digits(s) == 0) {
+			return -EINVAL;
+		}
+	}
+
+	if ((s->pos < s->end) && ((*s->pos == 'e') || (*s->pos == 'E'))) {
+		s->pos++;
+
+		if ((s->pos < s->end) &&
+		    ((*s->pos == '+') || (*s->pos == '-'))) {
+			s->pos++;
+		}
+
+		if (scan_digits(s) == 0) {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* Skip the contents of a container nested too deep to be addressed.
+ *
+ * This is done without recursion, so only the strings and the balance of
+ * the brackets are checked.
+ */
+static int skip_container(struct scanner *s)
+{
+	size_t nesting = 1;
+	const char *start;
+	size_t len;
+	int err;
+
+	while (s->pos < s->end) {
+		char c = *s->pos;
+
+		if (c == '"') {
+			err = scan_string(s, &start, &len);
+			if (err) {
+				return err;
+			}
+
+			continue;
+		}
+
+		s->pos++;
+
+		if ((c == '{') || (c == '[')) {
+			nesting++;
+		} else if (((c == '}') || (c == ']')) && (--nesting == 0)) {
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int scan_container(struct scanner *s, size_t depth, bool object)
+{
+	char close = object ? '}' : ']';
+	int err;
+
+	if (consume(s, close)) {
+		return 0;
+	}
+
+	if (depth >= CONFIG_CJSON_QUERY_MAX_DEPTH) {
+		return skip_container(s);
+	}
+
+	do {
+		struct segment *segment = &s->path[depth];
+
+		segment->key = NULL;
+		segment->len = 0;
+
+		if (object) {
+			err = scan_string(s, &segment->key, &segment->len);
+			if (err) {
+				return err;
+			}
+
+			if (!consume(s, ':')) {
+				return -EINVAL;
+			}
+		}
+
+		err = scan_value(s, depth + 1);
+		if (err) {
+			return err;
+		}
+	} while (consume(s, ','));
+
+	return consume(s, close) ? 0 : -EINVAL;
+}
+
+static int scan_value(struct scanner *s, size_t depth)
+{
+	const char *start;
+	size_t len;
+	int type;
+	int err;
+
+	skip_whitespace(s);
+
+	if (s->pos >= s->end) {
+		return -EINVAL;
+	}
+
+	start = s->pos;
+
+	switch (*s->pos) {
+	case '"':
+		err = scan_string(s, &start, &len);
+		if (err) {
+			return err;
+		}
+
+		match(s, depth, cJSON_String, start, len);
+		return 0;
+	case '{':
+	case '[':
+		type = (*s->pos == '{') ? cJSON_Object : cJSON_Array;
+		s->pos++;
+		err = scan_container(s, depth, type == cJSON_Object);
+		break;
+	case 't':
+		type = cJSON_True;
+		err = scan_literal(s, "true");
+		break;
+	case 'f':
+		type = cJSON_False;
+		err = scan_literal(s, "false");
+		break;
+	case 'n':
+		type = cJSON_NULL;
+		err = scan_literal(s, "null");
+		break;
+	default:
+		type = cJSON_Number;
+		err = scan_number(s);
+		break;
+	}
+
+	if (err) {
+		return err;
+	}
+
+	match(s, depth, type, start, s->pos - start);
+
+	return 0;
+}
+
+int cJSON_Query(const char *json, size_t len,
+		struct cJSON_QueryItem *items, size_t count)
+{
+	struct scanner s = {
+		.pos = json,
+		.end = json + len,
+		.items = items,
+		.count = count,
+	};
+	int err;
+
+	__ASSERT_NO_MSG(json != NULL);
+	__ASSERT_NO_MSG((items != NULL) || (count == 0));
+
+	for (size_t i = 0; i < count; i++) {
+		items[i].type = cJSON_Invalid;
+		items[i].value = NULL;
+		items[i].value_len = 0;
+	}
+
+	err = scan_value(&s, 0);
+	if (err) {
+		return err;
+	}
+
+	/* Only whitespace, or a null-terminator, may follow the document. */
+	skip_whitespace(&s);
+	if ((s.pos < s.end) && (*s.pos != '\0')) {
+		return -EINVAL;
+	}
+
+	return s.found;
+}
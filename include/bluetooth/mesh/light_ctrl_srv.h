@@ -117,12 +117,18 @@ struct bt_mesh_light_ctrl_srv_reg_cfg {
 	uint8_t accuracy;
 };
 
+/** Light Lightness Control property value. */
+struct bt_mesh_light_ctrl_prop_val {
+	/** Property ID. */
+	enum bt_mesh_light_ctrl_prop id;
+	/** Property value. */
+	struct sensor_value val;
+};
+
 /** Illumination regulator */
 struct bt_mesh_light_ctrl_srv_reg {
-	/** Regulator step timer */
-	struct k_delayed_work timer;
-	/** Internal integral sum. */
-	uint16_t i;
+	/** Index of the regulator instance */
+	uint8_t idx;
 	/** Regulator configuration */
 	struct bt_mesh_light_ctrl_srv_reg_cfg cfg;
 };
@@ -158,6 +164,8 @@ struct bt_mesh_light_ctrl_srv {
 	struct k_delayed_work action_delay;
 	/** Configuration parameters */
 	struct bt_mesh_light_ctrl_srv_cfg cfg;
+	/** Properties pending storage */
+	atomic_t props_dirty;
 	/** Publish parameters */
 	struct bt_mesh_model_pub pub;
 	/** Setup model publish parameters */
@@ -245,6 +253,40 @@ int bt_mesh_light_ctrl_srv_disable(struct bt_mesh_light_ctrl_srv *srv);
  */
 bool bt_mesh_light_ctrl_srv_is_on(struct bt_mesh_light_ctrl_srv *srv);
 
+/** @brief Get the values of a set of Light Lightness Control properties.
+ *
+ *  @param[in]     srv   Light Lightness Control Server instance.
+ *  @param[in,out] props Properties to get. The value of each property is
+ *                       filled in.
+ *  @param[in]     count Number of properties.
+ *
+ *  @retval 0       Successfully got all the property values.
+ *  @retval -ENOENT One of the property IDs is not a Light Lightness Control
+ *                  property.
+ */
+int bt_mesh_light_ctrl_srv_prop_get(struct bt_mesh_light_ctrl_srv *srv,
+				    struct bt_mesh_light_ctrl_prop_val *props,
+				    size_t count);
+
+/** @brief Set the values of a set of Light Lightness Control properties.
+ *
+ *  Either all or none of the properties are set. A status message is
+ *  published for each changed property, and the changed properties are
+ *  stored together.
+ *
+ *  @param[in] srv   Light Lightness Control Server instance.
+ *  @param[in] props Properties to set.
+ *  @param[in] count Number of properties.
+ *
+ *  @retval 0       Successfully set all the property values.
+ *  @retval -ENOENT One of the property IDs is not a Light Lightness Control
+ *                  property.
+ *  @retval -EINVAL One of the values is out of range for its property.
+ */
+int bt_mesh_light_ctrl_srv_prop_set(
+	struct bt_mesh_light_ctrl_srv *srv,
+	const struct bt_mesh_light_ctrl_prop_val *props, size_t count);
+
 /** @brief Publish the current OnOff state.
  *
  *  @param[in] srv Light Lightness Control Server instance.
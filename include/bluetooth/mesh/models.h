@@ -10,6 +10,7 @@
 #include <bluetooth/mesh.h>
 
 #include <bluetooth/mesh/model_types.h>
+#include <bluetooth/mesh/transition.h>
 
 /* Foundation models */
 #include <bluetooth/mesh/cfg_cli.h>
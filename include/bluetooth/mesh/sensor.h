@@ -295,7 +295,9 @@ struct bt_mesh_sensor_series {
 	 *  unique. The list of columns do not have to cover the entire valid
 	 *  range, and values that don't fit in any of the columns should be
 	 *  ignored. If columns overlap, samples must be present in all columns
-	 *  they fall into. The columns may come in any order.
+	 *  they fall into. The columns may come in any order, but columns
+	 *  sorted by their start value can be looked up without an index from
+	 *  the pool of @em CONFIG_BT_MESH_SENSOR_SRV_COLUMN_INDEX_SIZE entries.
 	 */
 	const struct bt_mesh_sensor_column *columns;
 
@@ -321,6 +323,31 @@ struct bt_mesh_sensor_series {
 	int (*get)(struct bt_mesh_sensor *sensor, struct bt_mesh_msg_ctx *ctx,
 		   const struct bt_mesh_sensor_column *column,
 		   struct sensor_value *value);
+
+	/** @brief Getter for the series values of several columns.
+	 *
+	 *  Optional bulk alternative to @c get. If set, it is used for all
+	 *  series messages, and is called once for a batch of up to @em
+	 *  CONFIG_BT_MESH_SENSOR_SRV_SERIES_BATCH columns.
+	 *
+	 *  @param[in]  sensor  Sensor pointer.
+	 *  @param[in]  ctx     Message context pointer, or NULL if this call
+	 *                      didn't originate from a mesh message.
+	 *  @param[in]  columns The requested sensor columns, in ascending order
+	 *                      of start value. Point to columns in the
+	 *                      @c columns array.
+	 *  @param[in]  count   Number of requested columns.
+	 *  @param[out] values  Sensor value response buffers, one for each
+	 *                      requested column. All channels indicated by the
+	 *                      sensor type must be filled.
+	 *
+	 *  @return 0 on success, or (negative) error code otherwise.
+	 */
+	int (*get_range)(
+		struct bt_mesh_sensor *sensor, struct bt_mesh_msg_ctx *ctx,
+		const struct bt_mesh_sensor_column *const *columns,
+		uint32_t count,
+		struct sensor_value values[][CONFIG_BT_MESH_SENSOR_CHANNELS_MAX]);
 };
 
 /** Sensor instance. */
@@ -345,7 +372,8 @@ struct bt_mesh_sensor {
 	 *
 	 *  Only sensors whose type have the @ref
 	 *  BT_MESH_SENSOR_TYPE_FLAG_SERIES flag set, a non-empty list of
-	 *  columns and a defined series getter will accept series messages.
+	 *  columns and a defined series getter (@c get or @c get_range) will
+	 *  accept series messages.
 	 */
 	const struct bt_mesh_sensor_series series;
 
@@ -363,6 +391,16 @@ struct bt_mesh_sensor {
 	int (*const get)(struct bt_mesh_sensor *sensor,
 			 struct bt_mesh_msg_ctx *ctx, struct sensor_value *rsp);
 
+	/** @brief Whether the application reports value changes.
+	 *
+	 *  If set, the server only samples the sensor for periodic
+	 *  publications when the application has reported a change through
+	 *  @ref bt_mesh_sensor_srv_notify, or when the publication interval
+	 *  has expired. Otherwise, the sensor is sampled every publication
+	 *  period to check its delta threshold.
+	 */
+	const bool change_notify;
+
 	/* Internal state, overwritten on init. Should only be written to by
 	 * internal modules.
 	 */
@@ -376,6 +414,16 @@ struct bt_mesh_sensor {
 		/** The previously published sensor value. */
 		struct sensor_value prev;
 
+		/** Series columns sorted by start value, as indexes into the
+		 *  columns array, or NULL if the columns array is sorted.
+		 */
+		const uint16_t *col_index;
+
+		/** Flag indicating that the value changed since the sensor
+		 *  was last sampled for a publication.
+		 */
+		atomic_t changed;
+
 		/** Sequence number of the previous publication. */
 		uint16_t seq;
 
@@ -393,6 +441,11 @@ struct bt_mesh_sensor {
 		/** Flag indicating whether the sensor is in fast cadence mode.
 		 */
 		uint8_t fast_pub : 1;
+
+		/** Flag indicating that the series columns are neither sorted
+		 *  nor indexed, and must be searched linearly.
+		 */
+		uint8_t col_unsorted : 1;
 	} state;
 };
 
@@ -129,6 +129,22 @@ int bt_mesh_sensor_srv_pub(struct bt_mesh_sensor_srv *srv,
 int bt_mesh_sensor_srv_sample(struct bt_mesh_sensor_srv *srv,
 			      struct bt_mesh_sensor *sensor);
 
+/** @brief Report a change in the sensor value.
+ *
+ *  Marks the sensor for sampling in the next periodic publication, where its
+ *  value is published if it's outside the delta threshold. Only affects
+ *  sensors with @c change_notify set, which are not sampled for periodic
+ *  publications until their value changes or their publication interval
+ *  expires.
+ *
+ *  Can be called from any context.
+ *
+ *  @param[in] srv    Sensor server instance.
+ *  @param[in] sensor Sensor instance whose value changed.
+ */
+void bt_mesh_sensor_srv_notify(struct bt_mesh_sensor_srv *srv,
+			       struct bt_mesh_sensor *sensor);
+
 /** @cond INTERNAL_HIDDEN */
 extern const struct bt_mesh_model_cb _bt_mesh_sensor_srv_cb;
 extern const struct bt_mesh_model_op _bt_mesh_sensor_srv_op[];
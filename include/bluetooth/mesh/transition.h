@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**
+ * @file
+ * @defgroup bt_mesh_transition Transition engine
+ * @{
+ * @brief Shared engine for gradual state transitions.
+ */
+
+#ifndef BT_MESH_TRANSITION_H__
+#define BT_MESH_TRANSITION_H__
+
+#include <bluetooth/mesh/model_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct bt_mesh_transition;
+
+/** @def BT_MESH_TRANSITION_INIT
+ *
+ *  @brief Initialization parameters for a @ref bt_mesh_transition instance.
+ *
+ *  @param[in] _cb Pointer to a @ref bt_mesh_transition_cb instance.
+ */
+#define BT_MESH_TRANSITION_INIT(_cb)                                           \
+	{                                                                      \
+		.cb = _cb,                                                     \
+	}
+
+/** Transition callbacks. */
+struct bt_mesh_transition_cb {
+	/** @brief Level update.
+	 *
+	 *  Called with the interpolated level every time it changes during
+	 *  the transition, and with the target level when the transition
+	 *  ends or is set without a transition time. The levels of all
+	 *  running transitions are updated in one pass every tick.
+	 *
+	 *  @note Must not start or stop any transitions.
+	 *
+	 *  @param[in] transition Transition instance.
+	 *  @param[in] level      Current level.
+	 */
+	void (*const step)(struct bt_mesh_transition *transition,
+			   int32_t level);
+
+	/** @brief The transition ended.
+	 *
+	 *  Called after the final level update. Transitions that end in the
+	 *  same tick are ended together, so that their status publications
+	 *  are sent back to back. Typically used to publish the new state.
+	 *
+	 *  All transitions in the group have reached their target level
+	 *  before the first end callback is called. Starting or stopping
+	 *  another transition of the group from the callback replaces or
+	 *  cancels its end, and its end callback is not called.
+	 *
+	 *  @param[in] transition Transition instance.
+	 */
+	void (*const end)(struct bt_mesh_transition *transition);
+};
+
+/** Transition instance.
+ *
+ *  All transitions are driven by a single timer, which runs at a fixed tick
+ *  interval of CONFIG_BT_MESH_TRANSITION_TICK milliseconds while any
+ *  transitions are in progress. Transitions are interpolated linearly
+ *  between their start and target levels, and end at the tick boundary
+ *  following their transition time.
+ *
+ *  The transition engine does not use any locking. The transition timer
+ *  runs in the system workqueue, and the transition API must only be called
+ *  from the system workqueue or from cooperative threads, such as the
+ *  Bluetooth receive thread the models are called from.
+ */
+struct bt_mesh_transition {
+	/** Transition callbacks. */
+	const struct bt_mesh_transition_cb *const cb;
+
+	/* Internal state, should only be written to by the transition
+	 * engine.
+	 */
+	struct {
+		/** Transition timer wheel node. */
+		sys_snode_t node;
+		/** Level at the start of the transition. */
+		int32_t start;
+		/** Target level. */
+		int32_t target;
+		/** Current level. */
+		int32_t level;
+		/** Tick at which the level starts changing. */
+		uint32_t start_tick;
+		/** Tick at which the transition ends. */
+		uint32_t end_tick;
+		/** Flag indicating whether the transition is in progress. */
+		bool active;
+		/** Flag indicating whether the transition has ended, and is
+		 *  waiting for its end callback.
+		 */
+		bool ending;
+	} state;
+};
+
+/** @brief Start a transition from the current level.
+ *
+ *  Replaces any transition in progress, starting from the current level.
+ *  If the transition parameters are NULL or have neither a transition time
+ *  nor a delay, the level is set immediately, without calling the
+ *  @c end callback.
+ *
+ *  @param[in] transition Transition instance.
+ *  @param[in] target     Target level.
+ *  @param[in] params     Transition parameters, or NULL to set the level
+ *                        immediately.
+ */
+void bt_mesh_transition_start(struct bt_mesh_transition *transition,
+			      int32_t target,
+			      const struct bt_mesh_model_transition *params);
+
+/** @brief Stop a transition at its current level.
+ *
+ *  Does not call any of the transition callbacks.
+ *
+ *  @param[in] transition Transition instance.
+ */
+void bt_mesh_transition_stop(struct bt_mesh_transition *transition);
+
+/** @brief Get the current level of a transition.
+ *
+ *  @param[in] transition Transition instance.
+ *
+ *  @return The current level of the transition, as of the last tick.
+ */
+static inline int32_t
+bt_mesh_transition_level_get(const struct bt_mesh_transition *transition)
+{
+	return transition->state.level;
+}
+
+/** @brief Get the target level of a transition.
+ *
+ *  @param[in] transition Transition instance.
+ *
+ *  @return The target level of the transition.
+ */
+static inline int32_t
+bt_mesh_transition_target_get(const struct bt_mesh_transition *transition)
+{
+	return transition->state.target;
+}
+
+/** @brief Get the remaining time of a transition.
+ *
+ *  @param[in] transition Transition instance.
+ *
+ *  @return The remaining time of the transition in milliseconds, including
+ *          any remaining delay, or 0 if the transition is not in progress.
+ */
+uint32_t
+bt_mesh_transition_remaining_get(const struct bt_mesh_transition *transition);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BT_MESH_TRANSITION_H__ */
+
+/** @} */
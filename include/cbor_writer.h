@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef CBOR_WRITER_H__
+#define CBOR_WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+
+/**
+ * @defgroup cbor_writer CBOR writer
+ * @{
+ * @brief Streaming CBOR (RFC 7049) writer that serializes directly into a
+ *        caller-provided buffer, without using the heap.
+ *
+ * The API mirrors the @ref json_writer API, so that the same encoder can
+ * produce either format. Maps and arrays are encoded with indefinite length,
+ * so that the number of items does not need to be known in advance.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief CBOR writer instance.
+ *
+ *  The members are internal to the writer and must not be accessed directly.
+ */
+struct cbor_writer {
+	/** Output buffer, or NULL to only compute the encoded length. */
+	uint8_t *buf;
+	/** Size of the output buffer. */
+	size_t size;
+	/** Length of the encoded data, also when it exceeds the buffer. */
+	size_t len;
+	/** Current nesting depth. */
+	uint8_t depth;
+	/** Set if the nesting was unbalanced or too deep. */
+	bool invalid;
+};
+
+/** @brief Initialize a CBOR writer.
+ *
+ *  @param[out] writer Writer instance.
+ *  @param[in] buf Output buffer. If NULL, nothing is written and the writer
+ *                 only computes the length of the encoded data.
+ *  @param[in] size Size of the output buffer.
+ */
+void cbor_writer_init(struct cbor_writer *writer, uint8_t *buf, size_t size);
+
+/** @brief Start a map.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the map in the enclosing map, or NULL if the
+ *                 map is the root or an array element.
+ */
+void cbor_writer_obj_start(struct cbor_writer *writer, const char *key);
+
+/** @brief End the current map.
+ *
+ *  @param[in] writer Writer instance.
+ */
+void cbor_writer_obj_end(struct cbor_writer *writer);
+
+/** @brief Start an array.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the array in the enclosing map, or NULL if the
+ *                 array is the root or an array element.
+ */
+void cbor_writer_arr_start(struct cbor_writer *writer, const char *key);
+
+/** @brief End the current array.
+ *
+ *  @param[in] writer Writer instance.
+ */
+void cbor_writer_arr_end(struct cbor_writer *writer);
+
+/** @brief Add a text string item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the item, or NULL inside an array.
+ *  @param[in] value Null-terminated string. NULL is encoded as "".
+ */
+void cbor_writer_str(struct cbor_writer *writer, const char *key,
+		     const char *value);
+
+/** @brief Add a byte string item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the item, or NULL inside an array.
+ *  @param[in] data Data.
+ *  @param[in] len Length of the data.
+ */
+void cbor_writer_bytes(struct cbor_writer *writer, const char *key,
+		       const void *data, size_t len);
+
+/** @brief Add a number item.
+ *
+ *  Integral values are encoded as integers. Other values are encoded as
+ *  single-precision floats if that is lossless, otherwise as double-precision
+ *  floats.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the item, or NULL inside an array.
+ *  @param[in] value Number.
+ */
+void cbor_writer_num(struct cbor_writer *writer, const char *key,
+		     double value);
+
+/** @brief Add an integer item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the item, or NULL inside an array.
+ *  @param[in] value Integer.
+ */
+void cbor_writer_int(struct cbor_writer *writer, const char *key,
+		     int32_t value);
+
+/** @brief Add a boolean item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the item, or NULL inside an array.
+ *  @param[in] value Boolean value.
+ */
+void cbor_writer_bool(struct cbor_writer *writer, const char *key,
+		      bool value);
+
+/** @brief Add a null item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Text key of the item, or NULL inside an array.
+ */
+void cbor_writer_null(struct cbor_writer *writer, const char *key);
+
+/** @brief Finish the encoding.
+ *
+ *  @param[in] writer Writer instance.
+ *
+ *  @return Length of the encoded data if the operation was successful.
+ *  @return -ENOMEM If the output buffer is too small. The length needed is
+ *          still available in @c writer->len.
+ *  @return -EINVAL If maps and arrays were not properly nested.
+ */
+int cbor_writer_finish(struct cbor_writer *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* CBOR_WRITER_H__ */
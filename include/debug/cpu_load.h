@@ -46,6 +46,71 @@ void cpu_load_reset(void);
  */
 uint32_t cpu_load_get(void);
 
+/** Number of buckets in the scheduling latency histogram. */
+#define CPU_LOAD_LATENCY_BUCKETS 16
+
+struct k_thread;
+
+/** @brief CPU usage of a thread. */
+struct cpu_load_thread_info {
+	/** Thread. */
+	const struct k_thread *thread;
+
+	/** Load, in the same units as @ref cpu_load_get. */
+	uint32_t load;
+
+	/** Number of times the thread was switched in. */
+	uint32_t switches;
+
+	/** Scheduling latency histogram. Bucket 0 counts latencies below
+	 *  1 us, bucket n counts latencies from 2^(n-1) us to 2^n us.
+	 *  The last bucket counts all longer latencies.
+	 */
+	uint32_t latency[CPU_LOAD_LATENCY_BUCKETS];
+};
+
+/** @brief CPU usage of an interrupt. */
+struct cpu_load_irq_info {
+	/** IRQ number, or -1 for interrupts that could not be identified. */
+	int irq;
+
+	/** Load, in the same units as @ref cpu_load_get. */
+	uint32_t load;
+
+	/** Number of times the interrupt service routine was called. */
+	uint32_t count;
+};
+
+/** @brief Callback for @ref cpu_load_threads_foreach. */
+typedef void (*cpu_load_thread_cb_t)(const struct cpu_load_thread_info *info,
+				     void *user_data);
+
+/** @brief Callback for @ref cpu_load_irqs_foreach. */
+typedef void (*cpu_load_irq_cb_t)(const struct cpu_load_irq_info *info,
+				  void *user_data);
+
+/** @brief Get the CPU usage of each thread that ran since the last reset.
+ *
+ * Available when CONFIG_CPU_LOAD_THREADS is enabled. Time spent in
+ * interrupts is not counted for the interrupted thread.
+ *
+ * @param cb Function called for each thread.
+ * @param user_data Data passed to the callback.
+ */
+void cpu_load_threads_foreach(cpu_load_thread_cb_t cb, void *user_data);
+
+/** @brief Get the CPU usage of each interrupt that fired since the last reset.
+ *
+ * Available when CONFIG_CPU_LOAD_THREADS is enabled.
+ *
+ * @param cb Function called for each interrupt.
+ * @param user_data Data passed to the callback.
+ */
+void cpu_load_irqs_foreach(cpu_load_irq_cb_t cb, void *user_data);
+
+/** @brief Reset the per-thread and per-interrupt measurement. */
+void cpu_load_threads_reset(void);
+
 /** @} */
 
 #ifdef __cplusplus
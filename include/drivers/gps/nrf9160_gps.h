@@ -0,0 +1,59 @@
+/**
+ * @file nrf9160_gps.h
+ *
+ * @brief nRF9160 GPS driver specific APIs.
+ */
+
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef ZEPHYR_INCLUDE_GPS_NRF9160_GPS_H_
+#define ZEPHYR_INCLUDE_GPS_NRF9160_GPS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include <device.h>
+
+/**
+ * @brief nRF9160 GPS driver frame pipeline metrics.
+ *
+ * Frames are received from the GNSS socket by a reader thread and queued
+ * until the driver thread has converted them to events and dispatched them
+ * to the event handler.
+ */
+struct nrf9160_gps_metrics {
+	/** Frames received from the GNSS socket. */
+	uint32_t frames;
+	/** Frames dropped because the frame queue was full. */
+	uint32_t dropped;
+	/** Frames dispatched later than CONFIG_NRF9160_GPS_FRAME_LATE_MS
+	 *  after they were received.
+	 */
+	uint32_t late;
+	/** NMEA sentences with an invalid format or checksum. */
+	uint32_t nmea_invalid;
+	/** NMEA sentences of types that are not enabled. */
+	uint32_t nmea_filtered;
+	/** Highest number of frames queued at once. */
+	uint32_t queue_max;
+};
+
+/**
+ * @brief Get the frame pipeline metrics of the nRF9160 GPS driver.
+ *
+ * @param dev Pointer to GPS device
+ * @param metrics Pointer to where the metrics are copied
+ */
+void nrf9160_gps_metrics_get(struct device *dev,
+			     struct nrf9160_gps_metrics *metrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZEPHYR_INCLUDE_GPS_NRF9160_GPS_H_ */
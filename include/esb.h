@@ -322,9 +322,12 @@ int esb_stop_rx(void);
 
 /** @brief Flush the TX buffer.
  *
- * This function clears the TX FIFO buffer.
+ * This function clears the TX FIFO buffer. The radio transmits directly
+ * from the TX FIFO, so the buffer cannot be flushed while a packet or
+ * an acknowledgment payload is being transmitted.
  *
  * @retval 0 If successful.
+ * @retval -EBUSY If the radio is transmitting from the TX FIFO.
  *           Otherwise, a (negative) error code is returned.
  */
 int esb_flush_tx(void);
@@ -332,6 +335,8 @@ int esb_flush_tx(void);
 /** @brief Pop the first item from the TX buffer.
  *
  * @retval 0 If successful.
+ * @retval -ENODATA If the TX buffer is empty.
+ * @retval -EBUSY If the radio is transmitting the first item.
  *           Otherwise, a (negative) error code is returned.
  */
 int esb_pop_tx(void);
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef JSON_WRITER_H__
+#define JSON_WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+
+/**
+ * @defgroup json_writer JSON writer
+ * @{
+ * @brief Streaming JSON writer that serializes directly into a caller-provided
+ *        buffer, without building an object tree or using the heap.
+ *
+ * The output is byte-identical to cJSON_PrintUnformatted() for the same
+ * sequence of items.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief JSON writer instance.
+ *
+ *  The members are internal to the writer and must not be accessed directly.
+ */
+struct json_writer {
+	/** Output buffer, or NULL to only compute the encoded length. */
+	char *buf;
+	/** Size of the output buffer. */
+	size_t size;
+	/** Length of the encoded data, also when it exceeds the buffer. */
+	size_t len;
+	/** Current nesting depth. */
+	uint8_t depth;
+	/** One bit per nesting level, set if a separator is needed before the
+	 *  next item on that level.
+	 */
+	uint32_t need_comma;
+	/** Set if the nesting was unbalanced or too deep. */
+	bool invalid;
+};
+
+/** @brief Initialize a JSON writer.
+ *
+ *  @param[out] writer Writer instance.
+ *  @param[in] buf Output buffer. If NULL, nothing is written and the writer
+ *                 only computes the length of the encoded data. This can be
+ *                 used to size an allocation before the actual encoding.
+ *  @param[in] size Size of the output buffer.
+ */
+void json_writer_init(struct json_writer *writer, char *buf, size_t size);
+
+/** @brief Start a JSON object.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the object in the enclosing object, or NULL if the
+ *                 object is the root or an array element.
+ */
+void json_writer_obj_start(struct json_writer *writer, const char *key);
+
+/** @brief End the current JSON object.
+ *
+ *  @param[in] writer Writer instance.
+ */
+void json_writer_obj_end(struct json_writer *writer);
+
+/** @brief Start a JSON array.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the array in the enclosing object, or NULL if the
+ *                 array is the root or an array element.
+ */
+void json_writer_arr_start(struct json_writer *writer, const char *key);
+
+/** @brief End the current JSON array.
+ *
+ *  @param[in] writer Writer instance.
+ */
+void json_writer_arr_end(struct json_writer *writer);
+
+/** @brief Add a string item. The string is escaped as needed.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the item, or NULL inside an array.
+ *  @param[in] value Null-terminated string. NULL is encoded as "".
+ */
+void json_writer_str(struct json_writer *writer, const char *key,
+		     const char *value);
+
+/** @brief Add a number item, formatted the same way as cJSON.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the item, or NULL inside an array.
+ *  @param[in] value Number. NaN and infinity are encoded as null.
+ */
+void json_writer_num(struct json_writer *writer, const char *key,
+		     double value);
+
+/** @brief Add an integer item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the item, or NULL inside an array.
+ *  @param[in] value Integer.
+ */
+void json_writer_int(struct json_writer *writer, const char *key,
+		     int32_t value);
+
+/** @brief Add a boolean item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the item, or NULL inside an array.
+ *  @param[in] value Boolean value.
+ */
+void json_writer_bool(struct json_writer *writer, const char *key,
+		      bool value);
+
+/** @brief Add a null item.
+ *
+ *  @param[in] writer Writer instance.
+ *  @param[in] key Key of the item, or NULL inside an array.
+ */
+void json_writer_null(struct json_writer *writer, const char *key);
+
+/** @brief Finish the encoding and null-terminate the output.
+ *
+ *  @param[in] writer Writer instance.
+ *
+ *  @return Length of the encoded data, excluding the null-terminator, if
+ *          the operation was successful.
+ *  @return -ENOMEM If the output buffer is too small. The length needed,
+ *          excluding the null-terminator, is still available in
+ *          @c writer->len.
+ *  @return -EINVAL If objects and arrays were not properly nested.
+ */
+int json_writer_finish(struct json_writer *writer);
+
+/** @brief Encoding pass of @ref json_writer_encode_alloc.
+ *
+ *  Encodes the whole message, typically by initializing a writer with
+ *  @p buf and @p size, adding the items and finishing the writer. Any writer
+ *  that computes the length when @p buf is NULL can be used, for example
+ *  the CBOR writer.
+ *
+ *  @param[in] buf Output buffer, or NULL to only compute the length.
+ *  @param[in] size Size of the output buffer.
+ *  @param[in] ctx Context given to @ref json_writer_encode_alloc.
+ *
+ *  @return Length of the encoded data, excluding any null-terminator, or a
+ *          negative error code.
+ */
+typedef int (*json_writer_pass_t)(char *buf, size_t size, const void *ctx);
+
+/** @brief Memory allocator for @ref json_writer_encode_alloc. */
+struct json_writer_allocator {
+	/** Allocate a block of memory, returns NULL on failure. */
+	void *(*alloc)(size_t size);
+	/** Free a block returned by @c alloc. */
+	void (*free)(void *ptr);
+};
+
+/** @brief Encode a message into an allocated buffer.
+ *
+ *  The first pass only computes the length, so that the output is allocated
+ *  exactly once, with room for a null-terminator, and no object tree has to
+ *  be built. The second pass encodes the message into the buffer.
+ *
+ *  @param[in] pass Encoding pass, called twice.
+ *  @param[in] ctx Context passed to @p pass.
+ *  @param[in] allocator Allocator for the output buffer.
+ *  @param[out] buf Output buffer, to be freed by the caller with the
+ *                  allocator. Not set on failure.
+ *
+ *  @return Length of the encoded data if the operation was successful.
+ *  @return -ENOMEM If the output buffer could not be allocated.
+ *  @return Other negative error code returned by @p pass.
+ */
+int json_writer_encode_alloc(json_writer_pass_t pass, const void *ctx,
+			     const struct json_writer_allocator *allocator,
+			     char **buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif /* JSON_WRITER_H__ */
@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
  */
 
+#include <kernel.h>
+#include <net/socket.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,6 +51,68 @@ int bsdlib_get_init_ret(void);
  */
 int bsdlib_shutdown(void);
 
+/**
+ * @brief Wait for offloaded sockets, native file descriptors and kernel
+ *        events.
+ *
+ * This function works like poll(), but it also accepts file descriptors
+ * that are not offloaded to the modem, such as native sockets, and kernel
+ * poll events, such as k_poll_signal. It returns when any of them is ready,
+ * without polling the modem periodically. poll() calls this function when
+ * an offloaded socket is polled.
+ *
+ * The state of each event in @p events is updated on return. Events that
+ * are ready must be reset by the application, as with k_poll().
+ *
+ * @param fds File descriptors to poll. May be NULL if @p nfds is zero.
+ * @param nfds Number of file descriptors.
+ * @param events Kernel poll events to wait for, initialized with
+ *               k_poll_event_init(). May be NULL if @p num_events is zero.
+ * @param num_events Number of kernel poll events, at most
+ *                   CONFIG_NRF91_SOCKET_POLL_MAX.
+ * @param timeout Timeout in milliseconds, or -1 to wait forever.
+ *
+ * @return Number of file descriptors and events that are ready, zero on
+ *         timeout, or -1 on error, with errno set.
+ */
+int nrf91_socket_poll(struct pollfd *fds, int nfds,
+		      struct k_poll_event *events, int num_events, int timeout);
+
+/** @brief DNS cache statistics. */
+struct nrf91_socket_dns_cache_stats {
+	/** Lookups answered with cached addresses. */
+	uint32_t hits;
+	/** Lookups answered with a cached nonexistent host. */
+	uint32_t negative_hits;
+	/** Lookups sent to the modem. */
+	uint32_t misses;
+	/** Entries replaced before they expired. */
+	uint32_t evictions;
+	/** Number of times the cache was flushed. */
+	uint32_t flushes;
+};
+
+/**
+ * @brief Remove all entries from the DNS cache.
+ *
+ * The cache is flushed automatically on PDN activation and deactivation
+ * notifications, if the AT command notification manager is enabled and
+ * the notifications are subscribed with AT+CGEREP=1.
+ *
+ * Available if CONFIG_NRF91_SOCKET_DNS_CACHE is enabled.
+ */
+void nrf91_socket_dns_cache_flush(void);
+
+/**
+ * @brief Get the DNS cache statistics.
+ *
+ * Available if CONFIG_NRF91_SOCKET_DNS_CACHE is enabled.
+ *
+ * @param[out] stats Statistics.
+ */
+void nrf91_socket_dns_cache_stats_get(
+	struct nrf91_socket_dns_cache_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
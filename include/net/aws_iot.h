@@ -190,6 +190,9 @@ int aws_iot_connect(struct aws_iot_config *const config);
 int aws_iot_disconnect(void);
 
 /** @brief Send data to AWS IoT broker.
+ *
+ *  If CONFIG_AWS_IOT_QUEUE is enabled, data that can not be published is
+ *  queued in flash and published when the client connects.
  *
  *  @param[in] tx_data Pointer to struct containing data to be transmitted to
  *                     the AWS IoT broker.
@@ -199,6 +202,16 @@ int aws_iot_disconnect(void);
  */
 int aws_iot_send(const struct aws_iot_data *const tx_data);
 
+/** @brief Publish messages that are queued in flash. Only available if
+ *         CONFIG_AWS_IOT_QUEUE is enabled.
+ *
+ *  The queue is also published automatically when the client connects.
+ *
+ *  @return 0 If successful.
+ *            Otherwise, a (negative) error code is returned.
+ */
+int aws_iot_send_queued(void);
+
 /** @brief Get data from AWS IoT broker
  *
  *  @return 0 If successful.
@@ -12,9 +12,88 @@
 #ifndef __COAP_UTILS_H__
 #define __COAP_UTILS_H__
 
+#include <stdbool.h>
 #include <net/coap.h>
 #include <net/net_ip.h>
 
+/** @brief Response to a request sent with @ref coap_utils_request. */
+struct coap_utils_response {
+	/** 0 if a response was received, -ETIMEDOUT if the server did not
+	 *  respond, or -ECONNRESET if the server rejected the request.
+	 */
+	int result;
+	/** CoAP response code. */
+	uint8_t code;
+	/** Response payload, or a part of it. */
+	const uint8_t *payload;
+	/** Length of the payload. */
+	uint16_t payload_len;
+	/** Offset of the payload in the whole response body, for responses
+	 *  received in blocks.
+	 */
+	size_t offset;
+	/** More blocks or observe notifications follow. The callback is called
+	 *  again for this request.
+	 */
+	bool more;
+};
+
+/** @brief Callback for responses to requests sent with
+ *  @ref coap_utils_request.
+ *
+ * @param[in] response  Response data, valid only in the callback.
+ * @param[in] user_data User data given in the request parameters.
+ */
+typedef void (*coap_utils_response_cb_t)(
+	const struct coap_utils_response *response, void *user_data);
+
+/** @brief Request parameters. */
+struct coap_utils_request_params {
+	/** CoAP method. */
+	enum coap_method method;
+	/** Server address. */
+	const struct sockaddr *addr;
+	/** NULL-terminated list of URI path options. Must stay valid until
+	 *  the request completes.
+	 */
+	const char *const *uri_path_options;
+	/** Request payload, sent in blocks if it is larger than
+	 *  CONFIG_COAP_UTILS_BLOCK_SIZE. Must stay valid until the request
+	 *  completes.
+	 */
+	const uint8_t *payload;
+	/** Length of the payload. */
+	size_t payload_len;
+	/** Send a confirmable request, retransmitted until it is
+	 *  acknowledged.
+	 */
+	bool confirmable;
+	/** Register as an observer of the resource. */
+	bool observe;
+	/** Response callback. */
+	coap_utils_response_cb_t cb;
+	/** User data passed to the callback. */
+	void *user_data;
+};
+
+/** @brief Request statistics, for measuring the request rate and
+ *  latency.
+ */
+struct coap_utils_stats {
+	/** Number of completed requests. */
+	uint32_t completed;
+	/** Number of requests that failed. */
+	uint32_t failed;
+	/** Number of retransmitted messages. */
+	uint32_t retransmissions;
+	/** Minimum request latency in milliseconds. */
+	uint32_t latency_min;
+	/** Maximum request latency in milliseconds. */
+	uint32_t latency_max;
+	/** Sum of request latencies in milliseconds. */
+	uint64_t latency_sum;
+};
+
 /** @brief Open socket and start the receiving thread.
  *
  * @param[in] ip_family network ip protocol family (AF_INET or AF_INET6)
@@ -37,6 +116,47 @@ int coap_send_request(enum coap_method method, const struct sockaddr *addr,
 		      const char *const *uri_path_options, uint8_t *payload,
 		      uint16_t payload_size, coap_reply_t reply_cb);
 
+/** @brief Send CoAP request.
+ *
+ * Several requests can be outstanding at the same time, up to
+ * CONFIG_COAP_UTILS_MAX_REQUESTS. Confirmable messages are retransmitted
+ * with exponential backoff. Payloads larger than a block are sent with
+ * Block1 transfer, and responses in blocks are requested with Block2
+ * transfer. The callback is called for every received block and
+ * observe notification, until the request completes. The callback is called
+ * without internal locks held, and may start or cancel requests.
+ *
+ * @param[in] params Request parameters.
+ *
+ * @retval >= 0 Request handle, used to cancel the request.
+ * @retval -ENOMEM No free request.
+ * @retval < 0  On other failure.
+ */
+int coap_utils_request(const struct coap_utils_request_params *params);
+
+/** @brief Cancel CoAP request or observe subscription.
+ *
+ * The callback is not called for the request anymore, except for a response
+ * that is already being delivered in another thread. Subsequent observe
+ * notifications are rejected with a reset message.
+ *
+ * @param[in] handle Request handle returned by @ref coap_utils_request.
+ *
+ * @retval 0       On success.
+ * @retval -ENOENT Request already completed.
+ * @retval -EINVAL Invalid handle.
+ */
+int coap_utils_cancel(int handle);
+
+/** @brief Get request statistics.
+ *
+ * @param[out] stats Statistics since the last reset.
+ */
+void coap_utils_stats_get(struct coap_utils_stats *stats);
+
+/** @brief Reset request statistics. */
+void coap_utils_stats_reset(void);
+
 #endif
 
 /**
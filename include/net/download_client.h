@@ -144,17 +144,86 @@ struct download_client {
 	int proto;
 
 	struct  {
-		/** Whether the HTTP header for
-		 * the current fragment has been processed.
-		 */
-		bool has_header;
+		/** Response parser state. */
+		uint8_t state;
 		/** The server has closed the connection. */
 		bool connection_close;
+		/** The current response has "Connection: close". */
+		bool close;
+		/** The current response uses chunked transfer encoding. */
+		bool chunked;
+		/** The current response has a "Content-Length". */
+		bool has_length;
+		/** The current response has a "Content-Range". */
+		bool has_range;
+		/** Data received after the last fragment is to be parsed. */
+		bool pending;
+		/** Number of requests without a complete response. */
+		uint8_t in_flight;
+		/** Offset in the file of the next byte to request. */
+		size_t requested;
+		/** Bytes left in the current body or chunk. */
+		size_t remaining;
+		/** Offset in the buffer of the first byte not parsed. */
+		size_t parsed;
+		/** Offset in the buffer up to which the current line
+		 *  has been searched for its end.
+		 */
+		size_t scanned;
+		/** Length of the payload collected in the buffer. */
+		size_t frag_len;
+		/** End of the data in the buffer, while a fragment
+		 *  is being delivered.
+		 */
+		size_t end;
 	} http;
 
 	struct {
 		/** CoAP block context. */
 		struct coap_block_context block_ctx;
+		/** Block requests in the window, starting from the first
+		 *  block that is not yet delivered to the application.
+		 */
+		struct {
+			/** Message ID of the request. */
+			uint16_t id;
+			/** Request state. */
+			uint8_t state;
+			/** Number of retransmissions. */
+			uint8_t retries;
+			/** Length of the received payload. */
+			uint16_t len;
+			/** Time when the request was sent, in milliseconds. */
+			int64_t sent;
+		} slot[CONFIG_DOWNLOAD_CLIENT_COAP_MAX_WINDOW];
+		/** Number of the first block in the window. */
+		uint32_t base;
+		/** Number of the last block of the file, if known. */
+		uint32_t last;
+		/** Number of blocks delivered to the application, to be
+		 *  removed from the window.
+		 */
+		uint8_t delivered;
+		/** Current window size, in blocks. */
+		uint8_t window;
+		/** Maximum window size for the negotiated block size. */
+		uint8_t window_max;
+		/** Blocks received since the last window increase. */
+		uint8_t window_acks;
+		/** Block size has been negotiated with the server. */
+		bool negotiated;
+		/** Bytes to skip in the first block, when resuming. */
+		uint16_t skip;
+		/** Offset in the buffer where datagrams are received. */
+		uint16_t rx_offset;
+		/** Smoothed round-trip time, in milliseconds. */
+		uint32_t srtt;
+		/** Round-trip time variation, in milliseconds. */
+		uint32_t rttvar;
+		/** Retransmission timeout, in milliseconds. */
+		uint32_t rto;
+		/** Token prefix of the current download. */
+		uint8_t session[4];
 	} coap;
 
 	/** Internal thread ID. */
@@ -211,6 +211,13 @@ enum ftp_trasfer_type {
 	FTP_TYPE_BINARY
 };
 
+enum ftp_put_type {
+	/** Create the file, or overwrite it if it exists */
+	FTP_PUT_NORMAL,
+	/** Append to the file, or create it if it does not exist */
+	FTP_PUT_APPEND
+};
+
 /**
  * @brief FTP asynchronous callback function.
  *
@@ -350,7 +357,66 @@ int ftp_get(const char *file);
  *
  * @retval ftp_return_code or negative if error
  */
-int ftp_put(const char *file, const uint8_t *data, uint16_t length);
+int ftp_put(const char *file, const uint8_t *data, size_t length);
+
+/**@brief Start a streaming upload to a file
+ * The data channel is set up once, and stays open until ftp_put_end().
+ * Other commands, except ftp_close(), return -EBUSY until then.
+ *
+ * @param file Target file name
+ * @param type Overwrite or append to the file
+ *
+ * @retval ftp_return_code or negative if error
+ */
+int ftp_put_start(const char *file, enum ftp_put_type type);
+
+/**@brief Send data of a streaming upload
+ * Can be called any number of times between ftp_put_start() and
+ * ftp_put_end().
+ *
+ * @param data Data to be stored
+ * @param length Length of data to be stored
+ *
+ * @retval 0 If successful, otherwise a negative error code
+ */
+int ftp_put_data(const uint8_t *data, size_t length);
+
+/**@brief End a streaming upload
+ * Close the data channel and wait for the server to store the file.
+ *
+ * @retval ftp_return_code or negative if error
+ */
+int ftp_put_end(void);
+
+/**@brief Start a streaming download of a file
+ * The data channel is set up once, and stays open until ftp_get_end().
+ * Other commands, except ftp_close(), return -EBUSY until then.
+ *
+ * @param file Target file name
+ * @param offset Offset in the file to start the download from, used to
+ *               resume an interrupted download. 0 to download the whole file.
+ *
+ * @retval ftp_return_code or negative if error
+ */
+int ftp_get_start(const char *file, uint32_t offset);
+
+/**@brief Receive data of a streaming download
+ *
+ * @param buf Buffer for the received data
+ * @param length Size of the buffer
+ *
+ * @retval Number of bytes received, 0 when the whole file is received,
+ *         -ECONNRESET or -EIO if the data channel was lost, or another
+ *         negative error code
+ */
+int ftp_get_data(uint8_t *buf, size_t length);
+
+/**@brief End a streaming download
+ * Close the data channel and wait for the transfer result.
+ *
+ * @retval ftp_return_code or negative if error
+ */
+int ftp_get_end(void);
 
 
 #ifdef __cplusplus
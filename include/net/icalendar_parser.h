@@ -58,6 +58,26 @@ enum ical_parser_error_id {
 	ICAL_ERROR_COM_NOT_SUPPORTED,
 };
 
+/**
+ * @brief iCalendar component properties.
+ *
+ * Used to select the properties that are parsed.
+ */
+enum ical_parser_prop {
+	/** SUMMARY property */
+	ICAL_PROP_SUMMARY = BIT(0),
+	/** LOCATION property */
+	ICAL_PROP_LOCATION = BIT(1),
+	/** DESCRIPTION property */
+	ICAL_PROP_DESCRIPTION = BIT(2),
+	/** DTSTART property */
+	ICAL_PROP_DTSTART = BIT(3),
+	/** DTEND property */
+	ICAL_PROP_DTEND = BIT(4),
+	/** All properties */
+	ICAL_PROP_ALL = BIT(5) - 1,
+};
+
 /**
  * @brief iCalendar component.
  */
@@ -100,16 +120,42 @@ struct ical_parser_evt {
 typedef int (*icalendar_parser_callback_t)(
 	const struct ical_parser_evt *event);
 
+struct ical_prop_desc;
+
 /**
  * @brief iCalendar parser instance.
  */
 struct icalendar_parser {
-	/** Internal Buffer for parsing incoming data stream */
-	char buf[CONFIG_ICAL_PARSER_BUFFER_SIZE + 1];
-	/** Offset of unparsed data in buf. */
-	size_t offset;
+	/** Component being parsed. */
+	struct ical_parser_evt evt;
+	/** Property name, or component name of BEGIN and END properties. */
+	char token[16];
+	/** Length of token. */
+	uint8_t token_len;
+	/** Property being parsed, NULL if unknown. */
+	const struct ical_prop_desc *prop;
+	/** Destination of the property value, NULL if not stored. */
+	char *value;
+	/** Length of the property value. */
+	uint16_t value_len;
+	/** Maximum length of the property value. */
+	uint16_t value_size;
+	/** Parser state. */
+	uint8_t state;
+	/** Parser state to resume after a line break. */
+	uint8_t resume;
+	/** Nesting level in the current component. */
+	uint8_t depth;
+	/** Parsing a quoted parameter value. */
+	bool quoted;
+	/** The property value is too long. */
+	bool overflow;
+	/** The current component is reported to the application. */
+	bool component;
 	/** begin of iCalendar object delimiter pair */
 	bool icalobject_begin;
+	/** Properties to parse, see @ref ical_parser_prop. */
+	uint32_t props;
 	/** Event handler. */
 	icalendar_parser_callback_t callback;
 };
@@ -125,14 +171,30 @@ struct icalendar_parser {
 int ical_parser_init(struct icalendar_parser *ical,
 		     icalendar_parser_callback_t callback);
 
+/**
+ * @brief Select the component properties to parse.
+ *
+ * Values of the properties that are not selected are skipped without
+ * being stored. All properties are parsed by default.
+ *
+ * @param[in,out] ical iCalendar parser instance.
+ * @param[in] props Properties to parse, see @ref ical_parser_prop.
+ */
+void ical_parser_props_set(struct icalendar_parser *ical, uint32_t props);
+
 /**
  * @brief Parse the iCalendar data stream. Return the parsed bytes.
  *
+ * The data stream can be fed in fragments of any size. An event is sent
+ * when the end of a component is parsed. The memory used does not depend
+ * on the size of the calendar.
+ *
  * @param[in,out] ical iCalendar parser instance.
  * @param[in] data Input data to be parsed.
  * @param[in] len  Length of input data stream.
  *
- * @retval size_t  Parsed bytes.
+ * @retval size_t  Parsed bytes. Less than @p len if the parsing has been
+ *                 stopped by the application.
  */
 size_t ical_parser_parse(struct icalendar_parser *ical,
 			const char *data, size_t len);
@@ -23,6 +23,12 @@ extern "C" {
  */
 
 /**@brief Requests specified A-GPS data from nRF Cloud.
+ *
+ * @details If CONFIG_NRF_CLOUD_AGPS_CACHE is enabled, types that are valid in
+ *	    the local cache are left out of the request, and are injected
+ *	    from the cache instead. The cached data is injected through the
+ *	    socket last passed to nrf_cloud_agps_process(), or the nRF9160 GPS
+ *	    driver. If all requested types are cached, no request is sent.
  *
  * @param types Array of assistance data types to request.
  * @param type_count Number of types to request.
@@ -49,6 +55,28 @@ int nrf_cloud_agps_request_all(void);
  */
 int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket);
 
+/**@brief Injects valid A-GPS data from the local cache into the modem.
+ *
+ * @details Data received from nRF Cloud is cached in settings storage
+ *	    together with the time of reception. This function can be used,
+ *	    for instance after a reset, to provide the modem with the
+ *	    assistance data that has not yet expired, without a network
+ *	    request. Requires CONFIG_NRF_CLOUD_AGPS_CACHE.
+ *
+ * @param socket Pointer to GNSS socket to which A-GPS data will be injected.
+ *		 If NULL, the nRF9160 GPS driver is used to inject the data.
+ *
+ * @return 0 if successful, otherwise a (negative) error code.
+ */
+int nrf_cloud_agps_cache_inject(const int *socket);
+
+/**@brief Invalidates all A-GPS data in the local cache.
+ *	  Requires CONFIG_NRF_CLOUD_AGPS_CACHE.
+ *
+ * @return 0 if successful, otherwise a (negative) error code.
+ */
+int nrf_cloud_agps_cache_clear(void);
+
 /** @} */
 
 #ifdef __cplusplus
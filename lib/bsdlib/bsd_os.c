@@ -17,6 +17,8 @@
 #include <errno.h>
 #include <logging/log.h>
 
+#include "nrf91_sockets_internal.h"
+
 #ifdef CONFIG_BSD_LIBRARY_TRACE_ENABLED
 #include <nrfx_uarte.h>
 #endif
@@ -70,6 +72,9 @@ static struct thread_monitor_entry {
 /* A list of threads that are sleeping and should be woken up on next event. */
 static sys_slist_t sleeping_threads;
 
+/* A list of listeners that are signaled on each RPC event. */
+static sys_slist_t event_listeners;
+
 /* RPC event counter, incremented on each RPC event. */
 static atomic_t rpc_event_cnt;
 
@@ -170,6 +175,24 @@ static void sleeping_thread_remove(struct sleeping_thread *thread)
 	irq_unlock(key);
 }
 
+void bsd_os_event_listener_add(struct bsd_os_event_listener *listener)
+{
+	uint32_t key = irq_lock();
+
+	sys_slist_append(&event_listeners, &listener->node);
+
+	irq_unlock(key);
+}
+
+void bsd_os_event_listener_remove(struct bsd_os_event_listener *listener)
+{
+	uint32_t key = irq_lock();
+
+	sys_slist_find_and_remove(&event_listeners, &listener->node);
+
+	irq_unlock(key);
+}
+
 int32_t bsd_os_timedwait(uint32_t context, int32_t *timeout)
 {
 	struct sleeping_thread thread;
@@ -376,6 +399,15 @@ ISR_DIRECT_DECLARE(rpc_proxy_irq_handler)
 		k_sem_give(&thread->sem);
 	}
 
+	struct bsd_os_event_listener *listener;
+
+	/* Signal threads polling offloaded sockets together with
+	 * kernel objects.
+	 */
+	SYS_SLIST_FOR_EACH_CONTAINER(&event_listeners, listener, node) {
+		k_poll_signal_raise(&listener->signal, 0);
+	}
+
 	ISR_DIRECT_PM(); /* PM done after servicing interrupt for best latency
 			  */
 	return 1; /* We should check if scheduling decision should be made */
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**
+ * @file
+ * @brief Cache of getaddrinfo() results for nrf91 offloaded sockets
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <init.h>
+#include <net/socket.h>
+#include <zephyr.h>
+#include <modem/bsdlib.h>
+#include <logging/log.h>
+
+#if defined(CONFIG_AT_NOTIF)
+#include <modem/at_notif.h>
+#endif
+
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
+
+#include "nrf91_sockets_internal.h"
+
+LOG_MODULE_REGISTER(nrf91_dns_cache, CONFIG_NRF91_SOCKET_DNS_CACHE_LOG_LEVEL);
+
+/* Results are cached by host name, service, PDN and hints. The modem does
+ * not report the TTL of DNS records, so results expire after a configured
+ * time. Host names that do not exist are cached for a shorter time. When
+ * the cache is full, an expired entry or the least recently used entry is
+ * replaced.
+ */
+
+#define TTL_MS (CONFIG_NRF91_SOCKET_DNS_CACHE_TTL * MSEC_PER_SEC)
+#define NEGATIVE_TTL_MS (CONFIG_NRF91_SOCKET_DNS_CACHE_NEGATIVE_TTL * \
+			 MSEC_PER_SEC)
+
+struct dns_cache_key {
+	int family;
+	int socktype;
+	int protocol;
+	int flags;
+	/* Host name, service and PDN name, separated by '\0' */
+	char name[CONFIG_NRF91_SOCKET_DNS_CACHE_NAME_LEN];
+	size_t name_len;
+};
+
+struct dns_cache_addr {
+	int family;
+	int socktype;
+	int protocol;
+	socklen_t addrlen;
+	union {
+		struct sockaddr_in in;
+		struct sockaddr_in6 in6;
+	} addr;
+};
+
+struct dns_cache_entry {
+	struct dns_cache_key key;
+	int64_t expiry;
+	uint32_t last_used;
+	/* getaddrinfo() result, zero or DNS_EAI_NONAME */
+	int error;
+	uint8_t addr_count;
+	struct dns_cache_addr addrs[CONFIG_NRF91_SOCKET_DNS_CACHE_ADDR_MAX];
+	bool valid;
+};
+
+static struct dns_cache_entry cache[CONFIG_NRF91_SOCKET_DNS_CACHE_SIZE];
+static struct nrf91_socket_dns_cache_stats stats;
+/* Incremented on each use, orders entries by use. */
+static uint32_t use_count;
+static K_MUTEX_DEFINE(cache_lock);
+
+static int key_init(struct dns_cache_key *key, const char *node,
+		    const char *service, const struct zsock_addrinfo *hints)
+{
+	const char *names[3] = { node, service, NULL };
+	size_t len;
+
+	memset(key, 0, sizeof(*key));
+
+	if (hints != NULL) {
+		key->family = hints->ai_family;
+		key->socktype = hints->ai_socktype;
+		key->protocol = hints->ai_protocol;
+		key->flags = hints->ai_flags;
+
+		/* PDN selected with the canonical name of the second hint */
+		if (hints->ai_next != NULL) {
+			names[2] = hints->ai_next->ai_canonname;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(names); i++) {
+		len = names[i] ? strlen(names[i]) : 0;
+		if (key->name_len + len + 1 > sizeof(key->name)) {
+			return -ENAMETOOLONG;
+		}
+
+		if (len > 0) {
+			memcpy(&key->name[key->name_len], names[i], len);
+		}
+		key->name_len += len + 1;
+	}
+
+	return 0;
+}
+
+static bool key_equals(const struct dns_cache_key *a,
+		       const struct dns_cache_key *b)
+{
+	return (a->family == b->family) &&
+	       (a->socktype == b->socktype) &&
+	       (a->protocol == b->protocol) &&
+	       (a->flags == b->flags) &&
+	       (a->name_len == b->name_len) &&
+	       !memcmp(a->name, b->name, a->name_len);
+}
+
+static struct dns_cache_entry *entry_find(const struct dns_cache_key *key)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (cache[i].valid && key_equals(&cache[i].key, key)) {
+			return &cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Find a free or expired entry, or else the least recently used entry. */
+static struct dns_cache_entry *entry_alloc(int64_t now)
+{
+	struct dns_cache_entry *lru = &cache[0];
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!cache[i].valid || cache[i].expiry <= now) {
+			return &cache[i];
+		}
+
+		if ((int32_t)(cache[i].last_used - lru->last_used) < 0) {
+			lru = &cache[i];
+		}
+	}
+
+	stats.evictions++;
+
+	return lru;
+}
+
+static int result_build(const struct dns_cache_entry *entry,
+			struct zsock_addrinfo **res)
+{
+	struct zsock_addrinfo *last = NULL;
+	struct zsock_addrinfo *ai;
+
+	*res = NULL;
+
+	for (size_t i = 0; i < entry->addr_count; i++) {
+		ai = k_calloc(1, sizeof(*ai));
+		if (ai == NULL) {
+			goto error;
+		}
+
+		ai->ai_addr = k_malloc(entry->addrs[i].addrlen);
+		if (ai->ai_addr == NULL) {
+			k_free(ai);
+			goto error;
+		}
+
+		ai->ai_family = entry->addrs[i].family;
+		ai->ai_socktype = entry->addrs[i].socktype;
+		ai->ai_protocol = entry->addrs[i].protocol;
+		ai->ai_addrlen = entry->addrs[i].addrlen;
+		memcpy(ai->ai_addr, &entry->addrs[i].addr,
+		       entry->addrs[i].addrlen);
+
+		if (last == NULL) {
+			*res = ai;
+		} else {
+			last->ai_next = ai;
+		}
+		last = ai;
+	}
+
+	return 0;
+
+error:
+	while (*res != NULL) {
+		ai = *res;
+		*res = ai->ai_next;
+		k_free(ai->ai_addr);
+		k_free(ai);
+	}
+
+	return DNS_EAI_MEMORY;
+}
+
+bool nrf91_dns_cache_lookup(const char *node, const char *service,
+			    const struct zsock_addrinfo *hints,
+			    struct zsock_addrinfo **res, int *error)
+{
+	struct dns_cache_entry *entry;
+	struct dns_cache_key key;
+
+	if (node == NULL || key_init(&key, node, service, hints)) {
+		return false;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	entry = entry_find(&key);
+	if (entry == NULL || entry->expiry <= k_uptime_get()) {
+		stats.misses++;
+		k_mutex_unlock(&cache_lock);
+		return false;
+	}
+
+	entry->last_used = ++use_count;
+
+	if (entry->error) {
+		stats.negative_hits++;
+		*res = NULL;
+		*error = entry->error;
+	} else {
+		stats.hits++;
+		*error = result_build(entry, res);
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	LOG_DBG("Cache hit for %s", log_strdup(node));
+
+	return true;
+}
+
+void nrf91_dns_cache_add(const char *node, const char *service,
+			 const struct zsock_addrinfo *hints, int error,
+			 const struct zsock_addrinfo *res)
+{
+	struct dns_cache_entry *entry;
+	struct dns_cache_key key;
+	struct dns_cache_addr *addr;
+	int64_t now;
+
+	if (node == NULL || key_init(&key, node, service, hints)) {
+		return;
+	}
+
+	/* Transient errors are not cached */
+	if (error != 0 && error != DNS_EAI_NONAME) {
+		return;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	now = k_uptime_get();
+
+	entry = entry_find(&key);
+	if (entry == NULL) {
+		entry = entry_alloc(now);
+	}
+
+	entry->key = key;
+	entry->error = error;
+	entry->expiry = now + (error ? NEGATIVE_TTL_MS : TTL_MS);
+	entry->last_used = ++use_count;
+	entry->addr_count = 0;
+	entry->valid = true;
+
+	for (; res != NULL && entry->addr_count < ARRAY_SIZE(entry->addrs);
+	     res = res->ai_next) {
+		if (res->ai_addr == NULL ||
+		    res->ai_addrlen > sizeof(entry->addrs[0].addr)) {
+			continue;
+		}
+
+		addr = &entry->addrs[entry->addr_count++];
+		addr->family = res->ai_family;
+		addr->socktype = res->ai_socktype;
+		addr->protocol = res->ai_protocol;
+		addr->addrlen = res->ai_addrlen;
+		memcpy(&addr->addr, res->ai_addr, res->ai_addrlen);
+	}
+
+	if (error == 0 && entry->addr_count == 0) {
+		/* Nothing to return from the cache */
+		entry->valid = false;
+	}
+
+	k_mutex_unlock(&cache_lock);
+}
+
+void nrf91_socket_dns_cache_flush(void)
+{
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		cache[i].valid = false;
+	}
+
+	stats.flushes++;
+
+	k_mutex_unlock(&cache_lock);
+
+	LOG_DBG("Cache flushed");
+}
+
+void nrf91_socket_dns_cache_stats_get(
+	struct nrf91_socket_dns_cache_stats *out)
+{
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&cache_lock);
+}
+
+#if defined(CONFIG_AT_NOTIF)
+/* Addresses may differ in another PDN, or after the PDN is reactivated. */
+static void pdn_notif_handler(void *context, const char *response)
+{
+	static const char *const pdn_events[] = {
+		"+CGEV: ME PDN ACT",
+		"+CGEV: ME PDN DEACT",
+		"+CGEV: NW PDN DEACT",
+		"+CGEV: ME DETACH",
+		"+CGEV: NW DETACH",
+	};
+
+	ARG_UNUSED(context);
+
+	for (size_t i = 0; i < ARRAY_SIZE(pdn_events); i++) {
+		if (!strncmp(response, pdn_events[i],
+			     strlen(pdn_events[i]))) {
+			nrf91_socket_dns_cache_flush();
+			return;
+		}
+	}
+}
+
+static int dns_cache_init(struct device *unused)
+{
+	int err;
+
+	ARG_UNUSED(unused);
+
+	/* Initializes the notification manager only once */
+	err = at_notif_init();
+	if (err) {
+		return err;
+	}
+
+	err = at_notif_register_handler(NULL, pdn_notif_handler);
+	if (err) {
+		LOG_ERR("Failed to register PDN notification handler, err %d",
+			err);
+	}
+
+	return err;
+}
+
+SYS_INIT(dns_cache_init, APPLICATION, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+#endif /* CONFIG_AT_NOTIF */
+
+#if defined(CONFIG_SHELL)
+static int cmd_dns_cache_show(const struct shell *shell, size_t argc,
+			      char **argv)
+{
+	const struct dns_cache_entry *entry;
+	int64_t now = k_uptime_get();
+	const char *service;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	shell_print(shell, "Hits: %u, negative hits: %u, misses: %u",
+		    stats.hits, stats.negative_hits, stats.misses);
+	shell_print(shell, "Evictions: %u, flushes: %u",
+		    stats.evictions, stats.flushes);
+
+	shell_print(shell, "  %-32s %-8s %5s %8s", "Host", "Service",
+		    "Addrs", "TTL (s)");
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		entry = &cache[i];
+		if (!entry->valid || entry->expiry <= now) {
+			continue;
+		}
+
+		service = &entry->key.name[strlen(entry->key.name) + 1];
+
+		shell_print(shell, "  %-32s %-8s %5u %8u", entry->key.name,
+			    service, entry->error ? 0 : entry->addr_count,
+			    (uint32_t)((entry->expiry - now) / MSEC_PER_SEC));
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return 0;
+}
+
+static int cmd_dns_cache_flush(const struct shell *shell, size_t argc,
+			       char **argv)
+{
+	nrf91_socket_dns_cache_flush();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_dns_cache,
+	SHELL_CMD_ARG(show, NULL, "Show cached hosts and statistics",
+		      cmd_dns_cache_show, 1, 0),
+	SHELL_CMD_ARG(flush, NULL, "Remove all cached hosts",
+		      cmd_dns_cache_flush, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(dns_cache, &sub_dns_cache, "nrf91 DNS cache", NULL);
+#endif /* CONFIG_SHELL */
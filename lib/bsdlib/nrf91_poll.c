@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**
+ * @file
+ * @brief Poll offloaded nrf91 sockets together with native file descriptors
+ *        and kernel objects.
+ */
+
+#include <bsd_limits.h>
+#include <errno.h>
+#include <string.h>
+#include <nrf_socket.h>
+#include <net/socket.h>
+#include <sys/fdtable.h>
+#include <zephyr.h>
+#include <modem/bsdlib.h>
+
+#include "nrf91_sockets_internal.h"
+
+/* Offloaded sockets are checked with a non-blocking nrf_poll() call, while
+ * native file descriptors and kernel objects are waited for with k_poll(),
+ * together with a signal that is raised on every bsdlib event. When the
+ * signal wakes the thread up, the offloaded sockets are checked again.
+ *
+ * The signal is reset before the offloaded sockets are checked, so that an
+ * event received after the check makes k_poll() return immediately.
+ */
+
+/* The first event is the bsdlib event signal. */
+#define POLL_EVENT_COUNT (CONFIG_NRF91_SOCKET_POLL_MAX + 1)
+
+struct poll_ctx {
+	struct pollfd *fds;
+	int nfds;
+	/* Offloaded sockets, and their index in fds, in the order of fds. */
+	struct nrf_pollfd nrf_fds[BSD_MAX_SOCKET_COUNT];
+	int nrf_idx[BSD_MAX_SOCKET_COUNT];
+	int nrf_nfds;
+	struct k_poll_event events[POLL_EVENT_COUNT];
+};
+
+static int offload_fds_init(struct poll_ctx *ctx)
+{
+	struct nrf_pollfd *nrf_fd;
+	int sd;
+
+	ctx->nrf_nfds = 0;
+
+	for (int i = 0; i < ctx->nfds; i++) {
+		ctx->fds[i].revents = 0;
+
+		if (ctx->fds[i].fd < 0) {
+			/* Per POSIX, negative fd's are just ignored */
+			continue;
+		}
+
+		sd = nrf91_socket_offload_sd_get(ctx->fds[i].fd);
+		if (sd < 0) {
+			/* Native file descriptor */
+			continue;
+		}
+
+		if (ctx->nrf_nfds == ARRAY_SIZE(ctx->nrf_fds)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		nrf_fd = &ctx->nrf_fds[ctx->nrf_nfds];
+		nrf_fd->fd = sd;
+		nrf_fd->events = 0;
+		nrf_fd->revents = 0;
+
+		/* Translate the API from native to nRF */
+		if (ctx->fds[i].events & POLLIN) {
+			nrf_fd->events |= NRF_POLLIN;
+		}
+		if (ctx->fds[i].events & POLLOUT) {
+			nrf_fd->events |= NRF_POLLOUT;
+		}
+
+		ctx->nrf_idx[ctx->nrf_nfds++] = i;
+	}
+
+	return 0;
+}
+
+/* Returns the number of offloaded sockets with events. */
+static int offload_fds_poll(struct poll_ctx *ctx)
+{
+	struct pollfd *fd;
+	int ready = 0;
+	int err;
+
+	if (ctx->nrf_nfds == 0) {
+		return 0;
+	}
+
+	err = nrf_poll(ctx->nrf_fds, ctx->nrf_nfds, 0);
+	if (err < 0) {
+		/* errno is set by bsdlib */
+		return -1;
+	}
+
+	/* Translate the API from nRF to native. */
+	for (int i = 0; i < ctx->nrf_nfds; i++) {
+		fd = &ctx->fds[ctx->nrf_idx[i]];
+		fd->revents = 0;
+
+		if (ctx->nrf_fds[i].revents & NRF_POLLIN) {
+			fd->revents |= POLLIN;
+		}
+		if (ctx->nrf_fds[i].revents & NRF_POLLOUT) {
+			fd->revents |= POLLOUT;
+		}
+		if (ctx->nrf_fds[i].revents & NRF_POLLERR) {
+			fd->revents |= POLLERR;
+		}
+		if (ctx->nrf_fds[i].revents & NRF_POLLNVAL) {
+			fd->revents |= POLLNVAL;
+		}
+		if (ctx->nrf_fds[i].revents & NRF_POLLHUP) {
+			fd->revents |= POLLHUP;
+		}
+
+		if (fd->revents) {
+			ready++;
+		}
+	}
+
+	return ready;
+}
+
+/* Check whether fds[i] is a native file descriptor. The offloaded sockets
+ * are walked in the order of fds, with off.
+ */
+static bool is_native_fd(const struct poll_ctx *ctx, int i, int *off)
+{
+	if (*off < ctx->nrf_nfds && ctx->nrf_idx[*off] == i) {
+		(*off)++;
+		return false;
+	}
+
+	return ctx->fds[i].fd >= 0;
+}
+
+/* Add the kernel poll events of the native file descriptors.
+ * Sets no_wait if a file descriptor is ready without waiting.
+ */
+static int native_fds_prepare(struct poll_ctx *ctx, struct k_poll_event **pev,
+			      bool *no_wait)
+{
+	struct k_poll_event *pev_end = ctx->events + ARRAY_SIZE(ctx->events);
+	const struct fd_op_vtable *vtable;
+	struct pollfd *fd;
+	void *obj;
+	int off = 0;
+	int err;
+
+	for (int i = 0; i < ctx->nfds; i++) {
+		if (!is_native_fd(ctx, i, &off)) {
+			continue;
+		}
+
+		fd = &ctx->fds[i];
+		fd->revents = 0;
+
+		obj = z_get_fd_obj_and_vtable(fd->fd, &vtable);
+		if (obj == NULL) {
+			fd->revents = POLLNVAL;
+			*no_wait = true;
+			continue;
+		}
+
+		err = z_fdtable_call_ioctl(vtable, obj, ZFD_IOCTL_POLL_PREPARE,
+					   fd, pev, pev_end);
+		if (err == -EALREADY) {
+			*no_wait = true;
+		} else if (err == -EXDEV) {
+			/* Socket of another offload provider */
+			fd->revents = POLLNVAL;
+			*no_wait = true;
+		} else if (err < 0) {
+			if (err != -1) {
+				errno = -err;
+			}
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Returns the number of native file descriptors with events. */
+static int native_fds_update(struct poll_ctx *ctx, struct k_poll_event *pev)
+{
+	const struct fd_op_vtable *vtable;
+	struct pollfd *fd;
+	int ready = 0;
+	void *obj;
+	int off = 0;
+	int err;
+
+	for (int i = 0; i < ctx->nfds; i++) {
+		if (!is_native_fd(ctx, i, &off)) {
+			continue;
+		}
+
+		fd = &ctx->fds[i];
+		if (fd->revents & POLLNVAL) {
+			/* Not prepared */
+			ready++;
+			continue;
+		}
+
+		obj = z_get_fd_obj_and_vtable(fd->fd, &vtable);
+		if (obj == NULL) {
+			fd->revents = POLLNVAL;
+			ready++;
+			continue;
+		}
+
+		err = z_fdtable_call_ioctl(vtable, obj, ZFD_IOCTL_POLL_UPDATE,
+					   fd, &pev);
+		if (err == -EAGAIN) {
+			continue;
+		} else if (err < 0) {
+			if (err != -1) {
+				errno = -err;
+			}
+			return -1;
+		}
+
+		if (fd->revents) {
+			ready++;
+		}
+	}
+
+	return ready;
+}
+
+int nrf91_socket_poll(struct pollfd *fds, int nfds,
+		      struct k_poll_event *events, int num_events, int timeout)
+{
+	struct bsd_os_event_listener listener;
+	struct poll_ctx ctx;
+	struct k_poll_event *pev;
+	k_timeout_t wait;
+	int64_t end = 0;
+	int64_t remaining;
+	bool no_wait;
+	int ready;
+	int err;
+
+	if ((nfds < 0) || (nfds > 0 && fds == NULL) ||
+	    (num_events < 0) || (num_events > CONFIG_NRF91_SOCKET_POLL_MAX) ||
+	    (num_events > 0 && events == NULL)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ctx.fds = fds;
+	ctx.nfds = nfds;
+
+	if (offload_fds_init(&ctx)) {
+		return -1;
+	}
+
+	if (timeout > 0) {
+		end = k_uptime_get() + timeout;
+	}
+
+	k_poll_signal_init(&listener.signal);
+	bsd_os_event_listener_add(&listener);
+
+	while (true) {
+		k_poll_signal_reset(&listener.signal);
+
+		ready = offload_fds_poll(&ctx);
+		if (ready < 0) {
+			break;
+		}
+
+		pev = ctx.events;
+		k_poll_event_init(pev++, K_POLL_TYPE_SIGNAL,
+				  K_POLL_MODE_NOTIFY_ONLY, &listener.signal);
+		if (num_events > 0) {
+			memcpy(pev, events, num_events * sizeof(*events));
+			pev += num_events;
+		}
+
+		no_wait = false;
+		err = native_fds_prepare(&ctx, &pev, &no_wait);
+		if (err) {
+			ready = -1;
+			break;
+		}
+
+		if (ready > 0 || no_wait || timeout == 0) {
+			wait = K_NO_WAIT;
+		} else if (timeout < 0) {
+			wait = K_FOREVER;
+		} else {
+			remaining = end - k_uptime_get();
+			wait = (remaining > 0) ? K_MSEC(remaining) : K_NO_WAIT;
+		}
+
+		/* Returns -EAGAIN on timeout, the event states tell the rest */
+		(void)k_poll(ctx.events, pev - ctx.events, wait);
+
+		for (int i = 0; i < num_events; i++) {
+			events[i].state = ctx.events[i + 1].state;
+			if (events[i].state != K_POLL_STATE_NOT_READY) {
+				ready++;
+			}
+		}
+
+		err = native_fds_update(&ctx, ctx.events + 1 + num_events);
+		if (err < 0) {
+			ready = -1;
+			break;
+		}
+
+		ready += err;
+
+		if (ready > 0 || timeout == 0 ||
+		    (timeout > 0 && k_uptime_get() >= end)) {
+			break;
+		}
+
+		/* Woken up by a bsdlib event, check the offloaded sockets */
+	}
+
+	bsd_os_event_listener_remove(&listener);
+
+	return ready;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**
+ * @file
+ * @brief sendmsg() for nrf91 offloaded sockets
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <net/socket.h>
+#include <zephyr.h>
+
+#include "nrf91_sockets_internal.h"
+
+/* The buffers of a message are gathered into a buffer owned by the call, and
+ * sent with a single sendto() call, so that the message is sent as a single
+ * datagram or TLS record. A message with a single buffer is sent without
+ * copying.
+ *
+ * Buffers are taken from a pool, or from the heap for messages that do not
+ * fit into a pool buffer, so that calls from different threads do not wait
+ * for each other. Heap buffers are limited to
+ * CONFIG_BSD_LIBRARY_SENDMSG_HEAP_MAX_SIZE. If no buffer is available, the
+ * message buffers are sent one by one.
+ */
+
+#define SENDMSG_BUF_SIZE ROUND_UP(CONFIG_BSD_LIBRARY_SENDMSG_BUF_SIZE, 4)
+
+static K_MEM_SLAB_DEFINE(sendmsg_bufs, SENDMSG_BUF_SIZE,
+			 CONFIG_BSD_LIBRARY_SENDMSG_BUF_COUNT, 4);
+
+static uint8_t *sendmsg_buf_alloc(size_t len, bool *pooled)
+{
+	void *buf;
+
+	*pooled = false;
+
+	if (len <= SENDMSG_BUF_SIZE &&
+	    k_mem_slab_alloc(&sendmsg_bufs, &buf, K_NO_WAIT) == 0) {
+		*pooled = true;
+		return buf;
+	}
+
+	if (len > CONFIG_BSD_LIBRARY_SENDMSG_HEAP_MAX_SIZE) {
+		return NULL;
+	}
+
+	return k_malloc(len);
+}
+
+static void sendmsg_buf_free(uint8_t *buf, bool pooled)
+{
+	if (pooled) {
+		k_mem_slab_free(&sendmsg_bufs, (void **)&buf);
+	} else {
+		k_free(buf);
+	}
+}
+
+static ssize_t sendmsg_unbuffered(void *obj, const struct msghdr *msg,
+				  int flags)
+{
+	ssize_t len = 0;
+	ssize_t ret;
+
+	for (size_t i = 0; i < msg->msg_iovlen; i++) {
+		if (msg->msg_iov[i].iov_len == 0) {
+			continue;
+		}
+
+		ret = nrf91_socket_offload_sendto(obj, msg->msg_iov[i].iov_base,
+						  msg->msg_iov[i].iov_len,
+						  flags, msg->msg_name,
+						  msg->msg_namelen);
+		if (ret < 0) {
+			return ret;
+		}
+
+		len += ret;
+	}
+
+	return len;
+}
+
+ssize_t nrf91_socket_offload_sendmsg(void *obj, const struct msghdr *msg,
+				     int flags)
+{
+	const struct iovec *iov = NULL;
+	size_t count = 0;
+	size_t len = 0;
+	uint8_t *buf;
+	bool pooled;
+	ssize_t ret;
+
+	if (msg == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (size_t i = 0; i < msg->msg_iovlen; i++) {
+		if (msg->msg_iov[i].iov_len == 0) {
+			continue;
+		}
+
+		iov = &msg->msg_iov[i];
+		len += iov->iov_len;
+		count++;
+	}
+
+	if (count <= 1) {
+		/* Nothing to gather, an empty message is sent as such */
+		return nrf91_socket_offload_sendto(obj,
+						   iov ? iov->iov_base : "",
+						   len, flags, msg->msg_name,
+						   msg->msg_namelen);
+	}
+
+	buf = sendmsg_buf_alloc(len, &pooled);
+	if (buf == NULL) {
+		return sendmsg_unbuffered(obj, msg, flags);
+	}
+
+	len = 0;
+
+	for (size_t i = 0; i < msg->msg_iovlen; i++) {
+		memcpy(buf + len, msg->msg_iov[i].iov_base,
+		       msg->msg_iov[i].iov_len);
+		len += msg->msg_iov[i].iov_len;
+	}
+
+	ret = nrf91_socket_offload_sendto(obj, buf, len, flags, msg->msg_name,
+					  msg->msg_namelen);
+
+	sendmsg_buf_free(buf, pooled);
+
+	return ret;
+}
@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <init.h>
+#include <modem/bsdlib.h>
 #include <net/socket_offload.h>
 #include <nrf_socket.h>
 #include <nrf_errno.h>
@@ -22,6 +23,8 @@
 #include <sys/fdtable.h>
 #include <zephyr.h>
 
+#include "nrf91_sockets_internal.h"
+
 #if defined(CONFIG_NET_SOCKETS_OFFLOAD)
 
 #if defined(CONFIG_NRF91_SOCKET_ENABLE_DEBUG_LOGS)
@@ -776,10 +779,9 @@ static ssize_t nrf91_socket_offload_recvfrom(void *obj, void *buf, size_t len,
 	return retval;
 }
 
-static ssize_t nrf91_socket_offload_sendto(void *obj, const void *buf,
-					   size_t len, int flags,
-					   const struct sockaddr *to,
-					   socklen_t tolen)
+ssize_t nrf91_socket_offload_sendto(void *obj, const void *buf, size_t len,
+				    int flags, const struct sockaddr *to,
+				    socklen_t tolen)
 {
 	int sd = OBJ_TO_SD(obj);
 	ssize_t retval;
@@ -817,144 +819,6 @@ error:
 	return retval;
 }
 
-static ssize_t nrf91_socket_offload_sendmsg(void *obj, const struct msghdr *msg,
-					    int flags)
-{
-	ssize_t len = 0;
-	ssize_t ret;
-	int i;
-	static K_MUTEX_DEFINE(sendmsg_lock);
-	static uint8_t buf[CONFIG_BSD_LIBRARY_SENDMSG_BUF_SIZE];
-
-	if (msg == NULL) {
-		errno = EINVAL;
-		return -1;
-	}
-
-	/* Try to reduce number of `sendto` calls - copy data if they fit into
-	 * a single buffer
-	 */
-
-	for (i = 0; i < msg->msg_iovlen; i++) {
-		len += msg->msg_iov[i].iov_len;
-	}
-
-	if (len <= sizeof(buf)) {
-		/* Protect `buf` access with a mutex. */
-		k_mutex_lock(&sendmsg_lock, K_FOREVER);
-		len = 0;
-
-		for (i = 0; i < msg->msg_iovlen; i++) {
-			memcpy(buf + len, msg->msg_iov[i].iov_base,
-			       msg->msg_iov[i].iov_len);
-			len += msg->msg_iov[i].iov_len;
-		}
-
-		ret = nrf91_socket_offload_sendto(obj, buf, len,
-						  flags, msg->msg_name,
-						  msg->msg_namelen);
-
-		k_mutex_unlock(&sendmsg_lock);
-		return ret;
-	}
-
-	/* If the data won't fit into intermediate buffer, send the buffers
-	 * separately
-	 */
-
-	len = 0;
-
-	for (i = 0; i < msg->msg_iovlen; i++) {
-		if (msg->msg_iov[i].iov_len == 0) {
-			continue;
-		}
-
-		ret = nrf91_socket_offload_sendto(obj, msg->msg_iov[i].iov_base,
-						  msg->msg_iov[i].iov_len,
-						  flags, msg->msg_name,
-						  msg->msg_namelen);
-		if (ret < 0) {
-			return ret;
-		}
-
-		len += ret;
-	}
-
-	return len;
-}
-
-static inline int nrf91_socket_offload_poll(struct pollfd *fds, int nfds,
-					    int timeout)
-{
-	int retval = 0;
-	struct nrf_pollfd tmp[BSD_MAX_SOCKET_COUNT] = { 0 };
-	void *obj;
-
-	for (int i = 0; i < nfds; i++) {
-		tmp[i].events = 0;
-		fds[i].revents = 0;
-
-		if (fds[i].fd < 0) {
-			/* Per POSIX, negative fd's are just ignored */
-			tmp[i].fd = fds[i].fd;
-			continue;
-		} else {
-			obj = z_get_fd_obj(fds[i].fd,
-					   (const struct fd_op_vtable *)
-						     &nrf91_socket_fd_op_vtable,
-					   ENOTSUP);
-			if (obj != NULL) {
-				/* Offloaded socket found. */
-				tmp[i].fd = OBJ_TO_SD(obj);
-			} else {
-				/* Non-offloaded socket, return an error. */
-				fds[i].revents = POLLNVAL;
-				retval++;
-			}
-		}
-
-		/* Translate the API from native to nRF */
-		if (fds[i].events & POLLIN) {
-			tmp[i].events |= NRF_POLLIN;
-		}
-		if (fds[i].events & POLLOUT) {
-			tmp[i].events |= NRF_POLLOUT;
-		}
-	}
-
-	if (retval > 0) {
-		return retval;
-	}
-
-	retval = nrf_poll((struct nrf_pollfd *)&tmp, nfds, timeout);
-
-	/* Translate the API from nRF to native. */
-	/* No need to translate .events, shall be untouched by poll() */
-	for (int i = 0; i < nfds; i++) {
-		if (fds[i].fd < 0) {
-			continue;
-		}
-
-		if (tmp[i].revents & NRF_POLLIN) {
-			fds[i].revents |= POLLIN;
-		}
-		if (tmp[i].revents & NRF_POLLOUT) {
-			fds[i].revents |= POLLOUT;
-		}
-		if (tmp[i].revents & NRF_POLLERR) {
-			fds[i].revents |= POLLERR;
-		}
-		if (tmp[i].revents & NRF_POLLNVAL) {
-			fds[i].revents |= POLLNVAL;
-		}
-		if (tmp[i].revents & NRF_POLLHUP) {
-			fds[i].revents |= POLLHUP;
-		}
-	}
-
-	return retval;
-}
-
 static void nrf91_socket_offload_freeaddrinfo(struct zsock_addrinfo *root)
 {
 	struct zsock_addrinfo *next = root;
@@ -1000,10 +864,19 @@ static int nrf91_socket_offload_getaddrinfo(const char *node,
 		}
 		nrf_hints_ptr = &nrf_hints;
 	}
+
+	if (IS_ENABLED(CONFIG_NRF91_SOCKET_DNS_CACHE) &&
+	    nrf91_dns_cache_lookup(node, service, hints, res, &error)) {
+		return error;
+	}
+
 	int retval = nrf_getaddrinfo(node, service, nrf_hints_ptr, &nrf_res);
 
 	if (retval != 0) {
 		error = nrf_to_z_dns_error_code(retval);
+		if (IS_ENABLED(CONFIG_NRF91_SOCKET_DNS_CACHE)) {
+			nrf91_dns_cache_add(node, service, hints, error, NULL);
+		}
 		return error;
 	}
 
@@ -1052,6 +925,10 @@ static int nrf91_socket_offload_getaddrinfo(const char *node,
 	}
 	nrf_freeaddrinfo(nrf_res);
 
+	if (IS_ENABLED(CONFIG_NRF91_SOCKET_DNS_CACHE) && retval == 0) {
+		nrf91_dns_cache_add(node, service, hints, 0, *res);
+	}
+
 	return retval;
 }
 
@@ -1112,7 +989,7 @@ static int nrf91_socket_offload_ioctl(void *obj, unsigned int request,
 		nfds = va_arg(args, int);
 		timeout = va_arg(args, int);
 
-		return nrf91_socket_offload_poll(fds, nfds, timeout);
+		return nrf91_socket_poll(fds, nfds, NULL, 0, timeout);
 	}
 
 	/* Otherwise, just forward to offloaded fcntl()
@@ -1159,6 +1036,19 @@ static const struct socket_op_vtable nrf91_socket_fd_op_vtable = {
 	.setsockopt = nrf91_socket_offload_setsockopt,
 };
 
+int nrf91_socket_offload_sd_get(int fd)
+{
+	void *obj = z_get_fd_obj(fd, (const struct fd_op_vtable *)
+					   &nrf91_socket_fd_op_vtable,
+				 ENOTSUP);
+
+	if (obj == NULL) {
+		return -1;
+	}
+
+	return OBJ_TO_SD(obj);
+}
+
 static bool nrf91_socket_is_supported(int family, int type, int proto)
 {
 	return true;
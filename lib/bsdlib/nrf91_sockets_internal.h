@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef NRF91_SOCKETS_INTERNAL_H__
+#define NRF91_SOCKETS_INTERNAL_H__
+
+#include <kernel.h>
+#include <net/socket.h>
+#include <sys/slist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Listener for bsdlib events.
+ *
+ * The signal is raised from the RPC interrupt on every bsdlib event, which
+ * is when the state of an offloaded socket may have changed. It allows
+ * waiting for offloaded sockets and kernel objects with a single k_poll().
+ */
+struct bsd_os_event_listener {
+	sys_snode_t node;
+	struct k_poll_signal signal;
+};
+
+/* Start raising the listener signal on bsdlib events. */
+void bsd_os_event_listener_add(struct bsd_os_event_listener *listener);
+
+/* Stop raising the listener signal on bsdlib events. */
+void bsd_os_event_listener_remove(struct bsd_os_event_listener *listener);
+
+/* Get the bsdlib socket descriptor of a file descriptor.
+ *
+ * Returns the socket descriptor if the file descriptor is an offloaded
+ * socket, a negative value otherwise.
+ */
+int nrf91_socket_offload_sd_get(int fd);
+
+/* Send data on an offloaded socket. */
+ssize_t nrf91_socket_offload_sendto(void *obj, const void *buf, size_t len,
+				    int flags, const struct sockaddr *to,
+				    socklen_t tolen);
+
+/* Send a message, gathered from its buffers, on an offloaded socket. */
+ssize_t nrf91_socket_offload_sendmsg(void *obj, const struct msghdr *msg,
+				     int flags);
+
+/* Look up a getaddrinfo() result in the DNS cache.
+ *
+ * Returns true on a cache hit, with the getaddrinfo() return value in error,
+ * and the result, if any, in res. The result is freed like the result of
+ * the offloaded getaddrinfo().
+ */
+bool nrf91_dns_cache_lookup(const char *node, const char *service,
+			    const struct zsock_addrinfo *hints,
+			    struct zsock_addrinfo **res, int *error);
+
+/* Add a getaddrinfo() result to the DNS cache. Only successful results and
+ * DNS_EAI_NONAME errors are cached.
+ */
+void nrf91_dns_cache_add(const char *node, const char *service,
+			 const struct zsock_addrinfo *hints, int error,
+			 const struct zsock_addrinfo *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF91_SOCKETS_INTERNAL_H__ */
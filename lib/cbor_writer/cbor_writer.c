@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <cbor_writer.h>
+
+/* Major types, shifted into the initial byte. */
+#define MT_UINT		(0 << 5)
+#define MT_NEGINT	(1 << 5)
+#define MT_BYTES	(2 << 5)
+#define MT_TEXT		(3 << 5)
+#define MT_ARRAY	(4 << 5)
+#define MT_MAP		(5 << 5)
+#define MT_SIMPLE	(7 << 5)
+
+#define AI_UINT8	24
+#define AI_UINT16	25
+#define AI_UINT32	26
+#define AI_UINT64	27
+#define AI_INDEFINITE	31
+
+#define SIMPLE_FALSE	(MT_SIMPLE | 20)
+#define SIMPLE_TRUE	(MT_SIMPLE | 21)
+#define SIMPLE_NULL	(MT_SIMPLE | 22)
+#define FLOAT32		(MT_SIMPLE | AI_UINT32)
+#define FLOAT64		(MT_SIMPLE | AI_UINT64)
+#define BREAK		(MT_SIMPLE | AI_INDEFINITE)
+
+static void put(struct cbor_writer *writer, const void *data, size_t len)
+{
+	if ((writer->buf != NULL) && (writer->len < writer->size)) {
+		size_t space = writer->size - writer->len;
+
+		memcpy(&writer->buf[writer->len], data, MIN(len, space));
+	}
+
+	writer->len += len;
+}
+
+static void put_byte(struct cbor_writer *writer, uint8_t byte)
+{
+	put(writer, &byte, 1);
+}
+
+/* Write an initial byte and argument, in network byte order, using the
+ * shortest possible encoding.
+ */
+static void put_head(struct cbor_writer *writer, uint8_t major, uint64_t arg)
+{
+	uint8_t head[9];
+	size_t len;
+
+	if (arg < AI_UINT8) {
+		head[0] = major | arg;
+		len = 1;
+	} else if (arg <= UINT8_MAX) {
+		head[0] = major | AI_UINT8;
+		head[1] = arg;
+		len = 2;
+	} else if (arg <= UINT16_MAX) {
+		head[0] = major | AI_UINT16;
+		sys_put_be16(arg, &head[1]);
+		len = 3;
+	} else if (arg <= UINT32_MAX) {
+		head[0] = major | AI_UINT32;
+		sys_put_be32(arg, &head[1]);
+		len = 5;
+	} else {
+		head[0] = major | AI_UINT64;
+		sys_put_be64(arg, &head[1]);
+		len = 9;
+	}
+
+	put(writer, head, len);
+}
+
+static void put_int(struct cbor_writer *writer, int64_t value)
+{
+	if (value < 0) {
+		/* -1 - n, computed without overflow for INT64_MIN. */
+		put_head(writer, MT_NEGINT, ~(uint64_t)value);
+	} else {
+		put_head(writer, MT_UINT, value);
+	}
+}
+
+static void put_text(struct cbor_writer *writer, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+
+	put_head(writer, MT_TEXT, len);
+	put(writer, str, len);
+}
+
+static void item_begin(struct cbor_writer *writer, const char *key)
+{
+	if (key != NULL) {
+		put_text(writer, key);
+	}
+}
+
+static void container_start(struct cbor_writer *writer, const char *key,
+			    uint8_t major)
+{
+	item_begin(writer, key);
+	put_byte(writer, major | AI_INDEFINITE);
+
+	if (writer->depth == UINT8_MAX) {
+		writer->invalid = true;
+		return;
+	}
+
+	writer->depth++;
+}
+
+static void container_end(struct cbor_writer *writer)
+{
+	if (writer->depth == 0) {
+		writer->invalid = true;
+		return;
+	}
+
+	writer->depth--;
+	put_byte(writer, BREAK);
+}
+
+void cbor_writer_init(struct cbor_writer *writer, uint8_t *buf, size_t size)
+{
+	__ASSERT_NO_MSG(writer != NULL);
+
+	writer->buf = buf;
+	writer->size = buf ? size : 0;
+	writer->len = 0;
+	writer->depth = 0;
+	writer->invalid = false;
+}
+
+void cbor_writer_obj_start(struct cbor_writer *writer, const char *key)
+{
+	container_start(writer, key, MT_MAP);
+}
+
+void cbor_writer_obj_end(struct cbor_writer *writer)
+{
+	container_end(writer);
+}
+
+void cbor_writer_arr_start(struct cbor_writer *writer, const char *key)
+{
+	container_start(writer, key, MT_ARRAY);
+}
+
+void cbor_writer_arr_end(struct cbor_writer *writer)
+{
+	container_end(writer);
+}
+
+void cbor_writer_str(struct cbor_writer *writer, const char *key,
+		     const char *value)
+{
+	item_begin(writer, key);
+	put_text(writer, value);
+}
+
+void cbor_writer_bytes(struct cbor_writer *writer, const char *key,
+		       const void *data, size_t len)
+{
+	item_begin(writer, key);
+	put_head(writer, MT_BYTES, len);
+	put(writer, data, len);
+}
+
+void cbor_writer_num(struct cbor_writer *writer, const char *key,
+		     double value)
+{
+	float single = (float)value;
+	uint8_t buf[9];
+
+	item_begin(writer, key);
+
+	/* Integral values within the 64-bit range are encoded as integers.
+	 * NaN fails the comparison and is encoded as a float.
+	 */
+	if ((value >= (double)INT64_MIN) && (value < (double)INT64_MAX) &&
+	    (value == (double)(int64_t)value)) {
+		put_int(writer, (int64_t)value);
+		return;
+	}
+
+	if (((double)single == value) || (value != value)) {
+		uint32_t bits;
+
+		memcpy(&bits, &single, sizeof(bits));
+		buf[0] = FLOAT32;
+		sys_put_be32(bits, &buf[1]);
+		put(writer, buf, 5);
+	} else {
+		uint64_t bits;
+
+		memcpy(&bits, &value, sizeof(bits));
+		buf[0] = FLOAT64;
+		sys_put_be64(bits, &buf[1]);
+		put(writer, buf, 9);
+	}
+}
+
+void cbor_writer_int(struct cbor_writer *writer, const char *key,
+		     int32_t value)
+{
+	item_begin(writer, key);
+	put_int(writer, value);
+}
+
+void cbor_writer_bool(struct cbor_writer *writer, const char *key,
+		      bool value)
+{
+	item_begin(writer, key);
+	put_byte(writer, value ? SIMPLE_TRUE : SIMPLE_FALSE);
+}
+
+void cbor_writer_null(struct cbor_writer *writer, const char *key)
+{
+	item_begin(writer, key);
+	put_byte(writer, SIMPLE_NULL);
+}
+
+int cbor_writer_finish(struct cbor_writer *writer)
+{
+	if (writer->invalid || (writer->depth != 0)) {
+		return -EINVAL;
+	}
+
+	if ((writer->buf != NULL) && (writer->len > writer->size)) {
+		return -ENOMEM;
+	}
+
+	return writer->len;
+}
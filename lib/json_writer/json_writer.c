@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#include <string.h>
+#include <json_writer.h>
+
+BUILD_ASSERT(CONFIG_JSON_WRITER_MAX_DEPTH < 32,
+	     "Nesting depth must fit in the need_comma bit field");
+
+/* Large enough for "%1.17g" of any double, same as used by cJSON. */
+#define NUMBER_BUF_SIZE 26
+
+static void put(struct json_writer *writer, const char *data, size_t len)
+{
+	if ((writer->buf != NULL) && (writer->len < writer->size)) {
+		size_t space = writer->size - writer->len;
+
+		memcpy(&writer->buf[writer->len], data, MIN(len, space));
+	}
+
+	writer->len += len;
+}
+
+static void put_char(struct json_writer *writer, char c)
+{
+	put(writer, &c, 1);
+}
+
+static void put_string(struct json_writer *writer, const char *str)
+{
+	const char *start;
+
+	put_char(writer, '"');
+
+	if (str == NULL) {
+		put_char(writer, '"');
+		return;
+	}
+
+	/* Copy runs of characters that do not need escaping in one go. */
+	for (start = str; *str != '\0'; str++) {
+		unsigned char c = (unsigned char)*str;
+		char escaped[7];
+		size_t escaped_len = 2;
+
+		if ((c > 31) && (c != '"') && (c != '\\')) {
+			continue;
+		}
+
+		put(writer, start, str - start);
+		start = str + 1;
+
+		escaped[0] = '\\';
+
+		switch (c) {
+		case '\\':
+		case '"':
+			escaped[1] = c;
+			break;
+		case '\b':
+			escaped[1] = 'b';
+			break;
+		case '\f':
+			escaped[1] = 'f';
+			break;
+		case '\n':
+			escaped[1] = 'n';
+			break;
+		case '\r':
+			escaped[1] = 'r';
+			break;
+		case '\t':
+			escaped[1] = 't';
+			break;
+		default:
+			escaped_len = 1 + snprintf(&escaped[1],
+						   sizeof(escaped) - 1,
+						   "u%04x", c);
+			break;
+		}
+
+		put(writer, escaped, escaped_len);
+	}
+
+	put(writer, start, str - start);
+	put_char(writer, '"');
+}
+
+/* Write the separator and key that precede any item. */
+static void item_begin(struct json_writer *writer, const char *key)
+{
+	uint32_t level_bit = BIT(writer->depth);
+
+	if (writer->need_comma & level_bit) {
+		put_char(writer, ',');
+	}
+
+	writer->need_comma |= level_bit;
+
+	if (key != NULL) {
+		put_string(writer, key);
+		put_char(writer, ':');
+	}
+}
+
+static void container_start(struct json_writer *writer, const char *key,
+			    char open)
+{
+	item_begin(writer, key);
+	put_char(writer, open);
+
+	if (writer->depth >= CONFIG_JSON_WRITER_MAX_DEPTH) {
+		writer->invalid = true;
+		return;
+	}
+
+	writer->depth++;
+	writer->need_comma &= ~BIT(writer->depth);
+}
+
+static void container_end(struct json_writer *writer, char close)
+{
+	if (writer->depth == 0) {
+		writer->invalid = true;
+		return;
+	}
+
+	writer->depth--;
+	put_char(writer, close);
+}
+
+void json_writer_init(struct json_writer *writer, char *buf, size_t size)
+{
+	__ASSERT_NO_MSG(writer != NULL);
+
+	writer->buf = buf;
+	writer->size = buf ? size : 0;
+	writer->len = 0;
+	writer->depth = 0;
+	writer->need_comma = 0;
+	writer->invalid = false;
+}
+
+void json_writer_obj_start(struct json_writer *writer, const char *key)
+{
+	container_start(writer, key, '{');
+}
+
+void json_writer_obj_end(struct json_writer *writer)
+{
+	container_end(writer, '}');
+}
+
+void json_writer_arr_start(struct json_writer *writer, const char *key)
+{
+	container_start(writer, key, '[');
+}
+
+void json_writer_arr_end(struct json_writer *writer)
+{
+	container_end(writer, ']');
+}
+
+void json_writer_str(struct json_writer *writer, const char *key,
+		     const char *value)
+{
+	item_begin(writer, key);
+	put_string(writer, value);
+}
+
+void json_writer_num(struct json_writer *writer, const char *key,
+		     double value)
+{
+	char buf[NUMBER_BUF_SIZE];
+	double test;
+	int len;
+
+	item_begin(writer, key);
+
+	/* This checks for NaN and infinity. */
+	if ((value * 0) != 0) {
+		put(writer, "null", strlen("null"));
+		return;
+	}
+
+	/* Same formatting as cJSON: try 15 digits of precision, and fall back
+	 * to 17 if the value can not be recovered from the shorter form.
+	 */
+	len = snprintf(buf, sizeof(buf), "%1.15g", value);
+	if ((sscanf(buf, "%lg", &test) != 1) || (test != value)) {
+		len = snprintf(buf, sizeof(buf), "%1.17g", value);
+	}
+
+	if ((len < 0) || (len >= (int)sizeof(buf))) {
+		writer->invalid = true;
+		return;
+	}
+
+	put(writer, buf, len);
+}
+
+void json_writer_int(struct json_writer *writer, const char *key,
+		     int32_t value)
+{
+	char buf[sizeof("-2147483648")];
+	int len;
+
+	item_begin(writer, key);
+
+	len = snprintf(buf, sizeof(buf), "%d", value);
+	put(writer, buf, len);
+}
+
+void json_writer_bool(struct json_writer *writer, const char *key,
+		      bool value)
+{
+	item_begin(writer, key);
+
+	if (value) {
+		put(writer, "true", strlen("true"));
+	} else {
+		put(writer, "false", strlen("false"));
+	}
+}
+
+void json_writer_null(struct json_writer *writer, const char *key)
+{
+	item_begin(writer, key);
+	put(writer, "null", strlen("null"));
+}
+
+int json_writer_finish(struct json_writer *writer)
+{
+	if (writer->invalid || (writer->depth != 0)) {
+		return -EINVAL;
+	}
+
+	if (writer->buf == NULL) {
+		return writer->len;
+	}
+
+	if (writer->len >= writer->size) {
+		if (writer->size > 0) {
+			writer->buf[writer->size - 1] = '\0';
+		}
+
+		return -ENOMEM;
+	}
+
+	writer->buf[writer->len] = '\0';
+
+	return writer->len;
+}
+
+int json_writer_encode_alloc(json_writer_pass_t pass, const void *ctx,
+			     const struct json_writer_allocator *allocator,
+			     char **buf)
+{
+	char *buffer;
+	int len;
+
+	__ASSERT_NO_MSG((pass != NULL) && (allocator != NULL) &&
+			(buf != NULL));
+
+	len = pass(NULL, 0, ctx);
+	if (len < 0) {
+		return len;
+	}
+
+	buffer = allocator->alloc(len + 1);
+	if (buffer == NULL) {
+		return -ENOMEM;
+	}
+
+	len = pass(buffer, len + 1, ctx);
+	if (len < 0) {
+		allocator->free(buffer);
+		return len;
+	}
+
+	*buf = buffer;
+
+	return len;
+}
@@ -10,15 +10,9 @@
 #include "model_handler.h"
 #include "lc_pwm_led.h"
 
-#define PWM_SIZE_STEP 512
-
 struct lightness_ctx {
 	struct bt_mesh_lightness_srv lightness_srv;
-	struct k_delayed_work per_work;
-	uint16_t target_lvl;
-	uint16_t current_lvl;
-	uint32_t time_per;
-	uint16_t rem_time;
+	struct bt_mesh_transition transition;
 };
 
 /** Configuration server definition */
@@ -74,44 +68,39 @@ static struct bt_mesh_health_srv health_srv = {
 
 BT_MESH_HEALTH_PUB_DEFINE(health_pub, 0);
 
-static void start_new_light_trans(const struct bt_mesh_lightness_set *set,
-				  struct lightness_ctx *ctx)
+static void light_status(struct lightness_ctx *l_ctx,
+			 struct bt_mesh_lightness_status *status)
 {
-	uint32_t step_cnt = abs(set->lvl - ctx->current_lvl) / PWM_SIZE_STEP;
-
-	k_delayed_work_cancel(&ctx->per_work);
-	ctx->target_lvl = set->lvl;
-	ctx->time_per = (step_cnt ? set->transition->time / step_cnt : 0);
-	ctx->rem_time = set->transition->time + set->transition->delay;
-	k_delayed_work_submit(&ctx->per_work, K_MSEC(set->transition->delay));
+	status->current = bt_mesh_transition_level_get(&l_ctx->transition);
+	status->target = bt_mesh_transition_target_get(&l_ctx->transition);
+	status->remaining_time =
+		bt_mesh_transition_remaining_get(&l_ctx->transition);
+}
 
-	printk("New light transition-> Lvl: %d, Time: %d, Delay: %d\n",
-	       set->lvl, set->transition->time, set->transition->delay);
+static void light_step(struct bt_mesh_transition *transition, int32_t level)
+{
+	lc_pwm_led_set(level);
 }
 
-static void periodic_led_work(struct k_work *work)
+static void light_end(struct bt_mesh_transition *transition)
 {
 	struct lightness_ctx *l_ctx =
-		CONTAINER_OF(work, struct lightness_ctx, per_work);
-	l_ctx->rem_time -= l_ctx->time_per;
-
-	if ((l_ctx->rem_time <= l_ctx->time_per) ||
-	    (abs(l_ctx->target_lvl - l_ctx->current_lvl) <= PWM_SIZE_STEP)) {
-		l_ctx->current_lvl = l_ctx->target_lvl;
-		l_ctx->rem_time = 0;
-		goto apply_and_print;
-	} else if (l_ctx->target_lvl > l_ctx->current_lvl) {
-		l_ctx->current_lvl += PWM_SIZE_STEP;
-	} else {
-		l_ctx->current_lvl -= PWM_SIZE_STEP;
-	}
+		CONTAINER_OF(transition, struct lightness_ctx, transition);
+	struct bt_mesh_lightness_status status;
 
-	k_delayed_work_submit(&l_ctx->per_work, K_MSEC(l_ctx->time_per));
-apply_and_print:
-	lc_pwm_led_set(l_ctx->current_lvl);
-	printk("Current light lvl: %u/65535\n", l_ctx->current_lvl);
+	printk("Current light lvl: %d/65535\n",
+	       bt_mesh_transition_level_get(transition));
+
+	/* Publish the new value at the end of the transition */
+	light_status(l_ctx, &status);
+	bt_mesh_lightness_srv_pub(&l_ctx->lightness_srv, NULL, &status);
 }
 
+static const struct bt_mesh_transition_cb transition_cb = {
+	.step = light_step,
+	.end = light_end,
+};
+
 static void light_set(struct bt_mesh_lightness_srv *srv,
 		      struct bt_mesh_msg_ctx *ctx,
 		      const struct bt_mesh_lightness_set *set,
@@ -120,10 +109,12 @@ static void light_set(struct bt_mesh_lightness_srv *srv,
 	struct lightness_ctx *l_ctx =
 		CONTAINER_OF(srv, struct lightness_ctx, lightness_srv);
 
-	start_new_light_trans(set, l_ctx);
-	rsp->current = l_ctx->current_lvl;
-	rsp->target = l_ctx->target_lvl;
-	rsp->remaining_time = set->transition->time + set->transition->delay;
+	bt_mesh_transition_start(&l_ctx->transition, set->lvl,
+				 set->transition);
+	light_status(l_ctx, rsp);
+
+	printk("New light transition-> Lvl: %d, Time: %d, Delay: %d\n",
+	       set->lvl, set->transition->time, set->transition->delay);
 }
 
 static void light_get(struct bt_mesh_lightness_srv *srv,
@@ -133,9 +124,7 @@ static void light_get(struct bt_mesh_lightness_srv *srv,
 	struct lightness_ctx *l_ctx =
 		CONTAINER_OF(srv, struct lightness_ctx, lightness_srv);
 
-	rsp->current = l_ctx->current_lvl;
-	rsp->target = l_ctx->target_lvl;
-	rsp->remaining_time = l_ctx->rem_time;
+	light_status(l_ctx, rsp);
 }
 
 static const struct bt_mesh_lightness_srv_handlers lightness_srv_handlers = {
@@ -145,7 +134,7 @@ static const struct bt_mesh_lightness_srv_handlers lightness_srv_handlers = {
 
 static struct lightness_ctx my_ctx = {
 	.lightness_srv = BT_MESH_LIGHTNESS_SRV_INIT(&lightness_srv_handlers),
-
+	.transition = BT_MESH_TRANSITION_INIT(&transition_cb),
 };
 
 static struct bt_mesh_light_ctrl_srv light_ctrl_srv =
@@ -176,7 +165,6 @@ const struct bt_mesh_comp *model_handler_init(void)
 	int err;
 
 	k_delayed_work_init(&attention_blink_work, attention_blink);
-	k_delayed_work_init(&my_ctx.per_work, periodic_led_work);
 
 	err = bt_mesh_light_ctrl_srv_enable(&light_ctrl_srv);
 	if (!err) {
@@ -110,6 +110,18 @@ class NrfHidTransport():
 
         return (rcpt, event_id, status, event_data)
 
+    @staticmethod
+    def send_feature_report(dev, recipient, event_id, status, event_data):
+        # Send the request without fetching the response. The device rejects
+        # the report while it is still processing the previous request.
+        data = NrfHidTransport._create_feature_report(recipient, event_id, status, event_data)
+
+        try:
+            return dev.send_feature_report(data) >= 0
+        except Exception as e:
+            logging.debug('Send feature report problem: {}'.format(e))
+            return False
+
     @staticmethod
     def exchange_feature_report(dev, recipient, event_id, status, event_data,
                                 poll_interval=POLL_INTERVAL_DEFAULT):
@@ -462,3 +474,20 @@ class NrfHidDevice():
 
     def config_set(self, module_name, option_name, value, poll_interval=POLL_INTERVAL_DEFAULT):
         return self._config_operation(module_name, option_name, False, value, poll_interval)
+
+    def config_send(self, module_name, option_name, value):
+        # Set the option without waiting for the response. Returns False if
+        # the device did not accept the request, for example because it is
+        # still busy with the previous one.
+        if not self.initialized():
+            print("Device not found")
+            return False
+
+        try:
+            event_id = NrfHidDevice._get_event_id(module_name, option_name, self.dev_config)
+        except KeyError:
+            print("No module: {} or option: {}".format(module_name, option_name))
+            return False
+
+        return NrfHidTransport.send_feature_report(self.dev_ptr, self.pid, event_id,
+                                                   ConfigStatus.SET, value)
@@ -22,6 +22,16 @@ FLASH_PAGE_SIZE = 4096
 DFU_SYNC_RETRIES = 3
 DFU_SYNC_INTERVAL = 1
 
+# Flag in the start request that selects the windowed transfer.
+DFU_START_FLAG_WINDOW = 0x01
+# Attempts to send a request while the device is busy with the previous one.
+# The interval between the attempts doubles up to the maximum.
+DFU_SEND_RETRIES = 200
+DFU_SEND_RETRY_INTERVAL = 0.001
+DFU_SEND_RETRY_INTERVAL_MAX = 0.05
+# Attempts to send a window that the device rejects.
+DFU_WINDOW_RETRIES = 3
+
 
 class FwInfo:
     def __init__(self, fetched_data):
@@ -327,15 +337,29 @@ def dfu_sync(dev):
     if (fetched_data is None) or (len(fetched_data) < struct.calcsize(fmt)):
         return None
 
-    return struct.unpack(fmt, fetched_data)
+    dfu_info = struct.unpack(fmt, fetched_data[:struct.calcsize(fmt)])
+
+    # Devices that support the windowed transfer append the window size.
+    window_fmt = '<H'
+    window_data = fetched_data[struct.calcsize(fmt):]
+
+    if len(window_data) >= struct.calcsize(window_fmt):
+        window_size = struct.unpack(window_fmt, window_data[:struct.calcsize(window_fmt)])[0]
+    else:
+        window_size = 0
+
+    return dfu_info + (window_size,)
 
 
-def dfu_start(dev, img_length, img_csum, offset):
+def dfu_start(dev, img_length, img_csum, offset, flags=0):
     # Start DFU operation at selected offset.
     # It can happen that device will reject this request - this will be
     # verified by dfu sync at data exchange.
     event_data = struct.pack('<III', img_length, img_csum, offset)
 
+    if flags:
+        event_data += struct.pack('<B', flags)
+
     success = dev.config_set('dfu', 'start', event_data)
 
     if success:
@@ -400,8 +424,16 @@ def dfu_transfer(dev, dfu_image, progress_callback):
         return False
 
     offset = get_dfu_operation_offset(dfu_image, dfu_info, img_csum)
+    start_offset = offset
+
+    window_size = dfu_info[4]
+
+    if window_size > 0:
+        flags = DFU_START_FLAG_WINDOW
+    else:
+        flags = 0
 
-    success = dfu_start(dev, img_length, img_csum, offset)
+    success = dfu_start(dev, img_length, img_csum, offset, flags)
 
     if not success:
         print('Cannot start DFU operation')
@@ -409,15 +441,23 @@ def dfu_transfer(dev, dfu_image, progress_callback):
 
     img_file = open(dfu_image, 'rb')
     img_file.seek(offset)
+    start_time = time.time()
 
     try:
-        offset, success = send_chunk(dev, img_csum, img_file, img_length, offset, success, progress_callback)
+        if window_size > 0:
+            offset, success = send_window(dev, img_csum, img_file, img_length, offset,
+                                          window_size, progress_callback)
+        else:
+            offset, success = send_chunk(dev, img_csum, img_file, img_length, offset, success,
+                                         progress_callback)
     except Exception:
         success = False
 
     img_file.close()
     print('')
 
+    transfer_report(offset - start_offset, time.time() - start_time, window_size)
+
     if success:
         print('DFU transfer completed')
         success = False
@@ -476,6 +516,109 @@ def send_chunk(dev, img_csum, img_file, img_length, offset, success, progress_ca
     return offset, success
 
 
+def send_with_backoff(send):
+    interval = DFU_SEND_RETRY_INTERVAL
+
+    for _ in range(DFU_SEND_RETRIES):
+        if send():
+            return True
+        time.sleep(interval)
+        interval = min(2 * interval, DFU_SEND_RETRY_INTERVAL_MAX)
+
+    return False
+
+
+def send_window_data(dev, window_data):
+    # Stream the chunks back to back, without fetching the responses. Retry
+    # a chunk only if the device did not accept it because it was busy.
+    for pos in range(0, len(window_data), EVENT_DATA_LEN_MAX):
+        chunk_data = window_data[pos:pos + EVENT_DATA_LEN_MAX]
+
+        if not send_with_backoff(lambda: dev.config_send('dfu', 'data', chunk_data)):
+            return False
+
+    return True
+
+
+def send_window_end(dev, offset, window_data):
+    event_data = struct.pack('<III', offset, len(window_data), zlib.crc32(window_data))
+
+    # The device can still be busy with the last data chunk.
+    return send_with_backoff(lambda: dev.config_set('dfu', 'window', event_data))
+
+
+def send_window(dev, img_csum, img_file, img_length, offset, window_size, progress_callback):
+    success = False
+    retries = DFU_WINDOW_RETRIES
+
+    while offset < img_length:
+        # Windows end at window size boundaries, so that the device writes
+        # whole flash pages.
+        window_len = min(window_size - offset % window_size, img_length - offset)
+
+        img_file.seek(offset)
+        window_data = img_file.read(window_len)
+
+        if len(window_data) == 0:
+            break
+
+        logging.debug('Send DFU window: offset {}, size {}'.format(offset, len(window_data)))
+
+        progress_callback(int(offset / img_length * 1000))
+
+        success = send_window_data(dev, window_data) and \
+                  send_window_end(dev, offset, window_data)
+
+        if not success:
+            print('Lost communication with the device')
+            break
+
+        # The device acknowledges the whole window by moving its offset.
+        success = False
+        dfu_info = dfu_sync(dev)
+
+        if dfu_info is None:
+            print('Lost communication with the device')
+            break
+        if dfu_info[0] == 0 and dfu_info[3] != img_length:
+            print('DFU interrupted by device')
+            break
+        if (dfu_info[1] != img_length) or (dfu_info[2] != img_csum):
+            print('Invalid sync information')
+            break
+
+        if dfu_info[3] == offset + len(window_data):
+            offset = dfu_info[3]
+            retries = DFU_WINDOW_RETRIES
+            success = True
+        elif dfu_info[3] == offset:
+            retries -= 1
+            if retries == 0:
+                print('DFU window rejected by device')
+                break
+            logging.debug('DFU window rejected, sending it again')
+        else:
+            print('Invalid sync information')
+            break
+
+    return offset, success
+
+
+def transfer_report(transferred, elapsed, window_size):
+    if window_size > 0:
+        mode = 'windowed, {} B window'.format(window_size)
+    else:
+        mode = 'chunk by chunk'
+
+    if elapsed > 0:
+        throughput = transferred / elapsed / 1024
+    else:
+        throughput = 0
+
+    print('Transferred {} B in {:.1f} s ({:.2f} KiB/s, {})'.format(transferred, elapsed,
+                                                                 throughput, mode))
+
+
 def get_dfu_operation_offset(dfu_image, dfu_info, img_csum):
     # Check if the previously interrupted DFU operation can be resumed.
     img_length = os.stat(dfu_image).st_size
@@ -8,6 +8,7 @@ from stats_nordic import StatsNordic
 import sys
 import argparse
 import logging
+import os
 
 
 def main():
@@ -16,6 +17,8 @@ def main():
     parser.add_argument('--start_time', help='Measurement start time[s]')
     parser.add_argument('--end_time', help='Measurement end time[s]')
     parser.add_argument('--log', help='Log level')
+    parser.add_argument('--summary', action='store_true',
+                        help='Print statistics of all events instead of plots')
     args = parser.parse_args()
 
     if args.log is not None:
@@ -33,9 +36,16 @@ def main():
     else:
         args.end_time = float(args.end_time)
 
-    sn = StatsNordic(args.dataset_name + ".csv", args.dataset_name + ".json",
-                     log_lvl_number)
-    sn.calculate_stats_preset1(args.start_time, args.end_time)
+    if os.path.isdir(args.dataset_name + ".trace"):
+        sn = StatsNordic(args.dataset_name + ".trace", None, log_lvl_number)
+    else:
+        sn = StatsNordic(args.dataset_name + ".csv",
+                         args.dataset_name + ".json", log_lvl_number)
+
+    if args.summary:
+        sn.calculate_stats_summary(args.start_time, args.end_time)
+    else:
+        sn.calculate_stats_preset1(args.start_time, args.end_time)
 
 if __name__ == "__main__":
     main()
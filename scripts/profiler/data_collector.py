@@ -17,6 +17,9 @@ def main():
     parser.add_argument('time', type=int, help='Time of collecting data [s]')
     parser.add_argument('dataset_name', help='Name of dataset')
     parser.add_argument('--log', help='Log level')
+    parser.add_argument('--format', choices=['csv', 'trace'], default='csv',
+                        help='Format of saved data. Trace store is written '
+                             'while events are received')
     args = parser.parse_args()
 
     if args.log is not None:
@@ -30,11 +33,17 @@ def main():
     signal.signal(signal.SIGINT, sigint_handler)
     end_ev = threading.Event()
 
-    profiler = RttNordicProfilerHost(
-                event_filename=args.dataset_name + ".csv",
-                finish_event=end_ev,
-                event_types_filename=args.dataset_name + ".json",
-                log_lvl=log_lvl_number)
+    if args.format == 'trace':
+        profiler = RttNordicProfilerHost(
+                    finish_event=end_ev,
+                    trace_dirname=args.dataset_name + ".trace",
+                    log_lvl=log_lvl_number)
+    else:
+        profiler = RttNordicProfilerHost(
+                    event_filename=args.dataset_name + ".csv",
+                    finish_event=end_ev,
+                    event_types_filename=args.dataset_name + ".json",
+                    log_lvl=log_lvl_number)
     profiler.get_events_descriptions()
     profiler.read_events_rtt(args.time)
 
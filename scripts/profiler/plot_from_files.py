@@ -7,6 +7,7 @@ from plot_nordic import PlotNordic
 import sys
 import argparse
 import logging
+import os
 
 def main():
     parser = argparse.ArgumentParser(
@@ -21,8 +22,11 @@ def main():
 	    log_lvl_number = logging.WARNING
 
     pn = PlotNordic(log_lvl=log_lvl_number)
-    pn.read_data_from_files(args.dataset_name + ".csv",
-                            args.dataset_name + ".json")
+    if os.path.isdir(args.dataset_name + ".trace"):
+        pn.read_data_from_trace(args.dataset_name + ".trace")
+    else:
+        pn.read_data_from_files(args.dataset_name + ".csv",
+                                args.dataset_name + ".json")
     pn.plot_events_from_file()
     pn.log_stats('log')
 
@@ -17,6 +17,7 @@ import logging
 
 from events import TrackedEvent
 from processed_events import ProcessedEvents
+from trace_store import TraceStore
 from plot_nordic_config import PlotNordicConfig
 
 
@@ -89,6 +90,9 @@ class PlotNordic():
         if not self.processed_events.raw_data.verify():
             self.logger.warning("Missing event descriptions")
 
+    def read_data_from_trace(self, dirname):
+        self.processed_events.raw_data = TraceStore(dirname).to_events_data()
+
     def write_data_to_files(self, events_filename, events_types_filename):
         self.processed_events.raw_data.write_data_to_files(
             events_filename, events_types_filename)
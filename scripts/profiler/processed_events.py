@@ -4,6 +4,7 @@
 # SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
 
 from events import EventsData, TrackedEvent
+from trace_analysis import events_data_columns, match_processing
 import logging
 import sys
 
@@ -40,24 +41,17 @@ class ProcessedEvents():
                 self.tracked_events.append(TrackedEvent(ev, None, None))
             return
 
-        for i in range(1, len(self.raw_data.events)):
-            if self.raw_data.events[i].type_id == self.event_processing_start_id:
-                self.start_event = self.raw_data.events[i]
-                for j in range(i - 1, -1, -1):
-                    # comparing memory addresses of event processing start
-                    # and event submit to identify matching events
-                    if self.raw_data.events[j].data[0] == self.start_event.data[0]:
-                        self.submit_event = self.raw_data.events[j]
-                        break
-
-            # comparing memory addresses of event processing start and end
-            # to identify matching events
-            if self.raw_data.events[i].type_id == self.event_processing_end_id:
-                if self.submit_event is not None \
-                        and self.raw_data.events[i].data[0] == self.start_event.data[0]:
-                    self.tracked_events.append(
-                        TrackedEvent(
-                            self.submit_event,
-                            self.start_event.timestamp,
-                            self.raw_data.events[i].timestamp))
-                    self.submit_event = None
+        events = self.raw_data.events
+        type_ids, addresses, timestamps = events_data_columns(self.raw_data)
+
+        # Memory addresses of event submit, processing start and end are
+        # compared to identify matching events.
+        match = match_processing(type_ids, addresses, timestamps,
+                                 self.event_processing_start_id,
+                                 self.event_processing_end_id)
+
+        for row, start_time, end_time in zip(match.submit_rows.tolist(),
+                                             match.proc_start_times.tolist(),
+                                             match.proc_end_times.tolist()):
+            self.tracked_events.append(TrackedEvent(events[row], start_time,
+                                                    end_time))
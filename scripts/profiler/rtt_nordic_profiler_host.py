@@ -10,6 +10,7 @@ import sys
 from enum import Enum
 from rtt_nordic_config import RttNordicConfig
 from events import Event, EventType, EventsData
+from trace_store import TraceWriter
 import logging
 
 class Command(Enum):
@@ -22,9 +23,12 @@ class RttNordicProfilerHost:
 
     def __init__(self, config=RttNordicConfig, finish_event=None,
                  queue=None, event_filename=None,
-                 event_types_filename=None, log_lvl=logging.WARNING):
+                 event_types_filename=None, trace_dirname=None,
+                 log_lvl=logging.WARNING):
         self.event_filename = event_filename
         self.event_types_filename = event_types_filename
+        self.trace_dirname = trace_dirname
+        self.trace_writer = None
         self.config = config
         self.finish_event = finish_event
         self.queue = queue
@@ -94,6 +98,8 @@ class RttNordicProfilerHost:
         if self.event_filename and self.event_types_filename:
             self.received_events.write_data_to_files(self.event_filename,
                                                      self.event_types_filename)
+        if self.trace_writer is not None:
+            self.trace_writer.close()
 
     def disconnect(self):
         self.stop_logging_events()
@@ -225,6 +231,10 @@ class RttNordicProfilerHost:
     def get_events_descriptions(self):
         self._send_command(Command.INFO)
         self._read_all_events_descriptions()
+        if self.trace_dirname is not None:
+            self.trace_writer = TraceWriter(
+                self.trace_dirname,
+                self.received_events.registered_events_types)
         if self.queue is not None:
             self.queue.put(self.received_events.registered_events_types)
         self.logger.info("Received events descriptions")
@@ -265,13 +275,21 @@ class RttNordicProfilerHost:
                                        signed=signum))
         return Event(id, timestamp, data)
 
+    def _store_event(self, event):
+        # Events written to trace store are kept in memory only if they
+        # are also saved to CSV, so long captures do not fill the memory.
+        if self.trace_writer is None or self.event_filename:
+            self.received_events.events.append(event)
+        if self.trace_writer is not None:
+            self.trace_writer.add_event(event)
+        if self.queue is not None:
+            self.queue.put(event)
+
     def _read_remaining_events(self):
         self.reading_data = False
         while self.bcnt != 0:
             event = self._read_single_event_rtt()
-            self.received_events.events.append(event)
-            if self.queue is not None:
-                self.queue.put(event)
+            self._store_event(event)
 
         # End of transmission
         if self.queue is not None:
@@ -284,9 +302,7 @@ class RttNordicProfilerHost:
         current_time = start_time
         while current_time - start_time < time_seconds or time_seconds < 0:
             event = self._read_single_event_rtt()
-            self.received_events.events.append(event)
-            if self.queue is not None:
-                self.queue.put(event)
+            self._store_event(event)
             current_time = time.time()
         self.logger.info("Real time transmission closed")
         self.shutdown()
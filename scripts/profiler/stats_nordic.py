@@ -4,7 +4,10 @@
 # SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
 
 from events import EventsData
-from processed_events import ProcessedEvents
+from trace_store import TraceStore
+from trace_analysis import ProcessingMatch, events_data_columns, \
+                           match_processing, processing_stats, \
+                           throughput_stats
 from enum import Enum
 import matplotlib.pyplot as plt
 import numpy as np
@@ -25,10 +28,31 @@ class EventState(Enum):
 class StatsNordic():
     def __init__(self, events_filename, events_types_filename, log_lvl):
         self.data_name = events_filename.split('.')[0]
-        self.processed_data = ProcessedEvents()
-        self.processed_data.raw_data.read_data_from_files(
-                                      events_filename, events_types_filename)
-        self.processed_data.match_event_processing()
+
+        if os.path.isdir(events_filename):
+            store = TraceStore(events_filename)
+            self.registered_events_types = store.registered_events_types
+            self.type_ids = store.type_ids
+            self.timestamps = store.timestamps
+            addresses = store.first_fields()
+        else:
+            raw_data = EventsData([], {})
+            raw_data.read_data_from_files(events_filename,
+                                          events_types_filename)
+            self.registered_events_types = raw_data.registered_events_types
+            self.type_ids, addresses, self.timestamps = \
+                events_data_columns(raw_data)
+
+        start_id = self._get_event_type_id('event_processing_start')
+        end_id = self._get_event_type_id('event_processing_end')
+        self.tracking_execution = (start_id is not None) and \
+                                  (end_id is not None)
+
+        if self.tracking_execution:
+            self.match = match_processing(self.type_ids, addresses,
+                                          self.timestamps, start_id, end_id)
+        else:
+            self.match = None
 
         self.logger = logging.getLogger('Stats Nordic')
         self.logger_console = logging.StreamHandler()
@@ -38,6 +62,12 @@ class StatsNordic():
         self.logger_console.setFormatter(self.log_format)
         self.logger.addHandler(self.logger_console)
 
+    def _get_event_type_id(self, type_name):
+        for key, value in self.registered_events_types.items():
+            if type_name == value.name:
+                return key
+        return None
+
     def calculate_stats_preset1(self, start_meas, end_meas):
         self.time_between_events("hid_mouse_event_dongle", EventState.SUBMIT,
                                  "hid_report_sent_event_device", EventState.SUBMIT,
@@ -57,34 +87,61 @@ class StatsNordic():
         plt.show()
 
     def _get_timestamps(self, event_name, event_state, start_meas, end_meas):
-        event_type_id = self.processed_data.raw_data.get_event_type_id(event_name)
+        event_type_id = self._get_event_type_id(event_name)
         if event_type_id == None:
             self.logger.error("Event name not found: " + event_name)
             return None
 
-        trackings = list(filter(lambda x:
-                      x.submit.type_id == event_type_id,
-                      self.processed_data.tracked_events))
-
         if type(event_state) is not EventState:
             self.logger.error("Event state should be EventState enum")
             return None
 
-        if event_state == EventState.SUBMIT:
-            timestamps = np.fromiter(map(lambda x: x.submit.timestamp, trackings),
-                                     dtype=np.float)
-        elif event_state == EventState.PROC_START:
-            timestamps = np.fromiter(map(lambda x: x.proc_start_time, trackings),
-                                     dtype=np.float)
-        elif event_state == EventState.PROC_END:
-            timestamps = np.fromiter(map(lambda x: x.proc_end_time, trackings),
-                                     dtype=np.float)
+        if self.match is None:
+            timestamps = self.timestamps[self.type_ids == event_type_id]
+        else:
+            selected = self.match.type_ids == event_type_id
+
+            if event_state == EventState.SUBMIT:
+                timestamps = self.match.submit_times[selected]
+            elif event_state == EventState.PROC_START:
+                timestamps = self.match.proc_start_times[selected]
+            elif event_state == EventState.PROC_END:
+                timestamps = self.match.proc_end_times[selected]
 
         timestamps = timestamps[np.where((timestamps > start_meas)
                                          & (timestamps < end_meas))]
 
         return timestamps
 
+    def calculate_stats_summary(self, start_meas=0, end_meas=float('inf')):
+        """Print number of events, event rate and processing latencies
+        for every event type."""
+        in_range = (self.timestamps > start_meas) & (self.timestamps < end_meas)
+        throughput = throughput_stats(self.type_ids[in_range],
+                                      self.timestamps[in_range])
+
+        latencies = {}
+        if self.match is not None:
+            selected = (self.match.submit_times > start_meas) & \
+                       (self.match.submit_times < end_meas)
+            latencies = processing_stats(ProcessingMatch(
+                *(field[selected] for field in self.match)))
+
+        header = "{:<40} {:>10} {:>10}".format("Event", "Count", "Rate[1/s]")
+        print(header)
+        for type_id, (count, rate) in sorted(throughput.items()):
+            name = self.registered_events_types[type_id].name
+            print("{:<40} {:>10} {:>10.1f}".format(name, count, rate))
+
+            if type_id not in latencies:
+                continue
+
+            for stage, stats in latencies[type_id].items():
+                print("    {:<16} mean {:.3f} ms, median {:.3f} ms, "
+                      "p99 {:.3f} ms, max {:.3f} ms".format(
+                          stage, stats.mean, stats.median, stats.p99,
+                          stats.max))
+
     def calculate_times_between(self, start_times, end_times):
         if end_times[0] <= start_times[0]:
             end_times = end_times[1:]
@@ -113,7 +170,7 @@ class StatsNordic():
                             start_meas=0, end_meas=float('inf')):
         self.logger.info("Stats calculating: {}->{}".format(start_event_name,
                                                             end_event_name))
-        if not self.processed_data.tracking_execution:
+        if not self.tracking_execution:
             if start_event_state != EventState.SUBMIT or \
               end_event_state != EventState.SUBMIT:
                 self.logger.error("Events processing is not tracked: " + \
@@ -133,7 +190,7 @@ class StatsNordic():
             return
 
         if len(end_times) == 0:
-            self.logger.error("No events logged: " + stop_event_name)
+            self.logger.error("No events logged: " + end_event_name)
             return
 
         if len(start_times) != len(end_times):
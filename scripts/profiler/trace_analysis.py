@@ -0,0 +1,166 @@
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+from collections import namedtuple
+import numpy as np
+
+
+# Event processing matched with the event submit. Every field is an array
+# with one element per tracked event.
+ProcessingMatch = namedtuple('ProcessingMatch',
+                             ['submit_rows', 'type_ids', 'submit_times',
+                              'proc_start_times', 'proc_end_times'])
+
+LatencyStats = namedtuple('LatencyStats',
+                          ['count', 'min', 'max', 'mean', 'std', 'median',
+                           'p99'])
+
+ADDRESS_SHIFT = np.uint64(32)
+ROW_MASK = np.uint64(0xFFFFFFFF)
+
+
+def events_data_columns(events_data):
+    """Type IDs, first data fields and timestamps of events as arrays."""
+    events = events_data.events
+    type_ids = np.fromiter((ev.type_id for ev in events), dtype=np.int64,
+                           count=len(events))
+    addresses = np.fromiter((ev.data[0] if len(ev.data) > 0 else -1
+                             for ev in events),
+                            dtype=np.int64, count=len(events))
+    timestamps = np.fromiter((ev.timestamp for ev in events),
+                             dtype=np.float64, count=len(events))
+
+    return type_ids, addresses, timestamps
+
+
+def _keys(addresses, rows):
+    # Sorting by the key sorts by address, and then by position in trace.
+    return (addresses.astype(np.uint64) << ADDRESS_SHIFT) | \
+           rows.astype(np.uint64)
+
+
+def match_processing(type_ids, addresses, timestamps, start_id, end_id):
+    """Match event processing start and end with the event submit.
+
+    Processing start and end events carry the address of the processed
+    event, and the event submit has the same address in its first field.
+    Submit is the last event with the address before processing start, and
+    processing end is the first end with the address after the start.
+
+    @param type_ids Type ID of every event in the trace.
+    @param addresses First data field of every event, -1 if there is none.
+    @param timestamps Timestamp of every event.
+    """
+    type_ids = np.asarray(type_ids)
+    addresses = np.asarray(addresses, dtype=np.int64)
+    timestamps = np.asarray(timestamps, dtype=np.float64)
+    rows = np.arange(len(type_ids), dtype=np.int64)
+
+    is_start = type_ids == start_id
+    is_end = type_ids == end_id
+    is_submit = ~is_start & ~is_end & (addresses >= 0)
+
+    submit_keys = np.sort(_keys(addresses[is_submit], rows[is_submit]))
+    end_keys = np.sort(_keys(addresses[is_end], rows[is_end]))
+
+    start_rows = rows[is_start]
+    start_addresses = addresses[is_start].astype(np.uint64)
+    start_keys = _keys(start_addresses, start_rows)
+
+    valid = np.ones(len(start_rows), dtype=bool)
+
+    # Last submit before the start.
+    submit_idx = np.searchsorted(submit_keys, start_keys) - 1
+    valid &= submit_idx >= 0
+    submit_idx = submit_idx.clip(0)
+    if len(submit_keys) > 0:
+        valid &= (submit_keys[submit_idx] >> ADDRESS_SHIFT) == start_addresses
+    else:
+        valid[:] = False
+
+    # First end after the start.
+    end_idx = np.searchsorted(end_keys, start_keys)
+    valid &= end_idx < len(end_keys)
+    end_idx = end_idx.clip(0, max(len(end_keys) - 1, 0))
+    if len(end_keys) > 0:
+        valid &= (end_keys[end_idx] >> ADDRESS_SHIFT) == start_addresses
+    else:
+        valid[:] = False
+
+    submit_rows = (submit_keys[submit_idx[valid]] & ROW_MASK).astype(np.int64)
+    start_rows = start_rows[valid]
+    end_rows = (end_keys[end_idx[valid]] & ROW_MASK).astype(np.int64)
+
+    # If processing of an event did not end, the next start with the same
+    # address gets the same end. Only the last start before the end is
+    # matched.
+    order = np.argsort(end_rows, kind='stable')
+    sorted_end_rows = end_rows[order]
+    last = np.zeros(len(end_rows), dtype=bool)
+    last[order[np.append(sorted_end_rows[1:] != sorted_end_rows[:-1],
+                         True)]] = True
+
+    submit_rows = submit_rows[last]
+    start_rows = start_rows[last]
+    end_rows = end_rows[last]
+
+    return ProcessingMatch(submit_rows, type_ids[submit_rows],
+                           timestamps[submit_rows], timestamps[start_rows],
+                           timestamps[end_rows])
+
+
+def latency_stats(times_ms):
+    if len(times_ms) == 0:
+        return None
+
+    return LatencyStats(len(times_ms), np.min(times_ms), np.max(times_ms),
+                        np.mean(times_ms), np.std(times_ms),
+                        np.median(times_ms), np.percentile(times_ms, 99))
+
+
+def _group_by_type(type_ids):
+    """Split indices of events into groups of the same type."""
+    order = np.argsort(type_ids, kind='stable')
+    sorted_ids = type_ids[order]
+    bounds = np.flatnonzero(np.diff(sorted_ids)) + 1
+    return zip(sorted_ids[np.append(0, bounds)] if len(order) > 0 else [],
+               np.split(order, bounds) if len(order) > 0 else [])
+
+
+def processing_stats(match):
+    """Latency statistics per submitted event type.
+
+    Return a dictionary with a type ID as the key, and a dictionary with
+    submit to processing start, processing start to end and submit to
+    processing end statistics as the value. Times are in milliseconds.
+    """
+    submit_to_start = (match.proc_start_times - match.submit_times) * 1000
+    processing = (match.proc_end_times - match.proc_start_times) * 1000
+    submit_to_end = (match.proc_end_times - match.submit_times) * 1000
+
+    stats = {}
+    for type_id, idx in _group_by_type(match.type_ids):
+        stats[int(type_id)] = {
+            'submit_to_start': latency_stats(submit_to_start[idx]),
+            'processing': latency_stats(processing[idx]),
+            'submit_to_end': latency_stats(submit_to_end[idx]),
+        }
+
+    return stats
+
+
+def throughput_stats(type_ids, timestamps):
+    """Number of events and events per second for every event type."""
+    type_ids = np.asarray(type_ids)
+    timestamps = np.asarray(timestamps, dtype=np.float64)
+
+    stats = {}
+    for type_id, idx in _group_by_type(type_ids):
+        times = timestamps[idx]
+        duration = np.max(times) - np.min(times)
+        rate = (len(idx) - 1) / duration if duration > 0 else 0
+        stats[int(type_id)] = (len(idx), rate)
+
+    return stats
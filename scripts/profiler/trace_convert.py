@@ -0,0 +1,30 @@
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+from events import EventsData
+from trace_store import TraceStore
+import argparse
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Convert dataset between CSV and trace store formats.')
+    parser.add_argument('dataset_name', help='Name of dataset')
+    parser.add_argument('--to_csv', action='store_true',
+                        help='Convert trace store to CSV')
+    args = parser.parse_args()
+
+    if args.to_csv:
+        events_data = TraceStore(args.dataset_name + ".trace").to_events_data()
+        events_data.write_data_to_files(args.dataset_name + ".csv",
+                                        args.dataset_name + ".json")
+    else:
+        events_data = EventsData([], {})
+        events_data.read_data_from_files(args.dataset_name + ".csv",
+                                         args.dataset_name + ".json")
+        TraceStore.write_events_data(events_data, args.dataset_name + ".trace")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,235 @@
+#
+# Copyright (c) 2020 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+from events import Event, EventType, EventsData
+import numpy as np
+import json
+import os
+
+
+# Trace store is a directory with one binary file per column. Every event
+# has a type ID and a timestamp. Data fields are stored per event type, as
+# a matrix with one row per event and one column per field, together with
+# an index of the rows of the event type in the whole trace.
+TRACE_STORE_VERSION = 1
+
+META_FILE = 'meta.json'
+TYPE_ID_FILE = 'type_id.bin'
+TIMESTAMP_FILE = 'timestamp.bin'
+
+TYPE_ID_DTYPE = np.dtype('<u2')
+TIMESTAMP_DTYPE = np.dtype('<f8')
+ROW_DTYPE = np.dtype('<i8')
+DATA_DTYPE = np.dtype('<i8')
+
+
+def _rows_file(type_id):
+    return 'type_{}_rows.bin'.format(type_id)
+
+
+def _data_file(type_id):
+    return 'type_{}_data.bin'.format(type_id)
+
+
+def _is_store_file(filename):
+    return filename == META_FILE or \
+           (filename.endswith('.bin') and
+            (filename in (TYPE_ID_FILE, TIMESTAMP_FILE) or
+             filename.startswith('type_')))
+
+
+class TraceWriter():
+    """Append events to a trace store while they are received.
+
+    Events are buffered and appended to the column files in batches. The
+    number of events in the metadata file is updated after each batch, so
+    the store can be read while it is written, and a capture that was
+    interrupted can be read up to the last batch.
+    """
+
+    def __init__(self, dirname, registered_events_types, flush_threshold=65536):
+        self.dirname = dirname
+        self.registered_events_types = registered_events_types
+        self.flush_threshold = flush_threshold
+
+        self.events_cnt = 0
+        self.type_events_cnt = {}
+
+        self.type_ids = []
+        self.timestamps = []
+        self.rows = {}
+        self.data = {}
+
+        os.makedirs(dirname, exist_ok=True)
+        for filename in os.listdir(dirname):
+            if _is_store_file(filename):
+                os.remove(os.path.join(dirname, filename))
+
+        self._write_meta()
+
+    def add_event(self, event):
+        self.type_ids.append(event.type_id)
+        self.timestamps.append(event.timestamp)
+        self.rows.setdefault(event.type_id, []).append(self.events_cnt +
+                                                       len(self.type_ids) - 1)
+        self.data.setdefault(event.type_id, []).extend(event.data)
+
+        if len(self.type_ids) >= self.flush_threshold:
+            self.flush()
+
+    def flush(self):
+        if len(self.type_ids) == 0:
+            return
+
+        self._append(TYPE_ID_FILE, self.type_ids, TYPE_ID_DTYPE)
+        self._append(TIMESTAMP_FILE, self.timestamps, TIMESTAMP_DTYPE)
+
+        for type_id, rows in self.rows.items():
+            self._append(_rows_file(type_id), rows, ROW_DTYPE)
+            self._append(_data_file(type_id), self.data[type_id], DATA_DTYPE)
+            self.type_events_cnt[type_id] = \
+                self.type_events_cnt.get(type_id, 0) + len(rows)
+
+        self.events_cnt += len(self.type_ids)
+
+        self.type_ids = []
+        self.timestamps = []
+        self.rows = {}
+        self.data = {}
+
+        self._write_meta()
+
+    def close(self):
+        self.flush()
+
+    def _append(self, filename, values, dtype):
+        with open(os.path.join(self.dirname, filename), 'ab') as f:
+            np.asarray(values, dtype=dtype).tofile(f)
+
+    def _write_meta(self):
+        meta = {
+            'version': TRACE_STORE_VERSION,
+            'events': self.events_cnt,
+            'type_events': dict((str(k), v)
+                                for k, v in self.type_events_cnt.items()),
+            'event_types': dict((str(k), v.serialize())
+                                for k, v in self.registered_events_types.items()),
+        }
+
+        # Replace the file at once, so that readers never see it partially
+        # written.
+        filename = os.path.join(self.dirname, META_FILE)
+        with open(filename + '.tmp', 'w') as wr:
+            json.dump(meta, wr, indent=4)
+        os.replace(filename + '.tmp', filename)
+
+
+class TraceStore():
+    """Read access to a trace store.
+
+    Columns are loaded as numpy arrays. Data of an event type is loaded
+    when it is accessed for the first time.
+    """
+
+    def __init__(self, dirname):
+        self.dirname = dirname
+
+        with open(os.path.join(dirname, META_FILE), 'r') as rd:
+            meta = json.load(rd)
+
+        if meta['version'] != TRACE_STORE_VERSION:
+            raise ValueError('Unsupported trace store version: {}'.format(
+                             meta['version']))
+
+        self.registered_events_types = dict(
+            (int(k), EventType.deserialize(v))
+            for k, v in meta['event_types'].items())
+        self.type_events_cnt = dict((int(k), v)
+                                    for k, v in meta['type_events'].items())
+
+        events_cnt = meta['events']
+        self.type_ids = self._load(TYPE_ID_FILE, TYPE_ID_DTYPE, events_cnt)
+        self.timestamps = self._load(TIMESTAMP_FILE, TIMESTAMP_DTYPE,
+                                     events_cnt)
+
+        self._rows = {}
+        self._data = {}
+
+    def __len__(self):
+        return len(self.type_ids)
+
+    def _load(self, filename, dtype, count):
+        path = os.path.join(self.dirname, filename)
+        if count == 0:
+            return np.empty(0, dtype=dtype)
+
+        values = np.fromfile(path, dtype=dtype, count=count)
+        if len(values) != count:
+            raise ValueError('Trace store file is truncated: ' + filename)
+
+        return values
+
+    def get_event_type_id(self, type_name):
+        for key, value in self.registered_events_types.items():
+            if type_name == value.name:
+                return key
+        return None
+
+    def rows(self, type_id):
+        """Indices of the events of the given type in the trace."""
+        if type_id not in self._rows:
+            self._rows[type_id] = self._load(_rows_file(type_id), ROW_DTYPE,
+                                             self.type_events_cnt.get(type_id, 0))
+        return self._rows[type_id]
+
+    def data(self, type_id):
+        """Data fields of the events of the given type, one row per event."""
+        if type_id not in self._data:
+            fields_cnt = len(self.registered_events_types[type_id].data_types)
+            events_cnt = self.type_events_cnt.get(type_id, 0)
+            data = self._load(_data_file(type_id), DATA_DTYPE,
+                              events_cnt * fields_cnt)
+            self._data[type_id] = data.reshape(events_cnt, fields_cnt)
+        return self._data[type_id]
+
+    def timestamps_of(self, type_id):
+        return self.timestamps[self.rows(type_id)]
+
+    def field(self, type_id, field_name):
+        """Values of one data field of the events of the given type."""
+        descriptions = self.registered_events_types[type_id].data_descriptions
+        return self.data(type_id)[:, descriptions.index(field_name)]
+
+    def first_fields(self):
+        """First data field of every event, or -1 for events without data.
+
+        Event manager puts the address of the event in the first field,
+        and the address identifies the event in processing start and end
+        events.
+        """
+        values = np.full(len(self), -1, dtype=DATA_DTYPE)
+        for type_id in self.registered_events_types:
+            data = self.data(type_id)
+            if data.shape[1] > 0:
+                values[self.rows(type_id)] = data[:, 0]
+        return values
+
+    def to_events_data(self):
+        events = [None] * len(self)
+        timestamps = self.timestamps.tolist()
+
+        for type_id in self.registered_events_types:
+            for row, data in zip(self.rows(type_id).tolist(),
+                                 self.data(type_id).tolist()):
+                events[row] = Event(type_id, timestamps[row], data)
+
+        return EventsData(events, self.registered_events_types)
+
+    @staticmethod
+    def write_events_data(events_data, dirname):
+        writer = TraceWriter(dirname, events_data.registered_events_types)
+        for ev in events_data.events:
+            writer.add_event(ev)
+        writer.close()
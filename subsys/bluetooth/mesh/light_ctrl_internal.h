@@ -16,6 +16,7 @@
 #include <bluetooth/mesh/sensor.h>
 #include <bluetooth/mesh/properties.h>
 #include "sensor.h"
+#include "light_ctrl_prop.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,33 +25,9 @@ extern "C" {
 static inline const struct bt_mesh_sensor_format *
 prop_format_get(enum bt_mesh_light_ctrl_prop id)
 {
-	switch (id) {
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY:
-		return &bt_mesh_sensor_format_illuminance;
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_ON:
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_PROLONG:
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_STANDBY:
-		return &bt_mesh_sensor_format_perceived_lightness;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY:
-		return &bt_mesh_sensor_format_percentage_8;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KID:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KIU:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPD:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPU:
-		return &bt_mesh_sensor_format_coefficient;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_PROLONG:
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_ON:
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_AUTO:
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_MANUAL:
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_OCCUPANCY_DELAY:
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_PROLONG:
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_ON:
-		return &bt_mesh_sensor_format_time_millisecond_24;
-	default:
-		return NULL;
-	}
+	const struct light_ctrl_prop *prop = light_ctrl_prop_get(id);
+
+	return prop ? prop->format : NULL;
 }
 
 static inline int prop_encode(struct net_buf_simple *buf,
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <string.h>
+#include "light_ctrl_prop.h"
+#include "sensor.h"
+
+#define PROP_INDEX(_id) ((_id) - LIGHT_CTRL_PROP_ID_MIN)
+
+/* Highest valid values of the property formats. The highest encodable value
+ * of the 24 bit formats means "value is not known".
+ */
+#define TIME_MAX 0xfffffe
+#define LIGHTNESS_MAX 0xffff
+#define ACCURACY_MAX 100
+#define COEFFICIENT_MAX 1000
+#define CENTI_LUX_MAX 0xfffffe
+
+#define PROP(_id, _member, _type, _max, _format)                               \
+	[PROP_INDEX(_id)] = {                                                  \
+		.offset = offsetof(struct bt_mesh_light_ctrl_srv, _member),    \
+		.type = LIGHT_CTRL_PROP_TYPE_##_type,                          \
+		.max = _max,                                                   \
+		.format = &bt_mesh_sensor_format_##_format,                    \
+	}
+
+#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
+#define REG_PROP(_id, _member, _type, _max, _format)                           \
+	PROP(_id, reg.cfg._member, _type, _max, _format)
+#else
+/* The regulator properties are always 0 without the regulator. */
+#define REG_PROP(_id, _member, _type, _max, _format)                           \
+	[PROP_INDEX(_id)] = {                                                  \
+		.type = LIGHT_CTRL_PROP_TYPE_NONE,                             \
+		.format = &bt_mesh_sensor_format_##_format,                    \
+	}
+#endif
+
+static const struct light_ctrl_prop props[LIGHT_CTRL_PROP_COUNT] = {
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON,
+		 lux[LIGHT_CTRL_STATE_ON], LUX, CENTI_LUX_MAX, illuminance),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG,
+		 lux[LIGHT_CTRL_STATE_PROLONG], LUX, CENTI_LUX_MAX,
+		 illuminance),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY,
+		 lux[LIGHT_CTRL_STATE_STANDBY], LUX, CENTI_LUX_MAX,
+		 illuminance),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_ON,
+	     cfg.light[LIGHT_CTRL_STATE_ON], U16, LIGHTNESS_MAX,
+	     perceived_lightness),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_PROLONG,
+	     cfg.light[LIGHT_CTRL_STATE_PROLONG], U16, LIGHTNESS_MAX,
+	     perceived_lightness),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_STANDBY,
+	     cfg.light[LIGHT_CTRL_STATE_STANDBY], U16, LIGHTNESS_MAX,
+	     perceived_lightness),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY, accuracy, U8,
+		 ACCURACY_MAX, percentage_8),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_REG_KID, kid, U16, COEFFICIENT_MAX,
+		 coefficient),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_REG_KIU, kiu, U16, COEFFICIENT_MAX,
+		 coefficient),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_REG_KPD, kpd, U16, COEFFICIENT_MAX,
+		 coefficient),
+	REG_PROP(BT_MESH_LIGHT_CTRL_PROP_REG_KPU, kpu, U16, COEFFICIENT_MAX,
+		 coefficient),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_PROLONG, cfg.fade_prolong, TIME,
+	     TIME_MAX, time_millisecond_24),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_ON, cfg.fade_on, TIME, TIME_MAX,
+	     time_millisecond_24),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_AUTO,
+	     cfg.fade_standby_auto, TIME, TIME_MAX, time_millisecond_24),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_MANUAL,
+	     cfg.fade_standby_manual, TIME, TIME_MAX, time_millisecond_24),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_OCCUPANCY_DELAY, cfg.occupancy_delay,
+	     TIME, TIME_MAX, time_millisecond_24),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_PROLONG, cfg.prolong, TIME, TIME_MAX,
+	     time_millisecond_24),
+	PROP(BT_MESH_LIGHT_CTRL_PROP_TIME_ON, cfg.on, TIME, TIME_MAX,
+	     time_millisecond_24),
+};
+
+static void to_prop_time(uint32_t time, struct sensor_value *prop)
+{
+	prop->val1 = time / MSEC_PER_SEC;
+	prop->val2 = (time % MSEC_PER_SEC) * 1000;
+}
+
+static uint32_t from_prop_time(const struct sensor_value *prop)
+{
+	return prop->val1 * MSEC_PER_SEC + prop->val2 / 1000;
+}
+
+const struct light_ctrl_prop *light_ctrl_prop_get(uint16_t id)
+{
+	if (id < LIGHT_CTRL_PROP_ID_MIN || id > LIGHT_CTRL_PROP_ID_MAX) {
+		return NULL;
+	}
+
+	return &props[PROP_INDEX(id)];
+}
+
+uint8_t light_ctrl_prop_index(const struct light_ctrl_prop *prop)
+{
+	return prop - props;
+}
+
+size_t light_ctrl_prop_size(const struct light_ctrl_prop *prop)
+{
+	switch (prop->type) {
+	case LIGHT_CTRL_PROP_TYPE_TIME:
+		return sizeof(uint32_t);
+	case LIGHT_CTRL_PROP_TYPE_U16:
+		return sizeof(uint16_t);
+	case LIGHT_CTRL_PROP_TYPE_U8:
+		return sizeof(uint8_t);
+	case LIGHT_CTRL_PROP_TYPE_LUX:
+		return sizeof(struct sensor_value);
+	default:
+		return 0;
+	}
+}
+
+void light_ctrl_prop_read(const struct bt_mesh_light_ctrl_srv *srv,
+			  const struct light_ctrl_prop *prop,
+			  struct sensor_value *val)
+{
+	const void *data = (const uint8_t *)srv + prop->offset;
+
+	memset(val, 0, sizeof(*val));
+
+	switch (prop->type) {
+	case LIGHT_CTRL_PROP_TYPE_TIME:
+		to_prop_time(*(const uint32_t *)data, val);
+		break;
+	case LIGHT_CTRL_PROP_TYPE_U16:
+		val->val1 = *(const uint16_t *)data;
+		break;
+	case LIGHT_CTRL_PROP_TYPE_U8:
+		val->val1 = *(const uint8_t *)data;
+		break;
+	case LIGHT_CTRL_PROP_TYPE_LUX:
+		*val = *(const struct sensor_value *)data;
+		break;
+	default:
+		break;
+	}
+}
+
+int light_ctrl_prop_check(const struct light_ctrl_prop *prop,
+			  const struct sensor_value *val)
+{
+	int64_t value;
+
+	if (val->val1 < 0 || val->val2 < 0) {
+		return -EINVAL;
+	}
+
+	switch (prop->type) {
+	case LIGHT_CTRL_PROP_TYPE_TIME:
+		value = (int64_t)val->val1 * MSEC_PER_SEC + val->val2 / 1000;
+		break;
+	case LIGHT_CTRL_PROP_TYPE_LUX:
+		value = (int64_t)val->val1 * 100 + val->val2 / 10000;
+		break;
+	case LIGHT_CTRL_PROP_TYPE_U16:
+	case LIGHT_CTRL_PROP_TYPE_U8:
+		value = val->val1;
+		break;
+	default:
+		return 0;
+	}
+
+	return value > prop->max ? -EINVAL : 0;
+}
+
+int light_ctrl_prop_write(struct bt_mesh_light_ctrl_srv *srv,
+			  const struct light_ctrl_prop *prop,
+			  const struct sensor_value *val)
+{
+	void *data = light_ctrl_prop_data(srv, prop);
+	union {
+		uint32_t time;
+		uint16_t u16;
+		uint8_t u8;
+		struct sensor_value lux;
+	} value;
+	int err;
+
+	err = light_ctrl_prop_check(prop, val);
+	if (err) {
+		return err;
+	}
+
+	switch (prop->type) {
+	case LIGHT_CTRL_PROP_TYPE_TIME:
+		value.time = from_prop_time(val);
+		break;
+	case LIGHT_CTRL_PROP_TYPE_U16:
+		value.u16 = val->val1;
+		break;
+	case LIGHT_CTRL_PROP_TYPE_U8:
+		value.u8 = val->val1;
+		break;
+	case LIGHT_CTRL_PROP_TYPE_LUX:
+		value.lux = *val;
+		break;
+	default:
+		return -EALREADY;
+	}
+
+	if (!memcmp(data, &value, light_ctrl_prop_size(prop))) {
+		return -EALREADY;
+	}
+
+	memcpy(data, &value, light_ctrl_prop_size(prop));
+
+	return 0;
+}
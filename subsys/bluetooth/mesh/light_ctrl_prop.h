@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**
+ * @file
+ * @brief Light LC property registry
+ */
+
+#ifndef LIGHT_CTRL_PROP_H__
+#define LIGHT_CTRL_PROP_H__
+
+#include <bluetooth/mesh/light_ctrl_srv.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Lowest Light LC property ID. */
+#define LIGHT_CTRL_PROP_ID_MIN BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON
+/** Highest Light LC property ID. */
+#define LIGHT_CTRL_PROP_ID_MAX BT_MESH_LIGHT_CTRL_PROP_TIME_ON
+/** Number of Light LC properties. */
+#define LIGHT_CTRL_PROP_COUNT                                                  \
+	(LIGHT_CTRL_PROP_ID_MAX - LIGHT_CTRL_PROP_ID_MIN + 1)
+
+/** Representation of a property value in the server. */
+enum light_ctrl_prop_type {
+	/** Not supported in this configuration, always 0. */
+	LIGHT_CTRL_PROP_TYPE_NONE,
+	/** Time in milliseconds, uint32_t. */
+	LIGHT_CTRL_PROP_TYPE_TIME,
+	/** Integer, uint16_t. */
+	LIGHT_CTRL_PROP_TYPE_U16,
+	/** Integer, uint8_t. */
+	LIGHT_CTRL_PROP_TYPE_U8,
+	/** Illuminance, struct sensor_value. */
+	LIGHT_CTRL_PROP_TYPE_LUX,
+};
+
+/** Light LC property registry entry. */
+struct light_ctrl_prop {
+	/** Offset of the value in the server structure. */
+	uint16_t offset;
+	/** Value representation, see @ref light_ctrl_prop_type. */
+	uint8_t type;
+	/** Highest valid value, in milliseconds for time values, and
+	 *  centi-lux for illuminance values.
+	 */
+	uint32_t max;
+	/** Encoding of the property value. */
+	const struct bt_mesh_sensor_format *format;
+};
+
+/** @brief Look up a Light LC property.
+ *
+ *  @param[in] id Property ID.
+ *
+ *  @return The property, or NULL if the ID is not a Light LC property.
+ */
+const struct light_ctrl_prop *light_ctrl_prop_get(uint16_t id);
+
+/** @brief Get the index of a property, in the range 0 to
+ *         @ref LIGHT_CTRL_PROP_COUNT - 1.
+ */
+uint8_t light_ctrl_prop_index(const struct light_ctrl_prop *prop);
+
+/** @brief Get the size of the value of a property in the server.
+ *
+ *  @return Size of the value, or 0 if the property is not supported.
+ */
+size_t light_ctrl_prop_size(const struct light_ctrl_prop *prop);
+
+/** @brief Get a pointer to the value of a property in the server. */
+static inline void *light_ctrl_prop_data(struct bt_mesh_light_ctrl_srv *srv,
+					 const struct light_ctrl_prop *prop)
+{
+	return (uint8_t *)srv + prop->offset;
+}
+
+/** @brief Read a property value.
+ *
+ *  @param[in]  srv  Server instance.
+ *  @param[in]  prop Property.
+ *  @param[out] val  Property value.
+ */
+void light_ctrl_prop_read(const struct bt_mesh_light_ctrl_srv *srv,
+			  const struct light_ctrl_prop *prop,
+			  struct sensor_value *val);
+
+/** @brief Check if a property value is within the property's bounds.
+ *
+ *  @retval 0       The value is valid.
+ *  @retval -EINVAL The value is out of bounds.
+ */
+int light_ctrl_prop_check(const struct light_ctrl_prop *prop,
+			  const struct sensor_value *val);
+
+/** @brief Write a property value.
+ *
+ *  @param[in] srv  Server instance.
+ *  @param[in] prop Property.
+ *  @param[in] val  New property value.
+ *
+ *  @retval 0         The value was changed.
+ *  @retval -EALREADY The property already had this value, or is not
+ *                    supported in this configuration.
+ *  @retval -EINVAL   The value is out of bounds.
+ */
+int light_ctrl_prop_write(struct bt_mesh_light_ctrl_srv *srv,
+			  const struct light_ctrl_prop *prop,
+			  const struct sensor_value *val);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIGHT_CTRL_PROP_H__ */
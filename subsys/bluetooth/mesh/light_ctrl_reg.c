@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include "light_ctrl_reg.h"
+
+BUILD_ASSERT(LIGHT_CTRL_REG_COUNT <= 32,
+	     "Regulator instances are tracked in a 32 bit mask");
+
+uint32_t light_ctrl_reg_step(struct light_ctrl_reg *reg, uint32_t active)
+{
+	uint32_t stepped = 0;
+
+	for (int n = 0; active; n++, active >>= 1) {
+		if (!(active & 1)) {
+			continue;
+		}
+
+		int32_t error = reg->target[n] - reg->ambient[n];
+		/* Accuracy is in percent, and both up and down: */
+		int32_t band = (reg->accuracy[n] * reg->target[n]) / (2 * 100);
+		int32_t input;
+		int32_t p;
+		int64_t i;
+
+		if (error > band) {
+			input = MIN(INT16_MAX, error - band);
+			p = input * reg->kpu[n];
+			i = ((int64_t)input * reg->kiu[n] * reg->interval) /
+			    MSEC_PER_SEC;
+		} else if (error < -band) {
+			input = MAX(INT16_MIN, error + band);
+			p = input * reg->kpd[n];
+			i = ((int64_t)input * reg->kid[n] * reg->interval) /
+			    MSEC_PER_SEC;
+		} else {
+			continue;
+		}
+
+		i = MAX(0, MIN(UINT16_MAX, reg->i[n] + i));
+		reg->i[n] = i;
+		reg->output[n] = MAX(0, MIN(UINT16_MAX, reg->i[n] + p));
+		stepped |= BIT(n);
+	}
+
+	return stepped;
+}
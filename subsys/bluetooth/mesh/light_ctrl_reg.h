@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**
+ * @file
+ * @brief Light LC Server illuminance regulator
+ */
+
+#ifndef LIGHT_CTRL_REG_H__
+#define LIGHT_CTRL_REG_H__
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of regulator instances. */
+#define LIGHT_CTRL_REG_COUNT CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG_COUNT
+
+/** @brief PI regulator state for all Light LC Server instances.
+ *
+ *  The state is stored as one array per parameter, so that all instances can
+ *  be stepped in a single pass with integer math. Illuminance values are in
+ *  whole lux, and the output is a linear lightness level.
+ */
+struct light_ctrl_reg {
+	/** Step interval in milliseconds. */
+	uint32_t interval;
+	/** Target illuminance. */
+	uint32_t target[LIGHT_CTRL_REG_COUNT];
+	/** Measured ambient illuminance. */
+	uint32_t ambient[LIGHT_CTRL_REG_COUNT];
+	/** Positive integral coefficient. */
+	uint16_t kiu[LIGHT_CTRL_REG_COUNT];
+	/** Negative integral coefficient. */
+	uint16_t kid[LIGHT_CTRL_REG_COUNT];
+	/** Positive proportional coefficient. */
+	uint16_t kpu[LIGHT_CTRL_REG_COUNT];
+	/** Negative proportional coefficient. */
+	uint16_t kpd[LIGHT_CTRL_REG_COUNT];
+	/** Integral sum. */
+	uint16_t i[LIGHT_CTRL_REG_COUNT];
+	/** Regulator output. */
+	uint16_t output[LIGHT_CTRL_REG_COUNT];
+	/** Dead band, in percent of the target. */
+	uint8_t accuracy[LIGHT_CTRL_REG_COUNT];
+};
+
+/** @brief Step a set of regulator instances.
+ *
+ *  Instances where the illuminance error is within the dead band are
+ *  skipped, and keep their integral sum and output. The regulator input is
+ *  limited to the range of a signed 16 bit value.
+ *
+ *  @param[in] reg    Regulator state.
+ *  @param[in] active Bitmask of the instances to step.
+ *
+ *  @return Bitmask of the instances with a new output.
+ */
+uint32_t light_ctrl_reg_step(struct light_ctrl_reg *reg, uint32_t active);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIGHT_CTRL_REG_H__ */
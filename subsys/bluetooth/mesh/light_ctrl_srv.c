@@ -10,6 +10,8 @@
 #include <bluetooth/mesh/properties.h>
 #include "lightness_internal.h"
 #include "light_ctrl_internal.h"
+#include "light_ctrl_prop.h"
+#include "light_ctrl_reg.h"
 #include "sensor.h"
 #include "model_utils.h"
 
@@ -34,6 +36,7 @@ enum flags {
 	FLAG_STORE_STATE,
 	FLAG_CTRL_SRV_MANUALLY_ENABLED,
 	FLAG_STARTED,
+	FLAG_STORE_LEGACY_CFG,
 };
 
 enum stored_flags {
@@ -42,6 +45,9 @@ enum stored_flags {
 	STORED_FLAG_ENABLED,
 };
 
+/* Configuration as stored in a single entry by earlier versions. Each property
+ * is now stored in a separate entry, named by its property ID.
+ */
 struct setup_srv_storage_data {
 	struct bt_mesh_light_ctrl_srv_cfg cfg;
 #if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
@@ -49,15 +55,58 @@ struct setup_srv_storage_data {
 #endif
 };
 
+#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
+/* Index of a server that runs without a regulator instance. */
+#define REG_IDX_NONE UINT8_MAX
+
+static void reg_step(struct k_work *work);
+
+/* The regulators of all servers are stepped together by a single timer. */
+static struct light_ctrl_reg regulator = { .interval = REG_INT };
+static struct bt_mesh_light_ctrl_srv *reg_srvs[LIGHT_CTRL_REG_COUNT];
+static atomic_t reg_active;
+static K_DELAYED_WORK_DEFINE(reg_timer, reg_step);
+#endif
+
 static void restart_timer(struct bt_mesh_light_ctrl_srv *srv, uint32_t delay)
 {
 	k_delayed_work_submit(&srv->timer, K_MSEC(delay));
 }
 
+static void reg_cfg_update(struct bt_mesh_light_ctrl_srv *srv)
+{
+#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
+	uint8_t idx = srv->reg.idx;
+
+	if (idx == REG_IDX_NONE) {
+		return;
+	}
+
+	regulator.kiu[idx] = srv->reg.cfg.kiu;
+	regulator.kid[idx] = srv->reg.cfg.kid;
+	regulator.kpu[idx] = srv->reg.cfg.kpu;
+	regulator.kpd[idx] = srv->reg.cfg.kpd;
+	regulator.accuracy[idx] = srv->reg.cfg.accuracy;
+#endif
+}
+
 static void reg_start(struct bt_mesh_light_ctrl_srv *srv)
 {
 #if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
-	k_delayed_work_submit(&srv->reg.timer, K_MSEC(REG_INT));
+	if (srv->reg.idx == REG_IDX_NONE) {
+		return;
+	}
+
+	reg_cfg_update(srv);
+	atomic_set_bit(&reg_active, srv->reg.idx);
+
+	/* The expired timer is no longer counting down, but may still be
+	 * waiting in the work queue.
+	 */
+	if (!k_delayed_work_remaining_get(&reg_timer) &&
+	    !k_work_pending(&reg_timer.work)) {
+		k_delayed_work_submit(&reg_timer, K_MSEC(REG_INT));
+	}
 #endif
 }
 
@@ -446,71 +495,67 @@ static void ctrl_disable(struct bt_mesh_light_ctrl_srv *srv)
 	k_delayed_work_cancel(&srv->action_delay);
 	k_delayed_work_cancel(&srv->timer);
 #if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
-	k_delayed_work_cancel(&srv->reg.timer);
+	if (srv->reg.idx != REG_IDX_NONE) {
+		atomic_clear_bit(&reg_active, srv->reg.idx);
+	}
 #endif
 }
 
 #if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
 static void reg_step(struct k_work *work)
 {
-	struct bt_mesh_light_ctrl_srv *srv = CONTAINER_OF(
-		work, struct bt_mesh_light_ctrl_srv, reg.timer.work);
-
-	if (!is_enabled(srv)) {
-		/* The server might be disabled asynchronously. */
-		return;
-	}
+	struct bt_mesh_light_ctrl_srv *srv;
+	struct sensor_value lux;
+	uint32_t active = atomic_get(&reg_active);
+	uint32_t stepped;
 
-	struct sensor_value raw_lux;
-
-	lux_get(srv, &raw_lux);
-
-	uint32_t lux = raw_lux.val1;
-	uint32_t ambient = srv->ambient_lux.val1;
+	for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+		if (!(active & BIT(n))) {
+			continue;
+		}
 
-	int32_t error = lux - ambient;
-	/* Accuracy should be in percent and both up and down: */
-	uint32_t accuracy = (srv->reg.cfg.accuracy * lux) / (2 * 100);
-	int16_t input;
-	uint16_t output;
+		srv = reg_srvs[n];
+		if (!is_enabled(srv)) {
+			/* The server might be disabled asynchronously. */
+			atomic_clear_bit(&reg_active, n);
+			active &= ~BIT(n);
+			continue;
+		}
 
-	if (error > accuracy) {
-		input = error - accuracy;
-	} else if (error < -accuracy) {
-		input = error + accuracy;
-	} else {
-		return;
+		lux_get(srv, &lux);
+		regulator.target[n] = lux.val1;
+		regulator.ambient[n] = srv->ambient_lux.val1;
 	}
 
-	if (input >= 0) {
-		int32_t p = input * srv->reg.cfg.kpu;
-		int32_t i = (input * REG_INT * srv->reg.cfg.kiu) / MSEC_PER_SEC;
-
-		srv->reg.i = MIN(UINT16_MAX, srv->reg.i + i);
-		output = MIN(UINT16_MAX, srv->reg.i + p);
-	} else {
-		int32_t p = input * srv->reg.cfg.kpd;
-		int32_t i = (input * REG_INT * srv->reg.cfg.kid) / MSEC_PER_SEC;
+	stepped = light_ctrl_reg_step(&regulator, active);
 
-		srv->reg.i = MAX(0, srv->reg.i + i);
-		output = MAX(0, srv->reg.i + p);
-	}
+	for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+		if (!(stepped & BIT(n))) {
+			continue;
+		}
 
-	/* The regulator output is always in linear format. We'll convert to
-	 * the configured representation again before calling the Lightness
-	 * server.
-	 */
-	uint16_t lvl = light_get(srv);
+		srv = reg_srvs[n];
 
-	/* Output value is max out of regulator and configured level. */
-	if (output > lvl) {
-		atomic_set_bit(&srv->flags, FLAG_REGULATOR);
-		light_set(srv, light_to_repr(output, LINEAR), REG_INT);
-	} else if (atomic_test_and_clear_bit(&srv->flags, FLAG_REGULATOR)) {
-		light_set(srv, light_to_repr(lvl, LINEAR), REG_INT);
+		/* The regulator output is always in linear format. We'll
+		 * convert to the configured representation again before
+		 * calling the Lightness server.
+		 */
+		uint16_t output = regulator.output[n];
+		uint16_t lvl = light_get(srv);
+
+		/* Output value is max out of regulator and configured level. */
+		if (output > lvl) {
+			atomic_set_bit(&srv->flags, FLAG_REGULATOR);
+			light_set(srv, light_to_repr(output, LINEAR), REG_INT);
+		} else if (atomic_test_and_clear_bit(&srv->flags,
+						     FLAG_REGULATOR)) {
+			light_set(srv, light_to_repr(lvl, LINEAR), REG_INT);
+		}
 	}
 
-	k_delayed_work_submit(&srv->reg.timer, K_MSEC(REG_INT));
+	if (atomic_get(&reg_active)) {
+		k_delayed_work_submit(&reg_timer, K_MSEC(REG_INT));
+	}
 }
 #endif
 
@@ -584,17 +629,39 @@ static void store_timeout(struct k_work *work)
 	int err;
 
 	if (atomic_test_and_clear_bit(&srv->flags, FLAG_STORE_CFG)) {
-		struct setup_srv_storage_data data = {
-			.cfg = srv->cfg,
-#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
-			.reg_cfg = srv->reg.cfg,
-#endif
-		};
+		for (uint16_t id = LIGHT_CTRL_PROP_ID_MIN;
+		     id <= LIGHT_CTRL_PROP_ID_MAX; id++) {
+			const struct light_ctrl_prop *prop =
+				light_ctrl_prop_get(id);
+			char name[5];
+
+			if (!atomic_test_and_clear_bit(
+				    &srv->props_dirty,
+				    light_ctrl_prop_index(prop)) ||
+			    !light_ctrl_prop_size(prop)) {
+				continue;
+			}
 
-		err = bt_mesh_model_data_store(srv->setup_srv, false, NULL,
-					       &data, sizeof(data));
-		if (err) {
-			BT_ERR("Failed storing config: %d", err);
+			snprintk(name, sizeof(name), "%x", id);
+
+			err = bt_mesh_model_data_store(
+				srv->setup_srv, false, name,
+				light_ctrl_prop_data(srv, prop),
+				light_ctrl_prop_size(prop));
+			if (err) {
+				BT_ERR("Failed storing property 0x%04x: %d",
+				       id, err);
+			}
+		}
+
+		if (atomic_test_and_clear_bit(&srv->flags,
+					      FLAG_STORE_LEGACY_CFG)) {
+			/* All properties are now stored separately. */
+			err = bt_mesh_model_data_store(srv->setup_srv, false,
+						       NULL, NULL, 0);
+			if (err) {
+				BT_ERR("Failed removing old config: %d", err);
+			}
 		}
 	}
 
@@ -937,180 +1004,58 @@ const struct bt_mesh_model_op _bt_mesh_light_ctrl_srv_op[] = {
 	BT_MESH_MODEL_OP_END,
 };
 
-static void to_prop_time(uint32_t time, struct sensor_value *prop)
+static void prop_store(struct bt_mesh_light_ctrl_srv *srv,
+		       const struct light_ctrl_prop *prop)
 {
-	prop->val1 = time / MSEC_PER_SEC;
-	prop->val2 = (time % MSEC_PER_SEC) * 1000;
-}
-
-static uint32_t from_prop_time(const struct sensor_value *prop)
-{
-	return prop->val1 * MSEC_PER_SEC + prop->val2 / 1000;
+	atomic_set_bit(&srv->props_dirty, light_ctrl_prop_index(prop));
+	store(srv, FLAG_STORE_CFG);
+	reg_cfg_update(srv);
 }
 
 static int prop_get(struct net_buf_simple *buf,
 		    const struct bt_mesh_light_ctrl_srv *srv, uint16_t id)
 {
-	struct sensor_value val = { 0 };
+	const struct light_ctrl_prop *prop = light_ctrl_prop_get(id);
+	struct sensor_value val;
 
-	switch (id) {
-#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KID:
-		val.val1 = srv->reg.cfg.kid;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KIU:
-		val.val1 = srv->reg.cfg.kiu;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPD:
-		val.val1 = srv->reg.cfg.kpd;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPU:
-		val.val1 = srv->reg.cfg.kpu;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY:
-		val.val1 = srv->reg.cfg.accuracy;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON:
-		val = srv->reg.cfg.lux[LIGHT_CTRL_STATE_ON];
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG:
-		val = srv->reg.cfg.lux[LIGHT_CTRL_STATE_PROLONG];
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY:
-		val = srv->reg.cfg.lux[LIGHT_CTRL_STATE_STANDBY];
-		break;
-#else
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KID:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KIU:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPD:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPU:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY:
-		break; /* Prevent returning -ENOENT */
-#endif
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_ON:
-		val.val1 = srv->cfg.light[LIGHT_CTRL_STATE_ON];
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_PROLONG:
-		val.val1 = srv->cfg.light[LIGHT_CTRL_STATE_PROLONG];
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_STANDBY:
-		val.val1 = srv->cfg.light[LIGHT_CTRL_STATE_STANDBY];
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_PROLONG:
-		to_prop_time(srv->cfg.fade_prolong, &val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_ON:
-		to_prop_time(srv->cfg.fade_on, &val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_AUTO:
-		to_prop_time(srv->cfg.fade_standby_auto, &val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_MANUAL:
-		to_prop_time(srv->cfg.fade_standby_manual, &val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_OCCUPANCY_DELAY:
-		to_prop_time(srv->cfg.occupancy_delay, &val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_PROLONG:
-		to_prop_time(srv->cfg.prolong, &val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_ON:
-		to_prop_time(srv->cfg.on, &val);
-		break;
-	default:
+	if (!prop) {
 		return -ENOENT;
 	}
 
-	return prop_encode(buf, id, &val);
+	light_ctrl_prop_read(srv, prop, &val);
+
+	return sensor_ch_encode(buf, prop->format, &val);
 }
 
 static int prop_set(struct net_buf_simple *buf,
 		    struct bt_mesh_light_ctrl_srv *srv, uint16_t id)
 {
+	const struct light_ctrl_prop *prop = light_ctrl_prop_get(id);
 	struct sensor_value val;
 	int err;
 
-	err = prop_decode(buf, id, &val);
+	if (!prop) {
+		return -ENOENT;
+	}
+
+	err = sensor_ch_decode(buf, prop->format, &val);
 	if (err) {
 		return err;
 	}
 
 	BT_DBG("0x%04x: %s", id, bt_mesh_sensor_ch_str(&val));
 
-	switch (id) {
-#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KID:
-		srv->reg.cfg.kid = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KIU:
-		srv->reg.cfg.kiu = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPD:
-		srv->reg.cfg.kpd = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPU:
-		srv->reg.cfg.kpu = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY:
-		srv->reg.cfg.accuracy = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON:
-		srv->reg.cfg.lux[LIGHT_CTRL_STATE_ON] = val;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG:
-		srv->reg.cfg.lux[LIGHT_CTRL_STATE_PROLONG] = val;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY:
-		srv->reg.cfg.lux[LIGHT_CTRL_STATE_STANDBY] = val;
-		break;
-#else
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KID:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KIU:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPD:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_KPU:
-	case BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG:
-	case BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY:
-		break; /* Prevent returning -ENOENT */
-#endif
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_ON:
-		srv->cfg.light[LIGHT_CTRL_STATE_ON] = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_PROLONG:
-		srv->cfg.light[LIGHT_CTRL_STATE_PROLONG] = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_STANDBY:
-		srv->cfg.light[LIGHT_CTRL_STATE_STANDBY] = val.val1;
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_PROLONG:
-		srv->cfg.fade_prolong = from_prop_time(&val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_ON:
-		srv->cfg.fade_on = from_prop_time(&val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_AUTO:
-		srv->cfg.fade_standby_auto = from_prop_time(&val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_MANUAL:
-		srv->cfg.fade_standby_manual = from_prop_time(&val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_OCCUPANCY_DELAY:
-		srv->cfg.occupancy_delay = from_prop_time(&val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_PROLONG:
-		srv->cfg.prolong = from_prop_time(&val);
-		break;
-	case BT_MESH_LIGHT_CTRL_PROP_TIME_ON:
-		srv->cfg.on = from_prop_time(&val);
-		break;
-	default:
-		return -ENOENT;
+	err = light_ctrl_prop_write(srv, prop, &val);
+	if (err == -EALREADY) {
+		return 0;
+	}
+
+	if (err) {
+		return err;
 	}
 
+	prop_store(srv, prop);
+
 	return 0;
 }
 
@@ -1237,6 +1182,9 @@ const struct bt_mesh_onoff_srv_handlers _bt_mesh_light_ctrl_srv_onoff = {
 static int light_ctrl_srv_init(struct bt_mesh_model *mod)
 {
 	struct bt_mesh_light_ctrl_srv *srv = mod->user_data;
+#if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
+	uint8_t idx;
+#endif
 
 	srv->model = mod;
 
@@ -1261,7 +1209,21 @@ static int light_ctrl_srv_init(struct bt_mesh_model *mod)
 #endif
 
 #if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
-	k_delayed_work_init(&srv->reg.timer, reg_step);
+	for (idx = 0; idx < ARRAY_SIZE(reg_srvs); idx++) {
+		if (!reg_srvs[idx]) {
+			break;
+		}
+	}
+
+	if (idx == ARRAY_SIZE(reg_srvs)) {
+		/* The server works without the illuminance regulator. */
+		BT_WRN("Out of regulator instances, increase "
+		       "CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG_COUNT");
+		srv->reg.idx = REG_IDX_NONE;
+	} else {
+		reg_srvs[idx] = srv;
+		srv->reg.idx = idx;
+	}
 #endif
 
 	net_buf_simple_init(srv->pub.msg, 0);
@@ -1312,6 +1274,14 @@ static int light_ctrl_srv_start(struct bt_mesh_model *mod)
 
 	atomic_set_bit(&srv->flags, FLAG_STARTED);
 
+	if (atomic_test_bit(&srv->flags, FLAG_STORE_LEGACY_CFG)) {
+		/* Move the old config to separate entries. */
+		atomic_set(&srv->props_dirty, BIT(LIGHT_CTRL_PROP_COUNT) - 1);
+		store(srv, FLAG_STORE_CFG);
+	} else {
+		atomic_clear(&srv->props_dirty);
+	}
+
 	if (srv->lightness->lightness_model->elem_idx == mod->elem_idx) {
 		BT_ERR("Lightness: Invalid element index");
 		return -EINVAL;
@@ -1387,11 +1357,27 @@ static int lc_setup_srv_settings_set(struct bt_mesh_model *mod,
 				     settings_read_cb read_cb, void *cb_arg)
 {
 	struct bt_mesh_light_ctrl_srv *srv = mod->user_data;
+	uint8_t saved[LIGHT_CTRL_PROP_COUNT][sizeof(struct sensor_value)];
+	const struct light_ctrl_prop *prop;
 	struct setup_srv_storage_data data;
 	ssize_t result;
 
 	if (name) {
-		return -ENOENT;
+		prop = light_ctrl_prop_get(strtol(name, NULL, 16));
+		if (!prop || !light_ctrl_prop_size(prop)) {
+			return -ENOENT;
+		}
+
+		result = read_cb(cb_arg, light_ctrl_prop_data(srv, prop),
+				 light_ctrl_prop_size(prop));
+		if (result < 0) {
+			return result;
+		}
+
+		/* Marks the property as loaded until the model is started. */
+		atomic_set_bit(&srv->props_dirty, light_ctrl_prop_index(prop));
+
+		return 0;
 	}
 
 	result = read_cb(cb_arg, &data, sizeof(data));
@@ -1403,12 +1389,39 @@ static int lc_setup_srv_settings_set(struct bt_mesh_model *mod,
 		return -EINVAL;
 	}
 
+	/* Properties stored separately are newer than the old config, and
+	 * might have been loaded already.
+	 */
+	for (uint16_t id = LIGHT_CTRL_PROP_ID_MIN; id <= LIGHT_CTRL_PROP_ID_MAX;
+	     id++) {
+		prop = light_ctrl_prop_get(id);
+		if (atomic_test_bit(&srv->props_dirty,
+				    light_ctrl_prop_index(prop))) {
+			memcpy(saved[light_ctrl_prop_index(prop)],
+			       light_ctrl_prop_data(srv, prop),
+			       light_ctrl_prop_size(prop));
+		}
+	}
+
 	srv->cfg = data.cfg;
 
 #if CONFIG_BT_MESH_LIGHT_CTRL_SRV_REG
 	srv->reg.cfg = data.reg_cfg;
 #endif
 
+	for (uint16_t id = LIGHT_CTRL_PROP_ID_MIN; id <= LIGHT_CTRL_PROP_ID_MAX;
+	     id++) {
+		prop = light_ctrl_prop_get(id);
+		if (atomic_test_bit(&srv->props_dirty,
+				    light_ctrl_prop_index(prop))) {
+			memcpy(light_ctrl_prop_data(srv, prop),
+			       saved[light_ctrl_prop_index(prop)],
+			       light_ctrl_prop_size(prop));
+		}
+	}
+
+	atomic_set_bit(&srv->flags, FLAG_STORE_LEGACY_CFG);
+
 	return 0;
 }
 
@@ -1479,3 +1492,58 @@ int bt_mesh_light_ctrl_srv_pub(struct bt_mesh_light_ctrl_srv *srv,
 {
 	return onoff_status_send(srv, ctx, srv->state);
 }
+
+int bt_mesh_light_ctrl_srv_prop_get(struct bt_mesh_light_ctrl_srv *srv,
+				    struct bt_mesh_light_ctrl_prop_val *props,
+				    size_t count)
+{
+	const struct light_ctrl_prop *prop;
+
+	for (size_t i = 0; i < count; i++) {
+		prop = light_ctrl_prop_get(props[i].id);
+		if (!prop) {
+			return -ENOENT;
+		}
+
+		light_ctrl_prop_read(srv, prop, &props[i].val);
+	}
+
+	return 0;
+}
+
+int bt_mesh_light_ctrl_srv_prop_set(
+	struct bt_mesh_light_ctrl_srv *srv,
+	const struct bt_mesh_light_ctrl_prop_val *props, size_t count)
+{
+	const struct light_ctrl_prop *prop;
+	int err;
+
+	/* Validate all values before changing any of them. */
+	for (size_t i = 0; i < count; i++) {
+		prop = light_ctrl_prop_get(props[i].id);
+		if (!prop) {
+			return -ENOENT;
+		}
+
+		err = light_ctrl_prop_check(prop, &props[i].val);
+		if (err) {
+			return err;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		prop = light_ctrl_prop_get(props[i].id);
+
+		if (light_ctrl_prop_write(srv, prop, &props[i].val)) {
+			continue;
+		}
+
+		prop_store(srv, prop);
+
+		if (srv->setup_srv) {
+			prop_tx(srv, NULL, props[i].id);
+		}
+	}
+
+	return 0;
+}
@@ -197,11 +197,10 @@ bt_mesh_sensor_column_format_get(const struct bt_mesh_sensor_type *type)
 }
 
 int sensor_column_encode(struct net_buf_simple *buf,
-			 struct bt_mesh_sensor *sensor,
-			 struct bt_mesh_msg_ctx *ctx,
-			 const struct bt_mesh_sensor_column *col)
+			 const struct bt_mesh_sensor *sensor,
+			 const struct bt_mesh_sensor_column *col,
+			 const struct sensor_value *values)
 {
-	struct sensor_value values[CONFIG_BT_MESH_SENSOR_CHANNELS_MAX];
 	const struct bt_mesh_sensor_format *col_format;
 	const uint64_t width_million =
 		(col->end.val1 - col->start.val1) * 1000000L +
@@ -230,11 +229,6 @@ int sensor_column_encode(struct net_buf_simple *buf,
 		return err;
 	}
 
-	err = sensor->series.get(sensor, ctx, col, values);
-	if (err) {
-		return err;
-	}
-
 	return sensor_value_encode(buf, sensor->type, values);
 }
 
@@ -132,9 +132,9 @@ int sensor_ch_decode(struct net_buf_simple *buf,
 		     struct sensor_value *value);
 
 int sensor_column_encode(struct net_buf_simple *buf,
-			 struct bt_mesh_sensor *sensor,
-			 struct bt_mesh_msg_ctx *ctx,
-			 const struct bt_mesh_sensor_column *col);
+			 const struct bt_mesh_sensor *sensor,
+			 const struct bt_mesh_sensor_column *col,
+			 const struct sensor_value *values);
 int sensor_column_decode(
 	struct net_buf_simple *buf, const struct bt_mesh_sensor_type *type,
 	struct bt_mesh_sensor_column *col,
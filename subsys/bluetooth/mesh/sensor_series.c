@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <bluetooth/mesh/sensor.h>
+#include "sensor_series.h"
+
+static uint16_t index_pool[CONFIG_BT_MESH_SENSOR_SRV_COLUMN_INDEX_SIZE];
+static uint32_t index_pool_used;
+
+static int value_cmp(const struct sensor_value *a,
+		     const struct sensor_value *b)
+{
+	if (a->val1 != b->val1) {
+		return (a->val1 < b->val1) ? -1 : 1;
+	}
+
+	if (a->val2 != b->val2) {
+		return (a->val2 < b->val2) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/* Position of the first column with a start value above the given value, or
+ * at or above it if inclusive is true.
+ */
+static uint32_t bound_get(const struct bt_mesh_sensor *sensor,
+			  const struct sensor_value *val, bool inclusive)
+{
+	uint32_t low = 0;
+	uint32_t high = sensor->series.column_count;
+
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		int cmp = value_cmp(&sensor_series_column(sensor, mid)->start,
+				    val);
+
+		if (cmp < 0 || (cmp == 0 && !inclusive)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+int sensor_series_index_init(struct bt_mesh_sensor *sensor)
+{
+	const struct bt_mesh_sensor_column *columns = sensor->series.columns;
+	uint32_t count = sensor->series.column_count;
+	uint16_t *index;
+	uint32_t i;
+
+	sensor->state.col_index = NULL;
+	sensor->state.col_unsorted = 0;
+
+	for (i = 1; i < count; i++) {
+		if (value_cmp(&columns[i - 1].start, &columns[i].start) > 0) {
+			break;
+		}
+	}
+
+	if (i >= count) {
+		return 0;
+	}
+
+	if (count > ARRAY_SIZE(index_pool) - index_pool_used) {
+		sensor->state.col_unsorted = 1;
+		return -ENOMEM;
+	}
+
+	index = &index_pool[index_pool_used];
+	index_pool_used += count;
+
+	/* Insertion sort, as the columns are only sorted once: */
+	for (i = 0; i < count; i++) {
+		uint32_t j = i;
+
+		while (j > 0 &&
+		       value_cmp(&columns[index[j - 1]].start,
+				 &columns[i].start) > 0) {
+			index[j] = index[j - 1];
+			j--;
+		}
+
+		index[j] = i;
+	}
+
+	sensor->state.col_index = index;
+
+	return 0;
+}
+
+const struct bt_mesh_sensor_column *
+sensor_series_column_get(const struct bt_mesh_sensor *sensor,
+			 const struct sensor_value *start)
+{
+	const struct bt_mesh_sensor_column *col;
+
+	if (sensor->state.col_unsorted) {
+		for (uint32_t i = 0; i < sensor->series.column_count; i++) {
+			col = &sensor->series.columns[i];
+			if (!value_cmp(&col->start, start)) {
+				return col;
+			}
+		}
+
+		return NULL;
+	}
+
+	uint32_t pos = bound_get(sensor, start, true);
+
+	if (pos == sensor->series.column_count) {
+		return NULL;
+	}
+
+	col = sensor_series_column(sensor, pos);
+	if (value_cmp(&col->start, start)) {
+		return NULL;
+	}
+
+	return col;
+}
+
+uint32_t sensor_series_range(const struct bt_mesh_sensor *sensor,
+			     const struct bt_mesh_sensor_column *range,
+			     uint32_t *first)
+{
+	uint32_t end;
+
+	if (sensor->state.col_unsorted) {
+		*first = 0;
+		return sensor->series.column_count;
+	}
+
+	*first = bound_get(sensor, &range->start, true);
+	end = bound_get(sensor, &range->end, false);
+
+	return (end > *first) ? (end - *first) : 0;
+}
+
+int sensor_series_values_get(
+	struct bt_mesh_sensor *sensor, struct bt_mesh_msg_ctx *ctx,
+	const struct bt_mesh_sensor_column *const *columns, uint32_t count,
+	struct sensor_value values[][CONFIG_BT_MESH_SENSOR_CHANNELS_MAX])
+{
+	int err;
+
+	if (sensor->series.get_range) {
+		return sensor->series.get_range(sensor, ctx, columns, count,
+						values);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		err = sensor->series.get(sensor, ctx, columns[i], values[i]);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
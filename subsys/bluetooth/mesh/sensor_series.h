@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+/**
+ * @file
+ * @brief Internal sensor series API
+ */
+
+#ifndef BT_MESH_INTERNAL_SENSOR_SERIES_H__
+#define BT_MESH_INTERNAL_SENSOR_SERIES_H__
+
+#include <bluetooth/mesh/sensor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The series columns of a sensor are accessed by their position in start
+ * value order. Sorted column arrays are used as they are, while unsorted
+ * arrays get an index from a shared pool.
+ */
+
+/** @brief Sort the series columns of a sensor.
+ *
+ *  @param[in] sensor Sensor with series columns.
+ *
+ *  @retval 0       The columns are sorted or indexed.
+ *  @retval -ENOMEM No room for the index, the columns will be searched
+ *                  linearly.
+ */
+int sensor_series_index_init(struct bt_mesh_sensor *sensor);
+
+/** @brief Get the series column at the given position.
+ *
+ *  @param[in] sensor Sensor with series columns.
+ *  @param[in] pos    Position of the column, in start value order.
+ *
+ *  @return The column at the given position.
+ */
+static inline const struct bt_mesh_sensor_column *
+sensor_series_column(const struct bt_mesh_sensor *sensor, uint32_t pos)
+{
+	if (sensor->state.col_index) {
+		pos = sensor->state.col_index[pos];
+	}
+
+	return &sensor->series.columns[pos];
+}
+
+/** @brief Find the series column with the given start value.
+ *
+ *  @param[in] sensor Sensor with series columns.
+ *  @param[in] start  Start value of the column.
+ *
+ *  @return The column with the given start value, or NULL if there is none.
+ */
+const struct bt_mesh_sensor_column *
+sensor_series_column_get(const struct bt_mesh_sensor *sensor,
+			 const struct sensor_value *start);
+
+/** @brief Find the series columns that start within a range.
+ *
+ *  Selects the columns where range->start <= start <= range->end, as
+ *  @ref bt_mesh_sensor_value_in_column does. If the columns are searched
+ *  linearly, all columns are selected, and must be checked by the caller.
+ *
+ *  @param[in]  sensor Sensor with series columns.
+ *  @param[in]  range  Range of start values.
+ *  @param[out] first  Position of the first selected column.
+ *
+ *  @return Number of selected columns.
+ */
+uint32_t sensor_series_range(const struct bt_mesh_sensor *sensor,
+			     const struct bt_mesh_sensor_column *range,
+			     uint32_t *first);
+
+/** @brief Get the series values of several columns.
+ *
+ *  Uses the sensor's bulk getter if present, or its single column getter
+ *  for each column.
+ *
+ *  @param[in]  sensor  Sensor with series columns.
+ *  @param[in]  ctx     Message context, or NULL.
+ *  @param[in]  columns Requested columns.
+ *  @param[in]  count   Number of requested columns.
+ *  @param[out] values  Value buffers, one for each requested column.
+ *
+ *  @return 0 on success, or (negative) error code otherwise.
+ */
+int sensor_series_values_get(
+	struct bt_mesh_sensor *sensor, struct bt_mesh_msg_ctx *ctx,
+	const struct bt_mesh_sensor_column *const *columns, uint32_t count,
+	struct sensor_value values[][CONFIG_BT_MESH_SENSOR_CHANNELS_MAX]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BT_MESH_INTERNAL_SENSOR_SERIES_H__ */
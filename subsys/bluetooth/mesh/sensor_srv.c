@@ -13,6 +13,7 @@
 #include "mesh/transport.h"
 #include "model_utils.h"
 #include "sensor.h"
+#include "sensor_series.h"
 
 #define BT_DBG_ENABLED IS_ENABLED(CONFIG_BT_MESH_DEBUG_MODEL)
 #define LOG_MODULE_NAME bt_mesh_sensor_srv
@@ -224,18 +225,10 @@ respond:
 	bt_mesh_model_send(mod, ctx, &rsp, NULL, NULL);
 }
 
-static const struct bt_mesh_sensor_column *
-column_get(const struct bt_mesh_sensor_series *series,
-	   const struct sensor_value *val)
+static bool series_supported(const struct bt_mesh_sensor *sensor)
 {
-	for (uint32_t i = 0; i < series->column_count; ++i) {
-		if (series->columns[i].start.val1 == val->val1 &&
-		    series->columns[i].start.val2 == val->val2) {
-			return &series->columns[i];
-		}
-	}
-
-	return NULL;
+	return sensor->series.columns &&
+	       (sensor->series.get || sensor->series.get_range);
 }
 
 static void handle_column_get(struct bt_mesh_model *mod,
@@ -268,10 +261,11 @@ static void handle_column_get(struct bt_mesh_model *mod,
 
 	const struct bt_mesh_sensor_format *col_format;
 	const struct bt_mesh_sensor_column *col;
+	struct sensor_value values[1][CONFIG_BT_MESH_SENSOR_CHANNELS_MAX];
 	struct sensor_value col_x;
 
 	col_format = bt_mesh_sensor_column_format_get(sensor->type);
-	if (!col_format || !sensor->series.columns || !sensor->series.get) {
+	if (!col_format || !series_supported(sensor)) {
 		BT_WARN("No series support in 0x%04x", sensor->type->id);
 		goto respond;
 	}
@@ -283,14 +277,20 @@ static void handle_column_get(struct bt_mesh_model *mod,
 
 	BT_DBG("Column %s", bt_mesh_sensor_ch_str(&col_x));
 
-	col = column_get(&sensor->series, &col_x);
+	col = sensor_series_column_get(sensor, &col_x);
 	if (!col) {
 		BT_WARN("Unknown column");
 		sensor_ch_encode(&rsp, col_format, &col_x);
 		goto respond;
 	}
 
-	err = sensor_column_encode(&rsp, sensor, ctx, col);
+	err = sensor_series_values_get(sensor, ctx, &col, 1, values);
+	if (err) {
+		BT_WARN("Failed getting sensor column: %d", err);
+		return;
+	}
+
+	err = sensor_column_encode(&rsp, sensor, col, values[0]);
 	if (err) {
 		BT_WARN("Failed encoding sensor column: %d", err);
 		return;
@@ -300,6 +300,50 @@ respond:
 	bt_mesh_model_send(mod, ctx, &rsp, NULL, NULL);
 }
 
+static void series_status_init(struct net_buf_simple *rsp, uint16_t id)
+{
+	bt_mesh_model_msg_init(rsp, BT_MESH_SENSOR_OP_SERIES_STATUS);
+	net_buf_simple_add_le16(rsp, id);
+}
+
+/* Encode a batch of columns into the response, and send the response
+ * whenever it can't fit the next column. The columns are split over as few
+ * Series Status messages as possible.
+ */
+static int series_batch_encode(struct bt_mesh_model *mod,
+			       struct bt_mesh_msg_ctx *ctx,
+			       struct bt_mesh_sensor *sensor,
+			       struct net_buf_simple *rsp,
+			       const struct bt_mesh_sensor_column *const *cols,
+			       uint32_t count)
+{
+	struct sensor_value values[CONFIG_BT_MESH_SENSOR_SRV_SERIES_BATCH]
+				  [CONFIG_BT_MESH_SENSOR_CHANNELS_MAX];
+	const struct bt_mesh_sensor_format *col_format =
+		bt_mesh_sensor_column_format_get(sensor->type);
+	size_t col_len = 2 * col_format->size + sensor_value_len(sensor->type);
+	int err;
+
+	err = sensor_series_values_get(sensor, ctx, cols, count, values);
+	if (err) {
+		return err;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (net_buf_simple_tailroom(rsp) < col_len + BT_MESH_MIC_SHORT) {
+			bt_mesh_model_send(mod, ctx, rsp, NULL, NULL);
+			series_status_init(rsp, sensor->type->id);
+		}
+
+		err = sensor_column_encode(rsp, sensor, cols[i], values[i]);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
 static void handle_series_get(struct bt_mesh_model *mod,
 			      struct bt_mesh_msg_ctx *ctx,
 			      struct net_buf_simple *buf)
@@ -320,15 +364,14 @@ static void handle_series_get(struct bt_mesh_model *mod,
 	struct bt_mesh_sensor *sensor = sensor_get(srv, id);
 
 	NET_BUF_SIMPLE_DEFINE(rsp, BT_MESH_TX_SDU_MAX);
-	bt_mesh_model_msg_init(&rsp, BT_MESH_SENSOR_OP_SERIES_STATUS);
-	net_buf_simple_add_le16(&rsp, id);
+	series_status_init(&rsp, id);
 
 	if (!sensor) {
 		goto respond;
 	}
 
 	col_format = bt_mesh_sensor_column_format_get(sensor->type);
-	if (!col_format || !sensor->series.columns || !sensor->series.get) {
+	if (!col_format || !series_supported(sensor)) {
 		BT_WARN("No series support in 0x%04x", sensor->type->id);
 		goto respond;
 	}
@@ -356,19 +399,47 @@ static void handle_series_get(struct bt_mesh_model *mod,
 		return;
 	}
 
-	for (uint32_t i = 0; i < sensor->series.column_count; ++i) {
+	const struct bt_mesh_sensor_column
+		*batch[CONFIG_BT_MESH_SENSOR_SRV_SERIES_BATCH];
+	uint32_t batched = 0;
+	uint32_t first = 0;
+	uint32_t count = sensor->series.column_count;
+	int err;
+
+	if (ranged) {
+		count = sensor_series_range(sensor, &range, &first);
+	}
+
+	BT_DBG("Columns #%u to #%u", first, first + count);
+
+	for (uint32_t pos = first; pos < first + count; pos++) {
 		const struct bt_mesh_sensor_column *col =
-			&sensor->series.columns[i];
+			sensor_series_column(sensor, pos);
 
+		/* Only needed if the columns are searched linearly: */
 		if (ranged &&
 		    !bt_mesh_sensor_value_in_column(&col->start, &range)) {
 			continue;
 		}
 
-		BT_DBG("Column #%u", i);
+		batch[batched++] = col;
+		if (batched < ARRAY_SIZE(batch)) {
+			continue;
+		}
 
-		int err = sensor_column_encode(&rsp, sensor, ctx, col);
+		err = series_batch_encode(mod, ctx, sensor, &rsp, batch,
+					  batched);
+		if (err) {
+			BT_WARN("Failed encoding: %d", err);
+			return;
+		}
+
+		batched = 0;
+	}
 
+	if (batched) {
+		err = series_batch_encode(mod, ctx, sensor, &rsp, batch,
+					  batched);
 		if (err) {
 			BT_WARN("Failed encoding: %d", err);
 			return;
@@ -387,6 +458,7 @@ const struct bt_mesh_model_op _bt_mesh_sensor_srv_op[] = {
 	  handle_column_get },
 	{ BT_MESH_SENSOR_OP_SERIES_GET, BT_MESH_SENSOR_MSG_MINLEN_SERIES_GET,
 	  handle_series_get },
+	BT_MESH_MODEL_OP_END,
 };
 
 static void handle_cadence_get(struct bt_mesh_model *mod,
@@ -708,6 +780,7 @@ const struct bt_mesh_model_op _bt_mesh_sensor_setup_srv_op[] = {
 	  handle_setting_set },
 	{ BT_MESH_SENSOR_OP_SETTING_SET_UNACKNOWLEDGED,
 	  BT_MESH_SENSOR_MSG_MINLEN_SETTING_SET, handle_setting_set_unack },
+	BT_MESH_MODEL_OP_END,
 };
 
 static int sensor_srv_init(struct bt_mesh_model *mod)
@@ -740,6 +813,11 @@ static int sensor_srv_init(struct bt_mesh_model *mod)
 
 		sys_slist_append(&srv->sensors, &best->state.node);
 		BT_DBG("Sensor 0x%04x", best->type->id);
+
+		if (best->series.columns &&
+		    sensor_series_index_init(best) == -ENOMEM) {
+			BT_WARN("No column index for 0x%04x", best->type->id);
+		}
 		min_id = best->type->id + 1;
 	}
 
@@ -842,39 +920,140 @@ static uint16_t min_int_get(const struct bt_mesh_sensor *sensor, uint8_t period_
 	return ceiling_fraction(min_int, pub_int);
 }
 
-/** @brief Conditionally add a sensor value to a publication.
+/** Periodic publication state of a sensor. */
+enum pub_state {
+	/** Not part of this publication. */
+	PUB_SKIP,
+	/** Published if the value is outside the delta threshold. */
+	PUB_CHECK,
+	/** Publication interval expired, always published. */
+	PUB_DUE,
+};
+
+/** @brief Get the length of the sensor's entry in a Sensor Status message.
+ *
+ *  @param sensor Sensor instance.
  *
- *  A sensor message will be added to the publication if its minimum interval
- *  has expired and the value is outside its delta threshold or the
- *  publication interval has expired.
+ *  @return Length of the marshalled sensor ID and value.
+ */
+static uint8_t status_len_get(const struct bt_mesh_sensor *sensor)
+{
+	uint8_t len = sensor_value_len(sensor->type);
+
+	if (len > 0 && len <= 16 && sensor->type->id < 2048) {
+		return 2 + len;
+	}
+
+	return 3 + len;
+}
+
+/** @brief Get the publication state of a sensor without sampling it.
  *
  *  @param srv         Server sending the publication.
- *  @param s           Sensor to add data of.
+ *  @param s           Sensor instance.
  *  @param period_div  Server's original period divisor.
  *  @param base_period Server's original base period.
+ *
+ *  @return The publication state of the sensor.
  */
-static void pub_msg_add(struct bt_mesh_sensor_srv *srv,
-			struct bt_mesh_sensor *s, uint8_t period_div,
-			uint32_t base_period)
+static enum pub_state pub_state_get(const struct bt_mesh_sensor_srv *srv,
+				    struct bt_mesh_sensor *s,
+				    uint8_t period_div, uint32_t base_period)
 {
-	uint16_t min_int = min_int_get(s, period_div, base_period);
-	int err;
+	uint16_t age = srv->seq - s->state.seq;
 
-	if (srv->seq - s->state.seq < min_int) {
-		return;
+	if (age < min_int_get(s, period_div, base_period)) {
+		return PUB_SKIP;
+	}
+
+	if (age >= pub_int_get(s, period_div)) {
+		return PUB_DUE;
 	}
 
+	if (s->change_notify && !atomic_get(&s->state.changed)) {
+		return PUB_SKIP;
+	}
+
+	return PUB_CHECK;
+}
+
+/** @brief Select the due sensors to add to the publication.
+ *
+ *  Due sensors are selected in the order of how long they have waited for
+ *  publication, as long as they fit in the publication. Due sensors that
+ *  don't fit are skipped, and get a head start in the next publication.
+ *
+ *  @param srv    Server sending the publication.
+ *  @param state  Publication state of each sensor in the server.
+ *  @param budget Max number of bytes to add to the publication.
+ *  @param limit  Max number of bytes a single sensor may add to an empty
+ *                publication.
+ *
+ *  @return Number of bytes reserved for the selected sensors.
+ */
+static size_t pub_due_select(struct bt_mesh_sensor_srv *srv,
+			     uint8_t *state, size_t budget, size_t limit)
+{
+	bool selected[CONFIG_BT_MESH_SENSOR_SRV_SENSORS_MAX] = {};
+	struct bt_mesh_sensor *s;
+	size_t reserved = 0;
+
+	while (true) {
+		struct bt_mesh_sensor *oldest = NULL;
+		uint16_t oldest_age = 0;
+		int oldest_idx = 0;
+		int i = 0;
+
+		SENSOR_FOR_EACH(&srv->sensors, s)
+		{
+			uint16_t age = srv->seq - s->state.seq;
+
+			if (state[i] == PUB_DUE && !selected[i] &&
+			    (!oldest || age > oldest_age)) {
+				oldest = s;
+				oldest_age = age;
+				oldest_idx = i;
+			}
+
+			i++;
+		}
+
+		if (!oldest) {
+			return reserved;
+		}
+
+		uint8_t len = status_len_get(oldest);
+
+		if (reserved + len <= budget ||
+		    (reserved == 0 && len <= limit)) {
+			selected[oldest_idx] = true;
+			reserved += len;
+		} else {
+			state[oldest_idx] = PUB_SKIP;
+		}
+	}
+}
+
+/** @brief Sample a sensor, and add its value to a publication.
+ *
+ *  @param srv   Server sending the publication.
+ *  @param s     Sensor to add data of.
+ *  @param state Publication state of the sensor.
+ */
+static void pub_msg_add(struct bt_mesh_sensor_srv *srv,
+			struct bt_mesh_sensor *s, enum pub_state state)
+{
 	struct sensor_value value[CONFIG_BT_MESH_SENSOR_CHANNELS_MAX] = {};
+	int err;
+
+	atomic_clear(&s->state.changed);
 
 	err = value_get(s, NULL, value);
 	if (err) {
 		return;
 	}
 
-	bool delta_triggered = bt_mesh_sensor_delta_threshold(s, value);
-	uint16_t interval = pub_int_get(s, period_div);
-
-	if (!delta_triggered && srv->seq - s->state.seq < interval) {
+	if (state != PUB_DUE && !bt_mesh_sensor_delta_threshold(s, value)) {
 		return;
 	}
 
@@ -890,7 +1069,9 @@ static void pub_msg_add(struct bt_mesh_sensor_srv *srv,
 int _bt_mesh_sensor_srv_update_handler(struct bt_mesh_model *mod)
 {
 	struct bt_mesh_sensor_srv *srv = mod->user_data;
+	uint8_t state[CONFIG_BT_MESH_SENSOR_SRV_SENSORS_MAX];
 	struct bt_mesh_sensor *s;
+	int i;
 
 	bt_mesh_model_msg_init(srv->pub.msg, BT_MESH_SENSOR_OP_STATUS);
 
@@ -905,16 +1086,43 @@ int _bt_mesh_sensor_srv_update_handler(struct bt_mesh_model *mod)
 	srv->pub.fast_period = 0;
 
 	uint32_t base_period = bt_mesh_model_pub_period_get(mod);
+	size_t limit = net_buf_simple_tailroom(srv->pub.msg) - BT_MESH_MIC_SHORT;
+	size_t budget = MIN(limit, CONFIG_BT_MESH_SENSOR_SRV_PUB_LEN);
 
+	/* Decide which sensors to sample before sampling any of them, so
+	 * that sensors that can't be published aren't sampled.
+	 */
+	i = 0;
+	SENSOR_FOR_EACH(&srv->sensors, s)
+	{
+		state[i++] = pub_state_get(srv, s, period_div, base_period);
+	}
+
+	size_t reserved = pub_due_select(srv, state, budget, limit);
+
+	/* Sensors are added in the order of their IDs, with the remaining
+	 * budget going to sensors that need a delta threshold check.
+	 */
+	i = 0;
 	SENSOR_FOR_EACH(&srv->sensors, s)
 	{
-		pub_msg_add(srv, s, period_div, base_period);
+		uint32_t len = srv->pub.msg->len - original_len;
+
+		if (state[i] == PUB_DUE) {
+			reserved -= status_len_get(s);
+			pub_msg_add(srv, s, state[i]);
+		} else if (state[i] == PUB_CHECK &&
+			   len + reserved + status_len_get(s) <= budget) {
+			pub_msg_add(srv, s, state[i]);
+		}
 
 		if (s->state.fast_pub) {
 			srv->pub.fast_period = true;
 			srv->pub.period_div =
 				MAX(srv->pub.period_div, s->state.pub_div);
 		}
+
+		i++;
 	}
 
 	if (period_div != srv->pub.period_div) {
@@ -975,3 +1183,9 @@ int bt_mesh_sensor_srv_sample(struct bt_mesh_sensor_srv *srv,
 
 	return bt_mesh_sensor_srv_pub(srv, NULL, sensor, value);
 }
+
+void bt_mesh_sensor_srv_notify(struct bt_mesh_sensor_srv *srv,
+			       struct bt_mesh_sensor *sensor)
+{
+	atomic_set(&sensor->state.changed, 1);
+}
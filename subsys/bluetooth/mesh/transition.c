@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <bluetooth/mesh/transition.h>
+#include "transition_internal.h"
+
+#define BT_DBG_ENABLED IS_ENABLED(CONFIG_BT_MESH_DEBUG_MODEL)
+#define LOG_MODULE_NAME bt_mesh_transition
+#include "common/log.h"
+
+#define TICK_MS CONFIG_BT_MESH_TRANSITION_TICK
+#define WHEEL_SIZE CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE
+
+/* Transitions are kept in a timer wheel, in the slot of the tick they end
+ * in. Transitions that end more than a full turn of the wheel ahead share
+ * the slot with transitions that end in earlier turns.
+ */
+static sys_slist_t wheel[WHEEL_SIZE];
+/* Number of transitions in progress */
+static uint32_t active;
+/* Last processed tick */
+static uint32_t curr_tick;
+/* Transitions that ended in the tick being processed, waiting for their end
+ * callback.
+ */
+static sys_slist_t ended;
+
+static void tick_work_handler(struct k_work *work);
+
+static K_DELAYED_WORK_DEFINE(tick_work, tick_work_handler);
+
+static int64_t uptime_get(void)
+{
+	return k_uptime_get();
+}
+
+/* Time source of all transitions */
+static int64_t (*time_get)(void) = uptime_get;
+
+void transition_time_source_set(int64_t (*func)(void))
+{
+	time_get = func ? func : uptime_get;
+}
+
+static uint32_t tick_get(int64_t uptime)
+{
+	return uptime / TICK_MS;
+}
+
+/* Whether tick a is before tick b, accounting for wrapping. */
+static bool tick_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+static void timer_start(int64_t now)
+{
+	k_delayed_work_submit(&tick_work, K_MSEC(TICK_MS - (now % TICK_MS)));
+}
+
+/* Remove a transition from the group of ended transitions, so that its end
+ * callback isn't called. Used when the transition is restarted or stopped by
+ * the end callback of another transition in the group.
+ */
+static void ended_remove(struct bt_mesh_transition *transition)
+{
+	sys_slist_find_and_remove(&ended, &transition->state.node);
+	transition->state.ending = false;
+}
+
+static void wheel_remove(struct bt_mesh_transition *transition)
+{
+	sys_slist_t *slot = &wheel[transition->state.end_tick % WHEEL_SIZE];
+
+	sys_slist_find_and_remove(slot, &transition->state.node);
+	transition->state.active = false;
+	active--;
+}
+
+static int32_t interpolate(const struct bt_mesh_transition *transition,
+			   uint32_t tick)
+{
+	uint32_t elapsed = tick - transition->state.start_tick;
+	uint32_t duration =
+		transition->state.end_tick - transition->state.start_tick;
+	int64_t delta =
+		(int64_t)transition->state.target - transition->state.start;
+
+	return transition->state.start + (delta * elapsed) / duration;
+}
+
+static void level_set(struct bt_mesh_transition *transition, int32_t level)
+{
+	if (transition->state.level == level) {
+		return;
+	}
+
+	transition->state.level = level;
+
+	if (transition->cb && transition->cb->step) {
+		transition->cb->step(transition, level);
+	}
+}
+
+static void ticks_process(uint32_t tick)
+{
+	struct bt_mesh_transition *transition, *tmp;
+	uint32_t ticks;
+
+	/* Collect the transitions that ended since the last processed tick.
+	 * Only the slots of the passed ticks are visited, unless the timer
+	 * is lagging behind by more than a full turn.
+	 */
+	ticks = MIN(tick - curr_tick, WHEEL_SIZE);
+
+	for (uint32_t i = 1; i <= ticks; i++) {
+		sys_slist_t *slot = &wheel[(curr_tick + i) % WHEEL_SIZE];
+
+		SYS_SLIST_FOR_EACH_CONTAINER_SAFE(slot, transition, tmp,
+						  state.node)
+		{
+			if (tick_before(tick, transition->state.end_tick)) {
+				continue;
+			}
+
+			sys_slist_find_and_remove(slot,
+						  &transition->state.node);
+			sys_slist_append(&ended, &transition->state.node);
+			transition->state.active = false;
+			transition->state.ending = true;
+			active--;
+		}
+	}
+
+	curr_tick = tick;
+
+	/* Update the levels of all running transitions in a single pass */
+	for (int i = 0; i < WHEEL_SIZE; i++) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&wheel[i], transition, state.node)
+		{
+			if (!tick_before(tick, transition->state.start_tick)) {
+				level_set(transition,
+					  interpolate(transition, tick));
+			}
+		}
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&ended, transition, state.node)
+	{
+		level_set(transition, transition->state.target);
+	}
+
+	/* End the transitions of this tick as a group. The end callbacks may
+	 * start or stop any transition, including the ones still waiting in
+	 * the group, so each transition is unlinked from the group before
+	 * its callback is called.
+	 */
+	while (!sys_slist_is_empty(&ended)) {
+		transition = CONTAINER_OF(sys_slist_get_not_empty(&ended),
+					  struct bt_mesh_transition,
+					  state.node);
+		transition->state.ending = false;
+
+		if (transition->cb && transition->cb->end) {
+			transition->cb->end(transition);
+		}
+	}
+}
+
+void transition_tick(void)
+{
+	int64_t now = time_get();
+	uint32_t tick = tick_get(now);
+
+	if (active && tick_before(curr_tick, tick)) {
+		ticks_process(tick);
+	}
+
+	if (active) {
+		timer_start(now);
+	}
+}
+
+static void tick_work_handler(struct k_work *work)
+{
+	transition_tick();
+}
+
+void bt_mesh_transition_start(struct bt_mesh_transition *transition,
+			      int32_t target,
+			      const struct bt_mesh_model_transition *params)
+{
+	uint32_t delay = params ? params->delay : 0;
+	uint32_t time = params ? params->time : 0;
+	int64_t now;
+
+	if (transition->state.active) {
+		wheel_remove(transition);
+	} else if (transition->state.ending) {
+		ended_remove(transition);
+	}
+
+	transition->state.target = target;
+
+	if (!delay && !time) {
+		level_set(transition, target);
+		return;
+	}
+
+	now = time_get();
+
+	if (!active) {
+		curr_tick = tick_get(now);
+		timer_start(now);
+	}
+
+	/* Round up to the next tick, so that transitions never end early.
+	 * The transition ends no earlier than the next tick to process.
+	 */
+	transition->state.start = transition->state.level;
+	transition->state.start_tick = tick_get(now + delay + TICK_MS - 1);
+	transition->state.end_tick =
+		tick_get(now + delay + time + TICK_MS - 1);
+
+	if (!tick_before(curr_tick, transition->state.start_tick)) {
+		transition->state.start_tick = curr_tick + 1;
+	}
+
+	if (!tick_before(curr_tick, transition->state.end_tick)) {
+		transition->state.end_tick = curr_tick + 1;
+	}
+
+	BT_DBG("%d -> %d: ticks %u - %u", transition->state.start, target,
+	       transition->state.start_tick, transition->state.end_tick);
+
+	sys_slist_append(&wheel[transition->state.end_tick % WHEEL_SIZE],
+			 &transition->state.node);
+	transition->state.active = true;
+	active++;
+}
+
+void bt_mesh_transition_stop(struct bt_mesh_transition *transition)
+{
+	if (transition->state.ending) {
+		ended_remove(transition);
+		return;
+	}
+
+	if (!transition->state.active) {
+		return;
+	}
+
+	wheel_remove(transition);
+
+	if (!active) {
+		k_delayed_work_cancel(&tick_work);
+	}
+}
+
+uint32_t
+bt_mesh_transition_remaining_get(const struct bt_mesh_transition *transition)
+{
+	int64_t now;
+	int32_t ticks;
+
+	if (!transition->state.active) {
+		return 0;
+	}
+
+	now = time_get();
+	ticks = transition->state.end_tick - tick_get(now);
+
+	return MAX(0, ticks * TICK_MS - (int32_t)(now % TICK_MS));
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef TRANSITION_INTERNAL_H__
+#define TRANSITION_INTERNAL_H__
+
+#include <bluetooth/mesh/transition.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Set the time source of the transitions.
+ *
+ *  All transition timing, including the start, the remaining time and the
+ *  ticks, is based on this time source. The uptime is used by default.
+ *
+ *  @param func Function returning the time in milliseconds, or NULL to use
+ *              the uptime.
+ */
+void transition_time_source_set(int64_t (*func)(void));
+
+/** @brief Process all transition ticks up to the current time.
+ *
+ *  Called by the transition timer, but may be called directly to drive the
+ *  transitions from another time source.
+ */
+void transition_tick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRANSITION_INTERNAL_H__ */
@@ -17,6 +17,8 @@
 #include <debug/ppi_trace.h>
 #include <logging/log.h>
 
+#include "cpu_load_threads.h"
+
 LOG_MODULE_REGISTER(cpu_load, CONFIG_CPU_LOAD_LOG_LEVEL);
 
 /* Convert event address to associated publish register */
@@ -279,6 +281,10 @@ static int cmd_cpu_load_reset(const struct shell *shell,
 
 	cpu_load_reset();
 
+	if (IS_ENABLED(CONFIG_CPU_LOAD_THREADS)) {
+		cpu_load_threads_reset();
+	}
+
 	return 0;
 }
 
@@ -288,6 +294,9 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_cmd_cpu_load,
 			cmd_cpu_load_reset, 1, 0),
 	SHELL_CMD_ARG(init, NULL, "Init",
 			cmd_cpu_load_reset, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_CPU_LOAD_THREADS_CMDS, threads, NULL,
+			"Get load of threads and interrupts",
+			cpu_load_threads_cmd, 1, 0),
 	SHELL_SUBCMD_SET_END
 );
 
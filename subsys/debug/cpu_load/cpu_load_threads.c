@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <stdio.h>
+#include <string.h>
+#include <kernel.h>
+#include <kernel_structs.h>
+#include <init.h>
+#include <debug/cpu_load.h>
+#include <shell/shell.h>
+
+#include "cpu_load_threads.h"
+
+#if defined(CONFIG_CPU_CORTEX_M)
+#include <arch/arm/aarch32/cortex_m/cmsis.h>
+#elif defined(CONFIG_ARCH_POSIX)
+#include <irq_handler.h>
+#endif
+
+/* Entry that collects interrupts that could not be identified. */
+#define IRQ_OTHER CONFIG_NUM_IRQS
+
+#define IRQ_NESTING_MAX 8
+
+/* Value of 100% load, as reported by cpu_load_get. */
+#define FULL_LOAD 100000
+
+struct thread_entry {
+	const struct k_thread *thread;
+	uint64_t cycles;
+	uint32_t switches;
+	/* Time when the thread was switched out. */
+	uint32_t switched_out_ts;
+	/* Thread was preempted and is waiting in the run queue. */
+	bool ready;
+	bool switched_out;
+	uint32_t latency[CPU_LOAD_LATENCY_BUCKETS];
+};
+
+struct irq_entry {
+	uint64_t cycles;
+	uint32_t count;
+};
+
+static struct thread_entry threads[CONFIG_CPU_LOAD_THREADS_MAX];
+static struct irq_entry irqs[IRQ_OTHER + 1];
+static struct thread_entry *current_entry;
+
+static uint8_t irq_stack[IRQ_NESTING_MAX];
+static uint8_t isr_depth;
+static uint32_t isr_exit_ts;
+
+static uint32_t last_ts;
+static uint64_t total_cycles;
+
+
+static int current_irq(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M)
+	return (int)__get_IPSR() - 16;
+#elif defined(CONFIG_ARCH_POSIX)
+	return posix_get_current_irq();
+#else
+	return -1;
+#endif
+}
+
+/* Charge the time since the last hook to whatever was running. */
+static void charge(uint32_t now)
+{
+	uint32_t delta = now - last_ts;
+
+	last_ts = now;
+	total_cycles += delta;
+
+	if (isr_depth > 0) {
+		irqs[irq_stack[MIN(isr_depth, IRQ_NESTING_MAX) - 1]].cycles +=
+			delta;
+	} else if (current_entry) {
+		current_entry->cycles += delta;
+	}
+}
+
+static struct thread_entry *entry_get(const struct k_thread *thread)
+{
+	size_t start = ((uintptr_t)thread / sizeof(void *)) %
+		       ARRAY_SIZE(threads);
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		struct thread_entry *entry =
+			&threads[(start + i) % ARRAY_SIZE(threads)];
+
+		if (entry->thread == thread) {
+			return entry;
+		}
+
+		if (!entry->thread) {
+			entry->thread = thread;
+			return entry;
+		}
+	}
+
+	/* Table is full, the time is counted only in the total. */
+	return NULL;
+}
+
+static void latency_store(struct thread_entry *entry, uint32_t cycles)
+{
+	uint32_t us = k_cyc_to_us_floor32(cycles);
+	size_t bucket = 0;
+
+	if (us > 0) {
+		bucket = MIN(32 - __builtin_clz(us),
+			     CPU_LOAD_LATENCY_BUCKETS - 1);
+	}
+
+	entry->latency[bucket]++;
+}
+
+static void thread_switched_in(const struct k_thread *thread)
+{
+	int key = irq_lock();
+	uint32_t now = k_cycle_get_32();
+
+	charge(now);
+
+	struct thread_entry *entry = entry_get(thread);
+
+	current_entry = entry;
+
+	if (entry) {
+		entry->switches++;
+
+		/* A preempted thread waited since it was switched out.
+		 * Otherwise, assume the thread was woken up by the last
+		 * interrupt, if it came after the thread was switched out.
+		 */
+		if (entry->ready) {
+			latency_store(entry, now - entry->switched_out_ts);
+		} else if (entry->switched_out &&
+			   ((int32_t)(isr_exit_ts - entry->switched_out_ts) >
+			    0)) {
+			latency_store(entry, now - isr_exit_ts);
+		}
+
+		entry->ready = false;
+	}
+
+	irq_unlock(key);
+}
+
+static void thread_switched_out(const struct k_thread *thread)
+{
+	int key = irq_lock();
+	uint32_t now = k_cycle_get_32();
+
+	charge(now);
+
+	if (current_entry) {
+		/* A thread that did not block stays in the run queue. */
+		current_entry->ready =
+			(thread->base.thread_state & _THREAD_QUEUED) != 0;
+		current_entry->switched_out = true;
+		current_entry->switched_out_ts = now;
+	}
+
+	/* Time until the next thread is switched in is not counted for any
+	 * thread.
+	 */
+	current_entry = NULL;
+
+	irq_unlock(key);
+}
+
+static void isr_enter(void)
+{
+	int key = irq_lock();
+	int irq = current_irq();
+
+	charge(k_cycle_get_32());
+
+	if ((irq < 0) || (irq >= IRQ_OTHER)) {
+		irq = IRQ_OTHER;
+	}
+
+	if (isr_depth < IRQ_NESTING_MAX) {
+		irq_stack[isr_depth] = irq;
+	}
+
+	isr_depth++;
+	irqs[irq].count++;
+
+	irq_unlock(key);
+}
+
+static void isr_exit(void)
+{
+	int key = irq_lock();
+	uint32_t now = k_cycle_get_32();
+
+	charge(now);
+
+	if (isr_depth > 0) {
+		isr_depth--;
+	}
+
+	if (isr_depth == 0) {
+		isr_exit_ts = now;
+	}
+
+	irq_unlock(key);
+}
+
+/* The hooks of the CPU statistics tracing backend are wrapped at link time,
+ * so the accounting works with any architecture that calls them.
+ */
+void __real_sys_trace_thread_switched_in(void);
+void __real_sys_trace_thread_switched_out(void);
+void __real_sys_trace_isr_enter(void);
+void __real_sys_trace_isr_exit(void);
+
+void __wrap_sys_trace_thread_switched_in(void)
+{
+	thread_switched_in(k_current_get());
+	__real_sys_trace_thread_switched_in();
+}
+
+void __wrap_sys_trace_thread_switched_out(void)
+{
+	thread_switched_out(k_current_get());
+	__real_sys_trace_thread_switched_out();
+}
+
+void __wrap_sys_trace_isr_enter(void)
+{
+	isr_enter();
+	__real_sys_trace_isr_enter();
+}
+
+void __wrap_sys_trace_isr_exit(void)
+{
+	isr_exit();
+	__real_sys_trace_isr_exit();
+}
+
+static uint32_t load_get(uint64_t cycles, uint64_t total)
+{
+	if (total == 0) {
+		return 0;
+	}
+
+	return (uint32_t)((cycles * FULL_LOAD) / total);
+}
+
+/* Total time since the reset, including the time since the last hook. */
+static uint64_t total_get(void)
+{
+	return total_cycles + (k_cycle_get_32() - last_ts);
+}
+
+void cpu_load_threads_foreach(cpu_load_thread_cb_t cb, void *user_data)
+{
+	__ASSERT_NO_MSG(cb);
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		struct thread_entry entry;
+		uint64_t total;
+		int key = irq_lock();
+
+		/* Include the time of the thread that is running now. */
+		charge(k_cycle_get_32());
+		entry = threads[i];
+		total = total_cycles;
+
+		irq_unlock(key);
+
+		if (!entry.thread) {
+			continue;
+		}
+
+		struct cpu_load_thread_info info = {
+			.thread = entry.thread,
+			.load = load_get(entry.cycles, total),
+			.switches = entry.switches,
+		};
+
+		memcpy(info.latency, entry.latency, sizeof(info.latency));
+
+		cb(&info, user_data);
+	}
+}
+
+void cpu_load_irqs_foreach(cpu_load_irq_cb_t cb, void *user_data)
+{
+	__ASSERT_NO_MSG(cb);
+
+	for (size_t i = 0; i < ARRAY_SIZE(irqs); i++) {
+		struct irq_entry entry;
+		uint64_t total;
+		int key = irq_lock();
+
+		entry = irqs[i];
+		total = total_get();
+
+		irq_unlock(key);
+
+		if (entry.count == 0) {
+			continue;
+		}
+
+		struct cpu_load_irq_info info = {
+			.irq = (i == IRQ_OTHER) ? -1 : (int)i,
+			.load = load_get(entry.cycles, total),
+			.count = entry.count,
+		};
+
+		cb(&info, user_data);
+	}
+}
+
+void cpu_load_threads_reset(void)
+{
+	int key = irq_lock();
+
+	memset(threads, 0, sizeof(threads));
+	memset(irqs, 0, sizeof(irqs));
+	total_cycles = 0;
+	last_ts = k_cycle_get_32();
+	isr_exit_ts = last_ts;
+
+	if (isr_depth == 0) {
+		current_entry = entry_get(k_current_get());
+	}
+
+	irq_unlock(key);
+}
+
+static int cpu_load_threads_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	cpu_load_threads_reset();
+
+	return 0;
+}
+
+SYS_INIT(cpu_load_threads_init, POST_KERNEL,
+	 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+#ifdef CONFIG_CPU_LOAD_THREADS_CMDS
+static void latency_print(const struct shell *shell,
+			  const struct cpu_load_thread_info *info)
+{
+	char buf[CPU_LOAD_LATENCY_BUCKETS * 16];
+	size_t pos = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(info->latency); i++) {
+		if (info->latency[i] == 0) {
+			continue;
+		}
+
+		int len = snprintf(&buf[pos], sizeof(buf) - pos, " %u+:%u",
+				   (i > 0) ? BIT(i - 1) : 0,
+				   info->latency[i]);
+
+		if ((len < 0) || (len >= (sizeof(buf) - pos))) {
+			break;
+		}
+
+		pos += len;
+	}
+
+	if (pos > 0) {
+		shell_print(shell, "    latency [us]:%s", buf);
+	}
+}
+
+static void thread_print(const struct cpu_load_thread_info *info,
+			 void *user_data)
+{
+	const struct shell *shell = user_data;
+	const char *name = k_thread_name_get((k_tid_t)info->thread);
+
+	if (name && (name[0] != '\0')) {
+		shell_print(shell, "  %-24s %3u,%03u%% %10u", name,
+			    info->load / 1000, info->load % 1000,
+			    info->switches);
+	} else {
+		shell_print(shell, "  %-24p %3u,%03u%% %10u",
+			    (void *)info->thread,
+			    info->load / 1000, info->load % 1000,
+			    info->switches);
+	}
+
+	latency_print(shell, info);
+}
+
+static void irq_print(const struct cpu_load_irq_info *info, void *user_data)
+{
+	const struct shell *shell = user_data;
+
+	if (info->irq < 0) {
+		shell_print(shell, "  %-24s %3u,%03u%% %10u", "other",
+			    info->load / 1000, info->load % 1000, info->count);
+	} else {
+		shell_print(shell, "  %-24d %3u,%03u%% %10u", info->irq,
+			    info->load / 1000, info->load % 1000, info->count);
+	}
+}
+
+int cpu_load_threads_cmd(const struct shell *shell, size_t argc, char **argv)
+{
+	shell_print(shell, "  %-24s %8s %10s", "Thread", "Load", "Switches");
+	cpu_load_threads_foreach(thread_print, (void *)shell);
+
+	shell_print(shell, "  %-24s %8s %10s", "IRQ", "Load", "Count");
+	cpu_load_irqs_foreach(irq_print, (void *)shell);
+
+	return 0;
+}
+
+#ifndef CONFIG_CPU_LOAD_CMDS
+/* Without the system-wide measurement, the threads subcommand is
+ * registered here.
+ */
+static int cmd_cpu_load_threads_reset(const struct shell *shell, size_t argc,
+				      char **argv)
+{
+	cpu_load_threads_reset();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_cmd_cpu_load_threads,
+	SHELL_CMD_ARG(threads, NULL, "Get load of threads and interrupts",
+			cpu_load_threads_cmd, 1, 0),
+	SHELL_CMD_ARG(reset, NULL, "Reset measurement",
+			cmd_cpu_load_threads_reset, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(cpu_load, &sub_cmd_cpu_load_threads, "CPU load", NULL);
+#endif /* CONFIG_CPU_LOAD_CMDS */
+#endif /* CONFIG_CPU_LOAD_THREADS_CMDS */
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef CPU_LOAD_THREADS_H__
+#define CPU_LOAD_THREADS_H__
+
+#include <shell/shell.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Shell command that prints the load of threads and interrupts. */
+int cpu_load_threads_cmd(const struct shell *shell, size_t argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPU_LOAD_THREADS_H__ */
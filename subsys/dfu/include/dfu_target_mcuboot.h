@@ -15,11 +15,24 @@
 #define DFU_TARGET_MCUBOOT_H__
 
 #include <stddef.h>
+#include <zephyr/types.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** @brief Write statistics of the current firmware upgrade. */
+struct dfu_target_mcuboot_stats {
+	/** Number of bytes written to the flash image. */
+	size_t bytes_written;
+	/** Time spent writing to the flash image, in milliseconds. */
+	uint32_t write_time_ms;
+	/** Number of times the write progress was stored to flash. */
+	uint32_t checkpoints;
+	/** Number of times a write waited for the flash writer thread. */
+	uint32_t stalls;
+};
+
 /**
  * @brief Find correct MCUBoot update file path entry in space separated string.
  *
@@ -70,6 +83,11 @@ int dfu_target_mcuboot_offset_get(size_t *offset);
 /**
  * @brief Write firmware data.
  *
+ * With CONFIG_DFU_TARGET_MCUBOOT_PIPELINE, the data is written by a
+ * separate thread. A write error is returned by the next call, and by all
+ * calls after it, until dfu_target_mcuboot_done() or
+ * dfu_target_mcuboot_init() is called.
+ *
  * @param[in] buf Pointer to data that should be written.
  * @param[in] len Length of data to write.
  *
@@ -77,6 +95,18 @@ int dfu_target_mcuboot_offset_get(size_t *offset);
  */
 int dfu_target_mcuboot_write(const void *const buf, size_t len);
 
+/**
+ * @brief Get write statistics, for example to compute the flash write
+ *	  throughput or the number of progress writes to flash.
+ *
+ * The statistics are reset by dfu_target_mcuboot_init().
+ *
+ * @param[out] stats Statistics of the current firmware upgrade.
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+int dfu_target_mcuboot_stats_get(struct dfu_target_mcuboot_stats *stats);
+
 /**
  * @brief Deinitialize resources and finalize firmware upgrade if successful.
 
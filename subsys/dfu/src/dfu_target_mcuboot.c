@@ -23,6 +23,7 @@
 #include <dfu/mcuboot.h>
 #include <dfu/dfu_target.h>
 #include <dfu/flash_img.h>
+#include "dfu_target_mcuboot.h"
 #include <settings/settings.h>
 
 LOG_MODULE_REGISTER(dfu_target_mcuboot, CONFIG_DFU_TARGET_LOG_LEVEL);
@@ -30,7 +31,23 @@ LOG_MODULE_REGISTER(dfu_target_mcuboot, CONFIG_DFU_TARGET_LOG_LEVEL);
 #define MAX_FILE_SEARCH_LEN 500
 #define MCUBOOT_HEADER_MAGIC 0x96f3b83d
 
+#if defined(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS)
+#define CHECKPOINT_INTERVAL CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_INTERVAL
+#define CHECKPOINT_INTERVAL_MS \
+	CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_INTERVAL_MS
+#else
+#define CHECKPOINT_INTERVAL 0
+#define CHECKPOINT_INTERVAL_MS 0
+#endif
+
 static struct flash_img_context flash_img;
+/* Updated by the writer thread when the pipeline is enabled. */
+static struct dfu_target_mcuboot_stats stats;
+static K_MUTEX_DEFINE(stats_lock);
+
+/* Progress at the last stored checkpoint. */
+static size_t checkpoint_offset;
+static int64_t checkpoint_time;
 
 int dfu_ctx_mcuboot_set_b1_file(const char *file, bool s0_active,
 				const char **update)
@@ -85,11 +102,240 @@ static int store_flash_img_context(void)
 			LOG_ERR("Problem storing offset (err %d)", err);
 			return err;
 		}
+
+		checkpoint_offset = bytes_written;
+		checkpoint_time = k_uptime_get();
+
+		k_mutex_lock(&stats_lock, K_FOREVER);
+		stats.checkpoints++;
+		k_mutex_unlock(&stats_lock);
 	}
 
 	return 0;
 }
 
+/**
+ * @brief Store the progress if enough data has been written, or enough time
+ *	  has passed, since the last checkpoint.
+ */
+static void checkpoint(void)
+{
+	size_t bytes_written = flash_img_bytes_written(&flash_img);
+	int err;
+
+	if (!IS_ENABLED(CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS) ||
+	    (bytes_written == checkpoint_offset)) {
+		return;
+	}
+
+	if ((bytes_written - checkpoint_offset < CHECKPOINT_INTERVAL) &&
+	    ((CHECKPOINT_INTERVAL_MS == 0) ||
+	     (k_uptime_get() - checkpoint_time < CHECKPOINT_INTERVAL_MS))) {
+		return;
+	}
+
+	err = store_flash_img_context();
+	if (err != 0) {
+		/* Failing to store progress is not a critical error you'll just
+		 * be left to download a bit more if you fail and resume.
+		 */
+		LOG_WRN("Unable to store write progress: %d", err);
+	}
+}
+
+static int flash_write(const uint8_t *buf, size_t len, bool flush)
+{
+	int64_t start = k_uptime_get();
+	int err = flash_img_buffered_write(&flash_img, (uint8_t *)buf, len,
+					   flush);
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	stats.write_time_ms += (uint32_t)(k_uptime_get() - start);
+	if (err == 0) {
+		stats.bytes_written += len;
+	}
+	k_mutex_unlock(&stats_lock);
+
+	if (err != 0) {
+		LOG_ERR("flash_img_buffered_write error %d", err);
+		return err;
+	}
+
+	if (!flush) {
+		checkpoint();
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_DFU_TARGET_MCUBOOT_PIPELINE)
+#define PIPELINE_BUF_SIZE CONFIG_DFU_TARGET_MCUBOOT_PIPELINE_BUF_SIZE
+
+struct pipeline_buf {
+	uint8_t data[PIPELINE_BUF_SIZE];
+	size_t len;
+};
+
+/* Buffers are filled and written in turn, so the writer thread always
+ * releases the buffer that is to be filled next.
+ */
+static struct pipeline_buf pipeline_bufs[2];
+static struct pipeline_buf *pipeline_fill;
+static uint8_t pipeline_next;
+/* Data accepted by dfu_target_mcuboot_write() but not yet written. */
+static atomic_t pipeline_pending;
+/* First write error, kept until the upgrade is finished or restarted,
+ * since the data after the failed write is not written.
+ */
+static atomic_t pipeline_err;
+/* Set to drop the queued data instead of writing it. */
+static atomic_t pipeline_discarding;
+
+static K_SEM_DEFINE(pipeline_free_sem, ARRAY_SIZE(pipeline_bufs),
+		    ARRAY_SIZE(pipeline_bufs));
+static K_MSGQ_DEFINE(pipeline_msgq, sizeof(struct pipeline_buf *),
+		     ARRAY_SIZE(pipeline_bufs), 4);
+
+static void pipeline_thread(void)
+{
+	struct pipeline_buf *buf;
+	int err;
+
+	while (true) {
+		k_msgq_get(&pipeline_msgq, &buf, K_FOREVER);
+
+		/* After an error, the rest of the data is dropped. */
+		if ((atomic_get(&pipeline_err) == 0) &&
+		    !atomic_get(&pipeline_discarding)) {
+			err = flash_write(buf->data, buf->len, false);
+			if (err != 0) {
+				atomic_set(&pipeline_err, err);
+			}
+		}
+
+		atomic_sub(&pipeline_pending, buf->len);
+		k_sem_give(&pipeline_free_sem);
+	}
+}
+
+K_THREAD_DEFINE(dfu_target_mcuboot_writer,
+		CONFIG_DFU_TARGET_MCUBOOT_PIPELINE_STACK_SIZE,
+		pipeline_thread, NULL, NULL, NULL,
+		CONFIG_DFU_TARGET_MCUBOOT_PIPELINE_THREAD_PRIO, 0, 0);
+
+static void pipeline_submit(void)
+{
+	struct pipeline_buf *buf = pipeline_fill;
+
+	pipeline_fill = NULL;
+
+	(void)k_msgq_put(&pipeline_msgq, &buf, K_FOREVER);
+}
+
+static int pipeline_write(const uint8_t *buf, size_t len)
+{
+	int err = atomic_get(&pipeline_err);
+
+	if (err != 0) {
+		return err;
+	}
+
+	while (len > 0) {
+		size_t chunk;
+
+		if (pipeline_fill == NULL) {
+			if (k_sem_take(&pipeline_free_sem, K_NO_WAIT) != 0) {
+				/* Both buffers are waiting to be written. */
+				k_mutex_lock(&stats_lock, K_FOREVER);
+				stats.stalls++;
+				k_mutex_unlock(&stats_lock);
+				k_sem_take(&pipeline_free_sem, K_FOREVER);
+			}
+
+			pipeline_fill = &pipeline_bufs[pipeline_next];
+			pipeline_fill->len = 0;
+			pipeline_next = (pipeline_next + 1) %
+					ARRAY_SIZE(pipeline_bufs);
+		}
+
+		chunk = MIN(len, PIPELINE_BUF_SIZE - pipeline_fill->len);
+		memcpy(&pipeline_fill->data[pipeline_fill->len], buf, chunk);
+		pipeline_fill->len += chunk;
+		atomic_add(&pipeline_pending, chunk);
+		buf += chunk;
+		len -= chunk;
+
+		if (pipeline_fill->len == PIPELINE_BUF_SIZE) {
+			pipeline_submit();
+		}
+	}
+
+	return atomic_get(&pipeline_err);
+}
+
+/* Wait until the writer thread has released all buffers. */
+static void pipeline_wait(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(pipeline_bufs); i++) {
+		k_sem_take(&pipeline_free_sem, K_FOREVER);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(pipeline_bufs); i++) {
+		k_sem_give(&pipeline_free_sem);
+	}
+}
+
+/**
+ * @brief Hand over the partially filled buffer and wait until the writer
+ *	  thread has written all data.
+ *
+ * @return The first error from the writer thread, which is cleared.
+ */
+static int pipeline_flush(void)
+{
+	if (pipeline_fill != NULL) {
+		pipeline_submit();
+	}
+
+	pipeline_wait();
+
+	return atomic_set(&pipeline_err, 0);
+}
+
+/**
+ * @brief Drop the data of an unfinished upgrade, without writing it.
+ *
+ * @return The first error from the writer thread, which is cleared.
+ */
+static int pipeline_discard(void)
+{
+	atomic_set(&pipeline_discarding, 1);
+
+	if (pipeline_fill != NULL) {
+		atomic_sub(&pipeline_pending, pipeline_fill->len);
+		pipeline_fill = NULL;
+		k_sem_give(&pipeline_free_sem);
+	}
+
+	/* A buffer that is being written is completed. */
+	pipeline_wait();
+
+	atomic_set(&pipeline_discarding, 0);
+
+	return atomic_set(&pipeline_err, 0);
+}
+#else
+static int pipeline_flush(void)
+{
+	return 0;
+}
+
+static int pipeline_discard(void)
+{
+	return 0;
+}
+#endif /* defined(CONFIG_DFU_TARGET_MCUBOOT_PIPELINE) */
+
 /**
  * @brief Function used by settings_load() to restore the flash_img variable.
  *	  See the Zephyr documentation of the settings subsystem for more
@@ -121,7 +367,20 @@ bool dfu_target_mcuboot_identify(const void *const buf)
 int dfu_target_mcuboot_init(size_t file_size, dfu_target_callback_t cb)
 {
 	ARG_UNUSED(cb);
-	int err = flash_img_init(&flash_img);
+	/* Data of an upgrade that was not finished is not written after the
+	 * flash image is initialized.
+	 */
+	int err = pipeline_discard();
+
+	if (err != 0) {
+		LOG_WRN("Discarding earlier write error %d", err);
+	}
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	memset(&stats, 0, sizeof(stats));
+	k_mutex_unlock(&stats_lock);
+
+	err = flash_img_init(&flash_img);
 
 	if (err != 0) {
 		LOG_ERR("flash_img_init error %d", err);
@@ -158,6 +417,9 @@ int dfu_target_mcuboot_init(size_t file_size, dfu_target_callback_t cb)
 			LOG_ERR("Cannot load settings (err %d)", err);
 			return err;
 		}
+
+		checkpoint_offset = flash_img_bytes_written(&flash_img);
+		checkpoint_time = k_uptime_get();
 	}
 
 	return 0;
@@ -166,25 +428,33 @@ int dfu_target_mcuboot_init(size_t file_size, dfu_target_callback_t cb)
 int dfu_target_mcuboot_offset_get(size_t *out)
 {
 	*out = flash_img_bytes_written(&flash_img);
+
+#if defined(CONFIG_DFU_TARGET_MCUBOOT_PIPELINE)
+	/* Data in the pipeline will be written, so it must not be sent again. */
+	*out += atomic_get(&pipeline_pending);
+#endif
+
 	return 0;
 }
 
 int dfu_target_mcuboot_write(const void *const buf, size_t len)
 {
-	int err = flash_img_buffered_write(&flash_img, (uint8_t *)buf, len, false);
+#if defined(CONFIG_DFU_TARGET_MCUBOOT_PIPELINE)
+	return pipeline_write(buf, len);
+#else
+	return flash_write(buf, len, false);
+#endif
+}
 
-	if (err != 0) {
-		LOG_ERR("flash_img_buffered_write error %d", err);
-		return err;
+int dfu_target_mcuboot_stats_get(struct dfu_target_mcuboot_stats *out)
+{
+	if (out == NULL) {
+		return -EINVAL;
 	}
 
-	err = store_flash_img_context();
-	if (err != 0) {
-		/* Failing to store progress is not a critical error you'll just
-		 * be left to download a bit more if you fail and resume.
-		 */
-		LOG_WRN("Unable to store write progress: %d", err);
-	}
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&stats_lock);
 
 	return 0;
 }
@@ -197,6 +467,7 @@ static void reset_flash_context(void)
 	if (err) {
 		LOG_ERR("Unable to re-initialize flash_img");
 	}
+	checkpoint_offset = 0;
 	err = store_flash_img_context();
 	if (err != 0) {
 		LOG_ERR("Unable to reset write progress: %d", err);
@@ -205,12 +476,18 @@ static void reset_flash_context(void)
 
 int dfu_target_mcuboot_done(bool successful)
 {
-	int err = 0;
+	int err = pipeline_flush();
+
+	if (err != 0) {
+		LOG_ERR("Pipelined write error %d", err);
+	}
 
 	if (successful) {
-		err = flash_img_buffered_write(&flash_img, NULL, 0, true);
+		if (err == 0) {
+			err = flash_write(NULL, 0, true);
+		}
+
 		if (err != 0) {
-			LOG_ERR("flash_img_buffered_write error %d", err);
 			reset_flash_context();
 			return err;
 		}
@@ -226,6 +503,7 @@ int dfu_target_mcuboot_done(bool successful)
 			"apply");
 	} else {
 		LOG_INF("MCUBoot image upgrade aborted.");
+		err = 0;
 	}
 
 	reset_flash_context();
@@ -11,6 +11,8 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "esb_fifo.h"
+
 /* Constants */
 
 /* 2 Mb RX wait for acknowledgment time-out value.
@@ -119,26 +121,6 @@ struct pipe_info {
 	bool ack_payload; /* State of the transmission of ACK payloads. */
 };
 
-/* First-in, first-out queue of payloads to be transmitted. */
-struct payload_tx_fifo {
-	 /* Payload queue */
-	struct esb_payload *payload[CONFIG_ESB_TX_FIFO_SIZE];
-
-	uint32_t back;	/* Back of the queue (last in). */
-	uint32_t front;	/* Front of queue (first out). */
-	uint32_t count;	/* Number of elements in the queue. */
-};
-
-/* First-in, first-out queue of received payloads. */
-struct payload_rx_fifo {
-	 /* Payload queue */
-	struct esb_payload *payload[CONFIG_ESB_RX_FIFO_SIZE];
-
-	uint32_t back;	/* Back of the queue (last in). */
-	uint32_t front;	/* Front of queue (first out). */
-	uint32_t count;	/* Number of elements in the queue. */
-};
-
 /* Enhanced ShockBurst address.
  *
  * Enhanced ShockBurst addresses consist of a base address and a prefix
@@ -176,13 +158,13 @@ static struct esb_address esb_addr = {
 };
 
 static esb_event_handler event_handler;
-static struct esb_payload *current_payload;
+static struct esb_frame *current_frame;
 
 /* FIFOs and buffers */
 static struct payload_tx_fifo tx_fifo;
 static struct payload_rx_fifo rx_fifo;
-static uint8_t tx_payload_buffer[CONFIG_ESB_MAX_PAYLOAD_LENGTH + 2];
-static uint8_t rx_payload_buffer[CONFIG_ESB_MAX_PAYLOAD_LENGTH + 2];
+/* Acknowledgment without payload. */
+static uint8_t ack_packet[2];
 
 /* Run time variables */
 static uint8_t pids[CONFIG_ESB_PIPE_COUNT];
@@ -449,52 +431,47 @@ static bool update_radio_parameters(void)
 
 static void reset_fifos(void)
 {
-	tx_fifo.back = 0;
-	tx_fifo.front = 0;
-	tx_fifo.count = 0;
-
-	rx_fifo.back = 0;
-	rx_fifo.front = 0;
-	rx_fifo.count = 0;
+	esb_tx_fifo_reset(&tx_fifo);
+	esb_rx_fifo_reset(&rx_fifo);
 }
 
 static void initialize_fifos(void)
 {
-	static struct esb_payload rx_payload[CONFIG_ESB_RX_FIFO_SIZE];
-	static struct esb_payload tx_payload[CONFIG_ESB_TX_FIFO_SIZE];
-
 	reset_fifos();
 
-	for (size_t i = 0; i < CONFIG_ESB_TX_FIFO_SIZE; i++) {
-		tx_fifo.payload[i] = &tx_payload[i];
-	}
+	rx_fifo.radio_frame = &rx_fifo.drop_frame;
+}
 
-	for (size_t i = 0; i < CONFIG_ESB_RX_FIFO_SIZE; i++) {
-		rx_fifo.payload[i] = &rx_payload[i];
+/* Whether the radio transmits from the first slot of the TX FIFO, as a
+ * packet, its retransmission, or an acknowledgment payload.
+ */
+static bool tx_fifo_sending(void)
+{
+	switch (esb_state) {
+	case ESB_STATE_PTX_TX:
+	case ESB_STATE_PTX_TX_ACK:
+	case ESB_STATE_PTX_RX_ACK:
+	case ESB_STATE_PRX_SEND_ACK:
+		return true;
+	default:
+		return false;
 	}
 }
 
 static void tx_fifo_remove_last(void)
 {
-	if (tx_fifo.count == 0) {
-		return;
-	}
-
 	uint32_t key = irq_lock();
 
-	tx_fifo.count--;
-	if (++tx_fifo.front >= CONFIG_ESB_TX_FIFO_SIZE) {
-		tx_fifo.front = 0;
-	}
+	esb_tx_fifo_pop(&tx_fifo);
 
 	irq_unlock(key);
 }
 
-/*  Function to push the content of the rx_buffer to the RX FIFO.
+/*  Function to push the received packet to the RX FIFO.
  *
- *  The module will point the register NRF_RADIO->PACKETPTR to a buffer for
- *  receiving packets. After receiving a packet the module will call this
- *  function to copy the received data to the RX FIFO.
+ *  The module will point the register NRF_RADIO->PACKETPTR to the next free
+ *  slot of the RX FIFO for receiving packets. After receiving a packet the
+ *  module will call this function to add the slot to the RX FIFO.
  *
  *  @param  pipe Pipe number to set for the packet.
  *  @param  pid  Packet ID.
@@ -504,36 +481,13 @@ static void tx_fifo_remove_last(void)
  */
 static bool rx_fifo_push_rfbuf(uint8_t pipe, uint8_t pid)
 {
-	if (rx_fifo.count >= CONFIG_ESB_RX_FIFO_SIZE) {
-		return false;
-	}
-
-	if (esb_cfg.protocol == ESB_PROTOCOL_ESB_DPL) {
-		if (rx_payload_buffer[0] > CONFIG_ESB_MAX_PAYLOAD_LENGTH) {
-			return false;
-		}
-		rx_fifo.payload[rx_fifo.back]->length = rx_payload_buffer[0];
-	} else if (esb_cfg.mode == ESB_MODE_PTX) {
-		/* Received packet is an acknowledgment */
-		rx_fifo.payload[rx_fifo.back]->length = 0;
-	} else {
-		rx_fifo.payload[rx_fifo.back]->length = esb_cfg.payload_length;
-	}
+	/* An acknowledgment without payload is received in PTX mode */
+	uint8_t length = (esb_cfg.mode == ESB_MODE_PTX) ?
+			 0 : esb_cfg.payload_length;
 
-	memcpy(rx_fifo.payload[rx_fifo.back]->data, &rx_payload_buffer[2],
-	       rx_fifo.payload[rx_fifo.back]->length);
-
-	rx_fifo.payload[rx_fifo.back]->pipe = pipe;
-	rx_fifo.payload[rx_fifo.back]->rssi = NRF_RADIO->RSSISAMPLE;
-	rx_fifo.payload[rx_fifo.back]->pid = pid;
-	rx_fifo.payload[rx_fifo.back]->noack = !(rx_payload_buffer[1] & 0x01);
-
-	if (++rx_fifo.back >= CONFIG_ESB_RX_FIFO_SIZE) {
-		rx_fifo.back = 0;
-	}
-	rx_fifo.count++;
-
-	return true;
+	return esb_rx_fifo_commit(&rx_fifo,
+				  esb_cfg.protocol == ESB_PROTOCOL_ESB_DPL,
+				  length, pipe, pid, NRF_RADIO->RSSISAMPLE);
 }
 
 static void sys_timer_init(void)
@@ -573,16 +527,13 @@ static void start_tx_transaction(void)
 	bool ack;
 
 	last_tx_attempts = 1;
-	/* Prepare the payload */
-	current_payload = tx_fifo.payload[tx_fifo.front];
+	/* Prepare the packet header, the payload is sent from the FIFO */
+	current_frame = esb_tx_fifo_front(&tx_fifo);
 
 	switch (esb_cfg.protocol) {
 	case ESB_PROTOCOL_ESB:
-		update_rf_payload_format(current_payload->length);
-		tx_payload_buffer[0] = current_payload->pid;
-		tx_payload_buffer[1] = 0;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
+		update_rf_payload_format(current_frame->length);
+		esb_frame_header_set(current_frame, false);
 
 		NRF_RADIO->SHORTS = radio_shorts_common |
 				    RADIO_SHORTS_DISABLED_RXEN_Msk;
@@ -596,12 +547,8 @@ static void start_tx_transaction(void)
 		break;
 
 	case ESB_PROTOCOL_ESB_DPL:
-		ack = !current_payload->noack || !esb_cfg.selective_auto_ack;
-		tx_payload_buffer[0] = current_payload->length;
-		tx_payload_buffer[1] = current_payload->pid << 1;
-		tx_payload_buffer[1] |= current_payload->noack ? 0x00 : 0x01;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
+		ack = !current_frame->noack || !esb_cfg.selective_auto_ack;
+		esb_frame_header_set(current_frame, true);
 
 		/* Handling ack if noack is set to false or if
 		 * selective auto ack is turned off
@@ -629,11 +576,11 @@ static void start_tx_transaction(void)
 		break;
 	}
 
-	NRF_RADIO->TXADDRESS = current_payload->pipe;
-	NRF_RADIO->RXADDRESSES = 1 << current_payload->pipe;
+	NRF_RADIO->TXADDRESS = current_frame->pipe;
+	NRF_RADIO->RXADDRESSES = 1 << current_frame->pipe;
 	NRF_RADIO->FREQUENCY = esb_addr.rf_channel;
 
-	NRF_RADIO->PACKETPTR = (uint32_t)tx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (uint32_t)current_frame->packet;
 
 	NVIC_ClearPendingIRQ(RADIO_IRQn);
 	irq_enable(RADIO_IRQn);
@@ -688,7 +635,8 @@ static void on_radio_disabled_tx(void)
 		update_rf_payload_format(0);
 	}
 
-	NRF_RADIO->PACKETPTR = (uint32_t)rx_payload_buffer;
+	/* The acknowledgment payload is received to the RX FIFO */
+	NRF_RADIO->PACKETPTR = (uint32_t)esb_rx_fifo_select(&rx_fifo);
 	on_radio_disabled = on_radio_disabled_tx_wait_for_ack;
 	esb_state = ESB_STATE_PTX_RX_ACK;
 }
@@ -715,9 +663,10 @@ static void on_radio_disabled_tx_wait_for_ack(void)
 		tx_fifo_remove_last();
 
 		if (esb_cfg.protocol != ESB_PROTOCOL_ESB &&
-		    rx_payload_buffer[0] > 0) {
-			if (rx_fifo_push_rfbuf((uint8_t)NRF_RADIO->TXADDRESS,
-					       rx_payload_buffer[1] >> 1)) {
+		    rx_fifo.radio_frame->packet[0] > 0) {
+			if (rx_fifo_push_rfbuf(
+				    (uint8_t)NRF_RADIO->TXADDRESS,
+				    rx_fifo.radio_frame->packet[1] >> 1)) {
 				interrupt_flags |=
 					INT_RX_DATA_RECEIVED_MSK;
 			}
@@ -750,8 +699,8 @@ static void on_radio_disabled_tx_wait_for_ack(void)
 			 */
 			NRF_RADIO->SHORTS = radio_shorts_common |
 					    RADIO_SHORTS_DISABLED_RXEN_Msk;
-			update_rf_payload_format(current_payload->length);
-			NRF_RADIO->PACKETPTR = (uint32_t)tx_payload_buffer;
+			update_rf_payload_format(current_frame->length);
+			NRF_RADIO->PACKETPTR = (uint32_t)current_frame->packet;
 			on_radio_disabled = on_radio_disabled_tx;
 			esb_state = ESB_STATE_PTX_TX_ACK;
 			ESB_SYS_TIMER->TASKS_START = 1;
@@ -767,7 +716,7 @@ static void clear_events_restart_rx(void)
 {
 	NRF_RADIO->SHORTS = radio_shorts_common;
 	update_rf_payload_format(esb_cfg.payload_length);
-	NRF_RADIO->PACKETPTR = (uint32_t)rx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (uint32_t)esb_rx_fifo_select(&rx_fifo);
 	NRF_RADIO->EVENTS_DISABLED = 0;
 	NRF_RADIO->TASKS_DISABLE = 1;
 
@@ -782,43 +731,45 @@ static void clear_events_restart_rx(void)
 	NRF_RADIO->TASKS_RXEN = 1;
 }
 
-static void on_radio_disabled_rx_dpl(bool retransmit_payload,
-				     struct pipe_info *pipe_info)
+/* Returns the acknowledgment packet to send. */
+static uint8_t *on_radio_disabled_rx_dpl(bool retransmit_payload,
+					 struct pipe_info *pipe_info,
+					 uint8_t s1)
 {
-	if (tx_fifo.count > 0 &&
-	    (tx_fifo.payload[tx_fifo.front]->pipe == NRF_RADIO->RXMATCH)) {
-		/* Pipe stays in ACK with payload until TX FIFO is empty */
-		/* Do not report TX success on first ack payload or retransmit
-		 */
-		if (pipe_info->ack_payload && !retransmit_payload) {
-			if (++tx_fifo.front >= CONFIG_ESB_TX_FIFO_SIZE) {
-				tx_fifo.front = 0;
-			}
+	struct esb_frame *frame = esb_tx_fifo_front(&tx_fifo);
 
-			tx_fifo.count--;
+	/* Pipe stays in ACK with payload until TX FIFO is empty */
+	/* Do not report TX success on first ack payload or retransmit */
+	if (frame && (frame->pipe == NRF_RADIO->RXMATCH) &&
+	    pipe_info->ack_payload && !retransmit_payload) {
+		esb_tx_fifo_pop(&tx_fifo);
 
-			/* ACK payloads also require TX_DS */
-			/* (page 40 of the
-			 * 'nRF24LE1_Product_Specification_rev1_6.pdf').
-			 */
-			interrupt_flags |= INT_TX_SUCCESS_MSK;
-		}
+		/* ACK payloads also require TX_DS */
+		/* (page 40 of the
+		 * 'nRF24LE1_Product_Specification_rev1_6.pdf').
+		 */
+		interrupt_flags |= INT_TX_SUCCESS_MSK;
+
+		frame = esb_tx_fifo_front(&tx_fifo);
+	}
 
+	if (frame && (frame->pipe == NRF_RADIO->RXMATCH)) {
 		pipe_info->ack_payload = true;
+		current_frame = frame;
 
-		current_payload = tx_fifo.payload[tx_fifo.front];
+		/* The payload is sent from the TX FIFO slot */
+		update_rf_payload_format(current_frame->length);
+		esb_ack_header_set(current_frame->packet, true,
+				   current_frame->length, 0, s1);
 
-		update_rf_payload_format(current_payload->length);
-		tx_payload_buffer[0] = current_payload->length;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
-	} else {
-		pipe_info->ack_payload = false;
-		update_rf_payload_format(0);
-		tx_payload_buffer[0] = 0;
+		return current_frame->packet;
 	}
 
-	tx_payload_buffer[1] = rx_payload_buffer[1];
+	pipe_info->ack_payload = false;
+	update_rf_payload_format(0);
+	esb_ack_header_set(ack_packet, true, 0, 0, s1);
+
+	return ack_packet;
 }
 
 static void on_radio_disabled_rx(void)
@@ -826,64 +777,71 @@ static void on_radio_disabled_rx(void)
 	bool retransmit_payload = false;
 	bool send_rx_event = true;
 	struct pipe_info *pipe_info;
+	uint8_t *ack;
+	uint8_t s0;
+	uint8_t s1;
 
 	if (NRF_RADIO->CRCSTATUS == 0) {
 		clear_events_restart_rx();
 		return;
 	}
 
-	if (rx_fifo.count >= CONFIG_ESB_RX_FIFO_SIZE) {
+	if (!esb_rx_fifo_accepts(&rx_fifo)) {
 		clear_events_restart_rx();
 		return;
 	}
 
+	s0 = rx_fifo.radio_frame->packet[0];
+	s1 = rx_fifo.radio_frame->packet[1];
+
 	pipe_info = &rx_pipe_info[NRF_RADIO->RXMATCH];
 	if (NRF_RADIO->RXCRC == pipe_info->crc &&
-	    (rx_payload_buffer[1] >> 1) == pipe_info->pid) {
+	    (s1 >> 1) == pipe_info->pid) {
 		retransmit_payload = true;
 		send_rx_event = false;
 	}
 
-	pipe_info->pid = rx_payload_buffer[1] >> 1;
+	pipe_info->pid = s1 >> 1;
 	pipe_info->crc = NRF_RADIO->RXCRC;
 
+	if (send_rx_event) {
+		/* Push the new packet to the RX buffer and trigger a received
+		 * event if the operation was successful. This must be done
+		 * before the radio receives again to the next free slot.
+		 */
+		if (rx_fifo_push_rfbuf(NRF_RADIO->RXMATCH, pipe_info->pid)) {
+			interrupt_flags |= INT_RX_DATA_RECEIVED_MSK;
+			NVIC_SetPendingIRQ(ESB_EVT_IRQ);
+		}
+	}
+
 	/* Check if an ack should be sent */
-	if ((esb_cfg.selective_auto_ack == false) ||
-	    ((rx_payload_buffer[1] & 0x01) == 1)) {
+	if ((esb_cfg.selective_auto_ack == false) || ((s1 & 0x01) == 1)) {
 		NRF_RADIO->SHORTS = radio_shorts_common |
 				    RADIO_SHORTS_DISABLED_RXEN_Msk;
 
 		switch (esb_cfg.protocol) {
 		case ESB_PROTOCOL_ESB_DPL:
-			on_radio_disabled_rx_dpl(retransmit_payload, pipe_info);
+			ack = on_radio_disabled_rx_dpl(retransmit_payload,
+						       pipe_info, s1);
 			break;
 
 		case ESB_PROTOCOL_ESB:
+		default:
 			update_rf_payload_format(0);
-			tx_payload_buffer[0] = rx_payload_buffer[0];
-			tx_payload_buffer[1] = 0;
+			esb_ack_header_set(ack_packet, false, 0, s0, 0);
+			ack = ack_packet;
 			break;
 		}
 
 		esb_state = ESB_STATE_PRX_SEND_ACK;
 		NRF_RADIO->TXADDRESS = NRF_RADIO->RXMATCH;
 
-		NRF_RADIO->PACKETPTR = (uint32_t)tx_payload_buffer;
+		NRF_RADIO->PACKETPTR = (uint32_t)ack;
 		on_radio_disabled = on_radio_disabled_rx_ack;
 	} else {
 		clear_events_restart_rx();
 	}
-
-	if (send_rx_event) {
-		/* Push the new packet to the RX buffer and trigger a received
-		 * event if the operation was
-		 * successful.
-		 */
-		if (rx_fifo_push_rfbuf(NRF_RADIO->RXMATCH, pipe_info->pid)) {
-			interrupt_flags |= INT_RX_DATA_RECEIVED_MSK;
-			NVIC_SetPendingIRQ(ESB_EVT_IRQ);
-		}
-	}
 }
 
 static void on_radio_disabled_rx_ack(void)
@@ -892,7 +850,7 @@ static void on_radio_disabled_rx_ack(void)
 			    RADIO_SHORTS_DISABLED_TXEN_Msk;
 	update_rf_payload_format(esb_cfg.payload_length);
 
-	NRF_RADIO->PACKETPTR = (uint32_t)rx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (uint32_t)esb_rx_fifo_select(&rx_fifo);
 	on_radio_disabled = on_radio_disabled_rx;
 
 	esb_state = ESB_STATE_PRX;
@@ -1154,26 +1112,28 @@ int esb_write_payload(const struct esb_payload *payload)
 	     payload->length > esb_cfg.payload_length)) {
 		return -EMSGSIZE;
 	}
-	if (tx_fifo.count >= CONFIG_ESB_TX_FIFO_SIZE) {
-		return -ENOMEM;
-	}
 	if (payload->pipe >= CONFIG_ESB_PIPE_COUNT) {
 		return -EINVAL;
 	}
 
 	uint32_t key = irq_lock();
+	struct esb_frame *frame = esb_tx_fifo_back(&tx_fifo);
 
-	memcpy(tx_fifo.payload[tx_fifo.back], payload,
-	       sizeof(struct esb_payload));
+	if (!frame) {
+		irq_unlock(key);
+		return -ENOMEM;
+	}
 
-	pids[payload->pipe] = (pids[payload->pipe] + 1) % (PID_MAX + 1);
-	tx_fifo.payload[tx_fifo.back]->pid = pids[payload->pipe];
+	/* Copy the payload where the radio transmits it from */
+	memcpy(&frame->packet[2], payload->data, payload->length);
+	frame->length = payload->length;
+	frame->pipe = payload->pipe;
+	frame->noack = payload->noack;
 
-	if (++tx_fifo.back >= CONFIG_ESB_TX_FIFO_SIZE) {
-		tx_fifo.back = 0;
-	}
+	pids[payload->pipe] = (pids[payload->pipe] + 1) % (PID_MAX + 1);
+	frame->pid = pids[payload->pipe];
 
-	tx_fifo.count++;
+	esb_tx_fifo_push(&tx_fifo);
 
 	irq_unlock(key);
 
@@ -1195,25 +1155,22 @@ int esb_read_rx_payload(struct esb_payload *payload)
 		return -EINVAL;
 	}
 
-	if (rx_fifo.count == 0) {
-		return -ENODATA;
-	}
-
 	uint32_t key = irq_lock();
+	const struct esb_frame *frame = esb_rx_fifo_front(&rx_fifo);
 
-	payload->length = rx_fifo.payload[rx_fifo.front]->length;
-	payload->pipe = rx_fifo.payload[rx_fifo.front]->pipe;
-	payload->rssi = rx_fifo.payload[rx_fifo.front]->rssi;
-	payload->pid = rx_fifo.payload[rx_fifo.front]->pid;
-	payload->noack = rx_fifo.payload[rx_fifo.front]->noack;
-	memcpy(payload->data, rx_fifo.payload[rx_fifo.front]->data,
-	       payload->length);
-
-	if (++rx_fifo.front >= CONFIG_ESB_RX_FIFO_SIZE) {
-		rx_fifo.front = 0;
+	if (!frame) {
+		irq_unlock(key);
+		return -ENODATA;
 	}
 
-	rx_fifo.count--;
+	payload->length = frame->length;
+	payload->pipe = frame->pipe;
+	payload->rssi = frame->rssi;
+	payload->pid = frame->pid;
+	payload->noack = frame->noack;
+	memcpy(payload->data, &frame->packet[2], payload->length);
+
+	esb_rx_fifo_pop(&rx_fifo);
 
 	irq_unlock(key);
 
@@ -1252,7 +1209,7 @@ int esb_start_rx(void)
 
 	NRF_RADIO->RXADDRESSES = esb_addr.rx_pipes_enabled;
 	NRF_RADIO->FREQUENCY = esb_addr.rf_channel;
-	NRF_RADIO->PACKETPTR = (uint32_t)rx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (uint32_t)esb_rx_fifo_select(&rx_fifo);
 
 	NVIC_ClearPendingIRQ(RADIO_IRQn);
 	irq_enable(RADIO_IRQn);
@@ -1293,14 +1250,18 @@ int esb_flush_tx(void)
 	}
 
 	uint32_t key = irq_lock();
+	int err = esb_tx_fifo_flush(&tx_fifo, tx_fifo_sending());
 
-	tx_fifo.count = 0;
-	tx_fifo.back = 0;
-	tx_fifo.front = 0;
+	if (!err) {
+		/* No acknowledgment payload is pending anymore */
+		for (size_t i = 0; i < ARRAY_SIZE(rx_pipe_info); i++) {
+			rx_pipe_info[i].ack_payload = false;
+		}
+	}
 
 	irq_unlock(key);
 
-	return 0;
+	return err;
 }
 
 int esb_pop_tx(void)
@@ -1308,20 +1269,19 @@ int esb_pop_tx(void)
 	if (!esb_initialized) {
 		return -EACCES;
 	}
-	if (tx_fifo.count == 0) {
-		return -ENODATA;
-	}
 
 	uint32_t key = irq_lock();
+	const struct esb_frame *frame = esb_tx_fifo_front(&tx_fifo);
+	int err = esb_tx_fifo_remove(&tx_fifo, tx_fifo_sending());
 
-	if (++tx_fifo.back >= CONFIG_ESB_TX_FIFO_SIZE) {
-		tx_fifo.back = 0;
+	if (!err) {
+		/* The removed payload is not acknowledged by the next packet */
+		rx_pipe_info[frame->pipe].ack_payload = false;
 	}
-	tx_fifo.count--;
 
 	irq_unlock(key);
 
-	return 0;
+	return err;
 }
 
 int esb_flush_rx(void)
@@ -1332,9 +1292,7 @@ int esb_flush_rx(void)
 
 	uint32_t key = irq_lock();
 
-	rx_fifo.count = 0;
-	rx_fifo.back = 0;
-	rx_fifo.front = 0;
+	esb_rx_fifo_reset(&rx_fifo);
 
 	memset(rx_pipe_info, 0, sizeof(rx_pipe_info));
 
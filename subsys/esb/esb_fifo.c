@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <stddef.h>
+#include <errno.h>
+
+#include "esb_fifo.h"
+
+void esb_tx_fifo_reset(struct payload_tx_fifo *fifo)
+{
+	fifo->back = 0;
+	fifo->front = 0;
+	fifo->count = 0;
+}
+
+struct esb_frame *esb_tx_fifo_back(struct payload_tx_fifo *fifo)
+{
+	if (fifo->count >= CONFIG_ESB_TX_FIFO_SIZE) {
+		return NULL;
+	}
+
+	return &fifo->frame[fifo->back];
+}
+
+void esb_tx_fifo_push(struct payload_tx_fifo *fifo)
+{
+	if (++fifo->back >= CONFIG_ESB_TX_FIFO_SIZE) {
+		fifo->back = 0;
+	}
+
+	fifo->count++;
+}
+
+struct esb_frame *esb_tx_fifo_front(struct payload_tx_fifo *fifo)
+{
+	if (fifo->count == 0) {
+		return NULL;
+	}
+
+	return &fifo->frame[fifo->front];
+}
+
+void esb_tx_fifo_pop(struct payload_tx_fifo *fifo)
+{
+	if (fifo->count == 0) {
+		return;
+	}
+
+	fifo->count--;
+	if (++fifo->front >= CONFIG_ESB_TX_FIFO_SIZE) {
+		fifo->front = 0;
+	}
+}
+
+int esb_tx_fifo_flush(struct payload_tx_fifo *fifo, bool sending)
+{
+	if (sending) {
+		return -EBUSY;
+	}
+
+	esb_tx_fifo_reset(fifo);
+
+	return 0;
+}
+
+int esb_tx_fifo_remove(struct payload_tx_fifo *fifo, bool sending)
+{
+	if (fifo->count == 0) {
+		return -ENODATA;
+	}
+
+	if (sending) {
+		return -EBUSY;
+	}
+
+	esb_tx_fifo_pop(fifo);
+
+	return 0;
+}
+
+void esb_rx_fifo_reset(struct payload_rx_fifo *fifo)
+{
+	fifo->back = 0;
+	fifo->front = 0;
+	fifo->count = 0;
+}
+
+uint8_t *esb_rx_fifo_select(struct payload_rx_fifo *fifo)
+{
+	if (fifo->count < CONFIG_ESB_RX_FIFO_SIZE) {
+		fifo->radio_frame = &fifo->frame[fifo->back];
+	} else {
+		fifo->radio_frame = &fifo->drop_frame;
+	}
+
+	return fifo->radio_frame->packet;
+}
+
+bool esb_rx_fifo_accepts(const struct payload_rx_fifo *fifo)
+{
+	return (fifo->radio_frame == &fifo->frame[fifo->back]) &&
+	       (fifo->count < CONFIG_ESB_RX_FIFO_SIZE);
+}
+
+bool esb_rx_fifo_commit(struct payload_rx_fifo *fifo, bool dpl,
+			uint8_t static_length, uint8_t pipe, uint8_t pid,
+			int8_t rssi)
+{
+	struct esb_frame *frame = fifo->radio_frame;
+	uint8_t length = dpl ? frame->packet[0] : static_length;
+
+	if (!esb_rx_fifo_accepts(fifo) ||
+	    (length > CONFIG_ESB_MAX_PAYLOAD_LENGTH)) {
+		return false;
+	}
+
+	frame->length = length;
+	frame->pipe = pipe;
+	frame->rssi = rssi;
+	frame->pid = pid;
+	frame->noack = !(frame->packet[1] & 0x01);
+
+	if (++fifo->back >= CONFIG_ESB_RX_FIFO_SIZE) {
+		fifo->back = 0;
+	}
+	fifo->count++;
+
+	return true;
+}
+
+struct esb_frame *esb_rx_fifo_front(struct payload_rx_fifo *fifo)
+{
+	if (fifo->count == 0) {
+		return NULL;
+	}
+
+	return &fifo->frame[fifo->front];
+}
+
+void esb_rx_fifo_pop(struct payload_rx_fifo *fifo)
+{
+	if (fifo->count == 0) {
+		return;
+	}
+
+	fifo->count--;
+	if (++fifo->front >= CONFIG_ESB_RX_FIFO_SIZE) {
+		fifo->front = 0;
+	}
+}
+
+void esb_frame_header_set(struct esb_frame *frame, bool dpl)
+{
+	if (dpl) {
+		frame->packet[0] = frame->length;
+		frame->packet[1] = frame->pid << 1;
+		frame->packet[1] |= frame->noack ? 0x00 : 0x01;
+	} else {
+		frame->packet[0] = frame->pid;
+		frame->packet[1] = 0;
+	}
+}
+
+void esb_ack_header_set(uint8_t *packet, bool dpl, uint8_t length,
+			uint8_t s0, uint8_t s1)
+{
+	if (dpl) {
+		packet[0] = length;
+		packet[1] = s1;
+	} else {
+		packet[0] = s0;
+		packet[1] = 0;
+	}
+}
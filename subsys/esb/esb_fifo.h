@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef ESB_FIFO_H__
+#define ESB_FIFO_H__
+
+#include <stdbool.h>
+#include <zephyr/types.h>
+
+/* FIFO slots and radio packet format of Enhanced ShockBurst.
+ *
+ * This code does not access the radio, so that it can be tested without
+ * the hardware. The functions are not reentrant, the caller must lock
+ * interrupts when a FIFO is shared with the radio interrupt.
+ */
+
+/* Payload in a FIFO slot.
+ *
+ * The radio reads and writes the packet directly (EasyDMA), so payloads are
+ * neither copied to nor from an intermediate buffer in the radio interrupt.
+ * The packet metadata follows the packet, so that it is not overwritten
+ * by the radio.
+ */
+struct esb_frame {
+	/* Radio packet: S0 (ESB) or LENGTH (DPL), S1, and payload. */
+	uint8_t packet[CONFIG_ESB_MAX_PAYLOAD_LENGTH + 2];
+	uint8_t length;	/* Payload length. */
+	uint8_t pipe;	/* Pipe. */
+	int8_t rssi;	/* RSSI of a received packet. */
+	uint8_t noack;	/* No acknowledgment flag. */
+	uint8_t pid;	/* Packet ID. */
+};
+
+/* First-in, first-out queue of payloads to be transmitted. */
+struct payload_tx_fifo {
+	 /* Payload queue */
+	struct esb_frame frame[CONFIG_ESB_TX_FIFO_SIZE];
+
+	uint32_t back;	/* Back of the queue (last in). */
+	uint32_t front;	/* Front of queue (first out). */
+	uint32_t count;	/* Number of elements in the queue. */
+};
+
+/* First-in, first-out queue of received payloads. */
+struct payload_rx_fifo {
+	 /* Payload queue */
+	struct esb_frame frame[CONFIG_ESB_RX_FIFO_SIZE];
+
+	uint32_t back;	/* Back of the queue (last in). */
+	uint32_t front;	/* Front of queue (first out). */
+	uint32_t count;	/* Number of elements in the queue. */
+
+	/* Frame the radio receives to, either the next free slot, or
+	 * drop_frame when the FIFO is full.
+	 */
+	struct esb_frame *radio_frame;
+	struct esb_frame drop_frame;
+};
+
+/*  Empty the TX FIFO. */
+void esb_tx_fifo_reset(struct payload_tx_fifo *fifo);
+
+/*  Get the slot to write the next payload to.
+ *
+ *  @return Free slot, or NULL if the FIFO is full.
+ */
+struct esb_frame *esb_tx_fifo_back(struct payload_tx_fifo *fifo);
+
+/*  Add the slot returned by @ref esb_tx_fifo_back to the FIFO. */
+void esb_tx_fifo_push(struct payload_tx_fifo *fifo);
+
+/*  Get the payload to transmit next.
+ *
+ *  @return First slot, or NULL if the FIFO is empty.
+ */
+struct esb_frame *esb_tx_fifo_front(struct payload_tx_fifo *fifo);
+
+/*  Remove the first payload, after it has been transmitted. */
+void esb_tx_fifo_pop(struct payload_tx_fifo *fifo);
+
+/*  Empty the TX FIFO on request of the application.
+ *
+ *  The radio transmits directly from the first slot, so the FIFO is not
+ *  emptied while the radio is using it.
+ *
+ *  @param  sending The radio transmits, or may retransmit, the first payload.
+ *
+ *  @retval 0       Operation successful.
+ *  @retval -EBUSY  The radio is using the first slot.
+ */
+int esb_tx_fifo_flush(struct payload_tx_fifo *fifo, bool sending);
+
+/*  Remove the first payload on request of the application.
+ *
+ *  @param  sending The radio transmits, or may retransmit, the first payload.
+ *
+ *  @retval 0        Operation successful.
+ *  @retval -ENODATA The FIFO is empty.
+ *  @retval -EBUSY   The radio is using the first slot.
+ */
+int esb_tx_fifo_remove(struct payload_tx_fifo *fifo, bool sending);
+
+/*  Empty the RX FIFO.
+ *
+ *  A packet that the radio is receiving to the FIFO is dropped.
+ */
+void esb_rx_fifo_reset(struct payload_rx_fifo *fifo);
+
+/*  Select the buffer for receiving the next packet.
+ *
+ *  The radio receives directly to the next free slot of the RX FIFO.
+ *  When the RX FIFO is full, the packet is received to a buffer that is
+ *  dropped.
+ *
+ *  @return Packet buffer, for NRF_RADIO->PACKETPTR.
+ */
+uint8_t *esb_rx_fifo_select(struct payload_rx_fifo *fifo);
+
+/*  Whether a packet received to the selected buffer can be added to the
+ *  RX FIFO. The FIFO may have been full, or flushed, when the buffer was
+ *  selected.
+ */
+bool esb_rx_fifo_accepts(const struct payload_rx_fifo *fifo);
+
+/*  Add the packet received to the selected buffer to the RX FIFO.
+ *
+ *  It must be called before the radio is given a buffer for the next
+ *  packet.
+ *
+ *  @param  dpl           Packet is in the dynamic payload length format.
+ *  @param  static_length Payload length, if not DPL.
+ *  @param  pipe          Pipe number to set for the packet.
+ *  @param  pid           Packet ID.
+ *  @param  rssi          Received signal strength.
+ *
+ *  @retval true   Operation successful.
+ *  @retval false  Packet dropped, because the FIFO was full or flushed
+ *                 when the buffer was selected, or the length is invalid.
+ */
+bool esb_rx_fifo_commit(struct payload_rx_fifo *fifo, bool dpl,
+			uint8_t static_length, uint8_t pipe, uint8_t pid,
+			int8_t rssi);
+
+/*  Get the first received payload.
+ *
+ *  @return First slot, or NULL if the FIFO is empty.
+ */
+struct esb_frame *esb_rx_fifo_front(struct payload_rx_fifo *fifo);
+
+/*  Remove the first received payload, after it has been read. */
+void esb_rx_fifo_pop(struct payload_rx_fifo *fifo);
+
+/*  Write the packet header of a payload to transmit.
+ *
+ *  @param  frame Payload.
+ *  @param  dpl   Use the dynamic payload length format.
+ */
+void esb_frame_header_set(struct esb_frame *frame, bool dpl);
+
+/*  Write the packet header of an acknowledgment.
+ *
+ *  @param  packet Acknowledgment packet.
+ *  @param  dpl    Use the dynamic payload length format.
+ *  @param  length Length of the acknowledgment payload.
+ *  @param  s0     S0 field of the acknowledged packet.
+ *  @param  s1     S1 field of the acknowledged packet.
+ */
+void esb_ack_header_set(uint8_t *packet, bool dpl, uint8_t length,
+			uint8_t s0, uint8_t s1);
+
+#endif /* ESB_FIFO_H__ */
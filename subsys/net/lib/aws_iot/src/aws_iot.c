@@ -2,13 +2,14 @@
 #include <net/mqtt.h>
 #include <net/socket.h>
 #include <net/cloud.h>
-#include <random/rand32.h>
 #include <stdio.h>
 
 #if defined(CONFIG_AWS_FOTA)
 #include <net/aws_fota.h>
 #endif
 
+#include "aws_iot_queue.h"
+
 #if defined(CONFIG_BOARD_QEMU_X86) && !defined(CONFIG_BSD_LIBRARY)
 #include "certificates.h"
 #endif
@@ -46,6 +47,17 @@ static char get_topic[GET_TOPIC_LEN + 1];
 static char update_topic[UPDATE_TOPIC_LEN + 1];
 static char delete_topic[DELETE_TOPIC_LEN + 1];
 
+#if defined(CONFIG_CLOUD_API)
+/* Data messages go to an application topic if one is configured, which
+ * allows payload formats that the shadow does not accept.
+ */
+#define MSG_TOPIC_ENABLED (sizeof(CONFIG_AWS_IOT_TOPIC_MSG) > 1)
+#define MSG_TOPIC "%s/" CONFIG_AWS_IOT_TOPIC_MSG
+#define MSG_TOPIC_LEN (AWS_CLIENT_ID_LEN_MAX + 1 + \
+		       sizeof(CONFIG_AWS_IOT_TOPIC_MSG) - 1)
+static char msg_topic[MSG_TOPIC_LEN + 1];
+#endif
+
 #if defined(CONFIG_AWS_IOT_TOPIC_UPDATE_ACCEPTED_SUBSCRIBE)
 #define UPDATE_ACCEPTED_TOPIC AWS_TOPIC "%s/shadow/update/accepted"
 #define UPDATE_ACCEPTED_TOPIC_LEN (AWS_TOPIC_LEN + AWS_CLIENT_ID_LEN_MAX + 23)
@@ -106,9 +118,39 @@ static aws_iot_evt_handler_t module_evt_handler;
 
 static atomic_t disconnect_requested;
 static atomic_t connection_poll_active;
+static atomic_t connected;
+static atomic_t message_id;
 
 static K_SEM_DEFINE(connection_poll_sem, 0, 1);
 
+/* Get the next message id. The ids of the messages in flight are unique,
+ * since they wrap around only after 65535 messages, and 0 is not a valid
+ * MQTT packet identifier.
+ */
+static uint16_t message_id_next(void)
+{
+	uint16_t id;
+
+	do {
+		id = (uint16_t)(atomic_inc(&message_id) + 1);
+	} while (id == 0);
+
+	return id;
+}
+
+#if defined(CONFIG_AWS_IOT_QUEUE)
+static void queue_drain_work_fn(struct k_work *work)
+{
+	if (!atomic_get(&connected)) {
+		return;
+	}
+
+	(void)aws_iot_queue_drain();
+}
+
+static K_WORK_DEFINE(queue_drain_work, queue_drain_work_fn);
+#endif
+
 static int connect_error_translate(const int err)
 {
 	switch (err) {
@@ -351,6 +393,16 @@ static int aws_iot_topics_populate(char *const id, size_t id_len)
 		return -ENOMEM;
 	}
 
+#if defined(CONFIG_CLOUD_API)
+	if (MSG_TOPIC_ENABLED) {
+		err = snprintf(msg_topic, sizeof(msg_topic),
+			       MSG_TOPIC, client_id_buf);
+		if (err >= MSG_TOPIC_LEN) {
+			return -ENOMEM;
+		}
+	}
+#endif
+
 #if defined(CONFIG_AWS_IOT_TOPIC_GET_ACCEPTED_SUBSCRIBE)
 	err = snprintf(get_accepted_topic, sizeof(get_accepted_topic),
 		       GET_ACCEPTED_TOPIC, client_id_buf);
@@ -476,7 +528,7 @@ static int topic_subscribe(void)
 		const struct mqtt_subscription_list app_sub_list = {
 			.list = app_topic_data.list,
 			.list_count = app_topic_data.list_count,
-			.message_id = sys_rand32_get()
+			.message_id = message_id_next()
 		};
 
 		for (size_t i = 0; i < app_sub_list.list_count; i++) {
@@ -494,7 +546,7 @@ static int topic_subscribe(void)
 		const struct mqtt_subscription_list aws_sub_list = {
 			.list = (struct mqtt_topic *)&aws_iot_rx_list,
 			.list_count = ARRAY_SIZE(aws_iot_rx_list),
-			.message_id = sys_rand32_get()
+			.message_id = message_id_next()
 		};
 
 		for (size_t i = 0; i < aws_sub_list.list_count; i++) {
@@ -565,6 +617,11 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 
 		LOG_DBG("MQTT client connected!");
 
+		atomic_set(&connected, 1);
+#if defined(CONFIG_AWS_IOT_QUEUE)
+		k_work_submit(&queue_drain_work);
+#endif
+
 		aws_iot_evt.data.persistent_session =
 				   mqtt_evt->param.connack.session_present_flag;
 		aws_iot_evt.type = AWS_IOT_EVT_CONNECTED;
@@ -574,6 +631,12 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 		break;
 	case MQTT_EVT_DISCONNECT:
 		LOG_DBG("MQTT_EVT_DISCONNECT: result = %d", mqtt_evt->result);
+
+		atomic_set(&connected, 0);
+#if defined(CONFIG_AWS_IOT_QUEUE)
+		/* Messages that were not acknowledged are published again. */
+		aws_iot_queue_unacked_requeue();
+#endif
 		aws_iot_evt.type = AWS_IOT_EVT_DISCONNECTED;
 		aws_iot_notify_event(&aws_iot_evt);
 		break;
@@ -611,6 +674,9 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 		LOG_DBG("MQTT_EVT_PUBACK: id = %d result = %d",
 			mqtt_evt->param.puback.message_id,
 			mqtt_evt->result);
+#if defined(CONFIG_AWS_IOT_QUEUE)
+		aws_iot_queue_ack(mqtt_evt->param.puback.message_id);
+#endif
 		break;
 	case MQTT_EVT_SUBACK:
 		LOG_DBG("MQTT_EVT_SUBACK: id = %d result = %d",
@@ -836,8 +902,52 @@ int aws_iot_input(void)
 	return mqtt_input(&client);
 }
 
+static int publish(const char *topic, size_t topic_len, enum mqtt_qos qos,
+		   const uint8_t *payload, size_t len, uint16_t *message_id)
+{
+	struct mqtt_publish_param param;
+
+	param.message.topic.qos		= qos;
+	param.message.topic.topic.utf8	= (uint8_t *)topic;
+	param.message.topic.topic.size	= topic_len;
+	param.message.payload.data	= (uint8_t *)payload;
+	param.message.payload.len	= len;
+	param.message_id		= message_id_next();
+	param.dup_flag			= 0;
+	param.retain_flag		= 0;
+
+	if (message_id != NULL) {
+		*message_id = param.message_id;
+	}
+
+	LOG_DBG("Publishing to topic: %s", log_strdup(topic));
+
+	return mqtt_publish(&client, &param);
+}
+
+#if defined(CONFIG_AWS_IOT_QUEUE)
+static int message_queue(const struct aws_iot_data *const tx_data)
+{
+	int err;
+
+	err = aws_iot_queue_put(tx_data->topic.str, tx_data->topic.len,
+				tx_data->qos, tx_data->ptr, tx_data->len);
+	if (err) {
+		LOG_ERR("aws_iot_queue_put, error: %d", err);
+		return err;
+	}
+
+	if (atomic_get(&connected)) {
+		k_work_submit(&queue_drain_work);
+	}
+
+	return 0;
+}
+#endif
+
 int aws_iot_send(const struct aws_iot_data *const tx_data)
 {
+	int err;
 	struct aws_iot_data tx_data_pub = {
 		.ptr	    = tx_data->ptr,
 		.len	    = tx_data->len,
@@ -854,6 +964,12 @@ int aws_iot_send(const struct aws_iot_data *const tx_data)
 		tx_data_pub.topic.len = strlen(get_topic);
 		break;
 	case CLOUD_EP_TOPIC_MSG:
+		if (MSG_TOPIC_ENABLED) {
+			tx_data_pub.topic.str = msg_topic;
+			tx_data_pub.topic.len = strlen(msg_topic);
+			break;
+		}
+
 		tx_data_pub.topic.str = update_topic;
 		tx_data_pub.topic.len = strlen(update_topic);
 		break;
@@ -884,21 +1000,38 @@ int aws_iot_send(const struct aws_iot_data *const tx_data)
 		break;
 	}
 
-	struct mqtt_publish_param param;
+#if defined(CONFIG_AWS_IOT_QUEUE)
+	if (!atomic_get(&connected) || aws_iot_queue_pending()) {
+		/* Keep the order of the messages, and send the queue
+		 * right away if connected.
+		 */
+		return message_queue(&tx_data_pub);
+	}
+#endif
 
-	param.message.topic.qos		= tx_data_pub.qos;
-	param.message.topic.topic.utf8	= tx_data_pub.topic.str;
-	param.message.topic.topic.size	= tx_data_pub.topic.len;
-	param.message.payload.data	= tx_data_pub.ptr;
-	param.message.payload.len	= tx_data_pub.len;
-	param.message_id		= sys_rand32_get();
-	param.dup_flag			= 0;
-	param.retain_flag		= 0;
+	err = publish(tx_data_pub.topic.str, tx_data_pub.topic.len,
+		      tx_data_pub.qos, tx_data_pub.ptr, tx_data_pub.len, NULL);
+#if defined(CONFIG_AWS_IOT_QUEUE)
+	if (err) {
+		LOG_WRN("Publish failed, error: %d, queueing message", err);
+		return message_queue(&tx_data_pub);
+	}
+#endif
 
-	LOG_DBG("Publishing to topic: %s",
-		log_strdup(param.message.topic.topic.utf8));
+	return err;
+}
 
-	return mqtt_publish(&client, &param);
+int aws_iot_send_queued(void)
+{
+#if defined(CONFIG_AWS_IOT_QUEUE)
+	if (!atomic_get(&connected)) {
+		return -ENOTCONN;
+	}
+
+	return aws_iot_queue_drain();
+#else
+	return -ENOTSUP;
+#endif
 }
 
 int aws_iot_disconnect(void)
@@ -991,6 +1124,14 @@ int aws_iot_init(const struct aws_iot_config *const config,
 	}
 #endif
 
+#if defined(CONFIG_AWS_IOT_QUEUE)
+	err = aws_iot_queue_init(publish);
+	if (err) {
+		LOG_ERR("aws_iot_queue_init, error: %d", err);
+		return err;
+	}
+#endif
+
 	module_evt_handler = event_handler;
 
 	return err;
@@ -0,0 +1,701 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <settings/settings.h>
+#include <logging/log.h>
+
+#include "aws_iot_queue.h"
+
+LOG_MODULE_REGISTER(aws_iot_queue, CONFIG_AWS_IOT_LOG_LEVEL);
+
+#define QUEUE_SETTINGS_NAME "aws_iot/q"
+/* "aws_iot/q/" followed by up to 8 hex digits. */
+#define QUEUE_KEY_LEN (sizeof(QUEUE_SETTINGS_NAME) + 8)
+
+#define ENTRY_SIZE_MAX CONFIG_AWS_IOT_QUEUE_ENTRY_MAX_SIZE
+#define BATCH_SIZE_MAX MAX(CONFIG_AWS_IOT_QUEUE_BATCH_MAX_SIZE, ENTRY_SIZE_MAX)
+
+/* Topics starting with this are reserved by AWS, for example the device
+ * shadow, and do not accept batches.
+ */
+#define AWS_RESERVED_TOPIC_PREFIX "$aws/"
+
+/* Persisted entry, followed by the topic and the payload. */
+struct entry_hdr {
+	uint8_t qos;
+	uint8_t topic_len;
+	uint16_t payload_len;
+} __packed;
+
+enum slot_state {
+	SLOT_FREE,
+	SLOT_QUEUED,
+	SLOT_UNACKED,
+};
+
+/* State of an entry in the current drain pass. */
+enum load_state {
+	LOAD_IDLE,
+	/* Planned for publishing, waiting to be read. */
+	LOAD_PENDING,
+	/* Read into drain_buf. */
+	LOAD_DONE,
+	/* On another topic than the rest of its batch, left queued. */
+	LOAD_SKIP,
+};
+
+/* In-memory index of the persisted entries, one slot per sequence number
+ * modulo the queue size. The entry header and a hash of the topic are kept
+ * in the index, so that the drain can be planned without reading the
+ * entries.
+ */
+struct slot {
+	uint32_t seq;
+	uint32_t topic_hash;
+	/* Offset of the payload in drain_buf, when planned for publishing. */
+	uint32_t offset;
+	uint16_t unit;
+	uint16_t message_id;
+	uint16_t payload_len;
+	uint8_t topic_len;
+	uint8_t qos;
+	uint8_t state;
+	uint8_t load;
+	bool batchable;
+};
+
+/* Message published in one drain pass: a single entry, or a batch of
+ * entries to the same topic. Laid out in drain_buf as the null-terminated
+ * topic, followed by the payloads of the entries, in brackets and
+ * separated by commas.
+ */
+struct unit {
+	uint32_t seq;
+	uint32_t start;
+	uint16_t count;
+	uint8_t topic_len;
+	uint8_t qos;
+	bool topic_loaded;
+};
+
+static struct slot slots[CONFIG_AWS_IOT_QUEUE_MAX_ENTRIES];
+/* Sequence number of the oldest entry, and of the next entry to add. */
+static uint32_t head;
+static uint32_t tail;
+
+static aws_iot_queue_publish_t publish_fn;
+static K_MUTEX_DEFINE(queue_mutex);
+
+static uint8_t entry_buf[sizeof(struct entry_hdr) + ENTRY_SIZE_MAX];
+
+/* Entries left over from a larger queue configuration, deleted after the
+ * queue is loaded.
+ */
+static uint32_t stale[CONFIG_AWS_IOT_QUEUE_MAX_ENTRIES];
+static size_t stale_count;
+
+/* Messages of the current drain pass. All their entries are read in a single
+ * pass over the stored settings. Fits at least one unit of the largest
+ * size.
+ */
+static struct unit units[CONFIG_AWS_IOT_QUEUE_MAX_ENTRIES];
+static size_t unit_count;
+static uint8_t drain_buf[UINT8_MAX + 1 + BATCH_SIZE_MAX + 2];
+static uint32_t batch_seq[CONFIG_AWS_IOT_QUEUE_MAX_ENTRIES];
+static bool draining;
+
+static struct slot *slot_get(uint32_t seq)
+{
+	return &slots[seq % ARRAY_SIZE(slots)];
+}
+
+/* Get the slot of an entry, or NULL if there is no entry with that sequence
+ * number.
+ */
+static struct slot *slot_find(uint32_t seq)
+{
+	struct slot *slot = slot_get(seq);
+
+	if ((slot->state == SLOT_FREE) || (slot->seq != seq)) {
+		return NULL;
+	}
+
+	return slot;
+}
+
+static bool slot_queued(uint32_t seq)
+{
+	struct slot *slot = slot_find(seq);
+
+	return (slot != NULL) && (slot->state == SLOT_QUEUED);
+}
+
+static void key_get(uint32_t seq, char *key, size_t key_size)
+{
+	snprintf(key, key_size, QUEUE_SETTINGS_NAME "/%x", seq);
+}
+
+static void entry_delete(uint32_t seq)
+{
+	struct slot *slot = slot_find(seq);
+	char key[QUEUE_KEY_LEN];
+	int err;
+
+	key_get(seq, key, sizeof(key));
+
+	err = settings_delete(key);
+	if (err) {
+		LOG_WRN("Could not delete queued message, error: %d", err);
+	}
+
+	if (slot != NULL) {
+		slot->state = SLOT_FREE;
+		slot->load = LOAD_IDLE;
+	}
+}
+
+/* Move the head past entries that are no longer queued. */
+static void head_advance(void)
+{
+	while ((head != tail) && (slot_find(head) == NULL)) {
+		head++;
+	}
+}
+
+static bool entry_valid(const struct entry_hdr *hdr, size_t len)
+{
+	return (len >= sizeof(*hdr)) &&
+	       (len == sizeof(*hdr) + hdr->topic_len + hdr->payload_len);
+}
+
+static const char *entry_topic(const struct entry_hdr *hdr)
+{
+	return (const char *)&entry_buf[sizeof(*hdr)];
+}
+
+static const uint8_t *entry_payload(const struct entry_hdr *hdr)
+{
+	return &entry_buf[sizeof(*hdr) + hdr->topic_len];
+}
+
+/* Batches are published as a JSON array of the queued messages, so only
+ * JSON objects and arrays on application topics are batched.
+ */
+static bool batchable(const struct entry_hdr *hdr)
+{
+	uint8_t first = (hdr->payload_len > 0) ? *entry_payload(hdr) : 0;
+
+	if (CONFIG_AWS_IOT_QUEUE_BATCH_MAX_SIZE == 0) {
+		return false;
+	}
+
+	if ((hdr->topic_len >= strlen(AWS_RESERVED_TOPIC_PREFIX)) &&
+	    (strncmp(entry_topic(hdr), AWS_RESERVED_TOPIC_PREFIX,
+		     strlen(AWS_RESERVED_TOPIC_PREFIX)) == 0)) {
+		return false;
+	}
+
+	return (first == '{') || (first == '[');
+}
+
+/* FNV-1a hash of the topic. */
+static uint32_t topic_hash(const char *topic, size_t len)
+{
+	uint32_t hash = 2166136261U;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint8_t)topic[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/* Index the entry in entry_buf. */
+static void slot_index(struct slot *slot, uint32_t seq)
+{
+	const struct entry_hdr *hdr = (const struct entry_hdr *)entry_buf;
+
+	slot->seq = seq;
+	slot->state = SLOT_QUEUED;
+	slot->load = LOAD_IDLE;
+	slot->qos = hdr->qos;
+	slot->topic_len = hdr->topic_len;
+	slot->payload_len = hdr->payload_len;
+	slot->topic_hash = topic_hash(entry_topic(hdr), hdr->topic_len);
+	slot->batchable = batchable(hdr);
+}
+
+/* Read an entry that is planned for publishing into its place in
+ * drain_buf. Entries that can't be read stay pending, and are dropped.
+ */
+static void entry_read(uint32_t seq, size_t len,
+		       settings_read_cb read_cb, void *cb_arg)
+{
+	const struct entry_hdr *hdr = (const struct entry_hdr *)entry_buf;
+	struct slot *slot = slot_find(seq);
+	struct unit *unit;
+	char *topic;
+
+	if ((slot == NULL) || (slot->load != LOAD_PENDING) ||
+	    (len > sizeof(entry_buf))) {
+		return;
+	}
+
+	if ((read_cb(cb_arg, entry_buf, len) != len) ||
+	    !entry_valid(hdr, len) || (hdr->qos != slot->qos) ||
+	    (hdr->topic_len != slot->topic_len) ||
+	    (hdr->payload_len != slot->payload_len)) {
+		return;
+	}
+
+	unit = &units[slot->unit];
+	topic = (char *)&drain_buf[unit->start];
+
+	if (!unit->topic_loaded) {
+		memcpy(topic, entry_topic(hdr), hdr->topic_len);
+		topic[hdr->topic_len] = '\0';
+		unit->topic_loaded = true;
+	} else if (memcmp(topic, entry_topic(hdr), hdr->topic_len) != 0) {
+		/* Same topic hash, but another topic. */
+		slot->load = LOAD_SKIP;
+		return;
+	}
+
+	memcpy(&drain_buf[slot->offset], entry_payload(hdr), hdr->payload_len);
+	slot->load = LOAD_DONE;
+}
+
+static int settings_set(const char *key, size_t len_rd,
+			settings_read_cb read_cb, void *cb_arg)
+{
+	const struct entry_hdr *hdr = (const struct entry_hdr *)entry_buf;
+	char *end;
+	uint32_t seq = strtoul(key, &end, 16);
+	struct slot *slot;
+
+	if ((end == key) || (*end != '\0')) {
+		return 0;
+	}
+
+	if (draining) {
+		entry_read(seq, len_rd, read_cb, cb_arg);
+		return 0;
+	}
+
+	slot = slot_get(seq);
+
+	if ((slot->state != SLOT_FREE) && (slot->seq != seq)) {
+		uint32_t older = MIN(slot->seq, seq);
+
+		if (stale_count < ARRAY_SIZE(stale)) {
+			stale[stale_count++] = older;
+		}
+
+		if (older == seq) {
+			return 0;
+		}
+	}
+
+	/* Entries that can't be read are indexed empty, and dropped when
+	 * the queue is drained.
+	 */
+	if ((len_rd > sizeof(entry_buf)) ||
+	    (read_cb(cb_arg, entry_buf, len_rd) != len_rd) ||
+	    !entry_valid(hdr, len_rd)) {
+		memset(entry_buf, 0, sizeof(*hdr));
+	}
+
+	slot_index(slot, seq);
+
+	return 0;
+}
+
+static struct settings_handler settings_handler = {
+	.name = QUEUE_SETTINGS_NAME,
+	.h_set = settings_set,
+};
+
+int aws_iot_queue_init(aws_iot_queue_publish_t publish)
+{
+	int err;
+
+	__ASSERT_NO_MSG(publish != NULL);
+
+	publish_fn = publish;
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("settings_subsys_init, error: %d", err);
+		return err;
+	}
+
+	err = settings_register(&settings_handler);
+	if (err) {
+		LOG_ERR("settings_register, error: %d", err);
+		return err;
+	}
+
+	k_mutex_lock(&queue_mutex, K_FOREVER);
+
+	memset(slots, 0, sizeof(slots));
+	stale_count = 0;
+
+	err = settings_load_subtree(QUEUE_SETTINGS_NAME);
+	if (err) {
+		LOG_ERR("settings_load_subtree, error: %d", err);
+	}
+
+	for (size_t i = 0; i < stale_count; i++) {
+		char key[QUEUE_KEY_LEN];
+
+		key_get(stale[i], key, sizeof(key));
+		(void)settings_delete(key);
+	}
+
+	stale_count = 0;
+
+	/* The queue spans from the oldest to the newest loaded entry. */
+	head = 0;
+	tail = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(slots); i++) {
+		uint32_t seq = slots[i].seq;
+
+		if (slots[i].state == SLOT_FREE) {
+			continue;
+		}
+
+		if (head == tail) {
+			head = seq;
+			tail = seq + 1;
+		} else if ((int32_t)(seq - head) < 0) {
+			head = seq;
+		} else if ((int32_t)(seq + 1 - tail) > 0) {
+			tail = seq + 1;
+		}
+	}
+
+	LOG_DBG("%d queued messages loaded", tail - head);
+
+	k_mutex_unlock(&queue_mutex);
+
+	return err;
+}
+
+int aws_iot_queue_put(const char *topic, size_t topic_len, enum mqtt_qos qos,
+		      const void *payload, size_t len)
+{
+	struct entry_hdr hdr = {
+		.qos = qos,
+		.topic_len = topic_len,
+		.payload_len = len,
+	};
+	char key[QUEUE_KEY_LEN];
+	struct slot *slot;
+	int err;
+
+	if ((topic_len > UINT8_MAX) || (topic_len + len > ENTRY_SIZE_MAX)) {
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&queue_mutex, K_FOREVER);
+
+	/* Drop the oldest messages to make room. */
+	while (tail - head >= ARRAY_SIZE(slots)) {
+		if (slot_find(head) != NULL) {
+			LOG_WRN("Queue full, dropping oldest message");
+			entry_delete(head);
+		}
+
+		head++;
+	}
+
+	memcpy(entry_buf, &hdr, sizeof(hdr));
+	memcpy(&entry_buf[sizeof(hdr)], topic, topic_len);
+	memcpy(&entry_buf[sizeof(hdr) + topic_len], payload, len);
+
+	key_get(tail, key, sizeof(key));
+
+	err = settings_save_one(key, entry_buf, sizeof(hdr) + topic_len + len);
+	if (err) {
+		LOG_ERR("Could not persist message, error: %d", err);
+		goto exit;
+	}
+
+	slot = slot_get(tail);
+	slot_index(slot, tail);
+	tail++;
+
+exit:
+	k_mutex_unlock(&queue_mutex);
+
+	return err;
+}
+
+bool aws_iot_queue_pending(void)
+{
+	bool pending = false;
+
+	k_mutex_lock(&queue_mutex, K_FOREVER);
+
+	for (uint32_t seq = head; seq != tail; seq++) {
+		if (slot_queued(seq)) {
+			pending = true;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&queue_mutex);
+
+	return pending;
+}
+
+/* Add a planned entry to a unit, at the given offset in drain_buf. */
+static void unit_add(struct slot *slot, uint32_t *offset)
+{
+	slot->unit = unit_count - 1;
+	slot->offset = *offset;
+	slot->load = LOAD_PENDING;
+	units[slot->unit].count++;
+	*offset += slot->payload_len;
+}
+
+/* Plan the next drain pass, in queue order. Each unit is either a single
+ * entry, or an entry together with later entries for the same topic that fit
+ * in the batch size budget. Units are planned until drain_buf is full.
+ */
+static size_t pass_plan(void)
+{
+	uint32_t used = 0;
+
+	unit_count = 0;
+
+	for (uint32_t seq = head; seq != tail; seq++) {
+		struct slot *slot = slot_find(seq);
+		struct unit *unit;
+		size_t batch_len;
+
+		if ((slot == NULL) || (slot->state != SLOT_QUEUED) ||
+		    (slot->load != LOAD_IDLE)) {
+			continue;
+		}
+
+		/* Topic, terminator, brackets and payload. */
+		if (used + slot->topic_len + 3 + slot->payload_len >
+		    sizeof(drain_buf)) {
+			break;
+		}
+
+		unit = &units[unit_count++];
+		unit->seq = seq;
+		unit->start = used;
+		unit->count = 0;
+		unit->topic_len = slot->topic_len;
+		unit->qos = slot->qos;
+		unit->topic_loaded = false;
+
+		used += slot->topic_len + 2;
+		unit_add(slot, &used);
+		batch_len = slot->payload_len;
+
+		for (uint32_t next = seq + 1; slot->batchable && (next != tail);
+		     next++) {
+			struct slot *entry = slot_find(next);
+
+			if ((entry == NULL) || (entry->state != SLOT_QUEUED) ||
+			    (entry->load != LOAD_IDLE) || !entry->batchable ||
+			    (entry->qos != slot->qos) ||
+			    (entry->topic_len != slot->topic_len) ||
+			    (entry->topic_hash != slot->topic_hash)) {
+				/* Published on its own, or in another batch. */
+				continue;
+			}
+
+			/* Separator and brackets included. */
+			if ((batch_len + 1 + entry->payload_len + 2 >
+			     CONFIG_AWS_IOT_QUEUE_BATCH_MAX_SIZE) ||
+			    (used + 1 + entry->payload_len + 1 >
+			     sizeof(drain_buf))) {
+				break;
+			}
+
+			used++;
+			unit_add(entry, &used);
+			batch_len += 1 + entry->payload_len;
+		}
+
+		used++;
+	}
+
+	return unit_count;
+}
+
+/* Read all entries of the pass in a single pass over the stored settings. */
+static int pass_load(void)
+{
+	int err;
+
+	draining = true;
+	err = settings_load_subtree(QUEUE_SETTINGS_NAME);
+	draining = false;
+
+	return err;
+}
+
+static void pass_end(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(slots); i++) {
+		slots[i].load = LOAD_IDLE;
+	}
+}
+
+/* Publish the entries of a unit that were read. Entries that could not be
+ * read are dropped.
+ */
+static int unit_publish(size_t index)
+{
+	const struct unit *unit = &units[index];
+	const char *topic = (const char *)&drain_buf[unit->start];
+	uint8_t *payload = &drain_buf[unit->start + unit->topic_len + 1];
+	size_t members = 0;
+	size_t count = 0;
+	size_t len = 1;
+	uint16_t message_id;
+	int err;
+
+	/* Pack the payloads that were read after the opening bracket. */
+	for (uint32_t seq = unit->seq; members < unit->count; seq++) {
+		struct slot *slot = slot_find(seq);
+
+		if ((slot == NULL) || (slot->load == LOAD_IDLE) ||
+		    (slot->unit != index)) {
+			continue;
+		}
+
+		members++;
+
+		if (slot->load == LOAD_PENDING) {
+			LOG_WRN("Dropping unreadable queued message");
+			entry_delete(seq);
+			continue;
+		}
+
+		if (slot->load != LOAD_DONE) {
+			continue;
+		}
+
+		if (count > 0) {
+			payload[len++] = ',';
+		}
+
+		memmove(&payload[len], &drain_buf[slot->offset],
+			slot->payload_len);
+		len += slot->payload_len;
+		batch_seq[count++] = seq;
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	if (count > 1) {
+		payload[0] = '[';
+		payload[len++] = ']';
+		err = publish_fn(topic, unit->topic_len, unit->qos, payload,
+				 len, &message_id);
+	} else {
+		err = publish_fn(topic, unit->topic_len, unit->qos, &payload[1],
+				 len - 1, &message_id);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	LOG_DBG("Published %d queued messages, id %d", count, message_id);
+
+	for (size_t i = 0; i < count; i++) {
+		struct slot *slot = slot_find(batch_seq[i]);
+
+		if (unit->qos == MQTT_QOS_0_AT_MOST_ONCE) {
+			entry_delete(batch_seq[i]);
+		} else if (slot != NULL) {
+			slot->state = SLOT_UNACKED;
+			slot->message_id = message_id;
+		}
+	}
+
+	return 0;
+}
+
+int aws_iot_queue_drain(void)
+{
+	int err = 0;
+
+	k_mutex_lock(&queue_mutex, K_FOREVER);
+
+	while (!err && (pass_plan() > 0)) {
+		err = pass_load();
+		if (err) {
+			LOG_WRN("Could not load queued messages, error: %d",
+				err);
+		}
+
+		for (size_t i = 0; !err && (i < unit_count); i++) {
+			err = unit_publish(i);
+			if (err) {
+				LOG_WRN("Could not publish queued messages, "
+					"error: %d", err);
+			}
+		}
+
+		pass_end();
+	}
+
+	head_advance();
+
+	k_mutex_unlock(&queue_mutex);
+
+	return err;
+}
+
+void aws_iot_queue_ack(uint16_t message_id)
+{
+	k_mutex_lock(&queue_mutex, K_FOREVER);
+
+	for (uint32_t seq = head; seq != tail; seq++) {
+		struct slot *slot = slot_find(seq);
+
+		if ((slot != NULL) && (slot->state == SLOT_UNACKED) &&
+		    (slot->message_id == message_id)) {
+			entry_delete(seq);
+		}
+	}
+
+	head_advance();
+
+	k_mutex_unlock(&queue_mutex);
+}
+
+void aws_iot_queue_unacked_requeue(void)
+{
+	k_mutex_lock(&queue_mutex, K_FOREVER);
+
+	for (uint32_t seq = head; seq != tail; seq++) {
+		struct slot *slot = slot_find(seq);
+
+		if ((slot != NULL) && (slot->state == SLOT_UNACKED)) {
+			slot->state = SLOT_QUEUED;
+		}
+	}
+
+	k_mutex_unlock(&queue_mutex);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef AWS_IOT_QUEUE_H__
+#define AWS_IOT_QUEUE_H__
+
+#include <stdbool.h>
+#include <net/mqtt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Function that publishes one message, or one batch of messages,
+ *         from the queue.
+ *
+ *  @param[in] topic Topic to publish to, null-terminated.
+ *  @param[in] topic_len Length of the topic.
+ *  @param[in] qos Quality of service.
+ *  @param[in] payload Payload.
+ *  @param[in] len Length of the payload.
+ *  @param[out] message_id MQTT message ID that the broker acknowledges.
+ *
+ *  @return 0 if the message was handed to the transport, otherwise a
+ *          negative error code.
+ */
+typedef int (*aws_iot_queue_publish_t)(const char *topic, size_t topic_len,
+				       enum mqtt_qos qos, const uint8_t *payload,
+				       size_t len, uint16_t *message_id);
+
+/** @brief Load the persisted queue.
+ *
+ *  @param[in] publish Function used to publish messages when draining.
+ *
+ *  @return 0 on success, otherwise a negative error code.
+ */
+int aws_iot_queue_init(aws_iot_queue_publish_t publish);
+
+/** @brief Persist a message at the end of the queue. If the queue is full,
+ *         the oldest message is dropped.
+ *
+ *  @return 0 on success, otherwise a negative error code.
+ */
+int aws_iot_queue_put(const char *topic, size_t topic_len, enum mqtt_qos qos,
+		      const void *payload, size_t len);
+
+/** @brief Check if there are messages that are not yet published. */
+bool aws_iot_queue_pending(void);
+
+/** @brief Publish the queued messages, in batches where possible.
+ *
+ *  QoS 0 messages are removed when published. QoS 1 messages are removed
+ *  when acknowledged, see @ref aws_iot_queue_ack.
+ *
+ *  @return 0 if all queued messages were published, otherwise a negative
+ *          error code. Messages that were not published stay queued.
+ */
+int aws_iot_queue_drain(void);
+
+/** @brief Remove the messages that were published with the given
+ *         message ID.
+ */
+void aws_iot_queue_ack(uint16_t message_id);
+
+/** @brief Mark unacknowledged messages for publishing again, for example
+ *         after a disconnect.
+ */
+void aws_iot_queue_unacked_requeue(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_QUEUE_H__ */
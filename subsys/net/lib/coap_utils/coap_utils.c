@@ -8,10 +8,11 @@
 #include <net/coap.h>
 #include <net/coap_utils.h>
 #include <net/socket.h>
+#include <random/rand32.h>
 
 LOG_MODULE_REGISTER(coap_utils, CONFIG_COAP_UTILS_LOG_LEVEL);
 
-#define MAX_COAP_MSG_LEN 256
+#define MAX_COAP_MSG_LEN CONFIG_COAP_UTILS_MSG_LEN
 #define COAP_VER 1
 #define COAP_TOKEN_LEN 8
 #define COAP_MAX_REPLIES 1
@@ -23,6 +24,87 @@ LOG_MODULE_REGISTER(coap_utils, CONFIG_COAP_UTILS_LOG_LEVEL);
 #define COAP_RECEIVE_STACK_SIZE 500
 #endif
 
+/* Block option value: NUM | M | SZX */
+#define BLOCK_NUM(val) ((uint32_t)(val) >> 4)
+#define BLOCK_MORE(val) (((val) & 0x08) != 0)
+#define BLOCK_SZX(val) ((val) & 0x07)
+#define BLOCK_VALUE(num, more, szx) \
+	(((num) << 4) | ((more) ? 0x08 : 0) | (szx))
+#define BLOCK_SIZE(szx) (1U << ((szx) + 4))
+#define BLOCK_SZX_DEFAULT (__builtin_ctz(CONFIG_COAP_UTILS_BLOCK_SIZE) - 4)
+
+BUILD_ASSERT((CONFIG_COAP_UTILS_BLOCK_SIZE &
+	      (CONFIG_COAP_UTILS_BLOCK_SIZE - 1)) == 0,
+	     "CoAP block size must be a power of two");
+
+/* Request handles hold the exchange index in the low bits, and the
+ * generation of the exchange in the high bits, so that a stale handle does
+ * not match a later request in the same exchange.
+ */
+#define HANDLE_INDEX_BITS 8
+#define HANDLE_INDEX_MASK ((1 << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MASK 0x7fff
+
+BUILD_ASSERT(CONFIG_COAP_UTILS_MAX_REQUESTS <= HANDLE_INDEX_MASK + 1,
+	     "Too many requests for the request handle");
+
+/* Observe sequence numbers are 24 bits long, RFC 7641 section 3.4 */
+#define OBSERVE_SEQ_HALF (1UL << 23)
+#define OBSERVE_FRESHNESS_MS (128 * MSEC_PER_SEC)
+
+enum exchange_state {
+	EXCHANGE_FREE,
+	/* Confirmable message sent, waiting for acknowledgment */
+	EXCHANGE_WAIT_ACK,
+	/* Waiting for a separate or non-confirmable response */
+	EXCHANGE_WAIT_RESPONSE,
+	/* Waiting for observe notifications */
+	EXCHANGE_OBSERVING,
+};
+
+/* Request with its retransmission state. Every message of a block-wise
+ * transfer belongs to the same exchange and uses the same token.
+ */
+struct coap_exchange {
+	enum exchange_state state;
+	/* Incremented every time the exchange is used for a new request */
+	uint16_t generation;
+	struct sockaddr addr;
+	enum coap_method method;
+	const char *const *uri_path_options;
+	const uint8_t *payload;
+	size_t payload_len;
+	bool confirmable;
+	bool observe;
+	bool block1;
+	coap_utils_response_cb_t cb;
+	void *user_data;
+
+	uint8_t token[COAP_TOKEN_LEN];
+	/* ID of the last sent message */
+	uint16_t id;
+	/* ID of the last received confirmable message, to drop duplicates */
+	uint16_t rx_id;
+	bool rx_id_valid;
+
+	uint8_t retries;
+	uint32_t timeout;
+	int64_t deadline;
+	int64_t start_time;
+
+	size_t block1_offset;
+	uint8_t block1_szx;
+	uint32_t block2_num;
+	uint8_t block2_szx;
+
+	uint32_t observe_seq;
+	int64_t observe_time;
+
+	/* Last sent message, kept for retransmission */
+	uint16_t len;
+	uint8_t buf[MAX_COAP_MSG_LEN];
+};
+
 const static int nfds = 1;
 static struct pollfd fds;
 static struct coap_reply replies[COAP_MAX_REPLIES];
@@ -31,6 +113,26 @@ static int proto_family;
 static K_THREAD_STACK_DEFINE(receive_stack_area, COAP_RECEIVE_STACK_SIZE);
 static struct k_thread receive_thread_data;
 
+/* Response to pass to the callback after exchange_lock is released, so that
+ * the callbacks may start and cancel requests without holding up the other
+ * exchanges.
+ */
+struct delivery {
+	coap_utils_response_cb_t cb;
+	void *user_data;
+	struct coap_utils_response response;
+};
+
+static struct coap_exchange exchanges[CONFIG_COAP_UTILS_MAX_REQUESTS];
+/* Every exchange ends at most once per pass, and a block of a response may be
+ * delivered before the exchange fails.
+ */
+static struct delivery deliveries[CONFIG_COAP_UTILS_MAX_REQUESTS + 1];
+static size_t delivery_count;
+static struct coap_utils_stats stats;
+static struct k_delayed_work retransmit_work;
+static K_MUTEX_DEFINE(exchange_lock);
+
 static int coap_open_socket(void)
 {
 	int sock;
@@ -53,18 +155,480 @@ static void coap_close_socket(int socket)
 	(void)close(socket);
 }
 
+static void coap_send_empty(uint8_t type, uint16_t id,
+			    const struct sockaddr *addr)
+{
+	struct coap_packet packet;
+	uint8_t buf[4];
+
+	if (coap_packet_init(&packet, buf, sizeof(buf), COAP_VER, type, 0,
+			     NULL, COAP_CODE_EMPTY, id) < 0) {
+		return;
+	}
+
+	if (sendto(fds.fd, packet.data, packet.offset, 0, addr,
+		   sizeof(*addr)) < 0) {
+		LOG_ERR("Failed to send empty message: %d", errno);
+	}
+}
+
+static void stats_latency_add(struct coap_exchange *ex)
+{
+	uint32_t latency = (uint32_t)(k_uptime_get() - ex->start_time);
+
+	if (stats.completed == 0 || latency < stats.latency_min) {
+		stats.latency_min = latency;
+	}
+	if (latency > stats.latency_max) {
+		stats.latency_max = latency;
+	}
+	stats.latency_sum += latency;
+	stats.completed++;
+}
+
+static void exchange_schedule(void)
+{
+	int64_t next = INT64_MAX;
+	int64_t now = k_uptime_get();
+
+	for (size_t i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		if ((exchanges[i].state == EXCHANGE_WAIT_ACK ||
+		     exchanges[i].state == EXCHANGE_WAIT_RESPONSE) &&
+		    exchanges[i].deadline < next) {
+			next = exchanges[i].deadline;
+		}
+	}
+
+	if (next == INT64_MAX) {
+		k_delayed_work_cancel(&retransmit_work);
+	} else {
+		k_delayed_work_submit(&retransmit_work,
+				      K_MSEC(MAX(next - now, 0)));
+	}
+}
+
+static void exchange_deliver(struct coap_exchange *ex, int result,
+			     uint8_t code, const uint8_t *payload,
+			     uint16_t payload_len, size_t offset, bool more)
+{
+	struct coap_utils_response response = {
+		.result = result,
+		.code = code,
+		.payload = payload,
+		.payload_len = payload_len,
+		.offset = offset,
+		.more = more,
+	};
+
+	if (!more) {
+		if (result) {
+			stats.failed++;
+		} else {
+			stats_latency_add(ex);
+		}
+
+		ex->state = EXCHANGE_FREE;
+		exchange_schedule();
+	}
+
+	if (ex->cb && delivery_count < ARRAY_SIZE(deliveries)) {
+		deliveries[delivery_count].cb = ex->cb;
+		deliveries[delivery_count].user_data = ex->user_data;
+		deliveries[delivery_count].response = response;
+		delivery_count++;
+	}
+}
+
+/* Take the pending deliveries. Must be called with exchange_lock held. */
+static size_t deliveries_take(struct delivery *out)
+{
+	size_t count = delivery_count;
+
+	memcpy(out, deliveries, count * sizeof(*out));
+	delivery_count = 0;
+
+	return count;
+}
+
+/* Call the response callbacks. Must be called without exchange_lock. */
+static void deliveries_run(const struct delivery *pending, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		pending[i].cb(&pending[i].response, pending[i].user_data);
+	}
+}
+
+static int exchange_build(struct coap_exchange *ex)
+{
+	struct coap_packet request;
+	const char *const *opt;
+	int ret;
+
+	ex->id = coap_next_id();
+
+	ret = coap_packet_init(&request, ex->buf, sizeof(ex->buf), COAP_VER,
+			       ex->confirmable ? COAP_TYPE_CON :
+						 COAP_TYPE_NON_CON,
+			       sizeof(ex->token), ex->token, ex->method,
+			       ex->id);
+	if (ret < 0) {
+		LOG_ERR("Failed to init CoAP message");
+		return ret;
+	}
+
+	/* Options are appended in the order of option numbers */
+	if (ex->observe) {
+		ret = coap_append_option_int(&request, COAP_OPTION_OBSERVE, 0);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	for (opt = ex->uri_path_options; opt && *opt; opt++) {
+		ret = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+						*opt, strlen(*opt));
+		if (ret < 0) {
+			LOG_ERR("Unable add option to request");
+			return ret;
+		}
+	}
+
+	/* Limit the response block size, or request the next block */
+	if ((ex->method == COAP_METHOD_GET && !ex->observe) ||
+	    ex->block2_num > 0) {
+		ret = coap_append_option_int(&request, COAP_OPTION_BLOCK2,
+					     BLOCK_VALUE(ex->block2_num, false,
+							 ex->block2_szx));
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	if (ex->payload_len > 0) {
+		const uint8_t *payload = ex->payload;
+		size_t len = ex->payload_len;
+
+		if (ex->block1) {
+			size_t size = BLOCK_SIZE(ex->block1_szx);
+
+			payload += ex->block1_offset;
+			len = MIN(size, ex->payload_len - ex->block1_offset);
+
+			ret = coap_append_option_int(&request,
+				COAP_OPTION_BLOCK1,
+				BLOCK_VALUE(ex->block1_offset / size,
+					    ex->block1_offset + len <
+						ex->payload_len,
+					    ex->block1_szx));
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		ret = coap_packet_append_payload_marker(&request);
+		if (ret < 0) {
+			LOG_ERR("Unable to append payload marker");
+			return ret;
+		}
+
+		ret = coap_packet_append_payload(&request, (uint8_t *)payload,
+						 len);
+		if (ret < 0) {
+			LOG_ERR("Not able to append payload");
+			return ret;
+		}
+	}
+
+	ex->len = request.offset;
+
+	return 0;
+}
+
+static int exchange_transmit(struct coap_exchange *ex)
+{
+	int ret = sendto(fds.fd, ex->buf, ex->len, 0, &ex->addr,
+			 sizeof(ex->addr));
+
+	if (ret < 0) {
+		LOG_ERR("Transmission failed: %d", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+/* Send the next message of the exchange. */
+static int exchange_send(struct coap_exchange *ex)
+{
+	int ret;
+
+	ret = exchange_build(ex);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = exchange_transmit(ex);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ex->retries = 0;
+	ex->rx_id_valid = false;
+
+	if (ex->confirmable) {
+		/* Initial timeout is randomized, RFC 7252 section 4.8 */
+		ex->timeout = CONFIG_COAP_UTILS_ACK_TIMEOUT +
+			      sys_rand32_get() %
+			      (CONFIG_COAP_UTILS_ACK_TIMEOUT / 2 + 1);
+		ex->state = EXCHANGE_WAIT_ACK;
+	} else {
+		ex->timeout = CONFIG_COAP_UTILS_RESPONSE_TIMEOUT;
+		ex->state = EXCHANGE_WAIT_RESPONSE;
+	}
+	ex->deadline = k_uptime_get() + ex->timeout;
+
+	exchange_schedule();
+
+	return 0;
+}
+
+static void retransmit_work_handler(struct k_work *work)
+{
+	struct delivery pending[ARRAY_SIZE(deliveries)];
+	size_t count;
+	int64_t now;
+
+	k_mutex_lock(&exchange_lock, K_FOREVER);
+
+	now = k_uptime_get();
+
+	for (size_t i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		struct coap_exchange *ex = &exchanges[i];
+
+		if ((ex->state != EXCHANGE_WAIT_ACK &&
+		     ex->state != EXCHANGE_WAIT_RESPONSE) ||
+		    ex->deadline > now) {
+			continue;
+		}
+
+		if (ex->state == EXCHANGE_WAIT_ACK &&
+		    ex->retries < CONFIG_COAP_UTILS_MAX_RETRANSMIT) {
+			ex->retries++;
+			ex->timeout *= 2;
+			ex->deadline = now + ex->timeout;
+			stats.retransmissions++;
+
+			LOG_DBG("Retransmit %u, attempt %u", ex->id,
+				ex->retries);
+			(void)exchange_transmit(ex);
+			continue;
+		}
+
+		LOG_WRN("Request timed out");
+		exchange_deliver(ex, -ETIMEDOUT, 0, NULL, 0, 0, false);
+	}
+
+	exchange_schedule();
+	count = deliveries_take(pending);
+
+	k_mutex_unlock(&exchange_lock);
+
+	deliveries_run(pending, count);
+}
+
+static bool observe_is_fresh(const struct coap_exchange *ex, uint32_t seq)
+{
+	/* RFC 7641 section 3.4 */
+	return ((ex->observe_seq < seq) &&
+		(seq - ex->observe_seq < OBSERVE_SEQ_HALF)) ||
+	       ((ex->observe_seq > seq) &&
+		(ex->observe_seq - seq > OBSERVE_SEQ_HALF)) ||
+	       (k_uptime_get() > ex->observe_time + OBSERVE_FRESHNESS_MS);
+}
+
+static void exchange_response_process(struct coap_exchange *ex,
+				      const struct coap_packet *response)
+{
+	uint8_t code = coap_header_get_code(response);
+	const uint8_t *payload;
+	uint16_t payload_len = 0;
+	size_t offset = 0;
+	int block;
+	int seq;
+
+	payload = coap_packet_get_payload(response, &payload_len);
+
+	/* Block1: send the next block */
+	if (ex->block1 && code == COAP_RESPONSE_CODE_CONTINUE) {
+		ex->block1_offset += BLOCK_SIZE(ex->block1_szx);
+
+		/* Server may ask for smaller blocks */
+		block = coap_get_option_int(response, COAP_OPTION_BLOCK1);
+		if (block >= 0 && BLOCK_SZX(block) < ex->block1_szx) {
+			ex->block1_szx = BLOCK_SZX(block);
+		}
+
+		if (ex->block1_offset < ex->payload_len) {
+			if (exchange_send(ex) < 0) {
+				exchange_deliver(ex, -EIO, code, NULL, 0, 0,
+						 false);
+			}
+			return;
+		}
+	}
+
+	/* Block2: request the next block */
+	block = coap_get_option_int(response, COAP_OPTION_BLOCK2);
+	if (block >= 0 && !ex->observe) {
+		offset = BLOCK_NUM(block) * BLOCK_SIZE(BLOCK_SZX(block));
+
+		if (BLOCK_MORE(block)) {
+			exchange_deliver(ex, 0, code, payload, payload_len,
+					 offset, true);
+
+			/* The request body has been sent */
+			ex->payload_len = 0;
+			ex->block1 = false;
+			ex->block2_szx = MIN(BLOCK_SZX(block), ex->block2_szx);
+			ex->block2_num = (offset + payload_len) /
+					 BLOCK_SIZE(ex->block2_szx);
+
+			if (exchange_send(ex) < 0) {
+				exchange_deliver(ex, -EIO, code, NULL, 0, 0,
+						 false);
+			}
+			return;
+		}
+	}
+
+	/* Observe: keep the exchange for notifications */
+	seq = coap_get_option_int(response, COAP_OPTION_OBSERVE);
+	if (ex->observe && seq >= 0 && (code >> 5) == 2) {
+		if (ex->state == EXCHANGE_OBSERVING) {
+			if (!observe_is_fresh(ex, seq)) {
+				LOG_DBG("Old notification dropped");
+				return;
+			}
+		} else {
+			stats_latency_add(ex);
+			ex->state = EXCHANGE_OBSERVING;
+			exchange_schedule();
+		}
+
+		ex->observe_seq = seq;
+		ex->observe_time = k_uptime_get();
+
+		exchange_deliver(ex, 0, code, payload, payload_len, 0, true);
+		return;
+	}
+
+	exchange_deliver(ex, 0, code, payload, payload_len, offset, false);
+}
+
+static struct coap_exchange *exchange_find_by_id(uint16_t id)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		if (exchanges[i].state == EXCHANGE_WAIT_ACK &&
+		    exchanges[i].id == id) {
+			return &exchanges[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct coap_exchange *exchange_find_by_token(const uint8_t *token,
+						    uint8_t tkl)
+{
+	if (tkl != COAP_TOKEN_LEN) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		if (exchanges[i].state != EXCHANGE_FREE &&
+		    memcmp(exchanges[i].token, token, tkl) == 0) {
+			return &exchanges[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Return true if the message belongs to a request sent with
+ * coap_utils_request.
+ */
+static bool exchange_message_handle(const struct coap_packet *response,
+				    const struct sockaddr *from)
+{
+	uint8_t type = coap_header_get_type(response);
+	uint16_t id = coap_header_get_id(response);
+	uint8_t token[COAP_TOKEN_LEN];
+	uint8_t tkl = coap_header_get_token(response, token);
+	struct coap_exchange *ex;
+
+	if (type == COAP_TYPE_ACK || type == COAP_TYPE_RESET) {
+		ex = exchange_find_by_id(id);
+		if (!ex) {
+			return false;
+		}
+
+		if (type == COAP_TYPE_RESET) {
+			exchange_deliver(ex, -ECONNRESET, 0, NULL, 0, 0, false);
+			return true;
+		}
+
+		if (coap_header_get_code(response) == COAP_CODE_EMPTY) {
+			/* Separate response follows */
+			ex->state = EXCHANGE_WAIT_RESPONSE;
+			ex->deadline = k_uptime_get() +
+				       CONFIG_COAP_UTILS_RESPONSE_TIMEOUT;
+			exchange_schedule();
+			return true;
+		}
+
+		if (exchange_find_by_token(token, tkl) != ex) {
+			LOG_WRN("Token mismatch in piggybacked response");
+			return true;
+		}
+	} else {
+		ex = exchange_find_by_token(token, tkl);
+		if (!ex) {
+			return false;
+		}
+
+		if (type == COAP_TYPE_CON) {
+			coap_send_empty(COAP_TYPE_ACK, id, from);
+
+			if (ex->rx_id_valid && ex->rx_id == id) {
+				/* Retransmission of a processed response */
+				return true;
+			}
+			ex->rx_id = id;
+			ex->rx_id_valid = true;
+		}
+	}
+
+	exchange_response_process(ex, response);
+
+	return true;
+}
+
 static void coap_receive(void)
 {
 	static uint8_t buf[MAX_COAP_MSG_LEN + 1];
 	struct coap_packet response;
 	struct coap_reply *reply = NULL;
 	static struct sockaddr from_addr;
+	static struct delivery pending[ARRAY_SIZE(deliveries)];
 	socklen_t from_addr_len;
+	size_t count;
+	bool handled;
 	int len;
 	int ret;
 
 	while (1) {
 		fds.revents = 0;
+		from_addr_len = sizeof(from_addr);
 
 		if (poll(&fds, nfds, -1) < 0) {
 			LOG_ERR("Error in poll:%d", errno);
@@ -120,10 +684,31 @@ static void coap_receive(void)
 			continue;
 		}
 
+		k_mutex_lock(&exchange_lock, K_FOREVER);
+		handled = exchange_message_handle(&response, &from_addr);
+		count = deliveries_take(pending);
+		k_mutex_unlock(&exchange_lock);
+
+		/* The payloads point into the receive buffer, which is not
+		 * reused until the callbacks return.
+		 */
+		deliveries_run(pending, count);
+
+		if (handled) {
+			continue;
+		}
+
 		reply = coap_response_received(&response, &from_addr, replies,
 					       COAP_MAX_REPLIES);
 		if (reply) {
 			coap_reply_clear(reply);
+		} else if (coap_header_get_type(&response) == COAP_TYPE_CON ||
+			   coap_get_option_int(&response,
+					       COAP_OPTION_OBSERVE) >= 0) {
+			/* Unknown request, e.g. a cancelled observation */
+			coap_send_empty(COAP_TYPE_RESET,
+					coap_header_get_id(&response),
+					&from_addr);
 		}
 	}
 }
@@ -200,6 +785,8 @@ void coap_init(int ip_family)
 	fds.revents = 0;
 	fds.fd = coap_open_socket();
 
+	k_delayed_work_init(&retransmit_work, retransmit_work_handler);
+
 	/* start sock receive thread */
 	k_thread_create(&receive_thread_data, receive_stack_area,
 			K_THREAD_STACK_SIZEOF(receive_stack_area),
@@ -238,3 +825,101 @@ int coap_send_request(enum coap_method method, const struct sockaddr *addr,
 end:
 	return ret;
 }
+
+int coap_utils_request(const struct coap_utils_request_params *params)
+{
+	struct coap_exchange *ex = NULL;
+	uint16_t generation;
+	int ret;
+
+	if (!params || !params->addr ||
+	    (params->payload_len > 0 && !params->payload)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&exchange_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		if (exchanges[i].state == EXCHANGE_FREE) {
+			ex = &exchanges[i];
+			break;
+		}
+	}
+
+	if (!ex) {
+		ret = -ENOMEM;
+		goto end;
+	}
+
+	generation = (ex->generation + 1) & HANDLE_GENERATION_MASK;
+	memset(ex, 0, offsetof(struct coap_exchange, buf));
+	ex->generation = generation;
+	memcpy(&ex->addr, params->addr, sizeof(ex->addr));
+	ex->method = params->method;
+	ex->uri_path_options = params->uri_path_options;
+	ex->payload = params->payload;
+	ex->payload_len = params->payload_len;
+	ex->confirmable = params->confirmable;
+	ex->observe = params->observe;
+	ex->block1 = params->payload_len > CONFIG_COAP_UTILS_BLOCK_SIZE;
+	ex->block1_szx = BLOCK_SZX_DEFAULT;
+	ex->block2_szx = BLOCK_SZX_DEFAULT;
+	ex->cb = params->cb;
+	ex->user_data = params->user_data;
+	memcpy(ex->token, coap_next_token(), sizeof(ex->token));
+	ex->start_time = k_uptime_get();
+
+	ret = exchange_send(ex);
+	if (ret < 0) {
+		ex->state = EXCHANGE_FREE;
+		goto end;
+	}
+
+	ret = (generation << HANDLE_INDEX_BITS) | (ex - exchanges);
+
+end:
+	k_mutex_unlock(&exchange_lock);
+
+	return ret;
+}
+
+int coap_utils_cancel(int handle)
+{
+	struct coap_exchange *ex;
+	int ret = 0;
+
+	if (handle < 0 ||
+	    (handle & HANDLE_INDEX_MASK) >= (int)ARRAY_SIZE(exchanges)) {
+		return -EINVAL;
+	}
+
+	ex = &exchanges[handle & HANDLE_INDEX_MASK];
+
+	k_mutex_lock(&exchange_lock, K_FOREVER);
+
+	if (ex->state == EXCHANGE_FREE ||
+	    ex->generation != (handle >> HANDLE_INDEX_BITS)) {
+		ret = -ENOENT;
+	} else {
+		ex->state = EXCHANGE_FREE;
+		exchange_schedule();
+	}
+
+	k_mutex_unlock(&exchange_lock);
+
+	return ret;
+}
+
+void coap_utils_stats_get(struct coap_utils_stats *stats_out)
+{
+	k_mutex_lock(&exchange_lock, K_FOREVER);
+	*stats_out = stats;
+	k_mutex_unlock(&exchange_lock);
+}
+
+void coap_utils_stats_reset(void)
+{
+	k_mutex_lock(&exchange_lock, K_FOREVER);
+	memset(&stats, 0, sizeof(stats));
+	k_mutex_unlock(&exchange_lock);
+}
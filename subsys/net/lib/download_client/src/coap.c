@@ -5,6 +5,8 @@
  */
 
 #include <zephyr.h>
+#include <sys/byteorder.h>
+#include <net/socket.h>
 #include <net/coap.h>
 #include <net/download_client.h>
 #include <logging/log.h>
@@ -14,107 +16,471 @@ LOG_MODULE_DECLARE(download_client, CONFIG_DOWNLOAD_CLIENT_LOG_LEVEL);
 #define COAP_VER 1
 #define FILENAME_SIZE CONFIG_DOWNLOAD_CLIENT_MAX_FILENAME_SIZE
 
+/* Room for the CoAP header and options of a response: header (4), token
+ * (8), ETag (up to 9), Max-Age (5), Content-Format (3), Block2 (4), Size2
+ * (6) and payload marker (1), rounded up for other options.
+ */
+#define COAP_HEADER_MAX 64
+
+#define TOKEN_LEN 8
+
+/* Retransmission timeout bounds, RFC 6298 */
+#define RTO_MIN 1000
+#define RTO_INIT 2000
+#define RTO_MAX ((CONFIG_DOWNLOAD_CLIENT_SOCK_TIMEOUT_MS > 0) ? \
+		 CONFIG_DOWNLOAD_CLIENT_SOCK_TIMEOUT_MS : 60000)
+
+#define BLOCK_NUM(val) ((uint32_t)(val) >> 4)
+#define BLOCK_MORE(val) (((val) & 0x08) != 0)
+#define BLOCK_SZX(val) ((val) & 0x07)
+
+#define LAST_UNKNOWN UINT32_MAX
+
+enum slot_state {
+	SLOT_FREE,
+	SLOT_IN_FLIGHT,
+	/* Acknowledged with an empty ACK, a separate response follows */
+	SLOT_ACKED,
+	SLOT_RECEIVED,
+	/* Error response while the size of the file is unknown */
+	SLOT_FAILED,
+};
+
 int url_parse_file(const char *url, char *file, size_t len);
-int socket_send(const struct download_client *client, size_t len);
+
+static size_t block_size(const struct download_client *client)
+{
+	return coap_block_size_to_bytes(client->coap.block_ctx.block_size);
+}
+
+/* Blocks are kept in the beginning of the buffer, in order, and datagrams
+ * are received after them. If there is no room for more than one block,
+ * the datagram is received at the beginning, and its payload is moved
+ * in place.
+ */
+static void window_max_update(struct download_client *client)
+{
+	size_t size = block_size(client);
+	size_t max = (sizeof(client->buf) - size - COAP_HEADER_MAX) / size;
+
+	if (!client->coap.negotiated || max == 0) {
+		client->coap.window_max = 1;
+		client->coap.rx_offset = (max > 0) ? size : 0;
+		return;
+	}
+
+	client->coap.window_max =
+		MIN(max, CONFIG_DOWNLOAD_CLIENT_COAP_MAX_WINDOW);
+	client->coap.rx_offset = client->coap.window_max * size;
+}
 
 int coap_block_init(struct download_client *client, size_t from)
 {
+	size_t size;
+
+	memset(&client->coap, 0, sizeof(client->coap));
+
 	coap_block_transfer_init(&client->coap.block_ctx,
 				 CONFIG_DOWNLOAD_CLIENT_COAP_BLOCK_SIZE, 0);
-	client->coap.block_ctx.current = from;
+	size = block_size(client);
+
+	client->coap.base = from / size;
+	client->coap.skip = from % size;
+	client->coap.last = LAST_UNKNOWN;
+	client->coap.window = 1;
+	client->coap.rto = MIN(RTO_INIT, RTO_MAX);
+	memcpy(client->coap.session, coap_next_token(),
+	       sizeof(client->coap.session));
+
+	window_max_update(client);
+
 	return 0;
 }
 
-int coap_block_update(struct download_client *client, struct coap_packet *pkt,
-		      size_t *blk_off)
+static void socket_timeout_update(struct download_client *client)
 {
-	int err;
-	bool more;
+	struct timeval timeo = {
+		.tv_sec = (client->coap.rto / 1000),
+		.tv_usec = (client->coap.rto % 1000) * 1000,
+	};
 
-	*blk_off = client->coap.block_ctx.current %
-		   coap_block_size_to_bytes(client->coap.block_ctx.block_size);
-	if (*blk_off) {
-		LOG_DBG("%d bytes of current block already downloaded",
-			*blk_off);
+	if (CONFIG_DOWNLOAD_CLIENT_SOCK_TIMEOUT_MS == SYS_FOREVER_MS) {
+		return;
+	}
+
+	/* Wake up to retransmit */
+	if (setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &timeo,
+		       sizeof(timeo))) {
+		LOG_WRN("Failed to set socket timeout, errno %d", errno);
+	}
+}
+
+static void rtt_sample(struct download_client *client, uint32_t rtt)
+{
+	uint32_t delta;
+	uint32_t rto;
+
+	/* RFC 6298 section 2 */
+	if (client->coap.srtt == 0) {
+		client->coap.srtt = MAX(rtt, 1);
+		client->coap.rttvar = rtt / 2;
+	} else {
+		delta = (client->coap.srtt > rtt) ? client->coap.srtt - rtt :
+						    rtt - client->coap.srtt;
+		client->coap.rttvar = (3 * client->coap.rttvar + delta) / 4;
+		client->coap.srtt = (7 * client->coap.srtt + rtt) / 8;
+	}
+
+	rto = client->coap.srtt + 4 * client->coap.rttvar;
+	rto = MIN(MAX(rto, RTO_MIN), RTO_MAX);
+
+	if (rto != client->coap.rto) {
+		client->coap.rto = rto;
+		socket_timeout_update(client);
+	}
+}
+
+/* Stop retransmitting a request that the server acknowledged. The separate
+ * response is waited for up to RTO_MAX, then the block is requested again.
+ */
+static void empty_ack_handle(struct download_client *client, uint16_t id)
+{
+	int64_t now = k_uptime_get();
+
+	for (uint8_t i = 0; i < client->coap.window_max; i++) {
+		if (client->coap.slot[i].state != SLOT_IN_FLIGHT ||
+		    client->coap.slot[i].id != id) {
+			continue;
+		}
+
+		LOG_DBG("CoAP block %d acknowledged", client->coap.base + i);
+
+		if (client->coap.slot[i].retries == 0) {
+			rtt_sample(client, now - client->coap.slot[i].sent);
+		}
+
+		client->coap.slot[i].state = SLOT_ACKED;
+		client->coap.slot[i].sent = now;
+		return;
 	}
+}
 
-	err = coap_update_from_block(pkt, &client->coap.block_ctx);
+static void window_grow(struct download_client *client)
+{
+	/* Additive increase, by one block when a window of blocks is
+	 * received without loss.
+	 */
+	if (++client->coap.window_acks < client->coap.window) {
+		return;
+	}
+
+	client->coap.window_acks = 0;
+	if (client->coap.window < client->coap.window_max) {
+		client->coap.window++;
+		LOG_DBG("CoAP window %d", client->coap.window);
+	}
+}
+
+static void window_shrink(struct download_client *client)
+{
+	client->coap.window = MAX(client->coap.window / 2, 1);
+	client->coap.window_acks = 0;
+	LOG_DBG("CoAP window %d, rto %d ms", client->coap.window,
+		client->coap.rto);
+}
+
+static void empty_ack_send(struct download_client *client, uint16_t id)
+{
+	struct coap_packet ack;
+	uint8_t buf[4];
+	int err;
+
+	err = coap_packet_init(&ack, buf, sizeof(buf), COAP_VER,
+			       COAP_TYPE_ACK, 0, NULL, COAP_CODE_EMPTY, id);
 	if (err) {
-		return err;
+		return;
 	}
 
-	if (client->file_size == 0) {
-		LOG_DBG("Total size: %d", client->coap.block_ctx.total_size);
-		client->file_size = client->coap.block_ctx.total_size;
+	(void)send(client->fd, ack.data, ack.offset, 0);
+}
+
+/* Deliver the blocks received in order, from the beginning of the window. */
+static void blocks_deliver(struct download_client *client)
+{
+	size_t size = block_size(client);
+	size_t len = 0;
+	uint8_t count = 0;
+
+	while (count < client->coap.window_max &&
+	       client->coap.slot[count].state == SLOT_RECEIVED) {
+		len += client->coap.slot[count].len;
+		count++;
+
+		/* Only the last block of the file is shorter */
+		if (client->coap.slot[count - 1].len < size) {
+			break;
+		}
 	}
 
-	more = coap_next_block(pkt, &client->coap.block_ctx);
-	if (!more) {
+	if (client->coap.skip) {
+		LOG_DBG("%d bytes of current block already downloaded",
+			client->coap.skip);
+		len -= MIN(len, client->coap.skip);
+		memmove(client->buf, client->buf + client->coap.skip, len);
+		client->coap.skip = 0;
+	}
+
+	client->offset = len;
+	client->progress += len;
+	client->coap.delivered = count;
+
+	if ((client->coap.base + count - 1) == client->coap.last) {
 		LOG_DBG("Last block received");
+		if (client->file_size == 0) {
+			/* Server did not tell the size in advance */
+			client->file_size = client->progress;
+		}
+	}
+}
+
+/* Remove the delivered blocks from the window. */
+static void window_advance(struct download_client *client)
+{
+	uint8_t count = client->coap.delivered;
+	size_t size = block_size(client);
+
+	if (count == 0) {
+		return;
+	}
+
+	memmove(client->buf, client->buf + count * size,
+		(client->coap.window_max - count) * size);
+	memmove(&client->coap.slot[0], &client->coap.slot[count],
+		(client->coap.window_max - count) *
+		sizeof(client->coap.slot[0]));
+	memset(&client->coap.slot[client->coap.window_max - count], 0,
+	       count * sizeof(client->coap.slot[0]));
+
+	client->coap.base += count;
+	client->coap.delivered = 0;
+}
+
+/* Forget the requests for blocks after the last block of the file, which
+ * were sent while the size of the file was unknown.
+ */
+static void window_truncate(struct download_client *client)
+{
+	uint32_t count = client->coap.last - client->coap.base + 1;
+
+	for (uint32_t i = count; i < client->coap.window_max; i++) {
+		memset(&client->coap.slot[i], 0, sizeof(client->coap.slot[i]));
+	}
+}
+
+/* Set up the window from the first response. */
+static int block_negotiate(struct download_client *client, int block2,
+			   int size2)
+{
+	size_t offset;
+	size_t from;
+
+	from = client->coap.base * block_size(client) + client->coap.skip;
+
+	if (block2 >= 0) {
+		if (BLOCK_SZX(block2) > client->coap.block_ctx.block_size) {
+			LOG_ERR("Server block size larger than requested");
+			return -EBADMSG;
+		}
+		/* Honor a smaller block size of the server */
+		client->coap.block_ctx.block_size = BLOCK_SZX(block2);
+		offset = BLOCK_NUM(block2) * block_size(client);
+	} else {
+		/* Whole resource in one response */
+		offset = 0;
+	}
+
+	if (from < offset || from >= offset + block_size(client)) {
+		LOG_ERR("Unexpected block at offset %d", offset);
+		return -EBADMSG;
 	}
 
+	client->coap.base = offset / block_size(client);
+	client->coap.skip = from - offset;
+
+	if (size2 > 0) {
+		LOG_DBG("Total size: %d", size2);
+		client->coap.block_ctx.total_size = size2;
+		client->file_size = size2;
+		client->coap.last = (size2 - 1) / block_size(client);
+	}
+
+	client->coap.negotiated = true;
+	window_max_update(client);
+
+	LOG_DBG("CoAP block size %d, window up to %d", block_size(client),
+		client->coap.window_max);
+
 	return 0;
 }
 
 int coap_parse(struct download_client *client, size_t len)
 {
 	int err;
-	size_t blk_off;
+	int block2;
+	int size2;
+	uint8_t type;
 	uint8_t response_code;
 	uint16_t payload_len;
 	const uint8_t *payload;
+	uint8_t token[TOKEN_LEN];
+	uint32_t num;
+	uint32_t index;
 	struct coap_packet response;
 
-	err = coap_packet_parse(&response, client->buf, len, NULL, 0);
+	err = coap_packet_parse(&response,
+				client->buf + client->coap.rx_offset, len,
+				NULL, 0);
 	if (err) {
 		LOG_ERR("Failed to parse CoAP packet, err %d", err);
 		return -1;
 	}
 
-	err = coap_block_update(client, &response, &blk_off);
-	if (err) {
-		return -1;
+	type = coap_header_get_type(&response);
+	response_code = coap_header_get_code(&response);
+
+	if (response_code == COAP_CODE_EMPTY) {
+		if (type == COAP_TYPE_RESET) {
+			LOG_ERR("Server rejected the request");
+			return -1;
+		}
+		/* Separate response follows */
+		if (type == COAP_TYPE_ACK) {
+			empty_ack_handle(client, coap_header_get_id(&response));
+		}
+		return 1;
+	}
+
+	if (type == COAP_TYPE_CON) {
+		/* Separate response */
+		empty_ack_send(client, coap_header_get_id(&response));
+	}
+
+	if (coap_header_get_token(&response, token) != TOKEN_LEN ||
+	    memcmp(token, client->coap.session,
+		   sizeof(client->coap.session))) {
+		LOG_DBG("Response to an old request");
+		return 1;
+	}
+
+	num = sys_get_be32(&token[sizeof(client->coap.session)]);
+	index = num - client->coap.base;
+	if (num < client->coap.base || index >= client->coap.window_max ||
+	    (client->coap.slot[index].state != SLOT_IN_FLIGHT &&
+	     client->coap.slot[index].state != SLOT_ACKED)) {
+		LOG_DBG("Duplicate response to block %d", num);
+		return 1;
 	}
 
-	response_code = coap_header_get_code(&response);
 	if (response_code != COAP_RESPONSE_CODE_OK &&
 	    response_code != COAP_RESPONSE_CODE_CONTENT) {
+		if (index > 0 && client->coap.last == LAST_UNKNOWN) {
+			/* The block can be after the end of the file, which
+			 * is known when an earlier block is received.
+			 */
+			LOG_DBG("Server responded with code 0x%x to block %d",
+				response_code, num);
+			client->coap.slot[index].state = SLOT_FAILED;
+			return 1;
+		}
+
 		LOG_ERR("Server responded with code 0x%x", response_code);
 		return -1;
 	}
 
+	block2 = coap_get_option_int(&response, COAP_OPTION_BLOCK2);
+	size2 = coap_get_option_int(&response, COAP_OPTION_SIZE2);
+
+	if (!client->coap.negotiated) {
+		err = block_negotiate(client, block2, size2);
+		if (err) {
+			return -1;
+		}
+		num = client->coap.base;
+		index = 0;
+	} else if (block2 < 0 || BLOCK_NUM(block2) != num ||
+		   BLOCK_SZX(block2) != client->coap.block_ctx.block_size) {
+		/* Retransmitted when the request times out */
+		LOG_WRN("Unexpected block in response to block %d", num);
+		return 1;
+	}
+
+	if (block2 < 0 || !BLOCK_MORE(block2)) {
+		client->coap.last = num;
+		window_truncate(client);
+	}
+
 	payload = coap_packet_get_payload(&response, &payload_len);
 	if (!payload) {
 		LOG_WRN("No CoAP payload!");
 		return -1;
 	}
 
-	/* TODO: because our buffer is large enough for the whole datagram,
-	 * we don't scrictly need to copy the bytes at the beginning
-	 * of the buffer, we could simply send a fragment pointing to the
-	 * payload directly.
-	 */
-	LOG_DBG("CoAP response: %d, copying %d bytes",
-		coap_header_get_code(&response), payload_len - blk_off);
-	memcpy(client->buf + client->offset, payload + blk_off,
-	       payload_len - blk_off);
+	if (payload_len > block_size(client) ||
+	    (payload_len < block_size(client) && num != client->coap.last)) {
+		LOG_ERR("Invalid block length %d", payload_len);
+		return -1;
+	}
 
-	client->offset += payload_len - blk_off;
-	client->progress += payload_len - blk_off;
+	LOG_DBG("CoAP response: block %d, %d bytes", num, payload_len);
+
+	/* Put the block in place in the window */
+	memmove(client->buf + index * block_size(client), payload,
+		payload_len);
+
+	if (client->coap.slot[index].state == SLOT_IN_FLIGHT &&
+	    client->coap.slot[index].retries == 0) {
+		/* Karn's algorithm: only unambiguous samples. The round trip
+		 * of a separate response was sampled with its empty ACK.
+		 */
+		rtt_sample(client,
+			   k_uptime_get() - client->coap.slot[index].sent);
+	}
+	window_grow(client);
+
+	client->coap.slot[index].state = SLOT_RECEIVED;
+	client->coap.slot[index].len = payload_len;
+
+	if (index > 0) {
+		/* Wait for the blocks before it */
+		return 1;
+	}
+
+	blocks_deliver(client);
 
 	return 0;
 }
 
-int coap_request_send(struct download_client *client)
+static int block_request_send(struct download_client *client, uint8_t index)
 {
 	int err;
 	char file[FILENAME_SIZE];
+	uint8_t token[TOKEN_LEN];
+	uint32_t num = client->coap.base + index;
 	struct coap_packet request;
 
+	memcpy(token, client->coap.session, sizeof(client->coap.session));
+	sys_put_be32(num, &token[sizeof(client->coap.session)]);
+
+	/* Retransmissions use the same message ID */
+	if (client->coap.slot[index].state != SLOT_IN_FLIGHT) {
+		client->coap.slot[index].id = coap_next_id();
+	}
+
 	err = coap_packet_init(
-		&request, client->buf, CONFIG_DOWNLOAD_CLIENT_BUF_SIZE,
-		COAP_VER, COAP_TYPE_CON, 8, coap_next_token(),
-		COAP_METHOD_GET, coap_next_id()
+		&request, client->buf + client->coap.rx_offset,
+		sizeof(client->buf) - client->coap.rx_offset,
+		COAP_VER, COAP_TYPE_CON, sizeof(token), token,
+		COAP_METHOD_GET, client->coap.slot[index].id
 	);
 	if (err) {
 		LOG_ERR("Failed to init CoAP message, err %d", err);
@@ -133,29 +499,137 @@ int coap_request_send(struct download_client *client)
 		return err;
 	}
 
-	err = coap_append_block2_option(&request, &client->coap.block_ctx);
+	err = coap_append_option_int(&request, COAP_OPTION_BLOCK2,
+				     (num << 4) |
+				     client->coap.block_ctx.block_size);
 	if (err) {
 		LOG_ERR("Unable to add block2 option");
 		return err;
 	}
 
-	err = coap_append_size2_option(&request, &client->coap.block_ctx);
-	if (err) {
-		LOG_ERR("Unable to add size2 option");
-		return err;
+	if (!client->coap.negotiated) {
+		/* Ask for the size of the file */
+		err = coap_append_option_int(&request, COAP_OPTION_SIZE2, 0);
+		if (err) {
+			LOG_ERR("Unable to add size2 option");
+			return err;
+		}
 	}
 
-	LOG_DBG("CoAP next block: %d", client->coap.block_ctx.current);
+	LOG_DBG("CoAP next block: %d", num);
 
-	err = socket_send(client, request.offset);
-	if (err) {
+	if (send(client->fd, request.data, request.offset, 0) < 0) {
 		LOG_ERR("Failed to send CoAP request, errno %d", errno);
-		return err;
+		return -errno;
 	}
 
 	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
 		LOG_HEXDUMP_DBG(request.data, request.offset, "CoAP request");
 	}
 
+	client->coap.slot[index].state = SLOT_IN_FLIGHT;
+	client->coap.slot[index].sent = k_uptime_get();
+
 	return 0;
 }
+
+int coap_request_send(struct download_client *client)
+{
+	int err;
+	bool lost = false;
+	int64_t now = k_uptime_get();
+
+	window_advance(client);
+
+	/* A block that failed before the end of the file was known, and that
+	 * is not after the end, is requested again. Another error response
+	 * ends the download.
+	 */
+	if (client->coap.slot[0].state == SLOT_FAILED) {
+		client->coap.slot[0].state = SLOT_FREE;
+		client->coap.slot[0].retries = 0;
+	}
+
+	if (!client->coap.negotiated) {
+		socket_timeout_update(client);
+	}
+
+	/* Request again the blocks whose separate response did not come */
+	for (uint8_t i = 0; i < client->coap.window_max; i++) {
+		if (client->coap.slot[i].state != SLOT_ACKED ||
+		    now - client->coap.slot[i].sent < RTO_MAX) {
+			continue;
+		}
+
+		LOG_DBG("CoAP block %d response timed out",
+			client->coap.base + i);
+
+		err = block_request_send(client, i);
+		if (err) {
+			return err;
+		}
+
+		client->coap.slot[i].retries++;
+	}
+
+	/* Retransmit the requests that timed out */
+	for (uint8_t i = 0; i < client->coap.window_max; i++) {
+		if (client->coap.slot[i].state != SLOT_IN_FLIGHT ||
+		    now - client->coap.slot[i].sent < client->coap.rto) {
+			continue;
+		}
+
+		LOG_DBG("CoAP block %d timed out", client->coap.base + i);
+
+		err = block_request_send(client, i);
+		if (err) {
+			return err;
+		}
+
+		client->coap.slot[i].retries++;
+		lost = true;
+	}
+
+	if (lost) {
+		/* Back off, RFC 6298 section 5.5 */
+		client->coap.rto = MIN(client->coap.rto * 2, RTO_MAX);
+		socket_timeout_update(client);
+		window_shrink(client);
+	}
+
+	/* Fill the window */
+	for (uint8_t i = 0; i < client->coap.window; i++) {
+		if (client->coap.slot[i].state != SLOT_FREE) {
+			continue;
+		}
+
+		if (client->coap.last != LAST_UNKNOWN &&
+		    client->coap.base + i > client->coap.last) {
+			break;
+		}
+
+		err = block_request_send(client, i);
+		if (err) {
+			return err;
+		}
+	}
+
+	/* Receive after the blocks in the window */
+	client->offset = client->coap.rx_offset;
+
+	return 0;
+}
+
+void coap_connection_reset(struct download_client *client)
+{
+	/* Requests in flight are lost with the connection */
+	for (uint8_t i = 0; i < client->coap.window_max; i++) {
+		if (client->coap.slot[i].state != SLOT_RECEIVED) {
+			client->coap.slot[i].state = SLOT_FREE;
+			client->coap.slot[i].retries = 0;
+		}
+	}
+
+	/* The new socket has the default timeout */
+	socket_timeout_update(client);
+}
@@ -26,12 +26,15 @@ int url_parse_port(const char *url, uint16_t *port);
 int url_parse_proto(const char *url, int *proto, int *type);
 int url_parse_host(const char *url, char *host, size_t len);
 
+void http_init(struct download_client *client);
 int http_parse(struct download_client *client, size_t len);
 int http_get_request_send(struct download_client *client);
+void http_fragment_consumed(struct download_client *client);
 
 int coap_block_init(struct download_client *client, size_t from);
 int coap_parse(struct download_client *client, size_t len);
 int coap_request_send(struct download_client *client);
+void coap_connection_reset(struct download_client *client);
 
 static const char *str_family(int family)
 {
@@ -273,10 +276,9 @@ cleanup:
 	return err;
 }
 
-int socket_send(const struct download_client *client, size_t len)
+int socket_send(const struct download_client *client, size_t off, size_t len)
 {
 	int sent;
-	size_t off = 0;
 
 	while (len) {
 		sent = send(client->fd, client->buf + off, len, 0);
@@ -351,6 +353,13 @@ static int reconnect(struct download_client *dl)
 		return err;
 	}
 
+	if (dl->proto == IPPROTO_TCP || dl->proto == IPPROTO_TLS_1_2) {
+		/* Requests in flight are lost with the connection */
+		http_init(dl);
+	} else if (IS_ENABLED(CONFIG_COAP)) {
+		coap_connection_reset(dl);
+	}
+
 	return 0;
 }
 
@@ -364,6 +373,13 @@ restart_and_suspend:
 	k_thread_suspend(dl->tid);
 
 	while (true) {
+		if (dl->http.pending) {
+			/* Data received after the last fragment */
+			dl->http.pending = false;
+			len = 0;
+			goto parse;
+		}
+
 		__ASSERT(dl->offset < sizeof(dl->buf), "Buffer overflow");
 
 		if (sizeof(dl->buf) - dl->offset == 0) {
@@ -380,26 +396,39 @@ restart_and_suspend:
 			   sizeof(dl->buf) - dl->offset, 0);
 
 		if ((len == 0) || (len == -1)) {
-			/* We just had an unexpected socket error or closure */
-
-			/* If there is a partial data payload in our buffer,
-			 * and it has been accounted in our progress, we have
-			 * to hand it to the application before discarding it.
+			/* We just had an unexpected socket error or closure.
+			 * A partial HTTP payload in our buffer is not
+			 * accounted in our progress yet, and it is requested
+			 * again after reconnecting.
 			 */
-			if ((dl->offset > 0) && (dl->http.has_header)) {
-				rc = fragment_evt_send(dl);
-				if (rc) {
-					/* Restart and suspend */
-					LOG_INF("Fragment refused, download stopped.");
-					break;
-				}
-			}
 
 			if (len == -1) {
+				if (errno == ETIMEDOUT &&
+				    (dl->proto == IPPROTO_UDP ||
+				     dl->proto == IPPROTO_DTLS_1_2)) {
+					LOG_DBG("Socket timeout, resending");
+					goto send_again;
+				}
+
 				if (errno == ETIMEDOUT) {
+					/* Resending on the same connection
+					 * would duplicate the pipelined
+					 * requests, so the requests are sent
+					 * again on a new connection. Like a
+					 * resend, this is not reported to the
+					 * application.
+					 */
 					LOG_DBG("Socket timeout, resending");
+
+					rc = reconnect(dl);
+					if (rc) {
+						error_evt_send(dl, EHOSTDOWN);
+						break;
+					}
+
 					goto send_again;
 				}
+
 				LOG_ERR("Error in recv(), errno %d", errno);
 			}
 
@@ -428,6 +457,7 @@ restart_and_suspend:
 
 		LOG_DBG("Read %d bytes from socket", len);
 
+parse:
 		if (dl->proto == IPPROTO_TCP || dl->proto == IPPROTO_TLS_1_2) {
 			rc = http_parse(client, len);
 			if (rc > 0) {
@@ -436,6 +466,10 @@ restart_and_suspend:
 			}
 		} else if (IS_ENABLED(CONFIG_COAP)) {
 			rc = coap_parse(client, len);
+			if (rc > 0) {
+				/* No new data in order, retransmit if needed */
+				goto send_again;
+			}
 		}
 
 		if (rc < 0) {
@@ -457,11 +491,13 @@ restart_and_suspend:
 		/* Send fragment to application.
 		 * If the application callback returns non-zero, stop.
 		 */
-		rc = fragment_evt_send(dl);
-		if (rc) {
-			/* Restart and suspend */
-			LOG_INF("Fragment refused, download stopped.");
-			break;
+		if (dl->offset) {
+			rc = fragment_evt_send(dl);
+			if (rc) {
+				/* Restart and suspend */
+				LOG_INF("Fragment refused, download stopped.");
+				break;
+			}
 		}
 
 		if (dl->progress == dl->file_size) {
@@ -481,27 +517,29 @@ restart_and_suspend:
 		}
 
 send_again:
-		dl->offset = 0;
-		/* Request next fragment, if necessary (HTTPS/CoAP) */
-		if (dl->proto != IPPROTO_TCP || len == 0) {
-			dl->http.has_header = false;
+		if (dl->proto == IPPROTO_TCP || dl->proto == IPPROTO_TLS_1_2) {
+			/* Keep the data received after the fragment */
+			http_fragment_consumed(dl);
+		} else {
+			dl->offset = 0;
+		}
 
-			rc = request_send(dl);
+		/* Request next fragment(s), if necessary */
+		rc = request_send(dl);
+		if (rc) {
+			rc = error_evt_send(dl, ECONNRESET);
 			if (rc) {
-				rc = error_evt_send(dl, ECONNRESET);
-				if (rc) {
-					/* Restart and suspend */
-					break;
-				}
-
-				rc = reconnect(dl);
-				if (rc) {
-					error_evt_send(dl, EHOSTDOWN);
-					break;
-				}
+				/* Restart and suspend */
+				break;
+			}
 
-				goto send_again;
+			rc = reconnect(dl);
+			if (rc) {
+				error_evt_send(dl, EHOSTDOWN);
+				break;
 			}
+
+			goto send_again;
 		}
 	}
 
@@ -616,8 +654,7 @@ int download_client_start(struct download_client *client, const char *file,
 	client->file_size = 0;
 	client->progress = from;
 
-	client->offset = 0;
-	client->http.has_header = false;
+	http_init(client);
 
 	if (IS_ENABLED(CONFIG_COAP)) {
 		coap_block_init(client, from);
@@ -31,21 +31,75 @@ LOG_MODULE_DECLARE(download_client, CONFIG_DOWNLOAD_CLIENT_LOG_LEVEL);
 	"Connection: keep-alive\r\n"                                           \
 	"\r\n"
 
+/* Length of "HTTP/1.1 200" */
+#define STATUS_LINE_MIN_LEN 12
+
+enum http_state {
+	HTTP_STATE_STATUS,
+	HTTP_STATE_HEADER,
+	HTTP_STATE_BODY,
+	HTTP_STATE_CHUNK_SIZE,
+	HTTP_STATE_CHUNK_DATA,
+	HTTP_STATE_CHUNK_END,
+	HTTP_STATE_TRAILER,
+};
+
 int url_parse_host(const char *url, char *host, size_t len);
 int url_parse_file(const char *url, char *file, size_t len);
-int socket_send(const struct download_client *client, size_t len);
+int socket_send(const struct download_client *client, size_t off, size_t len);
+
+static size_t frag_size(const struct download_client *client)
+{
+	size_t size = CONFIG_DOWNLOAD_CLIENT_HTTP_FRAG_SIZE;
+
+	if (client->config.frag_size_override) {
+		size = client->config.frag_size_override;
+	}
+
+	return MIN(size, sizeof(client->buf));
+}
+
+void http_init(struct download_client *client)
+{
+	memset(&client->http, 0, sizeof(client->http));
+	client->http.state = HTTP_STATE_STATUS;
+	client->offset = 0;
+}
+
+static bool request_allowed(const struct download_client *client)
+{
+	if (client->http.in_flight == 0) {
+		return true;
+	}
+
+	/* With HTTP, the whole file is requested at once.
+	 * With HTTPS, range requests are pipelined
+	 * once the size of the file is known.
+	 */
+	return (client->proto == IPPROTO_TLS_1_2) &&
+	       (client->file_size != 0) &&
+	       (client->http.requested < client->file_size) &&
+	       (client->http.in_flight <
+		CONFIG_DOWNLOAD_CLIENT_HTTP_PIPELINE_DEPTH);
+}
 
 int http_get_request_send(struct download_client *client)
 {
 	int err;
 	int len;
 	size_t off;
+	size_t room;
+	char *req;
 	char host[HOSTNAME_SIZE];
 	char file[FILENAME_SIZE];
 
 	__ASSERT_NO_MSG(client->host);
 	__ASSERT_NO_MSG(client->file);
 
+	if (!request_allowed(client)) {
+		return 0;
+	}
+
 	err = url_parse_host(client->host, host, sizeof(host));
 	if (err) {
 		return err;
@@ -56,132 +110,428 @@ int http_get_request_send(struct download_client *client)
 		return err;
 	}
 
-	/* Offset of last byte in range (Content-Range) */
-	if (client->config.frag_size_override) {
-		off = client->progress + client->config.frag_size_override - 1;
-	} else {
-		off = client->progress +
-			CONFIG_DOWNLOAD_CLIENT_HTTP_FRAG_SIZE - 1;
+	if (client->http.in_flight == 0) {
+		/* Nothing is coming, start from what we have */
+		client->http.requested = client->progress;
 	}
 
-	if (client->file_size != 0) {
-		/* Don't request bytes past the end of file */
-		off = MIN(off, client->file_size);
-	}
+	do {
+		/* Offset of last byte in range (Content-Range) */
+		off = client->http.requested + frag_size(client) - 1;
 
-	/* We use range requests only for HTTPS, due to memory limitations.
-	 * When using HTTP, we request the whole resource to minimize
-	 * network usage (only one request/response are sent).
-	 */
-	if (client->proto == IPPROTO_TLS_1_2) {
-		len = snprintf(client->buf,
-			CONFIG_DOWNLOAD_CLIENT_BUF_SIZE,
-			GET_HTTPS_TEMPLATE, file, host, client->progress, off);
-	} else {
-		len = snprintf(client->buf,
-			CONFIG_DOWNLOAD_CLIENT_BUF_SIZE,
-			GET_HTTP_TEMPLATE, file, host, client->progress);
-	}
+		if (client->file_size != 0) {
+			/* Don't request bytes past the end of file */
+			off = MIN(off, client->file_size - 1);
+		}
 
-	if (len < 0 || len > CONFIG_DOWNLOAD_CLIENT_BUF_SIZE) {
-		LOG_ERR("Cannot create GET request, buffer too small");
-		return -ENOMEM;
-	}
+		/* The request is built after the data received so far */
+		req = client->buf + client->offset;
+		room = sizeof(client->buf) - client->offset;
 
-	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
-		LOG_HEXDUMP_DBG(client->buf, len, "HTTP request");
-	}
+		/* We use range requests only for HTTPS, due to memory
+		 * limitations. When using HTTP, we request the whole resource
+		 * to minimize network usage (only one request/response are
+		 * sent).
+		 */
+		if (client->proto == IPPROTO_TLS_1_2) {
+			len = snprintf(req, room, GET_HTTPS_TEMPLATE, file,
+				       host, client->http.requested, off);
+		} else {
+			len = snprintf(req, room, GET_HTTP_TEMPLATE, file,
+				       host, client->http.requested);
+		}
 
-	err = socket_send(client, len);
-	if (err) {
-		LOG_ERR("Failed to send HTTP request, errno %d", errno);
-		return err;
-	}
+		if (len < 0 || (size_t)len >= room) {
+			if (client->http.in_flight) {
+				/* Try again when the buffer is consumed */
+				return 0;
+			}
+			LOG_ERR("Cannot create GET request, buffer too small");
+			return -ENOMEM;
+		}
+
+		if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
+			LOG_HEXDUMP_DBG(req, len, "HTTP request");
+		}
+
+		err = socket_send(client, client->offset, len);
+		if (err) {
+			LOG_ERR("Failed to send HTTP request, errno %d", errno);
+			return err;
+		}
+
+		client->http.requested = off + 1;
+		client->http.in_flight++;
+	} while (request_allowed(client));
 
 	return 0;
 }
 
-/* Returns:
- *  1 while the header is being received
- *  0 if the header has been fully received
- * -1 on error
+/* Returns a pointer to the value of the header field in `line`,
+ * if its name is `name`, or NULL otherwise.
  */
-static int http_header_parse(struct download_client *client, size_t *hdr_len)
+static const char *header_value(const char *line, size_t len,
+				const char *name)
 {
-	char *p;
+	size_t name_len = strlen(name);
+	const char *p;
 
-	p = strstr(client->buf, "\r\n\r\n");
-	if (!p) {
-		/* Waiting full HTTP header */
-		LOG_DBG("Waiting full header in response");
-		return 1;
+	if (len <= name_len || line[name_len] != ':') {
+		return NULL;
 	}
 
-	/* Offset of the end of the HTTP header in the buffer */
-	*hdr_len = p + strlen("\r\n\r\n") - client->buf;
+	for (size_t i = 0; i < name_len; i++) {
+		if (tolower((unsigned char)line[i]) != name[i]) {
+			return NULL;
+		}
+	}
 
-	LOG_DBG("GET header size: %u", *hdr_len);
-	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS)) {
-		LOG_HEXDUMP_DBG(client->buf, *hdr_len, "HTTP response");
+	p = line + name_len + 1;
+	while (p < line + len && *p == ' ') {
+		p++;
 	}
 
-	for (size_t i = 0; i < *hdr_len; i++) {
-		client->buf[i] = tolower(client->buf[i]);
+	return p;
+}
+
+/* Whether `token` is found in `str`, ignoring case. */
+static bool value_has(const char *str, size_t len, const char *token)
+{
+	size_t token_len = strlen(token);
+	size_t i;
+
+	for (size_t start = 0; start + token_len <= len; start++) {
+		for (i = 0; i < token_len; i++) {
+			if (tolower((unsigned char)str[start + i]) !=
+			    token[i]) {
+				break;
+			}
+		}
+		if (i == token_len) {
+			return true;
+		}
 	}
 
-	p = strstr(client->buf, "http/1.1 206");
-	if (!p) {
-		if (client->proto == IPPROTO_TLS_1_2) {
+	return false;
+}
+
+static int status_line_parse(struct download_client *client,
+			     const char *line, size_t len)
+{
+	unsigned long status;
+
+	if (len < STATUS_LINE_MIN_LEN || !value_has(line, 7, "http/1.")) {
+		LOG_ERR("Invalid HTTP status line");
+		return -1;
+	}
+
+	status = strtoul(line + 9, NULL, 10);
+	if (status != 206) {
+		if (client->proto == IPPROTO_TLS_1_2 || client->progress) {
 			LOG_ERR("Server did not honor partial content request");
 			return -1;
 		}
-		p = strstr(client->buf, "http/1.1 200");
-		if (!p) {
+		if (status != 200) {
 			LOG_ERR("Server response is not 200 Success");
 			return -1;
 		}
 	}
 
-	/* The file size is returned via "Content-Length" in case of HTTP,
-	 * and via "Content-Range" in case of HTTPS with range requests.
-	 */
+	client->http.chunked = false;
+	client->http.close = false;
+	client->http.has_length = false;
+	client->http.has_range = false;
+	client->http.remaining = 0;
+	client->http.state = HTTP_STATE_HEADER;
+
+	return 0;
+}
+
+static int content_range_parse(struct download_client *client,
+			       const char *value, size_t len)
+{
+	char *end;
+	const char *total;
+	unsigned long start;
+
+	/* bytes <start>-<end>/<size> */
+	while (len && !isdigit((unsigned char)*value)) {
+		value++;
+		len--;
+	}
+
+	start = strtoul(value, &end, 10);
+	if (end == value) {
+		LOG_ERR("Invalid \"Content-Range\" in response");
+		return -1;
+	}
+
+	if (start != client->progress) {
+		LOG_ERR("Unexpected range start %lu, expected %u", start,
+			client->progress);
+		return -1;
+	}
+
+	total = memchr(value, '/', len);
+	if (total && client->file_size == 0) {
+		client->file_size = strtoul(total + 1, NULL, 10);
+		LOG_DBG("File size = %u", client->file_size);
+	}
+
+	client->http.has_range = true;
+
+	return 0;
+}
+
+static int header_end(struct download_client *client)
+{
+	if (client->proto == IPPROTO_TLS_1_2 && client->file_size == 0 &&
+	    !client->http.has_range) {
+		LOG_ERR("Server did not send \"Content-Range\" in response");
+		return -1;
+	}
+
+	if (client->http.close) {
+		LOG_WRN("Peer closed connection, will re-connect");
+	}
+
+	if (client->http.chunked) {
+		LOG_DBG("Chunked response");
+		client->http.state = HTTP_STATE_CHUNK_SIZE;
+		return 0;
+	}
+
+	if (!client->http.has_length) {
+		LOG_WRN("Server did not send \"Content-Length\" in response");
+		return -1;
+	}
+
 	if (client->file_size == 0) {
-		if (client->proto == IPPROTO_TLS_1_2) {
-			p = strstr(client->buf, "content-range");
-			if (!p) {
-				LOG_ERR("Server did not send "
-					"\"Content-Range\" in response");
-				return -1;
-			}
-			p = strstr(p, "/");
-		} else { /* proto == PROTO_HTTP */
-			p = strstr(client->buf, "content-length");
-			if (!p) {
-				LOG_WRN("Server did not send "
-					"\"Content-Length\" in response");
-					return -1;
-			}
-			p = strstr(p, ":");
-		}
+		client->file_size = client->progress + client->http.remaining;
+		LOG_DBG("File size = %u", client->file_size);
+	}
+
+	if (client->http.remaining == 0) {
+		return 1;
+	}
+
+	client->http.state = HTTP_STATE_BODY;
+
+	return 0;
+}
+
+static int header_line_parse(struct download_client *client,
+			     const char *line, size_t len)
+{
+	const char *value;
+
+	if (len == 0) {
+		return header_end(client);
+	}
+
+	value = header_value(line, len, "content-length");
+	if (value) {
+		client->http.remaining = strtoul(value, NULL, 10);
+		client->http.has_length = true;
+		return 0;
+	}
+
+	value = header_value(line, len, "content-range");
+	if (value) {
+		return content_range_parse(client, value,
+					   len - (value - line));
+	}
+
+	value = header_value(line, len, "transfer-encoding");
+	if (value) {
+		client->http.chunked =
+			value_has(value, len - (value - line), "chunked");
+		return 0;
+	}
+
+	value = header_value(line, len, "connection");
+	if (value) {
+		client->http.close =
+			value_has(value, len - (value - line), "close");
+		return 0;
+	}
+
+	return 0;
+}
+
+static int chunk_size_parse(struct download_client *client,
+			    const char *line, size_t len)
+{
+	char *end;
+
+	/* Chunk extensions, if any, are ignored */
+	client->http.remaining = strtoul(line, &end, 16);
+	if (len == 0 || end == line) {
+		LOG_ERR("Invalid chunk size");
+		return -1;
+	}
+
+	LOG_DBG("Chunk of %u bytes", client->http.remaining);
 
-		if (!p) {
-			LOG_ERR("No file size in response");
+	client->http.state = client->http.remaining ? HTTP_STATE_CHUNK_DATA :
+						      HTTP_STATE_TRAILER;
+
+	return 0;
+}
+
+/* Returns:
+ *  1 if the response is complete
+ *  0 if the line has been parsed
+ * -1 on error
+ */
+static int line_parse(struct download_client *client, const char *line,
+		      size_t len)
+{
+	/* Strip line ending */
+	while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+		len--;
+	}
+
+	if (IS_ENABLED(CONFIG_DOWNLOAD_CLIENT_LOG_HEADERS) && len) {
+		LOG_HEXDUMP_DBG(line, len, "HTTP response");
+	}
+
+	switch (client->http.state) {
+	case HTTP_STATE_STATUS:
+		if (len == 0) {
+			/* Tolerate empty lines between responses */
+			return 0;
+		}
+		return status_line_parse(client, line, len);
+	case HTTP_STATE_HEADER:
+		return header_line_parse(client, line, len);
+	case HTTP_STATE_CHUNK_SIZE:
+		return chunk_size_parse(client, line, len);
+	case HTTP_STATE_CHUNK_END:
+		if (len != 0) {
+			LOG_ERR("Chunk is longer than its size");
 			return -1;
 		}
+		client->http.state = HTTP_STATE_CHUNK_SIZE;
+		return 0;
+	case HTTP_STATE_TRAILER:
+		/* Trailer fields are ignored */
+		return (len == 0) ? 1 : 0;
+	default:
+		__ASSERT(false, "Not a line state");
+		return -1;
+	}
+}
+
+/* Returns the length of the next line in the buffer, including the line
+ * ending, or zero if the line is not complete yet.
+ * Bytes are searched for the line ending only once.
+ */
+static size_t line_get(struct download_client *client)
+{
+	const char *end;
+	size_t from = MAX(client->http.scanned, client->http.parsed);
+
+	end = memchr(client->buf + from, '\n', client->offset - from);
+	if (!end) {
+		client->http.scanned = client->offset;
+		return 0;
+	}
+
+	return end + 1 - (client->buf + client->http.parsed);
+}
+
+/* Move body bytes after the payload collected so far. */
+static void body_copy(struct download_client *client)
+{
+	size_t len;
 
-		client->file_size = atoi(p + 1);
+	len = MIN(client->http.remaining,
+		  client->offset - client->http.parsed);
+	len = MIN(len, frag_size(client) - client->http.frag_len);
+
+	memmove(client->buf + client->http.frag_len,
+		client->buf + client->http.parsed, len);
+
+	client->http.frag_len += len;
+	client->http.parsed += len;
+	client->http.remaining -= len;
+}
+
+static int fragment_ready(struct download_client *client)
+{
+	/* The fragment is at the beginning of the buffer, the bytes that
+	 * are not parsed yet are kept until the fragment is consumed.
+	 */
+	client->http.end = client->offset;
+	client->offset = client->http.frag_len;
+	client->progress += client->http.frag_len;
+
+	return 0;
+}
+
+static int response_end(struct download_client *client)
+{
+	LOG_DBG("Response complete");
+
+	if (client->http.in_flight) {
+		client->http.in_flight--;
+	}
+
+	if (client->file_size == 0) {
+		/* Chunked response to a request for the whole file */
+		client->file_size = client->progress + client->http.frag_len;
 		LOG_DBG("File size = %u", client->file_size);
 	}
 
-	p = strstr(client->buf, "connection: close");
-	if (p) {
-		LOG_WRN("Peer closed connection, will re-connect");
+	if (client->http.close) {
 		client->http.connection_close = true;
 	}
 
-	client->http.has_header = true;
+	client->http.state = HTTP_STATE_STATUS;
 
-	return 0;
+	return fragment_ready(client);
+}
+
+/* Move the bytes that are not parsed yet after the payload collected so far,
+ * to receive more data in the space of the parsed bytes.
+ */
+static void unparsed_move(struct download_client *client)
+{
+	size_t gap = client->http.parsed - client->http.frag_len;
+
+	if (gap == 0) {
+		return;
+	}
+
+	memmove(client->buf + client->http.frag_len,
+		client->buf + client->http.parsed,
+		client->offset - client->http.parsed);
+
+	client->offset -= gap;
+	client->http.parsed -= gap;
+	client->http.scanned = MAX(client->http.scanned, gap) - gap;
+}
+
+void http_fragment_consumed(struct download_client *client)
+{
+	size_t len = client->http.end - client->http.parsed;
+
+	memmove(client->buf, client->buf + client->http.parsed, len);
+
+	if (client->http.scanned > client->http.parsed) {
+		client->http.scanned -= client->http.parsed;
+	} else {
+		client->http.scanned = 0;
+	}
+
+	client->http.parsed = 0;
+	client->http.frag_len = 0;
+	client->http.end = 0;
+	client->offset = len;
+
+	/* Parse what is left before receiving more */
+	client->http.pending = (len > 0);
 }
 
 /* Returns:
@@ -192,55 +542,53 @@ static int http_header_parse(struct download_client *client, size_t *hdr_len)
 int http_parse(struct download_client *client, size_t len)
 {
 	int rc;
-	size_t hdr_len;
+	size_t line_len;
 
 	/* Accumulate buffer offset */
 	client->offset += len;
 
-	if (!client->http.has_header) {
-		rc = http_header_parse(client, &hdr_len);
-		if (rc > 0) {
-			/* Wait for header */
-			return 1;
-		}
-		if (rc < 0) {
-			/* Something is wrong with the header */
-			return -1;
-		}
+	while (client->http.parsed < client->offset) {
+		switch (client->http.state) {
+		case HTTP_STATE_BODY:
+		case HTTP_STATE_CHUNK_DATA:
+			body_copy(client);
+			if (client->http.remaining == 0) {
+				if (client->http.state == HTTP_STATE_BODY) {
+					return response_end(client);
+				}
+				client->http.state = HTTP_STATE_CHUNK_END;
+			} else if (client->http.frag_len == frag_size(client)) {
+				return fragment_ready(client);
+			}
+			break;
+		default:
+			line_len = line_get(client);
+			if (line_len == 0) {
+				unparsed_move(client);
+				if (client->http.frag_len &&
+				    client->offset == sizeof(client->buf)) {
+					/* Make room for the rest of the line */
+					return fragment_ready(client);
+				}
+				/* Wait for the rest of the line */
+				return 1;
+			}
 
-		if (client->offset != hdr_len) {
-			/* The buffer contains some payload bytes,
-			 * copy them at the beginning of the buffer
-			 * and update the offset.
-			 */
-			LOG_DBG("Copying %u payload bytes",
-				client->offset - hdr_len);
-			memcpy(client->buf, client->buf + hdr_len,
-			       client->offset - hdr_len);
-
-			client->offset -= hdr_len;
-		} else {
-			/* Reset the offset.
-			 * The payload is received in an empty buffer.
-			 */
-			client->offset = 0;
+			rc = line_parse(client,
+					client->buf + client->http.parsed,
+					line_len);
+			client->http.parsed += line_len;
+			if (rc < 0) {
+				return -1;
+			}
+			if (rc > 0) {
+				return response_end(client);
+			}
+			break;
 		}
 	}
 
-	/* Accumulate overall file progress.
-	 * If the last recv() call read an HTTP header,
-	 * `offset` has been moved at the end of any trailing
-	 * payload bytes by http_header_parse(). In this case,
-	 * `offset` is less than `len` and it represents
-	 * the actual payload bytes.
-	 */
-	client->progress += MIN(client->offset, len);
-
-	/* Have we received a whole fragment or the whole file? */
-	if ((client->offset < CONFIG_DOWNLOAD_CLIENT_HTTP_FRAG_SIZE) &&
-	    (client->progress != client->file_size)) {
-		return 1;
-	}
+	unparsed_move(client);
 
-	return 0;
+	return 1;
 }
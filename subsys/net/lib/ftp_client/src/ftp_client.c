@@ -29,7 +29,10 @@ static K_THREAD_STACK_DEFINE(ftp_stack_area, FTP_STACK_SIZE);
 
 static struct ftp_client {
 	int sock; /* Socket descriptor. */
+	int data_sock; /* Data socket of a streaming transfer */
 	bool connected; /* Server connected flag */
+	bool xfer_done; /* Transfer complete reply received */
+	bool xfer_post; /* Post control replies of the transfer */
 	struct sockaddr_in remote; /* Server */
 	int sec_tag;
 	ftp_client_callback_t ctrl_callback;
@@ -38,19 +41,10 @@ static struct ftp_client {
 
 static struct k_work_q ftp_work_q;
 static char ctrl_buf[NET_IPV4_MTU];
-static K_SEM_DEFINE(tx_done, 0, 1);
-
-enum data_task_type {
-	TASK_SEND,
-	TASK_RECEIVE
-};
 
 static struct data_task {
 	struct k_work work;
-	enum data_task_type task;
 	char *ctrl_msg;		/* PSAV resposne */
-	uint8_t *data;		/* TX data */
-	uint16_t length;	/* TX length */
 } data_task_param;
 
 static int parse_return_code(const uint8_t *message, int success_code)
@@ -156,39 +150,6 @@ static int do_ftp_send_ctrl(const uint8_t *message, int length)
 	return ret;
 }
 
-/**@brief Send FTP data via socket
- */
-static int do_ftp_send_data(const char *pasv_msg, uint8_t *message, uint16_t length)
-{
-	int data_sock;
-	int ret;
-	uint32_t offset = 0;
-
-	/* Establish data channel */
-	ret = establish_data_channel(pasv_msg);
-	if (ret < 0) {
-		return ret;
-	}
-
-	LOG_HEXDUMP_DBG(message, length, "TXD");
-
-	data_sock = ret;
-	while (offset < length) {
-		ret = send(data_sock, message + offset, length - offset, 0);
-		if (ret < 0) {
-			LOG_ERR("send(data) failed: %d", -errno);
-			ret = -errno;
-			break;
-		}
-		offset += ret;
-		ret = 0;
-	}
-
-	LOG_DBG("DATA sent");
-	close(data_sock);
-	return ret;
-}
-
 /**@brief Receive FTP message from socket
  */
 static int do_ftp_recv_ctrl(bool post_result, int success_code)
@@ -278,14 +239,7 @@ static void data_task(struct k_work *item)
 	struct data_task *task_param =
 		CONTAINER_OF(item, struct data_task, work);
 
-	if (task_param->task == TASK_RECEIVE) {
-		do_ftp_recv_data(task_param->ctrl_msg);
-	} else if (task_param->task == TASK_SEND) {
-		do_ftp_send_data(task_param->ctrl_msg,
-				task_param->data,
-				task_param->length);
-		k_sem_give(&tx_done);
-	}
+	do_ftp_recv_data(task_param->ctrl_msg);
 }
 
 static void keepalive_handler(struct k_work *work)
@@ -307,6 +261,148 @@ static void keepalive_timeout(struct k_timer *dummy)
 
 K_TIMER_DEFINE(keepalive_timer, keepalive_timeout, NULL);
 
+static void keepalive_start(void)
+{
+	int keepalive_time = CONFIG_FTP_CLIENT_KEEPALIVE_TIME;
+
+	if (keepalive_time > 0) {
+		k_timer_start(&keepalive_timer, K_SECONDS(1),
+			K_SECONDS(keepalive_time));
+	}
+}
+
+/**@brief Wait for the end of a transfer on the control channel
+ */
+static int transfer_reply_wait(bool post_result)
+{
+	int ret;
+
+	do {
+		ret = do_ftp_recv_ctrl(post_result, FTP_CODE_226);
+		if (ret < 0 || ret == FTP_CODE_226) {
+			break;
+		}
+		/* Transfer failed, e.g. 426, 451 or 552 */
+		if (atoi(ctrl_buf) >= FTP_CODE_421) {
+			ret = atoi(ctrl_buf);
+			break;
+		}
+	} while (1);
+
+	return ret;
+}
+
+/**@brief Check if a streaming transfer owns the data channel
+ *
+ * The control channel carries the replies of the transfer until it ends,
+ * so no other command can be sent.
+ */
+static bool transfer_busy(void)
+{
+	if (client.data_sock != INVALID_SOCKET) {
+		LOG_ERR("Transfer in progress");
+		return true;
+	}
+
+	return false;
+}
+
+/**@brief Set up the data channel and start a transfer
+ *
+ * The data channel stays open until transfer_end(), so that any amount of
+ * data is transferred with a single PASV round trip.
+ */
+static int transfer_start(const char *cmd, uint32_t offset, bool post_result)
+{
+	int ret;
+
+	if (client.data_sock != INVALID_SOCKET) {
+		LOG_ERR("Transfer already started");
+		return -EALREADY;
+	}
+
+	/* Keep-alive would interleave with the transfer replies */
+	k_timer_stop(&keepalive_timer);
+
+	/* Always set Passive mode to act as TCP client */
+	ret = do_ftp_send_ctrl(CMD_PASV, sizeof(CMD_PASV) - 1);
+	if (ret) {
+		ret = -EIO;
+		goto error;
+	}
+	ret = do_ftp_recv_ctrl(true, FTP_CODE_227);
+	if (ret != FTP_CODE_227) {
+		goto error;
+	}
+	ret = establish_data_channel(ctrl_buf);
+	if (ret < 0) {
+		goto error;
+	}
+	client.data_sock = ret;
+
+	/* Resume from the offset */
+	if (offset > 0) {
+		sprintf(ctrl_buf, CMD_REST, offset);
+		ret = do_ftp_send_ctrl(ctrl_buf, strlen(ctrl_buf));
+		if (ret) {
+			ret = -EIO;
+			goto error;
+		}
+		ret = do_ftp_recv_ctrl(post_result, FTP_CODE_350);
+		if (ret != FTP_CODE_350) {
+			goto error;
+		}
+	}
+
+	ret = do_ftp_send_ctrl(cmd, strlen(cmd));
+	if (ret) {
+		ret = -EIO;
+		goto error;
+	}
+	ret = do_ftp_recv_ctrl(post_result, FTP_CODE_150);
+	if (ret != FTP_CODE_150) {
+		if (parse_return_code(ctrl_buf, FTP_CODE_125) != FTP_CODE_125) {
+			goto error;
+		}
+		ret = FTP_CODE_125;
+	}
+
+	/* Short transfers may complete in the same reply */
+	client.xfer_done =
+		(parse_return_code(ctrl_buf, FTP_CODE_226) == FTP_CODE_226);
+	client.xfer_post = post_result;
+
+	return ret;
+
+error:
+	if (client.data_sock != INVALID_SOCKET) {
+		close(client.data_sock);
+		client.data_sock = INVALID_SOCKET;
+	}
+	keepalive_start();
+	return ret;
+}
+
+static int transfer_end(void)
+{
+	int ret = FTP_CODE_226;
+
+	if (client.data_sock == INVALID_SOCKET) {
+		return -ENOTCONN;
+	}
+
+	/* Closing the data channel marks the end of an upload */
+	close(client.data_sock);
+	client.data_sock = INVALID_SOCKET;
+
+	if (!client.xfer_done) {
+		ret = transfer_reply_wait(client.xfer_post);
+	}
+
+	keepalive_start();
+	return ret;
+}
+
 int ftp_open(const char *hostname, uint16_t port, int sec_tag)
 {
 	int ret;
@@ -394,7 +490,10 @@ int ftp_open(const char *hostname, uint16_t port, int sec_tag)
 int ftp_login(const char *username, const char *password)
 {
 	int ret;
-	int keepalive_time = CONFIG_FTP_CLIENT_KEEPALIVE_TIME;
+
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
 
 	/* send username */
 	sprintf(ctrl_buf, CMD_USER, username);
@@ -418,10 +517,7 @@ int ftp_login(const char *username, const char *password)
 
 	client.connected = true;
 	/* Start keep alive timer */
-	if (keepalive_time > 0) {
-		k_timer_start(&keepalive_timer, K_SECONDS(1),
-			K_SECONDS(keepalive_time));
-	}
+	keepalive_start();
 
 	return ret;
 }
@@ -430,6 +526,11 @@ int ftp_close(void)
 {
 	int ret = 0;
 
+	if (client.data_sock != INVALID_SOCKET) {
+		close(client.data_sock);
+		client.data_sock = INVALID_SOCKET;
+	}
+
 	if (client.connected) {
 		ret = do_ftp_send_ctrl(CMD_QUIT, sizeof(CMD_QUIT) - 1);
 		if (ret == 0) {
@@ -448,6 +549,10 @@ int ftp_status(void)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	/* get server system type */
 	ret = do_ftp_send_ctrl(CMD_SYST, sizeof(CMD_SYST) - 1);
 	if (ret == 0) {
@@ -475,6 +580,10 @@ int ftp_type(enum ftp_trasfer_type type)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	if (type == FTP_TYPE_ASCII) {
 		ret = do_ftp_send_ctrl(CMD_TYPE_A, sizeof(CMD_TYPE_A) - 1);
 	} else if (type == FTP_TYPE_BINARY) {
@@ -493,6 +602,10 @@ int ftp_pwd(void)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	ret = do_ftp_send_ctrl(CMD_PWD, sizeof(CMD_PWD) - 1);
 	if (ret == 0) {
 		ret = do_ftp_recv_ctrl(true, FTP_CODE_257);
@@ -506,6 +619,10 @@ int ftp_list(const char *options, const char *target)
 	int ret;
 	char list_cmd[128];
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	/* Always set Passive mode to act as TCP client */
 	ret = do_ftp_send_ctrl(CMD_PASV, sizeof(CMD_PASV) - 1);
 	if (ret) {
@@ -516,7 +633,6 @@ int ftp_list(const char *options, const char *target)
 		return ret;
 	}
 	data_task_param.ctrl_msg = ctrl_buf;
-	data_task_param.task = TASK_RECEIVE;
 
 	/* Send LIST/NLST command in control channel */
 	if (strlen(options) != 0) {
@@ -553,6 +669,10 @@ int ftp_cwd(const char *folder)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	if (strcmp(folder, "..") == 0) {
 		ret = do_ftp_send_ctrl(CMD_CDUP, sizeof(CMD_CDUP) - 1);
 	} else {
@@ -570,6 +690,10 @@ int ftp_mkd(const char *folder)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	sprintf(ctrl_buf, CMD_MKD, folder);
 	ret = do_ftp_send_ctrl(ctrl_buf, strlen(ctrl_buf));
 	if (ret == 0) {
@@ -583,6 +707,10 @@ int ftp_rmd(const char *folder)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	sprintf(ctrl_buf, CMD_RMD, folder);
 	ret = do_ftp_send_ctrl(ctrl_buf, strlen(ctrl_buf));
 	if (ret == 0) {
@@ -596,6 +724,10 @@ int ftp_rename(const char *old_name, const char *new_name)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	sprintf(ctrl_buf, CMD_RNFR, old_name);
 	ret = do_ftp_send_ctrl(ctrl_buf, strlen(ctrl_buf));
 	if (ret == 0) {
@@ -618,6 +750,10 @@ int ftp_delete(const char *file)
 {
 	int ret;
 
+	if (transfer_busy()) {
+		return -EBUSY;
+	}
+
 	sprintf(ctrl_buf, CMD_DELE, file);
 	ret = do_ftp_send_ctrl(ctrl_buf, strlen(ctrl_buf));
 	if (ret == 0) {
@@ -630,37 +766,81 @@ int ftp_delete(const char *file)
 int ftp_get(const char *file)
 {
 	int ret;
-	char get_cmd[128];
+	uint8_t data_buf[NET_IPV4_MTU];
 
-	/* Always set Passive mode to act as TCP client */
-	ret = do_ftp_send_ctrl(CMD_PASV, sizeof(CMD_PASV) - 1);
-	if (ret) {
-		return -EIO;
+	ret = ftp_get_start(file, 0);
+	if (!FTP_PRELIMINARY_POS(ret)) {
+		return ret;
 	}
-	ret = do_ftp_recv_ctrl(true, FTP_CODE_227);
-	if (ret != FTP_CODE_227) {
+
+	do {
+		ret = ftp_get_data(data_buf, sizeof(data_buf));
+		if (ret > 0) {
+			client.data_callback(data_buf, ret);
+		}
+	} while (ret > 0);
+
+	if (ret < 0) {
+		(void)ftp_get_end();
 		return ret;
 	}
-	data_task_param.ctrl_msg = ctrl_buf;
-	data_task_param.task = TASK_RECEIVE;
 
-	/* Send RETR command in control channel */
+	return ftp_get_end();
+}
+
+int ftp_get_start(const char *file, uint32_t offset)
+{
+	char get_cmd[128];
+
 	sprintf(get_cmd, CMD_RETR, file);
-	ret = do_ftp_send_ctrl(get_cmd, strlen(get_cmd));
-	if (ret) {
-		return -EIO;
-	}
 
-	/* Set up data connection */
-	k_work_submit_to_queue(&ftp_work_q, &data_task_param.work);
+	return transfer_start(get_cmd, offset, false);
+}
 
-	/* Receive control */
-	do {
-		ret = do_ftp_recv_ctrl(false, FTP_CODE_226);
-		if (ret == -ETIMEDOUT || ret == FTP_CODE_226) {
-			break;
+int ftp_get_data(uint8_t *buf, size_t length)
+{
+	int ret;
+	struct pollfd fds[1];
+
+	if (client.data_sock == INVALID_SOCKET) {
+		return -ENOTCONN;
+	}
+
+	fds[0].fd = client.data_sock;
+	fds[0].events = POLLIN;
+	ret = poll(fds, 1, MSEC_PER_SEC * CONFIG_FTP_CLIENT_LISTEN_TIME);
+	if (ret < 0) {
+		LOG_ERR("poll(data) failed: (%d)", -errno);
+		return -errno;
+	}
+	if (ret == 0) {
+		LOG_ERR("poll(data) timeout");
+		return -ETIMEDOUT;
+	}
+	if ((fds[0].revents & POLLIN) != POLLIN) {
+		if (fds[0].revents & POLLERR) {
+			LOG_ERR("poll(data) error");
+			return -EIO;
 		}
-	} while (1);
+		/* POLLHUP or POLLNVAL without data, the transfer was aborted */
+		LOG_ERR("Data channel lost: 0x%02x", fds[0].revents);
+		return -ECONNRESET;
+	}
+
+	/* Server closed the data channel after the whole file, if 0 */
+	ret = recv(client.data_sock, buf, length, 0);
+	if (ret < 0) {
+		LOG_ERR("recv(data) failed: (%d)", -errno);
+		return -errno;
+	}
+
+	LOG_HEXDUMP_DBG(buf, ret, "RXD");
+	return ret;
+}
+
+int ftp_get_end(void)
+{
+	int ret = transfer_end();
 
 	if (ret == FTP_CODE_226) {
 		client.ctrl_callback(ctrl_buf, strlen(ctrl_buf));
@@ -669,47 +849,71 @@ int ftp_get(const char *file)
 	return ret;
 }
 
-int ftp_put(const char *file, const uint8_t *data, uint16_t length)
+int ftp_put(const char *file, const uint8_t *data, size_t length)
 {
 	int ret;
-	char put_cmd[128];
+
+	ret = ftp_put_start(file, FTP_PUT_NORMAL);
+	if (!FTP_PRELIMINARY_POS(ret)) {
+		return ret;
+	}
 
 	if (data && length) {
-		/* Always set Passive mode to act as TCP client */
-		ret = do_ftp_send_ctrl(CMD_PASV, sizeof(CMD_PASV) - 1);
+		ret = ftp_put_data(data, length);
 		if (ret) {
-			return -EIO;
-		}
-		ret = do_ftp_recv_ctrl(true, FTP_CODE_227);
-		if (ret != FTP_CODE_227) {
+			(void)ftp_put_end();
 			return ret;
 		}
-		data_task_param.ctrl_msg = ctrl_buf;
-		data_task_param.task = TASK_SEND;
-		data_task_param.data = (uint8_t *)data;
-		data_task_param.length = length;
 	}
 
-	/* Send STOR command in control channel */
-	sprintf(put_cmd, CMD_STOR, file);
-	ret = do_ftp_send_ctrl(put_cmd, strlen(put_cmd));
+	return ftp_put_end();
+}
+
+int ftp_put_start(const char *file, enum ftp_put_type type)
+{
+	char put_cmd[128];
 
-	/* Now send data */
-	if (data && length) {
-		k_work_submit_to_queue(&ftp_work_q, &data_task_param.work);
-		k_sem_take(&tx_done, K_FOREVER);
+	if (type == FTP_PUT_NORMAL) {
+		sprintf(put_cmd, CMD_STOR, file);
+	} else if (type == FTP_PUT_APPEND) {
+		sprintf(put_cmd, CMD_APPE, file);
+	} else {
+		return -EINVAL;
 	}
 
-	if (ret == 0) {
-		do {
-			ret = do_ftp_recv_ctrl(true, FTP_CODE_226);
-			if (ret == -ETIMEDOUT || ret == FTP_CODE_226) {
-				break;
-			}
-		} while (1);
+	return transfer_start(put_cmd, 0, true);
+}
+
+int ftp_put_data(const uint8_t *data, size_t length)
+{
+	int ret;
+	size_t offset = 0;
+
+	if (client.data_sock == INVALID_SOCKET) {
+		return -ENOTCONN;
 	}
 
-	return ret;
+	LOG_HEXDUMP_DBG(data, length, "TXD");
+
+	while (offset < length) {
+		ret = send(client.data_sock, data + offset, length - offset, 0);
+		if (ret < 0) {
+			LOG_ERR("send(data) failed: %d", -errno);
+			return -errno;
+		}
+		if (ret == 0) {
+			LOG_ERR("send(data) made no progress");
+			return -EIO;
+		}
+		offset += ret;
+	}
+
+	return 0;
+}
+
+int ftp_put_end(void)
+{
+	return transfer_end();
 }
 
 int ftp_init(ftp_client_callback_t ctrl_callback,
@@ -719,6 +923,7 @@ int ftp_init(ftp_client_callback_t ctrl_callback,
 		return -EINVAL;
 	}
 	client.sock = INVALID_SOCKET;
+	client.data_sock = INVALID_SOCKET;
 	client.connected = false;
 	client.sec_tag = INVALID_SEC_TAG;
 	client.ctrl_callback = ctrl_callback;
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <ctype.h>
 #include <strings.h>
 #include <zephyr.h>
 #include <zephyr/types.h>
@@ -14,402 +15,335 @@
 
 LOG_MODULE_REGISTER(icalendar_parser, CONFIG_ICAL_PARSER_LOG_LEVEL);
 
-static size_t unfold_contentline(const char *buf, char *prop_buf)
+/* Content lines are parsed byte by byte, as they are received.
+ * Property values are written directly to their destination, and folded
+ * lines are unfolded by dropping the line break and the whitespace that
+ * follows it. Values of properties that are not requested are not stored.
+ *
+ * Reference: RFC 5545 3.1 Content Lines
+ */
+enum ical_state {
+	/* Property name */
+	ICAL_STATE_NAME,
+	/* Property parameters */
+	ICAL_STATE_PARAM,
+	/* Property value */
+	ICAL_STATE_VALUE,
+	/* Beginning of a line, either a new content line or a fold */
+	ICAL_STATE_LINE_START,
+	/* Parsing stopped by the application */
+	ICAL_STATE_STOPPED,
+};
+
+enum ical_prop_id {
+	ICAL_PROP_ID_UNKNOWN,
+	ICAL_PROP_ID_BEGIN,
+	ICAL_PROP_ID_END,
+	ICAL_PROP_ID_COMPONENT,
+};
+
+struct ical_prop_desc {
+	const char *name;
+	uint8_t name_len;
+	uint8_t id;
+	/* Component property mask, error and destination */
+	uint8_t prop;
+	uint8_t error;
+	uint16_t offset;
+	uint16_t size;
+};
+
+#define PROP_COMPONENT(_name, _prop, _error, _field)                          \
+	{                                                                      \
+		.name = _name,                                                 \
+		.name_len = sizeof(_name) - 1,                                 \
+		.id = ICAL_PROP_ID_COMPONENT,                                  \
+		.prop = _prop,                                                 \
+		.error = _error,                                               \
+		.offset = offsetof(struct ical_component, _field),             \
+		.size = sizeof(((struct ical_component *)0)->_field) - 1,      \
+	}
+
+/* Property name lookup table. Names are matched by length first. */
+static const struct ical_prop_desc ical_props[] = {
+	{ .name = "BEGIN", .name_len = 5, .id = ICAL_PROP_ID_BEGIN },
+	{ .name = "END", .name_len = 3, .id = ICAL_PROP_ID_END },
+	PROP_COMPONENT("SUMMARY", ICAL_PROP_SUMMARY, ICAL_ERROR_SUMMARY,
+		       summary),
+	PROP_COMPONENT("LOCATION", ICAL_PROP_LOCATION, ICAL_ERROR_LOCATION,
+		       location),
+	PROP_COMPONENT("DESCRIPTION", ICAL_PROP_DESCRIPTION,
+		       ICAL_ERROR_DESCRIPTION, description),
+	PROP_COMPONENT("DTSTART", ICAL_PROP_DTSTART, ICAL_ERROR_DTSTART,
+		       dtstart),
+	PROP_COMPONENT("DTEND", ICAL_PROP_DTEND, ICAL_ERROR_DTEND, dtend),
+};
+
+static const struct {
+	const char *name;
+	enum ical_parser_evt_id id;
+} ical_components[] = {
+	{ "VEVENT", ICAL_EVT_VEVENT },
+	{ "VTODO", ICAL_EVT_VTODO },
+	{ "VJOURNAL", ICAL_EVT_VJOURNAL },
+	{ "VFREEBUSY", ICAL_EVT_VFREEBUSY },
+	{ "VTIMEZONE", ICAL_EVT_VTIMEZONE },
+};
+
+static bool token_equals(const struct icalendar_parser *ical,
+			 const char *name, size_t name_len)
 {
-	size_t unfold_size = 0;
-	const char *sol = buf;
-	char *eol;
-	uint16_t total_line_len = 0, single_line_len = 0;
-
-	while (1) {
-		eol = strstr(sol, "\r\n");
-		if (!eol) {
-			return 0;
-		}
-		single_line_len = eol - sol;
-		if ((total_line_len + single_line_len)
-		    <= CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE) {
-			memcpy(prop_buf +
-			       total_line_len, sol, single_line_len);
-			total_line_len += single_line_len;
-		} else {
-			LOG_DBG("Property value overflow."
-				"Increase CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE.");
-			return 0;
-		}
-		if (!strncmp(eol, "\r\n ", strlen("\r\n "))) {
-			/* Long content line is split into multiple lines.
-			 * Copy the folded part to unfolded buffer.
-			 */
-			sol = eol + strlen("\r\n ");
-		} else {
-			/* Content line is delimited. Count parsed bytes */
-			unfold_size = eol - buf;
-			break;
+	return (ical->token_len == name_len) &&
+	       !strncasecmp(ical->token, name, name_len);
+}
+
+static const struct ical_prop_desc *prop_lookup(
+	const struct icalendar_parser *ical)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(ical_props); i++) {
+		if (token_equals(ical, ical_props[i].name,
+				 ical_props[i].name_len)) {
+			return &ical_props[i];
 		}
 	}
-	prop_buf[unfold_size] = '\0';
 
-	return unfold_size;
+	return NULL;
 }
 
-static bool parse_desc_props(const char *buf,
-			     const char *name,
-			     size_t name_size,
-			     char *value,
-			     size_t max_value_len)
+/* Select where the value of the current property is written, if at all. */
+static void value_begin(struct icalendar_parser *ical)
 {
-	bool ret;
-	size_t unfold_size;
-	char ical_prop_buf[CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE + 1];
-
-	unfold_size = unfold_contentline(buf, ical_prop_buf);
-	if (unfold_size <= 0) {
-		/* Property wrong format - no parameter or value. */
-		LOG_ERR("%s no value/param.", name);
-		return false;
+	const struct ical_prop_desc *desc = ical->prop;
+
+	ical->value = NULL;
+	ical->value_len = 0;
+	ical->overflow = false;
+
+	if (!desc) {
+		return;
 	}
 
-	if (ical_prop_buf[name_size] == ':') {
-		size_t value_len = unfold_size - name_size - 1;
-
-		if (value_len <= max_value_len) {
-			memcpy(value,
-				ical_prop_buf + name_size + 1,
-				value_len);
-			value[value_len] = '\0';
-			ret = true;
-		} else {
-			/* Property value overflow. */
-			LOG_ERR("%s value overflow.", name);
-			ret = false;
+	switch (desc->id) {
+	case ICAL_PROP_ID_BEGIN:
+	case ICAL_PROP_ID_END:
+		/* The component name replaces the property name */
+		ical->token_len = 0;
+		break;
+	case ICAL_PROP_ID_COMPONENT:
+		if (ical->depth == 1 && ical->evt.id == ICAL_EVT_VEVENT &&
+		    ical->evt.error == ICAL_ERROR_NONE &&
+		    (ical->props & desc->prop)) {
+			ical->value = (char *)&ical->evt.ical_com +
+				      desc->offset;
+			ical->value_size = desc->size;
 		}
-	} else if (ical_prop_buf[name_size] == ';') {
-		/* Does not support property parameter. */
-		LOG_ERR("%s param not supported.", name);
-		ret = false;
-	} else {
-		/* Property wrong format - no parameter or value. */
-		LOG_ERR("%s wrong format.", name);
-		ret = false;
+		break;
+	default:
+		break;
 	}
-
-	return ret;
 }
 
-static bool parse_datetime_props(const char *buf,
-				 const char *name,
-				 size_t name_size,
-				 char *value,
-				 size_t max_value_len)
+static void component_begin(struct icalendar_parser *ical)
 {
-	bool ret;
-	size_t unfold_size;
-	char ical_prop_buf[CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE + 1];
-
-	unfold_size = unfold_contentline(buf, ical_prop_buf);
-	if (unfold_size <= 0) {
-		/* Property wrong format - fail to unfold property. */
-		LOG_ERR("%s wrong format. Fail to unfold property", name);
-		return false;
+	if (!ical->icalobject_begin) {
+		if (token_equals(ical, "VCALENDAR", 9)) {
+			LOG_DBG("Found a calendar stream");
+			ical->icalobject_begin = true;
+		}
+		return;
 	}
 
-	if (ical_prop_buf[name_size] == ':') {
-		size_t value_len = unfold_size - name_size - 1;
-
-		if (value_len <= max_value_len) {
-			memcpy(value,
-				ical_prop_buf + name_size + 1,
-				value_len);
-			value[value_len] = '\0';
-			ret = true;
-		} else {
-			/* Property value overflow. */
-			LOG_ERR("%s value overflow.", name);
-			ret = false;
-		}
-	} else if (ical_prop_buf[name_size] == ';') {
-		char *dtvalue;
-
-		dtvalue = strchr(ical_prop_buf, ':');
-		if (dtvalue) {
-			dtvalue = dtvalue + 1;
-			size_t value_len;
-
-			value_len = unfold_size -
-					(dtvalue - ical_prop_buf);
-			if (value_len <= max_value_len) {
-				memcpy(value, dtvalue, value_len);
-				value[value_len] = '\0';
-				ret = true;
-			} else {
-				/* Property value overflow. */
-				LOG_ERR("%s value overflow.", name);
-				ret = false;
-			}
-		} else {
-			/* Property wrong format - no value. */
-			LOG_ERR("%s wrong format - no value.", name);
-			ret = false;
-		}
-	} else {
-		/* Property wrong format - no parameter or value. */
-		LOG_ERR("%s wrong format.", name);
-		ret = false;
+	if (ical->depth++ > 0) {
+		/* Subcomponent, such as VALARM or STANDARD */
+		return;
 	}
 
-	return ret;
+	ical->component = false;
+	for (size_t i = 0; i < ARRAY_SIZE(ical_components); i++) {
+		if (token_equals(ical, ical_components[i].name,
+				 strlen(ical_components[i].name))) {
+			memset(&ical->evt, 0, sizeof(ical->evt));
+			ical->evt.id = ical_components[i].id;
+			ical->evt.error = (ical->evt.id == ICAL_EVT_VEVENT) ?
+				ICAL_ERROR_NONE : ICAL_ERROR_COM_NOT_SUPPORTED;
+			ical->component = true;
+			break;
+		}
+	}
 }
 
-static size_t parse_calprops(const char *buf)
+/* Returns the value returned by the application, if an event is sent. */
+static int component_end(struct icalendar_parser *ical)
 {
-	const char *parsed = buf;
-	char *end = NULL;
-	char prop_value[CONFIG_ICAL_PARSER_MAX_PROPERTY_SIZE + 1];
-
-	parsed = strstr(parsed, "BEGIN:VCALENDAR\r\n");
-	if (parsed == NULL) {
+	if (ical->depth == 0) {
+		if (token_equals(ical, "VCALENDAR", 9)) {
+			ical->icalobject_begin = false;
+		}
 		return 0;
 	}
-	parsed += strlen("BEGIN:VCALENDAR\r\n");
 
-	end = strstr(parsed, "\r\nBEGIN:");
-	if (end == NULL) {
+	if (--ical->depth > 0 || !ical->component) {
 		return 0;
 	}
-	end += strlen("\r\n");
-
-	while (parsed < end) {
-		memset(prop_value, 0, sizeof(prop_value));
-		if (!strncmp(parsed, "PRODID", 6)) {
-			if (!parse_desc_props(parsed, "PRODID", 6,
-					prop_value, sizeof(prop_value))) {
-				LOG_ERR("Wrong PRODID");
-			}
-		} else if (!strncmp(parsed, "VERSION", 7)) {
-			if (!parse_desc_props(parsed, "VERSION", 7,
-					prop_value, sizeof(prop_value))) {
-				LOG_ERR("Wrong VERSION");
-			}
-		}
-		parsed = strstr(parsed, "\r\n");
-		parsed += strlen("\r\n");
-	}
 
-	return (parsed - buf);
+	ical->component = false;
+
+	return ical->callback(&ical->evt);
 }
 
-static size_t parse_eventprop(const char *buf,
-			      struct ical_parser_evt *evt)
+/* A content line, with its folds, has been received. */
+static int line_end(struct icalendar_parser *ical)
 {
-	const char *parsed = buf;
-	char *com_end;
+	const struct ical_prop_desc *desc = ical->prop;
 
-	if (strncmp(buf, "BEGIN:VEVENT\r\n", strlen("BEGIN:VEVENT\r\n"))) {
+	if (ical->state != ICAL_STATE_VALUE || !desc) {
+		/* Unknown property, or no value */
 		return 0;
 	}
 
-	com_end = strstr(buf, "END:VEVENT\r\n");
-	if (com_end == NULL) {
+	switch (desc->id) {
+	case ICAL_PROP_ID_BEGIN:
+		component_begin(ical);
 		return 0;
+	case ICAL_PROP_ID_END:
+		return component_end(ical);
+	default:
+		break;
 	}
 
-	evt->id = ICAL_EVT_VEVENT;
-	evt->error = ICAL_ERROR_NONE;
-	com_end += strlen("END:VEVENT\r\n");
-	while (parsed < com_end) {
-		if (!strncasecmp(parsed, "SUMMARY", 7)) {
-			if (!parse_desc_props(
-				parsed, "SUMMARY", 7,
-				evt->ical_com.summary,
-				CONFIG_ICAL_PARSER_SUMMARY_SIZE)) {
-				evt->error = ICAL_ERROR_SUMMARY;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed, "LOCATION", 8)) {
-			if (!parse_desc_props(
-				parsed, "LOCATION", 8,
-				evt->ical_com.location,
-				CONFIG_ICAL_PARSER_LOCATION_SIZE)) {
-				evt->error = ICAL_ERROR_LOCATION;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed, "DESCRIPTION", 11)) {
-			if (!parse_desc_props(
-				parsed, "DESCRIPTION", 11,
-				evt->ical_com.description,
-				CONFIG_ICAL_PARSER_DESCRIPTION_SIZE)) {
-				evt->error = ICAL_ERROR_DESCRIPTION;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed, "DTSTART", 7)) {
-			if (!parse_datetime_props(
-				parsed, "DTSTART", 7,
-				evt->ical_com.dtstart,
-				CONFIG_ICAL_PARSER_DTSTART_SIZE)) {
-				evt->error = ICAL_ERROR_DTSTART;
-				parsed = com_end;
-			}
-		} else if (!strncasecmp(parsed,
-					"DTEND", 5)) {
-			if (!parse_datetime_props(
-				parsed, "DTEND", 5,
-				evt->ical_com.dtend,
-				CONFIG_ICAL_PARSER_DTEND_SIZE)) {
-				evt->error = ICAL_ERROR_DTEND;
-				parsed = com_end;
-			}
-		}
-
-		/* Move parsed pointer to end of line break */
-		parsed = strstr(parsed, "\r\n") + 2;
+	if (!ical->value) {
+		return 0;
 	}
 
-	return parsed - buf;
-}
-
-static size_t parse_todoprop(const char *buf,
-				struct ical_parser_evt *evt)
-{
-	const char *parsed = buf;
-	char *com_end;
-
-	com_end = strstr(buf, "END:VTODO\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VTODO\r\n");
+	if (ical->overflow) {
+		LOG_ERR("%s value overflow.", desc->name);
+		ical->evt.error = desc->error;
+		ical->value[0] = '\0';
+	} else {
+		ical->value[ical->value_len] = '\0';
 	}
-	evt->id = ICAL_EVT_VTODO;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
 
-	return parsed - buf;
+	return 0;
 }
 
-static size_t parse_jourprop(const char *buf,
-				struct ical_parser_evt *evt)
+static void name_parse(struct icalendar_parser *ical, char c)
 {
-	const char *parsed = buf;
-	char *com_end;
-
-	com_end = strstr(buf, "END:VJOURNAL\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VJOURNAL\r\n");
+	switch (c) {
+	case ':':
+		ical->prop = prop_lookup(ical);
+		value_begin(ical);
+		ical->state = ICAL_STATE_VALUE;
+		break;
+	case ';':
+		ical->prop = prop_lookup(ical);
+		ical->quoted = false;
+		ical->state = ICAL_STATE_PARAM;
+		break;
+	default:
+		/* Names longer than the token never match */
+		if (ical->token_len < sizeof(ical->token)) {
+			ical->token[ical->token_len++] = c;
+		}
+		break;
 	}
-	evt->id = ICAL_EVT_VJOURNAL;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
-
-	return parsed - buf;
 }
 
-static size_t parse_fbprop(const char *buf, struct ical_parser_evt *evt)
+static void param_parse(struct icalendar_parser *ical, char c)
 {
-	const char *parsed = buf;
-	char *com_end;
-
-	com_end = strstr(buf, "END:VFREEBUSY\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VFREEBUSY\r\n");
+	/* Parameter values can contain ':' within quotes */
+	if (c == '"') {
+		ical->quoted = !ical->quoted;
+	} else if (c == ':' && !ical->quoted) {
+		value_begin(ical);
+		ical->state = ICAL_STATE_VALUE;
 	}
-	evt->id = ICAL_EVT_VFREEBUSY;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
-
-	return parsed - buf;
 }
 
-static size_t parse_tzprop(const char *buf, struct ical_parser_evt *evt)
+static void value_parse(struct icalendar_parser *ical, char c)
 {
-	const char *parsed = buf;
-	char *com_end;
+	const struct ical_prop_desc *desc = ical->prop;
 
-	com_end = strstr(buf, "END:VTIMEZONE\r\n");
-	if (com_end) {
-		parsed = com_end + strlen("END:VTIMEZONE\r\n");
+	if (desc && (desc->id == ICAL_PROP_ID_BEGIN ||
+		     desc->id == ICAL_PROP_ID_END)) {
+		if (ical->token_len < sizeof(ical->token)) {
+			ical->token[ical->token_len++] = c;
+		}
+		return;
 	}
-	evt->id = ICAL_EVT_VTIMEZONE;
-	evt->error = ICAL_ERROR_COM_NOT_SUPPORTED;
-
-	return parsed - buf;
-}
 
-static size_t parse_component(char *buf, struct ical_parser_evt *evt)
-{
-	char *com_begin = buf;
-	size_t ret = 0;
-
-	/* Search begin of component */
-	if (!strncmp(com_begin, "BEGIN:VEVENT\r\n", 14)) {
-		ret += parse_eventprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VTODO\r\n", 13)) {
-		ret += parse_todoprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VJOURNAL\r\n", 16)) {
-		ret += parse_jourprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VFREEBUSY\r\n", 17)) {
-		ret += parse_fbprop(com_begin, evt);
-	} else if (!strncmp(com_begin, "BEGIN:VTIMEZONE\r\n", 17)) {
-		ret += parse_tzprop(com_begin, evt);
+	if (!ical->value) {
+		return;
 	}
 
-	return ret;
+	if (ical->value_len < ical->value_size) {
+		ical->value[ical->value_len++] = c;
+	} else {
+		ical->overflow = true;
+	}
 }
 
-static size_t parse_icalbody(char *buf,
-				icalendar_parser_callback_t callback)
+size_t ical_parser_parse(struct icalendar_parser *ical,
+			const char *data, size_t len)
 {
-	size_t parsed_bytes = 0, parsed_offset = 0;
+	char c;
 
-	do {
-		struct ical_parser_evt evt;
+	for (size_t i = 0; i < len; i++) {
+		c = data[i];
 
-		parsed_bytes = parse_component(buf + parsed_offset, &evt);
-		parsed_offset += parsed_bytes;
-		if (parsed_bytes > 0) {
-			callback(&evt);
+		if (ical->state == ICAL_STATE_STOPPED) {
+			return i;
 		}
-	} while (parsed_bytes > 0);
 
-	return parsed_offset;
-}
+		if (ical->state == ICAL_STATE_LINE_START) {
+			if (c == ' ' || c == '\t') {
+				/* Folded line, the whitespace is dropped */
+				ical->state = ical->resume;
+				continue;
+			}
 
-size_t ical_parser_parse(struct icalendar_parser *ical,
-			const char *data, size_t len)
-{
-	size_t parsed_offset = 0;
+			ical->state = ical->resume;
+			if (line_end(ical)) {
+				LOG_DBG("Parsing stopped by the application");
+				ical->state = ICAL_STATE_STOPPED;
+				return i;
+			}
 
-	if (CONFIG_ICAL_PARSER_BUFFER_SIZE < (ical->offset + len)) {
-		return -ENOBUFS;
-	}
+			ical->prop = NULL;
+			ical->token_len = 0;
+			ical->state = ICAL_STATE_NAME;
+		}
 
-	memcpy(ical->buf + ical->offset, data, len);
-	ical->buf[ical->offset + len] = '\0';
+		if (c == '\r') {
+			continue;
+		}
 
-	/* Check begin of iCalendar object delimiter
-	 * Reference: RFC 5545 3.4 iCalendar Object
-	 */
-	if (!ical->icalobject_begin) {
-		/* The body of the iCalendar object consists of
-		 * a sequence of calendar properties and
-		 * one or more calendar components.
-		 *
-		 * Reference: RFC 5545 3.6 Calendar Components
-		 */
-		parsed_offset += parse_calprops(ical->buf);
-		if (parsed_offset > 0) {
-			LOG_DBG("Found a calendar stream");
-			ical->icalobject_begin = true;
+		if (c == '\n') {
+			ical->resume = ical->state;
+			ical->state = ICAL_STATE_LINE_START;
+			continue;
 		}
-	}
 
-	/* If we got a calendar property, start parsing calendar body. */
-	if (ical->icalobject_begin) {
-		parsed_offset += parse_icalbody(ical->buf + parsed_offset,
-						ical->callback);
+		switch (ical->state) {
+		case ICAL_STATE_NAME:
+			name_parse(ical, c);
+			break;
+		case ICAL_STATE_PARAM:
+			param_parse(ical, c);
+			break;
+		case ICAL_STATE_VALUE:
+			value_parse(ical, c);
+			break;
+		default:
+			break;
+		}
 	}
 
-	if (parsed_offset) {
-		ical->offset = ical->offset + len - parsed_offset;
-		memcpy(ical->buf, ical->buf + parsed_offset, ical->offset);
-	}
+	return len;
+}
 
-	return parsed_offset;
+void ical_parser_props_set(struct icalendar_parser *ical, uint32_t props)
+{
+	ical->props = props;
 }
 
 int ical_parser_init(struct icalendar_parser *ical,
@@ -419,9 +353,11 @@ int ical_parser_init(struct icalendar_parser *ical,
 		return -EINVAL;
 	}
 
+	memset(ical, 0, sizeof(*ical));
+
 	ical->callback = callback;
-	ical->icalobject_begin = false;
-	ical->offset = 0;
+	ical->props = ICAL_PROP_ALL;
+	ical->state = ICAL_STATE_NAME;
 
 	return 0;
 }
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef NRF_CLOUD_AGPS_CACHE_H_
+#define NRF_CLOUD_AGPS_CACHE_H_
+
+#include <zephyr.h>
+#include <drivers/gps.h>
+
+#include "nrf_cloud_agps_schema_v1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Callback used when iterating over valid cached A-GPS elements.
+ *
+ * @param element A-GPS element pointing into the cache storage.
+ *
+ * @return 0 to continue iterating, otherwise a (negative) error code that
+ *	   stops the iteration and is returned to the caller.
+ */
+typedef int (*agps_cache_element_cb_t)(struct nrf_cloud_apgs_element *element);
+
+/**@brief Initialize the A-GPS cache and load stored elements from settings.
+ *	  Subsequent calls have no effect.
+ *
+ * @return 0 if successful, otherwise a (negative) error code.
+ */
+int agps_cache_init(void);
+
+/**@brief Store an A-GPS element received from nRF Cloud in the cache.
+ *	  The element is persisted only if its content differs from what is
+ *	  already cached, to limit flash wear.
+ *
+ * @param element Parsed A-GPS element.
+ *
+ * @return 0 if successful, otherwise a (negative) error code.
+ */
+int agps_cache_store(const struct nrf_cloud_apgs_element *element);
+
+/**@brief Filter a list of A-GPS types, keeping only the types that are
+ *	  missing from the cache or have expired.
+ *
+ * @param types Array of types to filter. Filtered in place.
+ * @param type_count Number of types in the array.
+ *
+ * @return Number of types left in the array after filtering.
+ */
+size_t agps_cache_filter_types(enum gps_agps_type *types, size_t type_count);
+
+/**@brief Call a function for every valid element of the given types in the
+ *	  cache.
+ *
+ * @param types Array of types to iterate over, or NULL for all types.
+ * @param type_count Number of types in the array.
+ * @param cb Callback to call.
+ *
+ * @return 0 if successful, otherwise the first error returned by @p cb.
+ */
+int agps_cache_foreach(const enum gps_agps_type *types, size_t type_count,
+		       agps_cache_element_cb_t cb);
+
+/**@brief Invalidate all cached A-GPS data, both in RAM and in settings.
+ *
+ * @return 0 if successful, otherwise a (negative) error code.
+ */
+int agps_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF_CLOUD_AGPS_CACHE_H_ */
@@ -19,6 +19,7 @@ LOG_MODULE_REGISTER(nrf_cloud_agps, CONFIG_NRF_CLOUD_AGPS_LOG_LEVEL);
 
 #include "nrf_cloud_transport.h"
 #include "nrf_cloud_agps_schema_v1.h"
+#include "nrf_cloud_agps_cache.h"
 
 extern void agps_print(enum nrf_cloud_agps_type type, void *data);
 
@@ -69,6 +70,103 @@ static int type_array2str(enum gps_agps_type *types, size_t type_count,
 	return 0;
 }
 
+#if defined(CONFIG_NRF_CLOUD_AGPS_CACHE)
+/* Types that can be requested from nRF Cloud, used to build a partial request
+ * when some of the data is already available in the cache.
+ */
+static const enum gps_agps_type all_types[] = {
+	GPS_AGPS_UTC_PARAMETERS,
+	GPS_AGPS_EPHEMERIDES,
+	GPS_AGPS_ALMANAC,
+	GPS_AGPS_KLOBUCHAR_CORRECTION,
+	GPS_AGPS_GPS_SYSTEM_CLOCK_AND_TOWS,
+	GPS_AGPS_LOCATION,
+	GPS_AGPS_INTEGRITY,
+};
+
+static int select_target(const int *socket);
+static int agps_send_to_modem(struct nrf_cloud_apgs_element *agps_data);
+
+/* Inject the types of a request that are not in the filtered request from
+ * the cache, into the target of the last processed A-GPS data.
+ */
+static int cached_types_inject(const enum gps_agps_type *types,
+			       size_t type_count,
+			       const enum gps_agps_type *filtered,
+			       size_t filtered_count)
+{
+	enum gps_agps_type cached[ARRAY_SIZE(all_types)];
+	size_t count = 0;
+	int err;
+
+	for (size_t i = 0; i < type_count; i++) {
+		size_t j;
+
+		for (j = 0; j < filtered_count; j++) {
+			if (filtered[j] == types[i]) {
+				break;
+			}
+		}
+
+		if ((j == filtered_count) && (count < ARRAY_SIZE(cached))) {
+			cached[count++] = types[i];
+		}
+	}
+
+	err = select_target(((gps_dev == NULL) && (fd >= 0)) ? &fd : NULL);
+	if (err) {
+		return err;
+	}
+
+	return agps_cache_foreach(cached, count, agps_send_to_modem);
+}
+
+/* Remove types that are valid in the cache from the request, and inject them
+ * into the modem from the cache instead. The filtered list is written to
+ * 'filtered', and the number of types left is returned. If nothing could be
+ * filtered out, or the cached data could not be injected, the original
+ * request is left untouched.
+ */
+static size_t request_types_filter(enum gps_agps_type **types,
+				   size_t type_count,
+				   enum gps_agps_type *filtered,
+				   size_t filtered_len)
+{
+	int err;
+	size_t count;
+	const enum gps_agps_type *src = *types;
+
+	if ((src == NULL) || (type_count == 0)) {
+		src = all_types;
+		type_count = ARRAY_SIZE(all_types);
+	}
+
+	if ((agps_cache_init() != 0) || (type_count > filtered_len)) {
+		return type_count;
+	}
+
+	memcpy(filtered, src, type_count * sizeof(*src));
+
+	count = agps_cache_filter_types(filtered, type_count);
+	if (count == type_count) {
+		return type_count;
+	}
+
+	LOG_DBG("%d of %d A-GPS types are cached", type_count - count,
+		type_count);
+
+	err = cached_types_inject(src, type_count, filtered, count);
+	if (err) {
+		LOG_WRN("Failed to inject cached A-GPS data, error: %d", err);
+		return type_count;
+	}
+
+	*types = filtered;
+
+	return count;
+}
+#endif /* defined(CONFIG_NRF_CLOUD_AGPS_CACHE) */
+
 int nrf_cloud_agps_request(enum gps_agps_type *types, size_t type_count)
 {
 	int err, len;
@@ -84,6 +182,23 @@ int nrf_cloud_agps_request(enum gps_agps_type *types, size_t type_count)
 		return -EINVAL;
 	}
 
+#if defined(CONFIG_NRF_CLOUD_AGPS_CACHE)
+	enum gps_agps_type filtered[ARRAY_SIZE(all_types)];
+	enum gps_agps_type *requested = types;
+	size_t count = request_types_filter(&requested, type_count,
+					    filtered, ARRAY_SIZE(filtered));
+
+	if (count == 0) {
+		LOG_DBG("All requested A-GPS data injected from the cache");
+		return 0;
+	}
+
+	if (requested != types) {
+		types = requested;
+		type_count = count;
+	}
+#endif
+
 	err = modem_info_init();
 	if (err) {
 		LOG_ERR("Could not initialize modem info module");
@@ -488,6 +603,24 @@ static size_t get_next_agps_element(struct nrf_cloud_apgs_element *element,
 	return len;
 }
 
+static int select_target(const int *socket)
+{
+	if (socket) {
+		LOG_DBG("Using user-provided socket, fd %d", *socket);
+
+		gps_dev = NULL;
+		fd = *socket;
+	} else if (gps_dev == NULL) {
+		gps_dev = device_get_binding("NRF9160_GPS");
+		if (gps_dev == NULL) {
+			LOG_ERR("GPS is not enabled, A-GPS data unhandled");
+			return -ENODEV;
+		}
+	}
+
+	return 0;
+}
+
 int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 {
 	int err;
@@ -505,19 +638,18 @@ int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 	LOG_DBG("Receievd AGPS data. Schema version: %d, length: %d",
 		version, buf_len);
 
-	if (socket) {
-		LOG_DBG("Using user-provided socket, fd %d", fd);
-
-		gps_dev = NULL;
-		fd = *socket;
-	} else if (gps_dev == NULL) {
-		gps_dev = device_get_binding("NRF9160_GPS");
-		if (gps_dev == NULL) {
-			LOG_ERR("GPS is not enabled, A-GPS response unhandled");
-			return -ENODEV;
+	if (IS_ENABLED(CONFIG_NRF_CLOUD_AGPS_CACHE)) {
+		err = agps_cache_init();
+		if (err) {
+			LOG_WRN("A-GPS cache unavailable, error: %d", err);
 		}
 	}
 
+	err = select_target(socket);
+	if (err) {
+		return err;
+	}
+
 	while (parsed_len < buf_len) {
 		size_t element_size =
 			get_next_agps_element(&element, &buf[parsed_len]);
@@ -552,7 +684,47 @@ int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 			LOG_ERR("Failed to send data to modem, error: %d", err);
 			return err;
 		}
+
+		if (IS_ENABLED(CONFIG_NRF_CLOUD_AGPS_CACHE)) {
+			err = agps_cache_store(&element);
+			if (err) {
+				LOG_WRN("Failed to cache A-GPS data, error: %d",
+					err);
+			}
+		}
 	}
 
 	return 0;
 }
+
+#if defined(CONFIG_NRF_CLOUD_AGPS_CACHE)
+int nrf_cloud_agps_cache_inject(const int *socket)
+{
+	int err;
+
+	err = agps_cache_init();
+	if (err) {
+		return err;
+	}
+
+	err = select_target(socket);
+	if (err) {
+		return err;
+	}
+
+	LOG_DBG("Injecting cached A-GPS data");
+
+	return agps_cache_foreach(NULL, 0, agps_send_to_modem);
+}
+
+int nrf_cloud_agps_cache_clear(void)
+{
+	int err = agps_cache_init();
+
+	if (err) {
+		return err;
+	}
+
+	return agps_cache_clear();
+}
+#endif /* defined(CONFIG_NRF_CLOUD_AGPS_CACHE) */
@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <date_time.h>
+#include <settings/settings.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(nrf_cloud_agps_cache, CONFIG_NRF_CLOUD_AGPS_LOG_LEVEL);
+
+#include "nrf_cloud_agps_cache.h"
+
+#define MODULE			"agps"
+#define KEY_EPHEMERIS		"eph"
+#define KEY_ALMANAC		"alm"
+#define KEY_UTC			"utc"
+#define KEY_KLOBUCHAR		"klob"
+
+/* "agps/eph/32" and similar, including null-terminator. */
+#define KEY_MAX_LEN		(sizeof(MODULE "/" KEY_KLOBUCHAR "/32"))
+
+#define MSEC_PER_MIN		(60LL * MSEC_PER_SEC)
+#define MSEC_PER_DAY		(24LL * 60LL * MSEC_PER_MIN)
+
+#define EPHEMERIS_VALIDITY_MS	\
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_EPHEMERIS_VALIDITY * MSEC_PER_MIN)
+#define ALMANAC_VALIDITY_MS	\
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_ALMANAC_VALIDITY * MSEC_PER_DAY)
+#define UTC_VALIDITY_MS		\
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_UTC_VALIDITY * MSEC_PER_DAY)
+#define KLOBUCHAR_VALIDITY_MS	\
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_KLOBUCHAR_VALIDITY * MSEC_PER_MIN)
+
+/* Each cached element is stored together with the UTC time, in
+ * milliseconds, at which it was received. A timestamp of zero marks an
+ * empty slot.
+ */
+struct cached_ephemeris {
+	int64_t stored_ms;
+	struct nrf_cloud_agps_ephemeris data;
+} __packed;
+
+struct cached_almanac {
+	int64_t stored_ms;
+	struct nrf_cloud_agps_almanac data;
+} __packed;
+
+struct cached_utc {
+	int64_t stored_ms;
+	struct nrf_cloud_agps_utc data;
+} __packed;
+
+struct cached_klobuchar {
+	int64_t stored_ms;
+	struct nrf_cloud_agps_klobuchar data;
+} __packed;
+
+static struct {
+	struct cached_ephemeris ephemeris[NRF_CLOUD_AGPS_MAX_SV_TOW];
+	struct cached_almanac almanac[NRF_CLOUD_AGPS_MAX_SV_TOW];
+	struct cached_utc utc;
+	struct cached_klobuchar klobuchar;
+} cache;
+
+static bool initialized;
+
+static K_MUTEX_DEFINE(cache_lock);
+
+static int64_t time_now(void)
+{
+	int64_t now;
+
+	if (date_time_now(&now)) {
+		return 0;
+	}
+
+	return now;
+}
+
+static bool is_valid(int64_t stored_ms, int64_t validity_ms, int64_t now)
+{
+	if ((stored_ms == 0) || (now == 0)) {
+		return false;
+	}
+
+	return (now - stored_ms) < validity_ms;
+}
+
+static int save(const char *type, int sv, const void *value, size_t len)
+{
+	char key[KEY_MAX_LEN];
+	int err;
+
+	if (sv > 0) {
+		snprintk(key, sizeof(key), MODULE "/%s/%d", type, sv);
+	} else {
+		snprintk(key, sizeof(key), MODULE "/%s", type);
+	}
+
+	if (value) {
+		err = settings_save_one(key, value, len);
+	} else {
+		err = settings_delete(key);
+	}
+
+	if (err) {
+		LOG_ERR("Failed to update %s in settings, error: %d", key, err);
+	}
+
+	return err;
+}
+
+static int read_entry(void *dst, size_t dst_len, size_t len,
+		      settings_read_cb read_cb, void *cb_arg)
+{
+	ssize_t rc;
+
+	if (len != dst_len) {
+		/* Stale layout, ignore the entry. */
+		return 0;
+	}
+
+	rc = read_cb(cb_arg, dst, dst_len);
+	if (rc != dst_len) {
+		LOG_ERR("Failed to read cached A-GPS entry");
+		memset(dst, 0, dst_len);
+		return rc < 0 ? rc : -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Function used by settings_load() to restore the cache.
+ *	  See the Zephyr documentation of the settings subsystem for more
+ *	  information.
+ */
+static int settings_set(const char *key, size_t len,
+			settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	int type_len;
+	int sv;
+
+	if (settings_name_steq(key, KEY_UTC, NULL)) {
+		return read_entry(&cache.utc, sizeof(cache.utc), len,
+				  read_cb, cb_arg);
+	}
+
+	if (settings_name_steq(key, KEY_KLOBUCHAR, NULL)) {
+		return read_entry(&cache.klobuchar, sizeof(cache.klobuchar),
+				  len, read_cb, cb_arg);
+	}
+
+	type_len = settings_name_next(key, &next);
+	if (next == NULL) {
+		return 0;
+	}
+
+	sv = atoi(next);
+	if ((sv < 1) || (sv > NRF_CLOUD_AGPS_MAX_SV_TOW)) {
+		return 0;
+	}
+
+	if ((type_len == strlen(KEY_EPHEMERIS)) &&
+	    !strncmp(key, KEY_EPHEMERIS, type_len)) {
+		return read_entry(&cache.ephemeris[sv - 1],
+				  sizeof(cache.ephemeris[0]), len,
+				  read_cb, cb_arg);
+	}
+
+	if ((type_len == strlen(KEY_ALMANAC)) &&
+	    !strncmp(key, KEY_ALMANAC, type_len)) {
+		return read_entry(&cache.almanac[sv - 1],
+				  sizeof(cache.almanac[0]), len,
+				  read_cb, cb_arg);
+	}
+
+	return 0;
+}
+
+int agps_cache_init(void)
+{
+	int err;
+	static struct settings_handler sh = {
+		.name = MODULE,
+		.h_set = settings_set,
+	};
+
+	if (initialized) {
+		return 0;
+	}
+
+	/* settings_subsys_init is idempotent so this is safe to do. */
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("settings_subsys_init failed (err %d)", err);
+		return err;
+	}
+
+	err = settings_register(&sh);
+	if (err) {
+		LOG_ERR("Cannot register settings (err %d)", err);
+		return err;
+	}
+
+	err = settings_load_subtree(MODULE);
+	if (err) {
+		LOG_ERR("Cannot load settings (err %d)", err);
+		return err;
+	}
+
+	initialized = true;
+
+	return 0;
+}
+
+/* Drop the expired entries of an array of per-SV entries, each starting with
+ * the timestamp. Called when new data of the same type is received, so that
+ * an SV that is no longer part of the assistance data set is requested once,
+ * and then forgotten.
+ */
+static void sv_array_expire(void *array, size_t entry_size, const char *key,
+			    int64_t validity_ms, int64_t now)
+{
+	for (size_t i = 0; i < NRF_CLOUD_AGPS_MAX_SV_TOW; i++) {
+		uint8_t *entry = (uint8_t *)array + i * entry_size;
+		int64_t stored_ms;
+
+		memcpy(&stored_ms, entry, sizeof(stored_ms));
+
+		if ((stored_ms == 0) || is_valid(stored_ms, validity_ms, now)) {
+			continue;
+		}
+
+		memset(entry, 0, entry_size);
+		(void)save(key, i + 1, NULL, 0);
+	}
+}
+
+int agps_cache_store(const struct nrf_cloud_apgs_element *element)
+{
+	int err = 0;
+	int64_t now = time_now();
+
+	if (now == 0) {
+		/* Without a valid time, the validity window can not be
+		 * tracked across resets.
+		 */
+		LOG_DBG("Time not known, A-GPS element not cached");
+		return 0;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	switch (element->type) {
+	case NRF_CLOUD_AGPS_EPHEMERIDES: {
+		uint8_t sv = element->ephemeris->sv_id;
+		struct cached_ephemeris *entry;
+
+		if ((sv < 1) || (sv > NRF_CLOUD_AGPS_MAX_SV_TOW)) {
+			err = -EINVAL;
+			break;
+		}
+
+		sv_array_expire(cache.ephemeris, sizeof(cache.ephemeris[0]),
+				KEY_EPHEMERIS, EPHEMERIS_VALIDITY_MS, now);
+
+		entry = &cache.ephemeris[sv - 1];
+
+		/* Identical data does not extend the validity window. */
+		if ((entry->stored_ms != 0) &&
+		    !memcmp(&entry->data, element->ephemeris,
+			    sizeof(entry->data))) {
+			break;
+		}
+
+		entry->stored_ms = now;
+		memcpy(&entry->data, element->ephemeris, sizeof(entry->data));
+		err = save(KEY_EPHEMERIS, sv, entry, sizeof(*entry));
+		break;
+	}
+	case NRF_CLOUD_AGPS_ALMANAC: {
+		uint8_t sv = element->almanac->sv_id;
+		struct cached_almanac *entry;
+
+		if ((sv < 1) || (sv > NRF_CLOUD_AGPS_MAX_SV_TOW)) {
+			err = -EINVAL;
+			break;
+		}
+
+		sv_array_expire(cache.almanac, sizeof(cache.almanac[0]),
+				KEY_ALMANAC, ALMANAC_VALIDITY_MS, now);
+
+		entry = &cache.almanac[sv - 1];
+
+		if ((entry->stored_ms != 0) &&
+		    !memcmp(&entry->data, element->almanac,
+			    sizeof(entry->data))) {
+			break;
+		}
+
+		entry->stored_ms = now;
+		memcpy(&entry->data, element->almanac, sizeof(entry->data));
+		err = save(KEY_ALMANAC, sv, entry, sizeof(*entry));
+		break;
+	}
+	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
+		if ((cache.utc.stored_ms != 0) &&
+		    !memcmp(&cache.utc.data, element->utc,
+			    sizeof(cache.utc.data))) {
+			break;
+		}
+
+		cache.utc.stored_ms = now;
+		memcpy(&cache.utc.data, element->utc, sizeof(cache.utc.data));
+		err = save(KEY_UTC, 0, &cache.utc, sizeof(cache.utc));
+		break;
+	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
+		if ((cache.klobuchar.stored_ms != 0) &&
+		    !memcmp(&cache.klobuchar.data,
+			    element->ion_correction.klobuchar,
+			    sizeof(cache.klobuchar.data))) {
+			break;
+		}
+
+		cache.klobuchar.stored_ms = now;
+		memcpy(&cache.klobuchar.data, element->ion_correction.klobuchar,
+		       sizeof(cache.klobuchar.data));
+		err = save(KEY_KLOBUCHAR, 0, &cache.klobuchar,
+			   sizeof(cache.klobuchar));
+		break;
+	default:
+		/* System time, location and integrity data are only useful
+		 * when fresh and are always requested from nRF Cloud.
+		 */
+		break;
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return err;
+}
+
+/* Check validity of an array of per-SV entries, each starting with the
+ * timestamp. The type is reported as needed if any entry expired, or if no
+ * valid entries are left. Expired entries are kept until new data of the
+ * type is received.
+ */
+static bool sv_array_needed(const void *array, size_t entry_size,
+			    int64_t validity_ms, int64_t now)
+{
+	size_t valid = 0;
+
+	for (size_t i = 0; i < NRF_CLOUD_AGPS_MAX_SV_TOW; i++) {
+		const uint8_t *entry = (const uint8_t *)array + i * entry_size;
+		int64_t stored_ms;
+
+		memcpy(&stored_ms, entry, sizeof(stored_ms));
+
+		if (stored_ms == 0) {
+			continue;
+		}
+
+		if (!is_valid(stored_ms, validity_ms, now)) {
+			return true;
+		}
+
+		valid++;
+	}
+
+	return valid == 0;
+}
+
+static bool type_needed(enum gps_agps_type type, int64_t now)
+{
+	switch (type) {
+	case GPS_AGPS_EPHEMERIDES:
+		return sv_array_needed(cache.ephemeris,
+				       sizeof(cache.ephemeris[0]),
+				       EPHEMERIS_VALIDITY_MS, now);
+	case GPS_AGPS_ALMANAC:
+		return sv_array_needed(cache.almanac,
+				       sizeof(cache.almanac[0]),
+				       ALMANAC_VALIDITY_MS, now);
+	case GPS_AGPS_UTC_PARAMETERS:
+		return !is_valid(cache.utc.stored_ms, UTC_VALIDITY_MS, now);
+	case GPS_AGPS_KLOBUCHAR_CORRECTION:
+		return !is_valid(cache.klobuchar.stored_ms,
+				 KLOBUCHAR_VALIDITY_MS, now);
+	default:
+		return true;
+	}
+}
+
+size_t agps_cache_filter_types(enum gps_agps_type *types, size_t type_count)
+{
+	size_t count = 0;
+	int64_t now = time_now();
+
+	if (now == 0) {
+		LOG_DBG("Time not known, cache validity can not be checked");
+		return type_count;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	for (size_t i = 0; i < type_count; i++) {
+		if (type_needed(types[i], now)) {
+			types[count++] = types[i];
+		} else {
+			LOG_DBG("A-GPS type %d is cached and valid", types[i]);
+		}
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return count;
+}
+
+static bool type_selected(const enum gps_agps_type *types, size_t type_count,
+			  enum gps_agps_type type)
+{
+	if (types == NULL) {
+		return true;
+	}
+
+	for (size_t i = 0; i < type_count; i++) {
+		if (types[i] == type) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int agps_cache_foreach(const enum gps_agps_type *types, size_t type_count,
+		       agps_cache_element_cb_t cb)
+{
+	int err = 0;
+	int64_t now = time_now();
+	struct nrf_cloud_apgs_element element;
+
+	if (now == 0) {
+		return 0;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	if (type_selected(types, type_count, GPS_AGPS_UTC_PARAMETERS) &&
+	    is_valid(cache.utc.stored_ms, UTC_VALIDITY_MS, now)) {
+		element.type = NRF_CLOUD_AGPS_UTC_PARAMETERS;
+		element.utc = &cache.utc.data;
+
+		err = cb(&element);
+		if (err) {
+			goto exit;
+		}
+	}
+
+	if (type_selected(types, type_count, GPS_AGPS_KLOBUCHAR_CORRECTION) &&
+	    is_valid(cache.klobuchar.stored_ms, KLOBUCHAR_VALIDITY_MS, now)) {
+		element.type = NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION;
+		element.ion_correction.klobuchar = &cache.klobuchar.data;
+
+		err = cb(&element);
+		if (err) {
+			goto exit;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache.almanac); i++) {
+		if (!type_selected(types, type_count, GPS_AGPS_ALMANAC) ||
+		    !is_valid(cache.almanac[i].stored_ms, ALMANAC_VALIDITY_MS,
+			      now)) {
+			continue;
+		}
+
+		element.type = NRF_CLOUD_AGPS_ALMANAC;
+		element.almanac = &cache.almanac[i].data;
+
+		err = cb(&element);
+		if (err) {
+			goto exit;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache.ephemeris); i++) {
+		if (!type_selected(types, type_count, GPS_AGPS_EPHEMERIDES) ||
+		    !is_valid(cache.ephemeris[i].stored_ms,
+			      EPHEMERIS_VALIDITY_MS, now)) {
+			continue;
+		}
+
+		element.type = NRF_CLOUD_AGPS_EPHEMERIDES;
+		element.ephemeris = &cache.ephemeris[i].data;
+
+		err = cb(&element);
+		if (err) {
+			goto exit;
+		}
+	}
+
+exit:
+	k_mutex_unlock(&cache_lock);
+
+	return err;
+}
+
+int agps_cache_clear(void)
+{
+	int err;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	memset(&cache, 0, sizeof(cache));
+
+	err = save(KEY_UTC, 0, NULL, 0);
+	err = save(KEY_KLOBUCHAR, 0, NULL, 0) ?: err;
+
+	for (int sv = 1; sv <= NRF_CLOUD_AGPS_MAX_SV_TOW; sv++) {
+		err = save(KEY_EPHEMERIS, sv, NULL, 0) ?: err;
+		err = save(KEY_ALMANAC, sv, NULL, 0) ?: err;
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return err;
+}
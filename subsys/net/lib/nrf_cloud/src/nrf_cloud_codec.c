@@ -13,6 +13,7 @@
 #include <logging/log.h>
 #include "cJSON.h"
 #include "cJSON_os.h"
+#include <json_writer.h>
 
 LOG_MODULE_REGISTER(nrf_cloud_codec, CONFIG_NRF_CLOUD_LOG_LEVEL);
 
@@ -41,28 +42,60 @@ static int json_add_obj(cJSON *parent, const char *str, cJSON *item)
 	return 0;
 }
 
-static int json_add_str(cJSON *parent, const char *str, const char *item)
+/* Encode a message with the streaming JSON writer. */
+typedef void (*json_encoder_t)(struct json_writer *writer, const void *ctx);
+
+struct json_encoding {
+	json_encoder_t encode;
+	const void *ctx;
+};
+
+static int json_encode_pass(char *buf, size_t size, const void *ctx)
 {
-	cJSON *json_str;
+	const struct json_encoding *encoding = ctx;
+	struct json_writer writer;
 
-	json_str = cJSON_CreateString(item);
-	if (json_str == NULL) {
-		return -ENOMEM;
-	}
+	json_writer_init(&writer, buf, size);
+	encoding->encode(&writer, encoding->ctx);
 
-	return json_add_obj(parent, str, json_str);
+	return json_writer_finish(&writer);
 }
 
-static int json_add_null(cJSON *parent, const char *str)
+static void *json_alloc(size_t size)
 {
-	cJSON *json_null;
+	return nrf_cloud_malloc(size);
+}
 
-	json_null = cJSON_CreateNull();
-	if (json_null == NULL) {
-		return -ENOMEM;
+static void json_free(void *ptr)
+{
+	nrf_cloud_free(ptr);
+}
+
+static const struct json_writer_allocator json_allocator = {
+	.alloc = json_alloc,
+	.free = json_free,
+};
+
+static int json_encode_alloc(json_encoder_t encode, const void *ctx,
+			     struct nrf_cloud_data *output)
+{
+	struct json_encoding encoding = {
+		.encode = encode,
+		.ctx = ctx,
+	};
+	char *buffer;
+	int len;
+
+	len = json_writer_encode_alloc(json_encode_pass, &encoding,
+				       &json_allocator, &buffer);
+	if (len < 0) {
+		return len;
 	}
 
-	return json_add_obj(parent, str, json_null);
+	output->ptr = buffer;
+	output->len = len;
+
+	return 0;
 }
 
 static cJSON *json_object_decode(cJSON *obj, const char *str)
@@ -161,42 +194,43 @@ int nrf_cloud_encode_shadow_data(const struct nrf_cloud_sensor_data *sensor,
 	return 0;
 }
 
+static void sensor_data_encode(struct json_writer *writer, const void *ctx)
+{
+	const struct nrf_cloud_sensor_data *sensor = ctx;
+
+	json_writer_obj_start(writer, NULL);
+	json_writer_str(writer, "appId", sensor_type_str[sensor->type]);
+	json_writer_str(writer, "data", sensor->data.ptr);
+	json_writer_str(writer, "messageType", "DATA");
+	json_writer_obj_end(writer);
+}
+
 int nrf_cloud_encode_sensor_data(const struct nrf_cloud_sensor_data *sensor,
 				 struct nrf_cloud_data *output)
 {
-	int ret;
-
 	__ASSERT_NO_MSG(sensor != NULL);
 	__ASSERT_NO_MSG(sensor->data.ptr != NULL);
 	__ASSERT_NO_MSG(sensor->data.len != 0);
 	__ASSERT_NO_MSG(output != NULL);
 
-	cJSON *root_obj = cJSON_CreateObject();
-
-	if (root_obj == NULL) {
-		return -ENOMEM;
-	}
-
-	ret = json_add_str(root_obj, "appId", sensor_type_str[sensor->type]);
-	ret += json_add_str(root_obj, "data", sensor->data.ptr);
-	ret += json_add_str(root_obj, "messageType", "DATA");
-
-	if (ret != 0) {
-		cJSON_Delete(root_obj);
-		return -ENOMEM;
-	}
-
-	char *buffer;
-
-	buffer = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
-
-	output->ptr = buffer;
-	output->len = strlen(buffer);
-
-	return 0;
+	return json_encode_alloc(sensor_data_encode, sensor, output);
 }
 
+/* Values that the requested state is decoded from. On initial pairing, a
+ * shadow delta event is sent which does not include the "desired" key,
+ * "state" is used instead.
+ */
+enum requested_state_item {
+	RS_STATE,
+	RS_STATE_TOPIC_PREFIX,
+	RS_STATE_PAIRING_STATE,
+	RS_STATE_CONFIG,
+	RS_DESIRED_TOPIC_PREFIX,
+	RS_DESIRED_PAIRING_STATE,
+	RS_DESIRED_CONFIG,
+	RS_COUNT
+};
+
 int nrf_cloud_decode_requested_state(const struct nrf_cloud_data *input,
 				     enum nfsm_state *requested_state)
 {
@@ -205,54 +239,63 @@ int nrf_cloud_decode_requested_state(const struct nrf_cloud_data *input,
 	__ASSERT_NO_MSG(input->ptr != NULL);
 	__ASSERT_NO_MSG(input->len != 0);
 
-	cJSON *root_obj;
-	cJSON *desired_obj;
-	cJSON *pairing_obj;
-	cJSON *pairing_state_obj;
-	cJSON *topic_prefix_obj;
-
-	root_obj = cJSON_Parse(input->ptr);
-	if (root_obj == NULL) {
-		LOG_ERR("cJSON_Parse failed: %s",
+	/* The shadow can be several kilobytes, so only the needed values are
+	 * located instead of parsing the whole document into a tree.
+	 */
+	struct cJSON_QueryItem items[RS_COUNT] = {
+		[RS_STATE] = { .path = "state" },
+		[RS_STATE_TOPIC_PREFIX] = {
+			.path = "state.nrfcloud_mqtt_topic_prefix" },
+		[RS_STATE_PAIRING_STATE] = { .path = "state.pairing.state" },
+		[RS_STATE_CONFIG] = { .path = "state.config" },
+		[RS_DESIRED_TOPIC_PREFIX] = {
+			.path = "desired.nrfcloud_mqtt_topic_prefix" },
+		[RS_DESIRED_PAIRING_STATE] = { .path = "desired.pairing.state" },
+		[RS_DESIRED_CONFIG] = { .path = "desired.config" },
+	};
+	const struct cJSON_QueryItem *topic_prefix;
+	const struct cJSON_QueryItem *pairing_state;
+	const struct cJSON_QueryItem *config;
+
+	if (cJSON_Query(input->ptr, input->len, items, RS_COUNT) < 0) {
+		LOG_ERR("cJSON_Query failed: %s",
 			log_strdup((char *)input->ptr));
 		return -ENOENT;
 	}
 
-	nrf_cloud_decode_desired_obj(root_obj, &desired_obj);
+	if (items[RS_STATE].type != cJSON_Invalid) {
+		topic_prefix = &items[RS_STATE_TOPIC_PREFIX];
+		pairing_state = &items[RS_STATE_PAIRING_STATE];
+		config = &items[RS_STATE_CONFIG];
+	} else {
+		topic_prefix = &items[RS_DESIRED_TOPIC_PREFIX];
+		pairing_state = &items[RS_DESIRED_PAIRING_STATE];
+		config = &items[RS_DESIRED_CONFIG];
+	}
 
-	topic_prefix_obj =
-		json_object_decode(desired_obj, "nrfcloud_mqtt_topic_prefix");
-	if (topic_prefix_obj != NULL) {
+	if (topic_prefix->type != cJSON_Invalid) {
 		(*requested_state) = STATE_UA_PIN_COMPLETE;
-		cJSON_Delete(root_obj);
 		return 0;
 	}
 
-	pairing_obj = json_object_decode(desired_obj, "pairing");
-	pairing_state_obj = json_object_decode(pairing_obj, "state");
-
-	if (!pairing_state_obj || pairing_state_obj->type != cJSON_String) {
-		if (cJSON_HasObjectItem(desired_obj, "config") == false) {
+	if (pairing_state->type != cJSON_String) {
+		if (config->type == cJSON_Invalid) {
 			LOG_WRN("Unhandled data received from nRF Cloud.");
 			LOG_INF("Ensure device firmware is up to date.");
 			LOG_INF("Delete and re-add device to nRF Cloud if problem persists.");
 		}
-		cJSON_Delete(root_obj);
 		return -ENOENT;
 	}
 
-	const char *state_str = pairing_state_obj->valuestring;
-
-	if (compare(state_str, DUA_PIN_STR)) {
+	if ((pairing_state->value_len >= strlen(DUA_PIN_STR)) &&
+	    (strncmp(pairing_state->value, DUA_PIN_STR,
+		     strlen(DUA_PIN_STR)) == 0)) {
 		(*requested_state) = STATE_UA_PIN_WAIT;
 	} else {
 		LOG_ERR("Deprecated state. Delete device from nRF Cloud and update device with JITP certificates.");
-		cJSON_Delete(root_obj);
 		return -ENOTSUP;
 	}
 
-	cJSON_Delete(root_obj);
-
 	return 0;
 }
 
@@ -338,39 +381,24 @@ int nrf_cloud_encode_config_response(struct nrf_cloud_data const *const input,
 	return 0;
 }
 
-int nrf_cloud_encode_state(uint32_t reported_state, struct nrf_cloud_data *output)
+static void state_encode(struct json_writer *writer, const void *ctx)
 {
-	int ret;
-
-	__ASSERT_NO_MSG(output != NULL);
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *state_obj = cJSON_CreateObject();
-	cJSON *reported_obj = cJSON_CreateObject();
-	cJSON *pairing_obj = cJSON_CreateObject();
-
-	if ((root_obj == NULL) || (state_obj == NULL) ||
-	    (reported_obj == NULL) || (pairing_obj == NULL)) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(pairing_obj);
-
-		return -ENOMEM;
-	}
-
-	ret = 0;
-
-	switch (reported_state) {
-	case STATE_UA_PIN_WAIT: {
-		ret += json_add_str(pairing_obj, "state", DUA_PIN_STR);
-		ret += json_add_null(pairing_obj, "topics");
-		ret += json_add_null(pairing_obj, "config");
-		ret += json_add_null(reported_obj, "stage");
-		ret += json_add_null(reported_obj,
-				     "nrfcloud_mqtt_topic_prefix");
+	const uint32_t *reported_state = ctx;
+
+	json_writer_obj_start(writer, NULL);
+	json_writer_obj_start(writer, "state");
+	json_writer_obj_start(writer, "reported");
+
+	switch (*reported_state) {
+	case STATE_UA_PIN_WAIT:
+		json_writer_null(writer, "stage");
+		json_writer_null(writer, "nrfcloud_mqtt_topic_prefix");
+		json_writer_obj_start(writer, "pairing");
+		json_writer_str(writer, "state", DUA_PIN_STR);
+		json_writer_null(writer, "topics");
+		json_writer_null(writer, "config");
+		json_writer_obj_end(writer);
 		break;
-	}
 	case STATE_UA_PIN_COMPLETE: {
 		struct nrf_cloud_data rx_endp;
 		struct nrf_cloud_data tx_endp;
@@ -378,70 +406,42 @@ int nrf_cloud_encode_state(uint32_t reported_state, struct nrf_cloud_data *outpu
 
 		/* Get the endpoint information. */
 		nct_dc_endpoint_get(&tx_endp, &rx_endp, &m_endp);
-		ret += json_add_str(reported_obj, "nrfcloud_mqtt_topic_prefix",
-				    m_endp.ptr);
-
-		/* Clear pairing config and pairingStatus fields. */
-		ret += json_add_str(pairing_obj, "state", PAIRED_STR);
-		ret += json_add_null(pairing_obj, "config");
-		ret += json_add_null(reported_obj, "pairingStatus");
-
-		/* Report pairing topics. */
-		cJSON *topics_obj = cJSON_CreateObject();
-
-		if (topics_obj == NULL) {
-			cJSON_Delete(root_obj);
-			cJSON_Delete(state_obj);
-			cJSON_Delete(reported_obj);
-			cJSON_Delete(pairing_obj);
-
-			return -ENOMEM;
-		}
-
-		ret += json_add_str(topics_obj, "d2c", tx_endp.ptr);
-		ret += json_add_str(topics_obj, "c2d", rx_endp.ptr);
-		ret += json_add_obj(pairing_obj, "topics", topics_obj);
-
-		if (ret != 0) {
-			cJSON_Delete(topics_obj);
-		}
+		json_writer_str(writer, "nrfcloud_mqtt_topic_prefix",
+				m_endp.ptr);
+
+		/* Clear pairingStatus field. */
+		json_writer_null(writer, "pairingStatus");
+
+		/* Clear pairing config and report pairing topics. */
+		json_writer_obj_start(writer, "pairing");
+		json_writer_str(writer, "state", PAIRED_STR);
+		json_writer_null(writer, "config");
+		json_writer_obj_start(writer, "topics");
+		json_writer_str(writer, "d2c", tx_endp.ptr);
+		json_writer_str(writer, "c2d", rx_endp.ptr);
+		json_writer_obj_end(writer);
+		json_writer_obj_end(writer);
 		break;
 	}
-	default: {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(pairing_obj);
-		return -ENOTSUP;
-	}
-	}
-
-	ret += json_add_obj(reported_obj, "pairing", pairing_obj);
-	ret += json_add_obj(state_obj, "reported", reported_obj);
-	ret += json_add_obj(root_obj, "state", state_obj);
-
-	if (ret != 0) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(pairing_obj);
-
-		return -ENOMEM;
+	default:
+		break;
 	}
 
-	char *buffer;
+	json_writer_obj_end(writer);
+	json_writer_obj_end(writer);
+	json_writer_obj_end(writer);
+}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
+int nrf_cloud_encode_state(uint32_t reported_state, struct nrf_cloud_data *output)
+{
+	__ASSERT_NO_MSG(output != NULL);
 
-	if (buffer == NULL) {
-		return -ENOMEM;
+	if ((reported_state != STATE_UA_PIN_WAIT) &&
+	    (reported_state != STATE_UA_PIN_COMPLETE)) {
+		return -ENOTSUP;
 	}
 
-	output->ptr = buffer;
-	output->len = strlen(buffer);
-
-	return 0;
+	return json_encode_alloc(state_encode, &reported_state, output);
 }
 
 /**
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* The subset of the bsdlib GNSS socket interface used by the GPS driver
+ * frame pipeline.
+ */
+
+#ifndef NRF_SOCKET_H__
+#define NRF_SOCKET_H__
+
+#include <zephyr/types.h>
+
+#define NRF_GNSS_MAX_SATELLITES 12
+#define NRF_GNSS_NMEA_MAX_LEN 83
+
+#define NRF_GNSS_PVT_FLAG_FIX_VALID_BIT 0x01
+#define NRF_GNSS_PVT_FLAG_LEAP_SECOND_VALID 0x02
+#define NRF_GNSS_PVT_FLAG_SLEEP_BETWEEN_PVT 0x04
+#define NRF_GNSS_PVT_FLAG_DEADLINE_MISSED 0x08
+#define NRF_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME 0x10
+
+#define NRF_GNSS_SV_FLAG_USED_IN_FIX 0x02
+#define NRF_GNSS_SV_FLAG_UNHEALTHY 0x08
+
+#define NRF_GNSS_AGPS_GPS_UTC_REQUEST 0
+#define NRF_GNSS_AGPS_KLOBUCHAR_REQUEST 1
+#define NRF_GNSS_AGPS_NEQUICK_REQUEST 2
+#define NRF_GNSS_AGPS_SYS_TIME_AND_SV_TOW_REQUEST 3
+#define NRF_GNSS_AGPS_POSITION_REQUEST 4
+#define NRF_GNSS_AGPS_INTEGRITY_REQUEST 5
+
+#define NRF_GNSS_PVT_DATA_ID 1
+#define NRF_GNSS_NMEA_DATA_ID 2
+#define NRF_GNSS_AGPS_DATA_ID 3
+
+typedef struct {
+	uint16_t year;
+	uint8_t month;
+	uint8_t day;
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t seconds;
+	uint16_t ms;
+} nrf_gnss_datetime_t;
+
+typedef struct {
+	uint16_t sv;
+	uint8_t signal;
+	uint16_t cn0;
+	int16_t elevation;
+	int16_t azimuth;
+	uint8_t flags;
+} nrf_gnss_sv_t;
+
+typedef struct {
+	double latitude;
+	double longitude;
+	float altitude;
+	float accuracy;
+	float speed;
+	float heading;
+	nrf_gnss_datetime_t datetime;
+	float pdop;
+	float hdop;
+	float vdop;
+	float tdop;
+	uint8_t flags;
+	nrf_gnss_sv_t sv[NRF_GNSS_MAX_SATELLITES];
+} nrf_gnss_pvt_data_frame_t;
+
+typedef char nrf_gnss_nmea_data_frame_t[NRF_GNSS_NMEA_MAX_LEN];
+
+typedef struct {
+	uint32_t sv_mask_ephe;
+	uint32_t sv_mask_alm;
+	uint32_t data_flags;
+} nrf_gnss_agps_data_frame_t;
+
+typedef struct {
+	uint8_t data_id;
+	union {
+		nrf_gnss_pvt_data_frame_t pvt;
+		nrf_gnss_nmea_data_frame_t nmea;
+		nrf_gnss_agps_data_frame_t agps;
+	};
+} nrf_gnss_data_frame_t;
+
+#endif /* NRF_SOCKET_H__ */
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <nrf_socket.h>
+
+#include "gps_pipeline.h"
+#include "nmea.h"
+
+#define NMEA_GGA "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M," \
+		 "46.9,M,,*47"
+#define NMEA_GSV "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00," \
+		 "13,06,292,00*74"
+#define NMEA_RMC "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4," \
+		 "230394,003.1,W*6A"
+#define NMEA_XTE "$GPXTE,A,A,0.67,L,N*6F"
+#define NMEA_BAD_CHECKSUM "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9," \
+			  "545.4,M,46.9,M,,*48"
+
+#define EVENTS_MAX 32
+#define STREAM_FRAMES 20
+#define STREAM_INTERVAL 10
+#define SLOW_HANDLER_DELAY 40
+#define READER_STACK_SIZE 1024
+#define READER_PRIORITY K_PRIO_PREEMPT(1)
+
+static struct gps_pipeline pipeline;
+
+/* Events dispatched by the pipeline */
+static struct {
+	struct gps_event evt[EVENTS_MAX];
+	size_t count;
+	int32_t delay;
+} events;
+
+static void handler(struct gps_pipeline *p, struct gps_event *evt)
+{
+	zassert_equal_ptr(p, &pipeline, "Wrong pipeline");
+
+	if (events.count < EVENTS_MAX) {
+		memcpy(&events.evt[events.count], evt, sizeof(*evt));
+		events.count++;
+	}
+
+	if (events.delay) {
+		k_sleep(K_MSEC(events.delay));
+	}
+}
+
+static void test_reset(void)
+{
+	memset(&events, 0, sizeof(events));
+	gps_pipeline_init(&pipeline, handler);
+}
+
+/* Recorded frames, as received from the GNSS socket */
+
+static int pvt_frame(nrf_gnss_data_frame_t *data, uint8_t flags, uint16_t seq)
+{
+	memset(data, 0, sizeof(*data));
+	data->data_id = NRF_GNSS_PVT_DATA_ID;
+	data->pvt.flags = flags;
+	data->pvt.latitude = 48.1173;
+	data->pvt.longitude = 11.5167;
+	data->pvt.datetime.ms = seq;
+	data->pvt.sv[0].sv = 3;
+	data->pvt.sv[0].flags = NRF_GNSS_SV_FLAG_USED_IN_FIX;
+
+	return sizeof(*data);
+}
+
+static int nmea_frame(nrf_gnss_data_frame_t *data, const char *sentence)
+{
+	memset(data, 0, sizeof(*data));
+	data->data_id = NRF_GNSS_NMEA_DATA_ID;
+	strcpy(data->nmea, sentence);
+
+	/* The null terminator is received */
+	return strlen(sentence) + 1;
+}
+
+static int agps_frame(nrf_gnss_data_frame_t *data, uint32_t data_flags)
+{
+	memset(data, 0, sizeof(*data));
+	data->data_id = NRF_GNSS_AGPS_DATA_ID;
+	data->agps.sv_mask_ephe = 0xffffffff;
+	data->agps.sv_mask_alm = 0x0000ffff;
+	data->agps.data_flags = data_flags;
+
+	return sizeof(*data);
+}
+
+/* Receive a frame the way the driver reader thread does. */
+static void receive(const nrf_gnss_data_frame_t *data, int len)
+{
+	struct gps_frame *frame = gps_pipeline_frame_alloc(&pipeline);
+
+	if (frame == NULL) {
+		gps_pipeline_frame_drop(&pipeline, data);
+		return;
+	}
+
+	memcpy(&frame->data, data, len);
+	gps_pipeline_frame_put(&pipeline, GPS_FRAME_GNSS, len);
+}
+
+static void search_started(void)
+{
+	zassert_not_null(gps_pipeline_frame_alloc(&pipeline), "Queue full");
+	gps_pipeline_frame_put(&pipeline, GPS_FRAME_SEARCH_STARTED, 0);
+}
+
+static size_t process_all(void)
+{
+	size_t processed = 0;
+
+	while (gps_pipeline_process(&pipeline, K_NO_WAIT) == 0) {
+		processed++;
+	}
+
+	return processed;
+}
+
+static void assert_event_types(const enum gps_event_type *types, size_t count)
+{
+	zassert_equal(events.count, count, "Wrong number of events: %d",
+		      (int)events.count);
+
+	for (size_t i = 0; i < count; i++) {
+		zassert_equal(events.evt[i].type, types[i],
+			      "Wrong event %d: %d", (int)i, events.evt[i].type);
+	}
+}
+
+static void test_nmea_parse(void)
+{
+	zassert_equal(nmea_parse(NMEA_GGA, strlen(NMEA_GGA)), NMEA_TYPE_GGA,
+		      "GGA not parsed");
+	zassert_equal(nmea_parse(NMEA_GSV, strlen(NMEA_GSV)), NMEA_TYPE_GSV,
+		      "GSV not parsed");
+	zassert_equal(nmea_parse(NMEA_RMC "\r\n", strlen(NMEA_RMC "\r\n")),
+		      NMEA_TYPE_RMC, "RMC with line ending not parsed");
+	zassert_equal(nmea_parse(NMEA_XTE, strlen(NMEA_XTE)),
+		      NMEA_TYPE_UNKNOWN, "XTE not unknown");
+	zassert_equal(nmea_parse(NMEA_BAD_CHECKSUM,
+				 strlen(NMEA_BAD_CHECKSUM)),
+		      NMEA_TYPE_INVALID, "Wrong checksum accepted");
+	zassert_equal(nmea_parse(NMEA_GGA, strlen(NMEA_GGA) - 1),
+		      NMEA_TYPE_INVALID, "Truncated sentence accepted");
+	zassert_equal(nmea_parse("GPGGA*56", 8), NMEA_TYPE_INVALID,
+		      "Sentence without start accepted");
+	zassert_equal(nmea_parse("$*00", 4), NMEA_TYPE_INVALID,
+		      "Short sentence accepted");
+}
+
+static void test_fix(void)
+{
+	static const enum gps_event_type expected[] = {
+		GPS_EVT_SEARCH_STARTED,
+		GPS_EVT_PVT,
+		GPS_EVT_NMEA,
+		GPS_EVT_PVT_FIX,
+		GPS_EVT_NMEA_FIX,
+		GPS_EVT_NMEA_FIX,
+	};
+	nrf_gnss_data_frame_t data;
+
+	test_reset();
+
+	search_started();
+	receive(&data, pvt_frame(&data, 0, 0));
+	receive(&data, nmea_frame(&data, NMEA_GGA));
+	zassert_equal(process_all(), 3, "Wrong number of frames processed");
+
+	receive(&data, pvt_frame(&data, NRF_GNSS_PVT_FLAG_FIX_VALID_BIT, 1));
+	receive(&data, nmea_frame(&data, NMEA_GGA));
+	receive(&data, nmea_frame(&data, NMEA_RMC));
+	zassert_equal(process_all(), 3, "Wrong number of frames processed");
+
+	assert_event_types(expected, ARRAY_SIZE(expected));
+	zassert_equal(events.evt[3].pvt.latitude, 48.1173, "Wrong latitude");
+	zassert_equal(events.evt[3].pvt.sv[0].sv, 3, "Wrong satellite");
+	zassert_equal(events.evt[4].nmea.len, strlen(NMEA_GGA),
+		      "Wrong NMEA length");
+	zassert_mem_equal(events.evt[4].nmea.buf, NMEA_GGA, strlen(NMEA_GGA),
+			  "Wrong NMEA sentence");
+	zassert_equal(pipeline.metrics.frames, 5, "Wrong frame count");
+	zassert_equal(pipeline.metrics.dropped, 0, "Frames dropped");
+}
+
+static void test_blocked(void)
+{
+	static const enum gps_event_type expected[] = {
+		GPS_EVT_OPERATION_BLOCKED,
+		GPS_EVT_OPERATION_UNBLOCKED,
+		GPS_EVT_PVT,
+	};
+	nrf_gnss_data_frame_t data;
+
+	test_reset();
+
+	receive(&data,
+		pvt_frame(&data, NRF_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME, 0));
+	receive(&data, nmea_frame(&data, NMEA_GGA));
+	receive(&data, pvt_frame(&data, NRF_GNSS_PVT_FLAG_DEADLINE_MISSED, 1));
+	receive(&data, pvt_frame(&data, 0, 2));
+	zassert_equal(process_all(), 4, "Wrong number of frames processed");
+
+	assert_event_types(expected, ARRAY_SIZE(expected));
+}
+
+static void test_agps(void)
+{
+	nrf_gnss_data_frame_t data;
+	struct gps_agps_request *request;
+
+	test_reset();
+
+	receive(&data, agps_frame(&data,
+				  BIT(NRF_GNSS_AGPS_GPS_UTC_REQUEST) |
+				  BIT(NRF_GNSS_AGPS_POSITION_REQUEST)));
+	zassert_equal(process_all(), 1, "Wrong number of frames processed");
+
+	zassert_equal(events.count, 1, "Wrong number of events");
+	zassert_equal(events.evt[0].type, GPS_EVT_AGPS_DATA_NEEDED,
+		      "Wrong event");
+
+	request = &events.evt[0].agps_request;
+	zassert_equal(request->sv_mask_ephe, 0xffffffff, "Wrong ephemerides");
+	zassert_equal(request->sv_mask_alm, 0x0000ffff, "Wrong almanacs");
+	zassert_true(request->utc, "UTC not requested");
+	zassert_true(request->position, "Position not requested");
+	zassert_false(request->klobuchar, "Klobuchar requested");
+	zassert_false(request->nequick, "NeQuick requested");
+	zassert_false(request->system_time_tow, "System time requested");
+	zassert_false(request->integrity, "Integrity requested");
+}
+
+static void test_nmea_filter(void)
+{
+	static const enum gps_event_type expected[] = {
+		GPS_EVT_NMEA,
+		GPS_EVT_NMEA,
+	};
+	nrf_gnss_data_frame_t data;
+
+	test_reset();
+
+	receive(&data, nmea_frame(&data, NMEA_GGA));
+	receive(&data, nmea_frame(&data, NMEA_GSV));
+	receive(&data, nmea_frame(&data, NMEA_BAD_CHECKSUM));
+	receive(&data, nmea_frame(&data, NMEA_RMC));
+	zassert_equal(process_all(), 4, "Wrong number of frames processed");
+
+	assert_event_types(expected, ARRAY_SIZE(expected));
+	zassert_mem_equal(events.evt[1].nmea.buf, NMEA_RMC, strlen(NMEA_RMC),
+			  "Wrong NMEA sentence");
+	zassert_equal(pipeline.metrics.nmea_filtered, 1,
+		      "GSV not filtered");
+	zassert_equal(pipeline.metrics.nmea_invalid, 1,
+		      "Invalid sentence not counted");
+}
+
+static void test_queue_full(void)
+{
+	nrf_gnss_data_frame_t data;
+
+	test_reset();
+
+	for (int i = 0; i < CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE + 2; i++) {
+		receive(&data, pvt_frame(&data, 0, i));
+	}
+
+	zassert_equal(pipeline.metrics.dropped, 2, "Wrong drop count");
+	zassert_equal(pipeline.metrics.queue_max,
+		      CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE, "Wrong queue max");
+
+	k_sleep(K_MSEC(CONFIG_NRF9160_GPS_FRAME_LATE_MS + 10));
+
+	zassert_equal(process_all(), CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE,
+		      "Wrong number of frames processed");
+	zassert_equal(pipeline.metrics.late,
+		      CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE, "Wrong late count");
+
+	/* The oldest frames are kept */
+	for (int i = 0; i < CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE; i++) {
+		zassert_equal(events.evt[i].pvt.datetime.ms, i,
+			      "Frame %d out of order", i);
+	}
+
+	/* Space is available again */
+	receive(&data, pvt_frame(&data, 0, 0));
+	zassert_equal(pipeline.metrics.dropped, 2, "Frame dropped");
+	zassert_equal(process_all(), 1, "Wrong number of frames processed");
+}
+
+/* Recorded stream received by a reader thread while a slow handler
+ * dispatches the events.
+ */
+
+static K_THREAD_STACK_DEFINE(reader_stack, READER_STACK_SIZE);
+static struct k_thread reader_thread;
+
+static void reader(void *p1, void *p2, void *p3)
+{
+	nrf_gnss_data_frame_t data;
+
+	for (int i = 0; i < STREAM_FRAMES; i++) {
+		receive(&data, pvt_frame(&data, 0, i));
+		k_sleep(K_MSEC(STREAM_INTERVAL));
+	}
+}
+
+static void test_slow_handler(void)
+{
+	uint16_t prev = 0;
+
+	test_reset();
+	events.delay = SLOW_HANDLER_DELAY;
+
+	k_thread_create(&reader_thread, reader_stack,
+			K_THREAD_STACK_SIZEOF(reader_stack), reader,
+			NULL, NULL, NULL, READER_PRIORITY, 0, K_NO_WAIT);
+
+	while (gps_pipeline_process(&pipeline,
+				    K_MSEC(2 * SLOW_HANDLER_DELAY)) == 0) {
+	}
+
+	k_thread_join(&reader_thread, K_FOREVER);
+
+	TC_PRINT("%d frames: %d dispatched, %d dropped, %d late\n",
+		 pipeline.metrics.frames, (int)events.count,
+		 pipeline.metrics.dropped, pipeline.metrics.late);
+
+	zassert_equal(pipeline.metrics.frames, STREAM_FRAMES,
+		      "Frames not received");
+	zassert_true(pipeline.metrics.dropped > 0, "No frames dropped");
+	zassert_equal(events.count + pipeline.metrics.dropped, STREAM_FRAMES,
+		      "Frames lost");
+	zassert_true(pipeline.metrics.late > 0, "No late frames");
+	zassert_equal(pipeline.metrics.queue_max,
+		      CONFIG_NRF9160_GPS_FRAME_QUEUE_SIZE, "Queue not filled");
+
+	for (size_t i = 0; i < events.count; i++) {
+		uint16_t seq = events.evt[i].pvt.datetime.ms;
+
+		zassert_true(i == 0 || seq > prev, "Frame %d out of order",
+			     seq);
+		prev = seq;
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(nrf9160_gps_pipeline_test,
+			 ztest_unit_test(test_nmea_parse),
+			 ztest_unit_test(test_fix),
+			 ztest_unit_test(test_blocked),
+			 ztest_unit_test(test_agps),
+			 ztest_unit_test(test_nmea_filter),
+			 ztest_unit_test(test_queue_full),
+			 ztest_unit_test(test_slow_handler)
+			 );
+	ztest_run_test_suite(nrf9160_gps_pipeline_test);
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Subset of the bsdlib limits used by the tests. */
+
+#ifndef BSD_LIMITS_H__
+#define BSD_LIMITS_H__
+
+#define BSD_MAX_SOCKET_COUNT 8
+
+#endif /* BSD_LIMITS_H__ */
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Subset of the bsdlib socket API used by the tests. nrf_poll() is
+ * implemented by the tests.
+ */
+
+#ifndef NRF_SOCKET_H__
+#define NRF_SOCKET_H__
+
+#include <zephyr/types.h>
+
+#define NRF_POLLIN   0x1
+#define NRF_POLLOUT  0x2
+#define NRF_POLLERR  0x4
+#define NRF_POLLHUP  0x8
+#define NRF_POLLNVAL 0x10
+
+struct nrf_pollfd {
+	int fd;
+	short events;
+	short revents;
+};
+
+int nrf_poll(struct nrf_pollfd *fds, uint32_t nfds, int timeout);
+
+#endif /* NRF_SOCKET_H__ */
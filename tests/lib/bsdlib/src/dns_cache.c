@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/socket.h>
+#include <modem/bsdlib.h>
+
+#include "nrf91_sockets_internal.h"
+
+#define SERVICE "443"
+
+static struct sockaddr_in addr4 = {
+	.sin_family = AF_INET,
+	.sin_port = htons(443),
+	.sin_addr = { { { 192, 0, 2, 1 } } },
+};
+
+static struct sockaddr_in6 addr6 = {
+	.sin6_family = AF_INET6,
+	.sin6_port = htons(443),
+	.sin6_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+			   0, 0, 0, 0, 0, 0, 0, 1 } } },
+};
+
+static struct zsock_addrinfo result6 = {
+	.ai_family = AF_INET6,
+	.ai_socktype = SOCK_STREAM,
+	.ai_protocol = IPPROTO_TCP,
+	.ai_addr = (struct sockaddr *)&addr6,
+	.ai_addrlen = sizeof(addr6),
+};
+
+/* Resolved addresses, as returned by the offloaded getaddrinfo(). */
+static struct zsock_addrinfo result = {
+	.ai_family = AF_INET,
+	.ai_socktype = SOCK_STREAM,
+	.ai_protocol = IPPROTO_TCP,
+	.ai_addr = (struct sockaddr *)&addr4,
+	.ai_addrlen = sizeof(addr4),
+	.ai_next = &result6,
+};
+
+static void result_free(struct zsock_addrinfo *res)
+{
+	struct zsock_addrinfo *next;
+
+	while (res != NULL) {
+		next = res->ai_next;
+		k_free(res->ai_addr);
+		k_free(res);
+		res = next;
+	}
+}
+
+static bool lookup(const char *node, const struct zsock_addrinfo *hints,
+		   int *error)
+{
+	struct zsock_addrinfo *res = NULL;
+	bool hit;
+
+	hit = nrf91_dns_cache_lookup(node, SERVICE, hints, &res, error);
+	result_free(res);
+
+	return hit;
+}
+
+static void test_dns_cache_hit(void)
+{
+	struct zsock_addrinfo hints = {
+		.ai_family = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct nrf91_socket_dns_cache_stats stats;
+	struct zsock_addrinfo *res = NULL;
+	int error = -1;
+	bool hit;
+
+	nrf91_socket_dns_cache_flush();
+
+	hit = nrf91_dns_cache_lookup("example.com", SERVICE, &hints, &res,
+				     &error);
+	zassert_false(hit, "Hit in an empty cache");
+
+	nrf91_dns_cache_add("example.com", SERVICE, &hints, 0, &result);
+
+	hit = nrf91_dns_cache_lookup("example.com", SERVICE, &hints, &res,
+				     &error);
+	zassert_true(hit, "Added lookup not cached");
+	zassert_equal(error, 0, "Wrong result: %d", error);
+	zassert_not_null(res, "No addresses");
+	zassert_equal(res->ai_family, AF_INET, "Wrong family");
+	zassert_equal(res->ai_socktype, SOCK_STREAM, "Wrong socket type");
+	zassert_equal(res->ai_addrlen, sizeof(addr4), "Wrong address length");
+	zassert_mem_equal(res->ai_addr, &addr4, sizeof(addr4),
+			  "Wrong address");
+	zassert_not_null(res->ai_next, "Second address missing");
+	zassert_equal(res->ai_next->ai_family, AF_INET6, "Wrong family");
+	zassert_mem_equal(res->ai_next->ai_addr, &addr6, sizeof(addr6),
+			  "Wrong address");
+	zassert_is_null(res->ai_next->ai_next, "Too many addresses");
+	result_free(res);
+
+	/* Other hints, service or host */
+	hints.ai_family = AF_INET;
+	zassert_false(lookup("example.com", &hints, &error),
+		      "Hit with other hints");
+	zassert_false(nrf91_dns_cache_lookup("example.com", "80", NULL, &res,
+					     &error),
+		      "Hit with another service");
+	zassert_false(lookup("example.org", NULL, &error),
+		      "Hit with another host");
+
+	nrf91_socket_dns_cache_stats_get(&stats);
+	zassert_equal(stats.hits, 1, "Wrong hit count");
+	zassert_equal(stats.misses, 4, "Wrong miss count");
+}
+
+static void test_dns_cache_pdn(void)
+{
+	struct zsock_addrinfo hints_pdn = {
+		.ai_canonname = "apn.example",
+	};
+	struct zsock_addrinfo hints = {
+		.ai_next = &hints_pdn,
+	};
+	int error;
+
+	nrf91_socket_dns_cache_flush();
+
+	nrf91_dns_cache_add("example.com", SERVICE, &hints, 0, &result);
+
+	zassert_true(lookup("example.com", &hints, &error), "Not cached");
+	zassert_false(lookup("example.com", NULL, &error),
+		      "Hit without PDN");
+
+	hints_pdn.ai_canonname = "other.example";
+	zassert_false(lookup("example.com", &hints, &error),
+		      "Hit with another PDN");
+}
+
+static void test_dns_cache_negative(void)
+{
+	int error = 0;
+
+	nrf91_socket_dns_cache_flush();
+
+	nrf91_dns_cache_add("nonexistent.example", SERVICE, NULL,
+			    DNS_EAI_NONAME, NULL);
+	nrf91_dns_cache_add("unreachable.example", SERVICE, NULL,
+			    DNS_EAI_AGAIN, NULL);
+
+	zassert_true(lookup("nonexistent.example", NULL, &error),
+		     "Nonexistent host not cached");
+	zassert_equal(error, DNS_EAI_NONAME, "Wrong result: %d", error);
+	zassert_false(lookup("unreachable.example", NULL, &error),
+		      "Transient error cached");
+}
+
+static void test_dns_cache_expiry(void)
+{
+	int error;
+
+	nrf91_socket_dns_cache_flush();
+
+	nrf91_dns_cache_add("example.com", SERVICE, NULL, 0, &result);
+	nrf91_dns_cache_add("nonexistent.example", SERVICE, NULL,
+			    DNS_EAI_NONAME, NULL);
+
+	k_sleep(K_MSEC(MAX(CONFIG_NRF91_SOCKET_DNS_CACHE_TTL,
+			   CONFIG_NRF91_SOCKET_DNS_CACHE_NEGATIVE_TTL) *
+		       MSEC_PER_SEC + 10));
+
+	zassert_false(lookup("example.com", NULL, &error), "Not expired");
+	zassert_false(lookup("nonexistent.example", NULL, &error),
+		      "Nonexistent host not expired");
+}
+
+static void test_dns_cache_lru(void)
+{
+	struct nrf91_socket_dns_cache_stats before;
+	struct nrf91_socket_dns_cache_stats after;
+	char host[] = "host0.example";
+	int error;
+
+	nrf91_socket_dns_cache_flush();
+	nrf91_socket_dns_cache_stats_get(&before);
+
+	/* Fill the cache, and use the first entry */
+	for (int i = 0; i < CONFIG_NRF91_SOCKET_DNS_CACHE_SIZE; i++) {
+		host[4] = '0' + i;
+		nrf91_dns_cache_add(host, SERVICE, NULL, 0, &result);
+	}
+
+	zassert_true(lookup("host0.example", NULL, &error), "Not cached");
+
+	/* Replaces the least recently used entry, the second one */
+	nrf91_dns_cache_add("new.example", SERVICE, NULL, 0, &result);
+
+	nrf91_socket_dns_cache_stats_get(&after);
+	zassert_equal(after.evictions - before.evictions, 1,
+		      "Entry not evicted");
+	zassert_true(lookup("new.example", NULL, &error), "Not cached");
+	zassert_true(lookup("host0.example", NULL, &error),
+		     "Recently used entry evicted");
+	zassert_false(lookup("host1.example", NULL, &error),
+		      "Least recently used entry not evicted");
+}
+
+static void test_dns_cache_flush(void)
+{
+	int error;
+
+	nrf91_dns_cache_add("example.com", SERVICE, NULL, 0, &result);
+	zassert_true(lookup("example.com", NULL, &error), "Not cached");
+
+	nrf91_socket_dns_cache_flush();
+
+	zassert_false(lookup("example.com", NULL, &error), "Not flushed");
+}
+
+void test_dns_cache_suite(void)
+{
+	ztest_test_suite(bsdlib_dns_cache_test,
+			 ztest_unit_test(test_dns_cache_hit),
+			 ztest_unit_test(test_dns_cache_pdn),
+			 ztest_unit_test(test_dns_cache_negative),
+			 ztest_unit_test(test_dns_cache_expiry),
+			 ztest_unit_test(test_dns_cache_lru),
+			 ztest_unit_test(test_dns_cache_flush)
+			 );
+	ztest_run_test_suite(bsdlib_dns_cache_test);
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/socket.h>
+#include <sys/fdtable.h>
+#include <sockets_internal.h>
+#include <bsd_limits.h>
+#include <nrf_socket.h>
+#include <modem/bsdlib.h>
+
+#include "nrf91_sockets_internal.h"
+
+#define NATIVE_PORT 4242
+#define EVENT_DELAY 100
+#define POLL_TIMEOUT 1000
+
+#define SD_TO_OBJ(sd) ((void *)(sd + 1))
+#define OBJ_TO_SD(obj) (((int)obj) - 1)
+
+/* Mocked bsdlib */
+
+static struct {
+	/* Events of the offloaded sockets, by socket descriptor */
+	short revents[BSD_MAX_SOCKET_COUNT];
+	uint32_t poll_calls;
+	struct bsd_os_event_listener *listener;
+} modem;
+
+int nrf_poll(struct nrf_pollfd *fds, uint32_t nfds, int timeout)
+{
+	int ready = 0;
+
+	zassert_equal(timeout, 0, "nrf_poll() shall not block");
+
+	modem.poll_calls++;
+
+	for (uint32_t i = 0; i < nfds; i++) {
+		fds[i].revents = modem.revents[fds[i].fd] &
+			(fds[i].events | NRF_POLLERR | NRF_POLLHUP |
+			 NRF_POLLNVAL);
+		if (fds[i].revents) {
+			ready++;
+		}
+	}
+
+	return ready;
+}
+
+void bsd_os_event_listener_add(struct bsd_os_event_listener *listener)
+{
+	zassert_is_null(modem.listener, "Listener already added");
+	modem.listener = listener;
+}
+
+void bsd_os_event_listener_remove(struct bsd_os_event_listener *listener)
+{
+	zassert_equal_ptr(modem.listener, listener, "Unknown listener");
+	modem.listener = NULL;
+}
+
+/* A modem event, as signaled from the RPC interrupt. */
+static void modem_event(int sd, short revents)
+{
+	unsigned int key = irq_lock();
+
+	modem.revents[sd] |= revents;
+	if (modem.listener) {
+		k_poll_signal_raise(&modem.listener->signal, 0);
+	}
+
+	irq_unlock(key);
+}
+
+/* Mocked offloaded sockets */
+
+static const struct socket_op_vtable offload_vtable;
+
+int nrf91_socket_offload_sd_get(int fd)
+{
+	void *obj = z_get_fd_obj(fd, (const struct fd_op_vtable *)
+					   &offload_vtable,
+				 ENOTSUP);
+
+	if (obj == NULL) {
+		return -1;
+	}
+
+	return OBJ_TO_SD(obj);
+}
+
+static int offload_ioctl(void *obj, unsigned int request, va_list args)
+{
+	switch (request) {
+	case ZFD_IOCTL_POLL_PREPARE:
+		return -EXDEV;
+
+	case ZFD_IOCTL_POLL_UPDATE:
+		return -EOPNOTSUPP;
+
+	case ZFD_IOCTL_POLL_OFFLOAD: {
+		struct zsock_pollfd *fds;
+		int nfds;
+		int timeout;
+
+		fds = va_arg(args, struct zsock_pollfd *);
+		nfds = va_arg(args, int);
+		timeout = va_arg(args, int);
+
+		return nrf91_socket_poll(fds, nfds, NULL, 0, timeout);
+	}
+
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
+
+static int offload_close(void *obj)
+{
+	return 0;
+}
+
+static const struct socket_op_vtable offload_vtable = {
+	.fd_vtable = {
+		.close = offload_close,
+		.ioctl = offload_ioctl,
+	},
+};
+
+static int offload_socket_create(int sd)
+{
+	int fd = z_reserve_fd();
+
+	zassert_true(fd >= 0, "Failed to reserve fd");
+
+	z_finalize_fd(fd, SD_TO_OBJ(sd),
+		      (const struct fd_op_vtable *)&offload_vtable);
+
+	return fd;
+}
+
+/* Test fixture */
+
+static struct sockaddr_in6 native_addr = {
+	.sin6_family = AF_INET6,
+	.sin6_port = htons(NATIVE_PORT),
+	.sin6_addr = IN6ADDR_LOOPBACK_INIT,
+};
+
+static int offload_fd;
+static int native_fd;
+static int sender_fd;
+static struct k_poll_signal app_signal;
+
+static void modem_event_work_fn(struct k_work *work)
+{
+	modem_event(0, NRF_POLLIN);
+}
+
+static void native_event_work_fn(struct k_work *work)
+{
+	int ret = sendto(sender_fd, "x", 1, 0,
+			 (struct sockaddr *)&native_addr, sizeof(native_addr));
+
+	zassert_equal(ret, 1, "sendto() failed");
+}
+
+static void app_event_work_fn(struct k_work *work)
+{
+	k_poll_signal_raise(&app_signal, 1);
+}
+
+static K_DELAYED_WORK_DEFINE(modem_event_work, modem_event_work_fn);
+static K_DELAYED_WORK_DEFINE(native_event_work, native_event_work_fn);
+static K_DELAYED_WORK_DEFINE(app_event_work, app_event_work_fn);
+
+static void fixture_setup(void)
+{
+	int ret;
+
+	offload_fd = offload_socket_create(0);
+
+	native_fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(native_fd >= 0, "Failed to create native socket");
+
+	ret = bind(native_fd, (struct sockaddr *)&native_addr,
+		   sizeof(native_addr));
+	zassert_equal(ret, 0, "Failed to bind native socket");
+
+	sender_fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sender_fd >= 0, "Failed to create sender socket");
+
+	k_poll_signal_init(&app_signal);
+}
+
+static void test_reset(void)
+{
+	char buf[8];
+
+	memset(modem.revents, 0, sizeof(modem.revents));
+	modem.poll_calls = 0;
+	k_poll_signal_reset(&app_signal);
+
+	/* Drain the native socket */
+	while (recv(native_fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+	}
+}
+
+static void pollfds_init(struct pollfd *fds)
+{
+	fds[0].fd = offload_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = native_fd;
+	fds[1].events = POLLIN;
+}
+
+static void test_offloaded_ready(void)
+{
+	struct pollfd fds[2];
+	int ret;
+
+	test_reset();
+	pollfds_init(fds);
+	modem.revents[0] = NRF_POLLIN;
+
+	/* Through the socket API, which offloads to nrf91_socket_poll() */
+	ret = poll(fds, ARRAY_SIZE(fds), 0);
+
+	zassert_equal(ret, 1, "Wrong number of ready fds: %d", ret);
+	zassert_equal(fds[0].revents, POLLIN, "Offloaded socket not ready");
+	zassert_equal(fds[1].revents, 0, "Native socket ready");
+	zassert_is_null(modem.listener, "Listener not removed");
+}
+
+static void test_offloaded_wakeup(void)
+{
+	struct pollfd fds[2];
+	int64_t start;
+	int64_t elapsed;
+	int ret;
+
+	test_reset();
+	pollfds_init(fds);
+
+	start = k_uptime_get();
+	k_delayed_work_submit(&modem_event_work, K_MSEC(EVENT_DELAY));
+
+	ret = poll(fds, ARRAY_SIZE(fds), POLL_TIMEOUT);
+	elapsed = k_uptime_delta(&start);
+
+	zassert_equal(ret, 1, "Wrong number of ready fds: %d", ret);
+	zassert_equal(fds[0].revents, POLLIN, "Offloaded socket not ready");
+	zassert_equal(fds[1].revents, 0, "Native socket ready");
+	zassert_true(elapsed >= EVENT_DELAY && elapsed < POLL_TIMEOUT,
+		     "Woken up after %d ms", (int)elapsed);
+	/* Once before waiting, and once after the bsdlib event */
+	zassert_equal(modem.poll_calls, 2, "Modem polled %d times",
+		      modem.poll_calls);
+}
+
+static void test_native_wakeup(void)
+{
+	struct pollfd fds[2];
+	int ret;
+
+	test_reset();
+	pollfds_init(fds);
+
+	k_delayed_work_submit(&native_event_work, K_MSEC(EVENT_DELAY));
+
+	ret = poll(fds, ARRAY_SIZE(fds), POLL_TIMEOUT);
+
+	zassert_equal(ret, 1, "Wrong number of ready fds: %d", ret);
+	zassert_equal(fds[0].revents, 0, "Offloaded socket ready");
+	zassert_equal(fds[1].revents, POLLIN, "Native socket not ready");
+	zassert_equal(modem.poll_calls, 1, "Modem polled %d times",
+		      modem.poll_calls);
+}
+
+static void test_event_wakeup(void)
+{
+	struct pollfd fds[2];
+	struct k_poll_event event;
+	unsigned int signaled;
+	int result;
+	int ret;
+
+	test_reset();
+	pollfds_init(fds);
+	k_poll_event_init(&event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY,
+			  &app_signal);
+
+	k_delayed_work_submit(&app_event_work, K_MSEC(EVENT_DELAY));
+
+	ret = nrf91_socket_poll(fds, ARRAY_SIZE(fds), &event, 1, POLL_TIMEOUT);
+
+	zassert_equal(ret, 1, "Wrong number of ready fds and events: %d", ret);
+	zassert_equal(fds[0].revents, 0, "Offloaded socket ready");
+	zassert_equal(fds[1].revents, 0, "Native socket ready");
+	zassert_equal(event.state, K_POLL_STATE_SIGNALED, "Event not ready");
+
+	k_poll_signal_check(&app_signal, &signaled, &result);
+	zassert_true(signaled, "Signal reset");
+	zassert_equal(result, 1, "Wrong signal result");
+}
+
+static void test_timeout(void)
+{
+	struct pollfd fds[2];
+	int64_t start;
+	int64_t elapsed;
+	int ret;
+
+	test_reset();
+	pollfds_init(fds);
+
+	start = k_uptime_get();
+	ret = poll(fds, ARRAY_SIZE(fds), EVENT_DELAY);
+	elapsed = k_uptime_delta(&start);
+
+	zassert_equal(ret, 0, "Wrong number of ready fds: %d", ret);
+	zassert_true(elapsed >= EVENT_DELAY, "Timed out after %d ms",
+		     (int)elapsed);
+	/* No busy polling */
+	zassert_equal(modem.poll_calls, 1, "Modem polled %d times",
+		      modem.poll_calls);
+}
+
+static void test_invalid(void)
+{
+	struct pollfd fds[3];
+	struct k_poll_event events[CONFIG_NRF91_SOCKET_POLL_MAX + 1];
+	int ret;
+
+	test_reset();
+	pollfds_init(fds);
+	fds[2].fd = CONFIG_POSIX_MAX_FDS - 1;
+	fds[2].events = POLLIN;
+
+	ret = nrf91_socket_poll(fds, ARRAY_SIZE(fds), NULL, 0, POLL_TIMEOUT);
+
+	zassert_equal(ret, 1, "Wrong number of ready fds: %d", ret);
+	zassert_equal(fds[2].revents, POLLNVAL, "Closed fd not invalid");
+
+	ret = nrf91_socket_poll(fds, 2, events, ARRAY_SIZE(events), 0);
+
+	zassert_equal(ret, -1, "Too many events accepted");
+	zassert_equal(errno, EINVAL, "Wrong errno: %d", errno);
+}
+
+void test_sendmsg_suite(void);
+void test_dns_cache_suite(void);
+
+void test_main(void)
+{
+	fixture_setup();
+
+	ztest_test_suite(bsdlib_poll_test,
+			 ztest_unit_test(test_offloaded_ready),
+			 ztest_unit_test(test_offloaded_wakeup),
+			 ztest_unit_test(test_native_wakeup),
+			 ztest_unit_test(test_event_wakeup),
+			 ztest_unit_test(test_timeout),
+			 ztest_unit_test(test_invalid)
+			 );
+	ztest_run_test_suite(bsdlib_poll_test);
+
+	test_sendmsg_suite();
+	test_dns_cache_suite();
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/socket.h>
+#include <bsd_limits.h>
+
+#include "nrf91_sockets_internal.h"
+
+#define SD_TO_OBJ(sd) ((void *)(sd + 1))
+#define OBJ_TO_SD(obj) (((int)obj) - 1)
+
+#define MQTT_SD 1
+#define COAP_SD 2
+
+#define MQTT_HEADER_LEN 2
+#define MQTT_TOPIC_LEN 16
+#define MQTT_PAYLOAD_LEN 96
+#define MQTT_MSG_LEN (MQTT_HEADER_LEN + MQTT_TOPIC_LEN + MQTT_PAYLOAD_LEN)
+#define COAP_HEADER_LEN 8
+#define COAP_PAYLOAD_LEN 64
+#define COAP_MSG_LEN (COAP_HEADER_LEN + COAP_PAYLOAD_LEN)
+#define LARGE_MSG_LEN (2 * CONFIG_BSD_LIBRARY_SENDMSG_BUF_SIZE)
+#define OVERSIZED_MSG_LEN (CONFIG_BSD_LIBRARY_SENDMSG_HEAP_MAX_SIZE + 1)
+
+#define BENCHMARK_MESSAGES 100
+#define SENDER_STACK_SIZE 1024
+#define SENDER_PRIORITY K_PRIO_PREEMPT(1)
+
+/* Mocked modem send, which takes some time per datagram or record. */
+static struct {
+	uint32_t calls[BSD_MAX_SOCKET_COUNT];
+	const void *last_buf;
+	size_t last_len;
+	atomic_t in_flight;
+	atomic_t max_in_flight;
+	bool corrupt;
+} modem_tx;
+
+static void message_fill(uint8_t *buf, size_t len, uint8_t seed)
+{
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = seed + i;
+	}
+}
+
+static bool message_check(const uint8_t *buf, size_t len)
+{
+	for (size_t i = 1; i < len; i++) {
+		if (buf[i] != (uint8_t)(buf[0] + i)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+ssize_t nrf91_socket_offload_sendto(void *obj, const void *buf, size_t len,
+				    int flags, const struct sockaddr *to,
+				    socklen_t tolen)
+{
+	atomic_val_t in_flight = atomic_inc(&modem_tx.in_flight) + 1;
+	atomic_val_t max = atomic_get(&modem_tx.max_in_flight);
+
+	while (in_flight > max &&
+	       !atomic_cas(&modem_tx.max_in_flight, max, in_flight)) {
+		max = atomic_get(&modem_tx.max_in_flight);
+	}
+
+	modem_tx.calls[OBJ_TO_SD(obj)]++;
+	modem_tx.last_buf = buf;
+	modem_tx.last_len = len;
+
+	if (!message_check(buf, len)) {
+		modem_tx.corrupt = true;
+	}
+
+	/* Transfer to the modem */
+	k_sleep(K_MSEC(1));
+
+	atomic_dec(&modem_tx.in_flight);
+
+	return len;
+}
+
+static void modem_tx_reset(void)
+{
+	memset(&modem_tx, 0, sizeof(modem_tx));
+}
+
+/* Message made of consecutive parts of a buffer. */
+static void msg_init(struct msghdr *msg, struct iovec *iov,
+		     const size_t *part_len, size_t parts, uint8_t *buf)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_iov = iov;
+	msg->msg_iovlen = parts;
+
+	for (size_t i = 0; i < parts; i++) {
+		iov[i].iov_base = buf;
+		iov[i].iov_len = part_len[i];
+		buf += part_len[i];
+	}
+}
+
+static void test_sendmsg_gather(void)
+{
+	static const size_t part_len[] = { MQTT_HEADER_LEN, 0, MQTT_TOPIC_LEN,
+					   MQTT_PAYLOAD_LEN };
+	uint8_t buf[MQTT_MSG_LEN];
+	struct iovec iov[ARRAY_SIZE(part_len)];
+	struct msghdr msg;
+	ssize_t ret;
+
+	modem_tx_reset();
+	message_fill(buf, sizeof(buf), 0);
+	msg_init(&msg, iov, part_len, ARRAY_SIZE(part_len), buf);
+
+	ret = nrf91_socket_offload_sendmsg(SD_TO_OBJ(MQTT_SD), &msg, 0);
+
+	zassert_equal(ret, MQTT_MSG_LEN, "Wrong length sent: %d", ret);
+	zassert_equal(modem_tx.calls[MQTT_SD], 1, "Message not gathered");
+	zassert_false(modem_tx.corrupt, "Corrupted message");
+}
+
+static void test_sendmsg_single(void)
+{
+	static const size_t part_len[] = { 0, COAP_MSG_LEN, 0 };
+	uint8_t buf[COAP_MSG_LEN];
+	struct iovec iov[ARRAY_SIZE(part_len)];
+	struct msghdr msg;
+	ssize_t ret;
+
+	modem_tx_reset();
+	message_fill(buf, sizeof(buf), 0);
+	msg_init(&msg, iov, part_len, ARRAY_SIZE(part_len), buf);
+
+	ret = nrf91_socket_offload_sendmsg(SD_TO_OBJ(COAP_SD), &msg, 0);
+
+	zassert_equal(ret, COAP_MSG_LEN, "Wrong length sent: %d", ret);
+	zassert_equal(modem_tx.calls[COAP_SD], 1, "Message not sent once");
+	zassert_equal_ptr(modem_tx.last_buf, buf, "Message copied");
+}
+
+static void test_sendmsg_large(void)
+{
+	static const size_t part_len[] = { COAP_HEADER_LEN,
+					   LARGE_MSG_LEN - COAP_HEADER_LEN };
+	static uint8_t buf[LARGE_MSG_LEN];
+	struct iovec iov[ARRAY_SIZE(part_len)];
+	struct msghdr msg;
+	ssize_t ret;
+
+	modem_tx_reset();
+	message_fill(buf, sizeof(buf), 0);
+	msg_init(&msg, iov, part_len, ARRAY_SIZE(part_len), buf);
+
+	ret = nrf91_socket_offload_sendmsg(SD_TO_OBJ(COAP_SD), &msg, 0);
+
+	zassert_equal(ret, LARGE_MSG_LEN, "Wrong length sent: %d", ret);
+	zassert_equal(modem_tx.calls[COAP_SD], 1, "Message not gathered");
+	zassert_false(modem_tx.corrupt, "Corrupted message");
+}
+
+static void test_sendmsg_oversized(void)
+{
+	static const size_t part_len[] = { COAP_HEADER_LEN,
+					   OVERSIZED_MSG_LEN - COAP_HEADER_LEN };
+	static uint8_t buf[OVERSIZED_MSG_LEN];
+	struct iovec iov[ARRAY_SIZE(part_len)];
+	struct msghdr msg;
+	ssize_t ret;
+
+	modem_tx_reset();
+	message_fill(buf, sizeof(buf), 0);
+	msg_init(&msg, iov, part_len, ARRAY_SIZE(part_len), buf);
+
+	ret = nrf91_socket_offload_sendmsg(SD_TO_OBJ(COAP_SD), &msg, 0);
+
+	/* Not gathered in a heap buffer larger than the limit */
+	zassert_equal(ret, OVERSIZED_MSG_LEN, "Wrong length sent: %d", ret);
+	zassert_equal(modem_tx.calls[COAP_SD], ARRAY_SIZE(part_len),
+		      "Message not sent part by part");
+	zassert_false(modem_tx.corrupt, "Corrupted message");
+}
+
+/* Benchmark */
+
+static K_THREAD_STACK_DEFINE(mqtt_stack, SENDER_STACK_SIZE);
+static K_THREAD_STACK_DEFINE(coap_stack, SENDER_STACK_SIZE);
+static struct k_thread mqtt_thread;
+static struct k_thread coap_thread;
+
+static void sender(void *p1, void *p2, void *p3)
+{
+	int sd = (int)p1;
+	const size_t *part_len = p2;
+	size_t parts = (size_t)p3;
+	uint8_t buf[MQTT_MSG_LEN];
+	struct iovec iov[4];
+	struct msghdr msg;
+	size_t len = 0;
+	ssize_t ret;
+
+	for (size_t i = 0; i < parts; i++) {
+		len += part_len[i];
+	}
+
+	for (int i = 0; i < BENCHMARK_MESSAGES; i++) {
+		message_fill(buf, len, i);
+		msg_init(&msg, iov, part_len, parts, buf);
+
+		ret = nrf91_socket_offload_sendmsg(SD_TO_OBJ(sd), &msg, 0);
+		if (ret != len) {
+			modem_tx.corrupt = true;
+		}
+	}
+}
+
+static void test_sendmsg_benchmark(void)
+{
+	/* MQTT PUBLISH: fixed header, topic and payload */
+	static const size_t mqtt_parts[] = { MQTT_HEADER_LEN, MQTT_TOPIC_LEN,
+					     MQTT_PAYLOAD_LEN };
+	/* CoAP request: header with options, and payload */
+	static const size_t coap_parts[] = { COAP_HEADER_LEN,
+					     COAP_PAYLOAD_LEN };
+	int64_t start;
+	int64_t elapsed;
+
+	modem_tx_reset();
+	start = k_uptime_get();
+
+	k_thread_create(&mqtt_thread, mqtt_stack,
+			K_THREAD_STACK_SIZEOF(mqtt_stack), sender,
+			(void *)MQTT_SD, (void *)mqtt_parts,
+			(void *)ARRAY_SIZE(mqtt_parts), SENDER_PRIORITY, 0,
+			K_NO_WAIT);
+	k_thread_create(&coap_thread, coap_stack,
+			K_THREAD_STACK_SIZEOF(coap_stack), sender,
+			(void *)COAP_SD, (void *)coap_parts,
+			(void *)ARRAY_SIZE(coap_parts), SENDER_PRIORITY, 0,
+			K_NO_WAIT);
+
+	k_thread_join(&mqtt_thread, K_FOREVER);
+	k_thread_join(&coap_thread, K_FOREVER);
+
+	elapsed = k_uptime_delta(&start);
+
+	TC_PRINT("%d MQTT and %d CoAP messages sent in %d ms\n",
+		 BENCHMARK_MESSAGES, BENCHMARK_MESSAGES, (int)elapsed);
+
+	zassert_equal(modem_tx.calls[MQTT_SD], BENCHMARK_MESSAGES,
+		      "MQTT messages not gathered");
+	zassert_equal(modem_tx.calls[COAP_SD], BENCHMARK_MESSAGES,
+		      "CoAP messages not gathered");
+	zassert_false(modem_tx.corrupt, "Corrupted message");
+	zassert_equal(atomic_get(&modem_tx.max_in_flight), 2,
+		      "Senders serialized");
+}
+
+void test_sendmsg_suite(void)
+{
+	ztest_test_suite(bsdlib_sendmsg_test,
+			 ztest_unit_test(test_sendmsg_gather),
+			 ztest_unit_test(test_sendmsg_single),
+			 ztest_unit_test(test_sendmsg_large),
+			 ztest_unit_test(test_sendmsg_oversized),
+			 ztest_unit_test(test_sendmsg_benchmark)
+			 );
+	ztest_run_test_suite(bsdlib_sendmsg_test);
+}
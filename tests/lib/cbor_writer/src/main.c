@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <cbor_writer.h>
+#include <json_writer.h>
+
+#define BUF_SIZE 256
+
+static uint8_t buf[BUF_SIZE];
+
+static void assert_output(struct cbor_writer *writer, const uint8_t *expected,
+			  size_t expected_len)
+{
+	int len = cbor_writer_finish(writer);
+
+	zassert_equal(len, (int)expected_len, "Length mismatch: %d vs %d",
+		      len, (int)expected_len);
+	zassert_mem_equal(buf, expected, expected_len, "Output mismatch");
+}
+
+/* Test vectors from RFC 7049, appendix A. */
+static void test_cbor_writer_numbers(void)
+{
+	static const struct {
+		double value;
+		uint8_t len;
+		uint8_t cbor[9];
+	} vectors[] = {
+		{ 0, 1, { 0x00 } },
+		{ 23, 1, { 0x17 } },
+		{ 24, 2, { 0x18, 0x18 } },
+		{ 1000, 3, { 0x19, 0x03, 0xe8 } },
+		{ 1000000, 5, { 0x1a, 0x00, 0x0f, 0x42, 0x40 } },
+		{ 1000000000000, 9,
+		  { 0x1b, 0x00, 0x00, 0x00, 0xe8, 0xd4, 0xa5, 0x10, 0x00 } },
+		{ -1, 1, { 0x20 } },
+		{ -1000, 3, { 0x39, 0x03, 0xe7 } },
+		{ 1.5, 5, { 0xfa, 0x3f, 0xc0, 0x00, 0x00 } },
+		{ 100000.5, 5, { 0xfa, 0x47, 0xc3, 0x50, 0x40 } },
+		{ 1.1, 9,
+		  { 0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a } },
+		{ -4.1, 9,
+		  { 0xfb, 0xc0, 0x10, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66 } },
+	};
+	struct cbor_writer writer;
+
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+		cbor_writer_init(&writer, buf, sizeof(buf));
+		cbor_writer_num(&writer, NULL, vectors[i].value);
+		assert_output(&writer, vectors[i].cbor, vectors[i].len);
+	}
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_int(&writer, NULL, -2147483648);
+	assert_output(&writer, (const uint8_t[]){ 0x3a, 0x7f, 0xff, 0xff, 0xff },
+		      5);
+}
+
+static void test_cbor_writer_simple(void)
+{
+	static const uint8_t expected[] = {
+		0x9f, 0xf4, 0xf5, 0xf6, 0x60, 0x64, 0x49, 0x45, 0x54, 0x46,
+		0x44, 0x01, 0x02, 0x03, 0x04, 0xff
+	};
+	static const uint8_t bytes[] = { 0x01, 0x02, 0x03, 0x04 };
+	struct cbor_writer writer;
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_arr_start(&writer, NULL);
+	cbor_writer_bool(&writer, NULL, false);
+	cbor_writer_bool(&writer, NULL, true);
+	cbor_writer_null(&writer, NULL);
+	cbor_writer_str(&writer, NULL, NULL);
+	cbor_writer_str(&writer, NULL, "IETF");
+	cbor_writer_bytes(&writer, NULL, bytes, sizeof(bytes));
+	cbor_writer_arr_end(&writer);
+
+	assert_output(&writer, expected, sizeof(expected));
+}
+
+static void test_cbor_writer_nesting(void)
+{
+	/* {_ "a": 1, "b": [_ 2, 3]} */
+	static const uint8_t expected[] = {
+		0xbf, 0x61, 0x61, 0x01, 0x61, 0x62, 0x9f, 0x02, 0x03, 0xff,
+		0xff
+	};
+	struct cbor_writer writer;
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_obj_start(&writer, NULL);
+	cbor_writer_int(&writer, "a", 1);
+	cbor_writer_arr_start(&writer, "b");
+	cbor_writer_int(&writer, NULL, 2);
+	cbor_writer_int(&writer, NULL, 3);
+	cbor_writer_arr_end(&writer);
+	cbor_writer_obj_end(&writer);
+
+	assert_output(&writer, expected, sizeof(expected));
+}
+
+static void test_cbor_writer_overflow(void)
+{
+	struct cbor_writer writer;
+	uint8_t small[4];
+	int err;
+
+	cbor_writer_init(&writer, small, sizeof(small));
+	cbor_writer_obj_start(&writer, NULL);
+	cbor_writer_str(&writer, "appId", "GPS");
+	cbor_writer_obj_end(&writer);
+
+	err = cbor_writer_finish(&writer);
+	zassert_equal(err, -ENOMEM, "Overflow not detected");
+	zassert_equal(writer.len, 12, "Needed length not reported");
+
+	cbor_writer_init(&writer, NULL, 0);
+	cbor_writer_obj_start(&writer, NULL);
+	cbor_writer_str(&writer, "appId", "GPS");
+	cbor_writer_obj_end(&writer);
+	zassert_equal(cbor_writer_finish(&writer), 12, "Unexpected length");
+}
+
+static void test_cbor_writer_unbalanced(void)
+{
+	struct cbor_writer writer;
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_obj_start(&writer, NULL);
+	zassert_equal(cbor_writer_finish(&writer), -EINVAL,
+		      "Unterminated map not detected");
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_arr_end(&writer);
+	zassert_equal(cbor_writer_finish(&writer), -EINVAL,
+		      "Unbalanced end not detected");
+}
+
+/* A typical sensor message is smaller in CBOR than in JSON. */
+static void test_cbor_writer_smaller_than_json(void)
+{
+	struct cbor_writer cbor;
+	struct json_writer json;
+
+	cbor_writer_init(&cbor, NULL, 0);
+	cbor_writer_obj_start(&cbor, NULL);
+	cbor_writer_str(&cbor, "appId", "TEMP");
+	cbor_writer_num(&cbor, "data", 23.5);
+	cbor_writer_str(&cbor, "messageType", "DATA");
+	cbor_writer_num(&cbor, "ts", 1600000000000.0);
+	cbor_writer_obj_end(&cbor);
+
+	json_writer_init(&json, NULL, 0);
+	json_writer_obj_start(&json, NULL);
+	json_writer_str(&json, "appId", "TEMP");
+	json_writer_num(&json, "data", 23.5);
+	json_writer_str(&json, "messageType", "DATA");
+	json_writer_num(&json, "ts", 1600000000000.0);
+	json_writer_obj_end(&json);
+
+	zassert_true(cbor_writer_finish(&cbor) < json_writer_finish(&json),
+		     "CBOR encoding is not smaller");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_cbor_writer,
+		ztest_unit_test(test_cbor_writer_numbers),
+		ztest_unit_test(test_cbor_writer_simple),
+		ztest_unit_test(test_cbor_writer_nesting),
+		ztest_unit_test(test_cbor_writer_overflow),
+		ztest_unit_test(test_cbor_writer_unbalanced),
+		ztest_unit_test(test_cbor_writer_smaller_than_json)
+	);
+
+	ztest_run_test_suite(test_cbor_writer);
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <cJSON.h>
+#include <cJSON_os.h>
+
+#define ARENA_SIZE 4096
+
+/* Shadow delta as received from nRF Cloud, shortened. */
+static const char shadow[] =
+	"{\"version\":1093,\"timestamp\":1599039620,"
+	"\"state\":{"
+		"\"pairing\":{\"state\":\"not_associated\","
+			"\"topics\":{\"d2c\":\"prod/a1b2/m/d/nrf-1234/d2c\","
+				"\"c2d\":\"prod/a1b2/m/d/nrf-1234/+/r\"}},"
+		"\"config\":{\"GPS\":{\"enable\":true},"
+			"\"TEMP\":{\"thresh_lo\":-12.5,\"thresh_hi\":1e2}},"
+		"\"sensors\":[\"GPS\",\"TEMP\"],"
+		"\"escaped\":\"a \\\"quoted\\\" value\","
+		"\"nothing\":null},"
+	"\"metadata\":{\"pairing\":{\"state\":{\"timestamp\":1599039620}}}}";
+
+static uint8_t arena_buf[ARENA_SIZE] __aligned(sizeof(double));
+static struct cJSON_Arena arena;
+
+static void assert_same_tree(cJSON *a, cJSON *b)
+{
+	char *a_str = cJSON_PrintUnformatted(a);
+	char *b_str = cJSON_PrintUnformatted(b);
+
+	zassert_not_null(a_str, "Print failed");
+	zassert_not_null(b_str, "Print failed");
+	zassert_equal(strcmp(a_str, b_str), 0, "Trees differ:\n%s\n%s",
+		      a_str, b_str);
+
+	cJSON_FreeString(a_str);
+	cJSON_FreeString(b_str);
+}
+
+static void test_arena_parse(void)
+{
+	cJSON *heap_root = cJSON_Parse(shadow);
+	cJSON *arena_root;
+
+	cJSON_ArenaInit(&arena, arena_buf, sizeof(arena_buf));
+
+	arena_root = cJSON_ArenaParse(&arena, shadow);
+	zassert_not_null(arena_root, "Arena parse failed");
+	zassert_true(((uint8_t *)arena_root >= arena_buf) &&
+		     ((uint8_t *)arena_root < &arena_buf[ARENA_SIZE]),
+		     "Tree not allocated from the arena");
+	zassert_true(arena.high_water > 0, "High-water mark not updated");
+
+	TC_PRINT("Shadow of %d bytes used %d bytes of arena\n",
+		 (int)strlen(shadow), (int)arena.high_water);
+
+	assert_same_tree(heap_root, arena_root);
+
+	/* Deleting detached parts and the tree must leave the arena alone. */
+	cJSON_Delete(cJSON_DetachItemFromObject(
+		cJSON_GetObjectItem(arena_root, "state"), "config"));
+	cJSON_Delete(arena_root);
+	cJSON_ArenaReset(&arena);
+
+	/* After a reset, the same memory is used again. */
+	arena_root = cJSON_ArenaParse(&arena, shadow);
+	zassert_equal((uint8_t *)arena_root, arena_buf,
+		      "Arena not reused after reset");
+	cJSON_Delete(arena_root);
+	cJSON_ArenaReset(&arena);
+
+	cJSON_Delete(heap_root);
+}
+
+static void test_arena_fallback(void)
+{
+	static uint8_t small_buf[64] __aligned(sizeof(double));
+	struct cJSON_Arena small;
+	cJSON *heap_root = cJSON_Parse(shadow);
+	cJSON *root;
+
+	cJSON_ArenaInit(&small, small_buf, sizeof(small_buf));
+
+	root = cJSON_ArenaParse(&small, shadow);
+	zassert_not_null(root, "No fallback to the heap");
+	zassert_true(((uint8_t *)root < small_buf) ||
+		     ((uint8_t *)root >= &small_buf[sizeof(small_buf)]),
+		     "Tree allocated from an exhausted arena");
+
+	assert_same_tree(heap_root, root);
+
+	cJSON_Delete(root);
+	cJSON_ArenaReset(&small);
+	cJSON_Delete(heap_root);
+
+	zassert_is_null(cJSON_ArenaParse(&arena, "{\"a\":"),
+			"Invalid input accepted");
+	cJSON_ArenaReset(&arena);
+}
+
+static void test_query(void)
+{
+	struct cJSON_QueryItem items[] = {
+		{ .path = "state.pairing.state" },
+		{ .path = "state.config.GPS.enable" },
+		{ .path = "state.config.TEMP.thresh_lo" },
+		{ .path = "state.config.TEMP" },
+		{ .path = "state.sensors" },
+		{ .path = "state.escaped" },
+		{ .path = "state.nothing" },
+		{ .path = "version" },
+		{ .path = "state.missing" },
+		{ .path = "state.config.GPS.enable.deeper" },
+		{ .path = "pairing.state" },
+		{ .path = "State.Pairing.STATE" },
+	};
+	int found;
+
+	found = cJSON_Query(shadow, strlen(shadow), items, ARRAY_SIZE(items));
+	zassert_equal(found, 9, "Unexpected number of items found: %d", found);
+
+	zassert_equal(items[0].type, cJSON_String, "Wrong type");
+	zassert_equal(items[0].value_len, strlen("not_associated"),
+		      "Wrong length");
+	zassert_mem_equal(items[0].value, "not_associated",
+			  items[0].value_len, "Wrong value");
+
+	zassert_equal(items[1].type, cJSON_True, "Wrong type");
+
+	zassert_equal(items[2].type, cJSON_Number, "Wrong type");
+	zassert_mem_equal(items[2].value, "-12.5", items[2].value_len,
+			  "Wrong value");
+
+	zassert_equal(items[3].type, cJSON_Object, "Wrong type");
+	zassert_mem_equal(items[3].value,
+			  "{\"thresh_lo\":-12.5,\"thresh_hi\":1e2}",
+			  items[3].value_len, "Wrong value");
+
+	zassert_equal(items[4].type, cJSON_Array, "Wrong type");
+	zassert_equal(items[5].type, cJSON_String, "Wrong type");
+	zassert_mem_equal(items[5].value, "a \\\"quoted\\\" value",
+			  items[5].value_len, "Wrong value");
+	zassert_equal(items[6].type, cJSON_NULL, "Wrong type");
+	zassert_equal(items[7].type, cJSON_Number, "Wrong type");
+
+	/* Keys are case-insensitive, like in cJSON_GetObjectItem() */
+	zassert_equal(items[11].type, cJSON_String, "Wrong type");
+	zassert_equal(items[11].value, items[0].value, "Wrong value");
+
+	for (size_t i = 8; i < ARRAY_SIZE(items) - 1; i++) {
+		zassert_equal(items[i].type, cJSON_Invalid,
+			      "Unexpected item %s found", items[i].path);
+		zassert_is_null(items[i].value, "Value set for missing item");
+	}
+}
+
+/* Shadow with a subtree nested deeper than CONFIG_CJSON_QUERY_MAX_DEPTH */
+static const char deep_shadow[] =
+	"{\"state\":{"
+		"\"config\":{\"a\":{\"b\":{\"c\":{\"d\":{\"e\":{\"f\":{"
+			"\"g\":{\"h\":[{\"i\":\"}]\"},[[1,2]],{}]}}}}}}}},"
+		"\"pairing\":{\"state\":\"paired\"}}}";
+
+static void test_query_deep(void)
+{
+	struct cJSON_QueryItem items[] = {
+		{ .path = "state.pairing.state" },
+		{ .path = "state.config.a.b.c.d.e.f" },
+		{ .path = "state.config.a.b.c.d.e.f.g" },
+	};
+	int found;
+
+	found = cJSON_Query(deep_shadow, strlen(deep_shadow), items,
+			    ARRAY_SIZE(items));
+	zassert_equal(found, 2, "Unexpected number of items found: %d", found);
+
+	/* Values after the deep subtree are found */
+	zassert_equal(items[0].type, cJSON_String, "Wrong type");
+	zassert_mem_equal(items[0].value, "paired", items[0].value_len,
+			  "Wrong value");
+
+	/* The deepest addressable value is returned as raw JSON */
+	zassert_equal(items[1].type, cJSON_Object, "Wrong type");
+	zassert_equal(items[1].value[items[1].value_len - 1], '}',
+		      "Wrong value");
+
+	/* Values nested deeper than the limit are skipped */
+	zassert_equal(items[2].type, cJSON_Invalid, "Too deep item found");
+}
+
+static void test_query_invalid(void)
+{
+	static const char *const invalid[] = {
+		"",
+		"{",
+		"{\"a\" 1}",
+		"{\"a\":1,}",
+		"[1 2]",
+		"{\"a\":tru}",
+		"{\"a\":\"unterminated}",
+		"{\"a\":1} trailing",
+		"{\"a\":1-2}",
+		"{\"a\":-}",
+		"{\"a\":+1}",
+		"{\"a\":01}",
+		"{\"a\":1.}",
+		"{\"a\":.5}",
+		"{\"a\":1e}",
+		"{\"a\":1e+-2}",
+		"{\"a\":1.5e2.5}",
+		"[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]",
+		"[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[\"]\"]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]",
+	};
+	static const char *const numbers[] = {
+		"0", "-0", "10", "-0.5", "1e2", "1E+2", "-12.5e-3",
+	};
+	struct cJSON_QueryItem item = { .path = "a" };
+
+	for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+		zassert_equal(cJSON_Query(invalid[i], strlen(invalid[i]),
+					  &item, 1),
+			      -EINVAL, "Invalid input %s accepted", invalid[i]);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(numbers); i++) {
+		zassert_equal(cJSON_Query(numbers[i], strlen(numbers[i]),
+					  &item, 1),
+			      0, "Valid number %s rejected", numbers[i]);
+	}
+
+	/* The null-terminator may be included in the length. */
+	zassert_equal(cJSON_Query("{\"a\":1}", sizeof("{\"a\":1}"), &item, 1),
+		      1, "Null-terminated input rejected");
+}
+
+void test_main(void)
+{
+	cJSON_Init();
+
+	ztest_test_suite(test_cjson,
+		ztest_unit_test(test_arena_parse),
+		ztest_unit_test(test_arena_fallback),
+		ztest_unit_test(test_query),
+		ztest_unit_test(test_query_deep),
+		ztest_unit_test(test_query_invalid)
+	);
+
+	ztest_run_test_suite(test_cjson);
+}
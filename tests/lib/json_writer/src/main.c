@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <stdio.h>
+#include <string.h>
+#include <json_writer.h>
+#include <cJSON.h>
+#include <cJSON_os.h>
+
+#define BUF_SIZE 256
+
+static char buf[BUF_SIZE];
+
+static const char *const test_strings[] = {
+	"",
+	"GPS",
+	"25.3",
+	"$GPGGA,181908.00,3404.7041778,N,07044.3966270,W,4,13,1.00",
+	"quote \" backslash \\ slash /",
+	"control \b\f\n\r\t \x01\x1f",
+};
+
+static const double test_numbers[] = {
+	0, 1, -1, 0.1, 1.5, -273.15, 123456789, 1e-7, 1e300, 3.141592653589793,
+};
+
+/* Compare the JSON writer output with the cJSON output for the same tree. */
+static void assert_same_output(cJSON *root, struct json_writer *writer)
+{
+	char *expected = cJSON_PrintUnformatted(root);
+	int len = json_writer_finish(writer);
+
+	zassert_not_null(expected, "cJSON_PrintUnformatted failed");
+	zassert_equal(len, strlen(expected), "Length mismatch: %d vs %d",
+		      len, strlen(expected));
+	zassert_mem_equal(buf, expected, len + 1, "Output mismatch:\n%s\n%s",
+			  buf, expected);
+
+	cJSON_FreeString(expected);
+	cJSON_Delete(root);
+}
+
+static void test_json_writer_strings(void)
+{
+	struct json_writer writer;
+
+	for (size_t i = 0; i < ARRAY_SIZE(test_strings); i++) {
+		cJSON *root = cJSON_CreateObject();
+
+		cJSON_AddItemToObject(root, "appId",
+				      cJSON_CreateString("TEMP"));
+		cJSON_AddItemToObject(root, "data",
+				      cJSON_CreateString(test_strings[i]));
+		cJSON_AddItemToObject(root, "messageType",
+				      cJSON_CreateString("DATA"));
+
+		json_writer_init(&writer, buf, sizeof(buf));
+		json_writer_obj_start(&writer, NULL);
+		json_writer_str(&writer, "appId", "TEMP");
+		json_writer_str(&writer, "data", test_strings[i]);
+		json_writer_str(&writer, "messageType", "DATA");
+		json_writer_obj_end(&writer);
+
+		assert_same_output(root, &writer);
+	}
+}
+
+static void test_json_writer_numbers(void)
+{
+	struct json_writer writer;
+	cJSON *root = cJSON_CreateArray();
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	json_writer_arr_start(&writer, NULL);
+
+	for (size_t i = 0; i < ARRAY_SIZE(test_numbers); i++) {
+		cJSON_AddItemToArray(root, cJSON_CreateNumber(test_numbers[i]));
+		json_writer_num(&writer, NULL, test_numbers[i]);
+	}
+
+	cJSON_AddItemToArray(root, cJSON_CreateNumber(-2147483648.0));
+	json_writer_int(&writer, NULL, INT32_MIN);
+
+	json_writer_arr_end(&writer);
+
+	assert_same_output(root, &writer);
+}
+
+static void test_json_writer_nesting(void)
+{
+	struct json_writer writer;
+	cJSON *root = cJSON_CreateObject();
+	cJSON *state = cJSON_CreateObject();
+	cJSON *reported = cJSON_CreateObject();
+	cJSON *config = cJSON_CreateObject();
+	cJSON *gps = cJSON_CreateObject();
+	cJSON *arr = cJSON_CreateArray();
+
+	cJSON_AddItemToObject(gps, "enable", cJSON_CreateBool(true));
+	cJSON_AddItemToObject(gps, "interval", cJSON_CreateNull());
+	cJSON_AddItemToObject(config, "GPS", gps);
+	cJSON_AddItemToObject(config, "empty", cJSON_CreateObject());
+	cJSON_AddItemToArray(arr, cJSON_CreateBool(false));
+	cJSON_AddItemToArray(arr, cJSON_CreateArray());
+	cJSON_AddItemToArray(arr, cJSON_CreateString("x"));
+	cJSON_AddItemToObject(config, "list", arr);
+	cJSON_AddItemToObject(reported, "config", config);
+	cJSON_AddItemToObject(state, "reported", reported);
+	cJSON_AddItemToObject(root, "state", state);
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	json_writer_obj_start(&writer, NULL);
+	json_writer_obj_start(&writer, "state");
+	json_writer_obj_start(&writer, "reported");
+	json_writer_obj_start(&writer, "config");
+	json_writer_obj_start(&writer, "GPS");
+	json_writer_bool(&writer, "enable", true);
+	json_writer_null(&writer, "interval");
+	json_writer_obj_end(&writer);
+	json_writer_obj_start(&writer, "empty");
+	json_writer_obj_end(&writer);
+	json_writer_arr_start(&writer, "list");
+	json_writer_bool(&writer, NULL, false);
+	json_writer_arr_start(&writer, NULL);
+	json_writer_arr_end(&writer);
+	json_writer_str(&writer, NULL, "x");
+	json_writer_arr_end(&writer);
+	json_writer_obj_end(&writer);
+	json_writer_obj_end(&writer);
+	json_writer_obj_end(&writer);
+	json_writer_obj_end(&writer);
+
+	assert_same_output(root, &writer);
+}
+
+static void test_json_writer_length_only(void)
+{
+	struct json_writer writer;
+	int len;
+
+	json_writer_init(&writer, NULL, 0);
+	json_writer_obj_start(&writer, NULL);
+	json_writer_str(&writer, "appId", "GPS");
+	json_writer_obj_end(&writer);
+
+	len = json_writer_finish(&writer);
+	zassert_equal(len, strlen("{\"appId\":\"GPS\"}"),
+		      "Unexpected length %d", len);
+}
+
+static void test_json_writer_overflow(void)
+{
+	struct json_writer writer;
+	char small[8];
+	int err;
+
+	memset(small, 'x', sizeof(small));
+
+	json_writer_init(&writer, small, sizeof(small));
+	json_writer_obj_start(&writer, NULL);
+	json_writer_str(&writer, "appId", "GPS");
+	json_writer_obj_end(&writer);
+
+	err = json_writer_finish(&writer);
+	zassert_equal(err, -ENOMEM, "Overflow not detected");
+	zassert_equal(writer.len, strlen("{\"appId\":\"GPS\"}"),
+		      "Needed length not reported");
+	zassert_equal(small[sizeof(small) - 1], '\0',
+		      "Output not null-terminated");
+}
+
+static void test_json_writer_unbalanced(void)
+{
+	struct json_writer writer;
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	json_writer_obj_start(&writer, NULL);
+	zassert_equal(json_writer_finish(&writer), -EINVAL,
+		      "Unterminated object not detected");
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	json_writer_obj_end(&writer);
+	zassert_equal(json_writer_finish(&writer), -EINVAL,
+		      "Unbalanced end not detected");
+
+	json_writer_init(&writer, buf, sizeof(buf));
+	for (int i = 0; i <= CONFIG_JSON_WRITER_MAX_DEPTH; i++) {
+		json_writer_arr_start(&writer, NULL);
+	}
+	zassert_equal(json_writer_finish(&writer), -EINVAL,
+		      "Too deep nesting not detected");
+}
+
+static int encode_pass(char *out, size_t size, const void *ctx)
+{
+	struct json_writer writer;
+
+	json_writer_init(&writer, out, size);
+	json_writer_obj_start(&writer, NULL);
+	json_writer_str(&writer, "appId", ctx);
+	json_writer_obj_end(&writer);
+
+	return json_writer_finish(&writer);
+}
+
+static int failing_pass(char *out, size_t size, const void *ctx)
+{
+	return -EINVAL;
+}
+
+static const struct json_writer_allocator allocator = {
+	.alloc = k_malloc,
+	.free = k_free,
+};
+
+static void test_json_writer_encode_alloc(void)
+{
+	char *out = NULL;
+	int len;
+
+	len = json_writer_encode_alloc(encode_pass, "GPS", &allocator, &out);
+	zassert_equal(len, strlen("{\"appId\":\"GPS\"}"),
+		      "Unexpected length %d", len);
+	zassert_not_null(out, "No output");
+	zassert_true(!strcmp(out, "{\"appId\":\"GPS\"}"),
+		     "Unexpected output %s", out);
+	k_free(out);
+
+	out = NULL;
+	len = json_writer_encode_alloc(failing_pass, NULL, &allocator, &out);
+	zassert_equal(len, -EINVAL, "Error not returned");
+	zassert_is_null(out, "Output set on error");
+}
+
+void test_main(void)
+{
+	cJSON_Init();
+
+	ztest_test_suite(test_json_writer,
+		ztest_unit_test(test_json_writer_strings),
+		ztest_unit_test(test_json_writer_numbers),
+		ztest_unit_test(test_json_writer_nesting),
+		ztest_unit_test(test_json_writer_length_only),
+		ztest_unit_test(test_json_writer_overflow),
+		ztest_unit_test(test_json_writer_unbalanced),
+		ztest_unit_test(test_json_writer_encode_alloc)
+	);
+
+	ztest_run_test_suite(test_json_writer);
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+#include <bluetooth/mesh/light_ctrl_srv.h>
+
+#include "light_ctrl_prop.h"
+#include "sensor.h"
+
+static struct bt_mesh_light_ctrl_srv srv;
+
+/* Every Light LC property, with a valid value and the server field it is
+ * stored in.
+ */
+static const struct {
+	enum bt_mesh_light_ctrl_prop id;
+	const struct bt_mesh_sensor_format *format;
+	struct sensor_value val;
+	struct sensor_value too_big;
+	const void *field;
+} props[] = {
+	{ BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_ON,
+	  &bt_mesh_sensor_format_illuminance, { 500, 250000 }, { 167773 },
+	  &srv.reg.cfg.lux[LIGHT_CTRL_STATE_ON] },
+	{ BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_PROLONG,
+	  &bt_mesh_sensor_format_illuminance, { 200 }, { 167773 },
+	  &srv.reg.cfg.lux[LIGHT_CTRL_STATE_PROLONG] },
+	{ BT_MESH_LIGHT_CTRL_PROP_ILLUMINANCE_STANDBY,
+	  &bt_mesh_sensor_format_illuminance, { 10 }, { 167773 },
+	  &srv.reg.cfg.lux[LIGHT_CTRL_STATE_STANDBY] },
+	{ BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_ON,
+	  &bt_mesh_sensor_format_perceived_lightness, { 60000 }, { 65536 },
+	  &srv.cfg.light[LIGHT_CTRL_STATE_ON] },
+	{ BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_PROLONG,
+	  &bt_mesh_sensor_format_perceived_lightness, { 30000 }, { 65536 },
+	  &srv.cfg.light[LIGHT_CTRL_STATE_PROLONG] },
+	{ BT_MESH_LIGHT_CTRL_PROP_LIGHTNESS_STANDBY,
+	  &bt_mesh_sensor_format_perceived_lightness, { 1000 }, { 65536 },
+	  &srv.cfg.light[LIGHT_CTRL_STATE_STANDBY] },
+	{ BT_MESH_LIGHT_CTRL_PROP_REG_ACCURACY,
+	  &bt_mesh_sensor_format_percentage_8, { 5 }, { 101 },
+	  &srv.reg.cfg.accuracy },
+	{ BT_MESH_LIGHT_CTRL_PROP_REG_KID,
+	  &bt_mesh_sensor_format_coefficient, { 25 }, { 1001 },
+	  &srv.reg.cfg.kid },
+	{ BT_MESH_LIGHT_CTRL_PROP_REG_KIU,
+	  &bt_mesh_sensor_format_coefficient, { 250 }, { 1001 },
+	  &srv.reg.cfg.kiu },
+	{ BT_MESH_LIGHT_CTRL_PROP_REG_KPD,
+	  &bt_mesh_sensor_format_coefficient, { 80 }, { 1001 },
+	  &srv.reg.cfg.kpd },
+	{ BT_MESH_LIGHT_CTRL_PROP_REG_KPU,
+	  &bt_mesh_sensor_format_coefficient, { 100 }, { 1001 },
+	  &srv.reg.cfg.kpu },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_PROLONG,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 5, 500000 }, { 16778 },
+	  &srv.cfg.fade_prolong },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_ON,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 1 }, { 16778 },
+	  &srv.cfg.fade_on },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_AUTO,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 3 }, { 16778 },
+	  &srv.cfg.fade_standby_auto },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_FADE_STANDBY_MANUAL,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 0, 250000 },
+	  { 16778 }, &srv.cfg.fade_standby_manual },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_OCCUPANCY_DELAY,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 2 }, { 16778 },
+	  &srv.cfg.occupancy_delay },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_PROLONG,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 10 }, { 16778 },
+	  &srv.cfg.prolong },
+	{ BT_MESH_LIGHT_CTRL_PROP_TIME_ON,
+	  &bt_mesh_sensor_format_time_millisecond_24, { 60 }, { 16778 },
+	  &srv.cfg.on },
+};
+
+static void test_lookup(void)
+{
+	bool seen[LIGHT_CTRL_PROP_COUNT] = { 0 };
+	const struct light_ctrl_prop *prop;
+
+	zassert_equal(ARRAY_SIZE(props), LIGHT_CTRL_PROP_COUNT,
+		      "Not all properties tested");
+
+	for (int i = 0; i < ARRAY_SIZE(props); i++) {
+		prop = light_ctrl_prop_get(props[i].id);
+
+		zassert_not_null(prop, "0x%04x not found", props[i].id);
+		zassert_equal_ptr(prop->format, props[i].format,
+				  "0x%04x: Wrong format", props[i].id);
+		zassert_equal_ptr(light_ctrl_prop_data(&srv, prop),
+				  props[i].field, "0x%04x: Wrong field",
+				  props[i].id);
+		zassert_true(light_ctrl_prop_size(prop) > 0,
+			     "0x%04x: No size", props[i].id);
+		zassert_true(light_ctrl_prop_index(prop) <
+			     LIGHT_CTRL_PROP_COUNT, "0x%04x: Invalid index",
+			     props[i].id);
+		zassert_false(seen[light_ctrl_prop_index(prop)],
+			      "0x%04x: Index used twice", props[i].id);
+		seen[light_ctrl_prop_index(prop)] = true;
+	}
+
+	zassert_is_null(light_ctrl_prop_get(LIGHT_CTRL_PROP_ID_MIN - 1),
+			"Found property below the range");
+	zassert_is_null(light_ctrl_prop_get(LIGHT_CTRL_PROP_ID_MAX + 1),
+			"Found property above the range");
+	zassert_is_null(light_ctrl_prop_get(BT_MESH_PROP_ID_PRESENT_AMB_TEMP),
+			"Found other property");
+}
+
+static void test_read_write(void)
+{
+	const struct light_ctrl_prop *prop;
+	struct sensor_value val;
+	int err;
+
+	memset(&srv, 0, sizeof(srv));
+
+	for (int i = 0; i < ARRAY_SIZE(props); i++) {
+		prop = light_ctrl_prop_get(props[i].id);
+
+		err = light_ctrl_prop_write(&srv, prop, &props[i].val);
+		zassert_equal(err, 0, "0x%04x: Write failed: %d", props[i].id,
+			      err);
+
+		light_ctrl_prop_read(&srv, prop, &val);
+		zassert_equal(val.val1, props[i].val.val1,
+			      "0x%04x: Wrong value %d", props[i].id, val.val1);
+		zassert_equal(val.val2, props[i].val.val2,
+			      "0x%04x: Wrong fraction %d", props[i].id,
+			      val.val2);
+
+		err = light_ctrl_prop_write(&srv, prop, &props[i].val);
+		zassert_equal(err, -EALREADY, "0x%04x: Changed by same value",
+			      props[i].id);
+
+		err = light_ctrl_prop_write(&srv, prop, &props[i].too_big);
+		zassert_equal(err, -EINVAL, "0x%04x: Too big value written",
+			      props[i].id);
+		light_ctrl_prop_read(&srv, prop, &val);
+		zassert_equal(val.val1, props[i].val.val1,
+			      "0x%04x: Changed by invalid value", props[i].id);
+	}
+
+	/* The fields are set, not only the registry values */
+	zassert_equal(srv.cfg.fade_prolong, 5500, "Wrong fade prolong time");
+	zassert_equal(srv.cfg.light[LIGHT_CTRL_STATE_ON], 60000,
+		      "Wrong lightness on");
+	zassert_equal(srv.reg.cfg.accuracy, 5, "Wrong accuracy");
+}
+
+static void test_encode_decode(void)
+{
+	const struct light_ctrl_prop *prop;
+	struct sensor_value val;
+	int err;
+
+	NET_BUF_SIMPLE_DEFINE(buf,
+			      CONFIG_BT_MESH_SENSOR_CHANNEL_ENCODED_SIZE_MAX);
+
+	for (int i = 0; i < ARRAY_SIZE(props); i++) {
+		prop = light_ctrl_prop_get(props[i].id);
+
+		net_buf_simple_reset(&buf);
+		err = sensor_ch_encode(&buf, prop->format, &props[i].val);
+		zassert_equal(err, 0, "0x%04x: Encoding failed", props[i].id);
+
+		err = sensor_ch_decode(&buf, prop->format, &val);
+		zassert_equal(err, 0, "0x%04x: Decoding failed", props[i].id);
+		zassert_equal(val.val1, props[i].val.val1,
+			      "0x%04x: Wrong decoded value %d", props[i].id,
+			      val.val1);
+	}
+}
+
+static void test_batch(void)
+{
+	struct bt_mesh_light_ctrl_prop_val vals[ARRAY_SIZE(props)];
+	const struct light_ctrl_prop *prop;
+	int err;
+
+	memset(&srv, 0, sizeof(srv));
+
+	for (int i = 0; i < ARRAY_SIZE(props); i++) {
+		vals[i].id = props[i].id;
+		vals[i].val = props[i].val;
+	}
+
+	/* One invalid value rejects the whole batch */
+	vals[3].val = props[3].too_big;
+	err = bt_mesh_light_ctrl_srv_prop_set(&srv, vals, ARRAY_SIZE(vals));
+	zassert_equal(err, -EINVAL, "Invalid batch accepted");
+	zassert_equal(srv.cfg.light[LIGHT_CTRL_STATE_ON], 0,
+		      "Invalid batch partially applied");
+	zassert_equal(atomic_get(&srv.props_dirty), 0,
+		      "Invalid batch marked for storage");
+
+	vals[3].val = props[3].val;
+	err = bt_mesh_light_ctrl_srv_prop_set(&srv, vals, ARRAY_SIZE(vals));
+	zassert_equal(err, 0, "Batch set failed: %d", err);
+	zassert_equal(atomic_get(&srv.props_dirty),
+		      BIT(LIGHT_CTRL_PROP_COUNT) - 1,
+		      "Changed properties not marked for storage");
+
+	/* Only changed properties are stored again */
+	atomic_clear(&srv.props_dirty);
+	vals[0].val.val1++;
+	err = bt_mesh_light_ctrl_srv_prop_set(&srv, vals, ARRAY_SIZE(vals));
+	zassert_equal(err, 0, "Batch set failed: %d", err);
+	prop = light_ctrl_prop_get(vals[0].id);
+	zassert_equal(atomic_get(&srv.props_dirty),
+		      BIT(light_ctrl_prop_index(prop)),
+		      "Wrong properties marked for storage");
+
+	memset(vals, 0, sizeof(vals));
+	for (int i = 0; i < ARRAY_SIZE(props); i++) {
+		vals[i].id = props[ARRAY_SIZE(props) - 1 - i].id;
+	}
+
+	err = bt_mesh_light_ctrl_srv_prop_get(&srv, vals, ARRAY_SIZE(vals));
+	zassert_equal(err, 0, "Batch get failed: %d", err);
+
+	/* The last one is the changed illuminance */
+	for (int i = 0; i < ARRAY_SIZE(props) - 1; i++) {
+		int j = ARRAY_SIZE(props) - 1 - i;
+
+		zassert_equal(vals[i].val.val1, props[j].val.val1,
+			      "0x%04x: Wrong value", vals[i].id);
+	}
+
+	vals[0].id = BT_MESH_PROP_ID_PRESENT_AMB_TEMP;
+	err = bt_mesh_light_ctrl_srv_prop_get(&srv, vals, ARRAY_SIZE(vals));
+	zassert_equal(err, -ENOENT, "Unknown property accepted");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(light_ctrl_prop_test,
+			 ztest_unit_test(test_lookup),
+			 ztest_unit_test(test_read_write),
+			 ztest_unit_test(test_encode_decode),
+			 ztest_unit_test(test_batch)
+			 );
+	ztest_run_test_suite(light_ctrl_prop_test);
+}
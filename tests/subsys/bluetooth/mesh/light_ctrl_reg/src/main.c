@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+
+#include "light_ctrl_reg.h"
+
+#define INTERVAL 100
+#define LUX_MAX 167772
+#define CONFORMANCE_STEPS 1000
+#define BENCHMARK_STEPS 10000
+
+/* Regulator of a single server, as stepped before all regulators were
+ * stepped together.
+ */
+struct ref_reg {
+	uint32_t lux;
+	uint32_t ambient;
+	uint16_t kiu;
+	uint16_t kid;
+	uint16_t kpu;
+	uint16_t kpd;
+	uint8_t accuracy;
+	uint16_t i;
+	uint16_t output;
+};
+
+static struct light_ctrl_reg reg;
+static struct ref_reg ref[LIGHT_CTRL_REG_COUNT];
+static uint32_t seed;
+
+static uint32_t rand_get(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 8;
+}
+
+static bool ref_step(struct ref_reg *r)
+{
+	int32_t error = r->lux - r->ambient;
+	/* Accuracy should be in percent and both up and down: */
+	int32_t accuracy = (r->accuracy * r->lux) / (2 * 100);
+	int16_t input;
+
+	if (error > accuracy) {
+		input = MIN(INT16_MAX, error - accuracy);
+	} else if (error < -accuracy) {
+		input = MAX(INT16_MIN, error + accuracy);
+	} else {
+		return false;
+	}
+
+	if (input >= 0) {
+		int32_t p = input * r->kpu;
+		int64_t i = ((int64_t)input * INTERVAL * r->kiu) /
+			    MSEC_PER_SEC;
+
+		r->i = MIN(UINT16_MAX, r->i + i);
+		r->output = MIN(UINT16_MAX, r->i + p);
+	} else {
+		int32_t p = input * r->kpd;
+		int64_t i = ((int64_t)input * INTERVAL * r->kid) /
+			    MSEC_PER_SEC;
+
+		r->i = MAX(0, r->i + i);
+		r->output = MAX(0, r->i + p);
+	}
+
+	return true;
+}
+
+static void reg_init(void)
+{
+	memset(&reg, 0, sizeof(reg));
+	memset(ref, 0, sizeof(ref));
+	reg.interval = INTERVAL;
+
+	for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+		/* Every other instance gets the full coefficient range. */
+		uint32_t range = (n & 1) ? (UINT16_MAX + 1) : 1001;
+
+		ref[n].kiu = reg.kiu[n] = rand_get() % range;
+		ref[n].kid = reg.kid[n] = rand_get() % range;
+		ref[n].kpu = reg.kpu[n] = rand_get() % range;
+		ref[n].kpd = reg.kpd[n] = rand_get() % range;
+		ref[n].accuracy = reg.accuracy[n] = rand_get() % 101;
+	}
+}
+
+static void lux_set(int n, uint32_t lux, uint32_t ambient)
+{
+	ref[n].lux = reg.target[n] = lux;
+	ref[n].ambient = reg.ambient[n] = ambient;
+}
+
+static void test_conformance(void)
+{
+	uint32_t active;
+	uint32_t stepped;
+	uint32_t lux;
+
+	seed = 1;
+	reg_init();
+
+	for (int step = 0; step < CONFORMANCE_STEPS; step++) {
+		active = rand_get() | (rand_get() << 16);
+
+		for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+			/* Mostly small errors, to stay within the integral
+			 * range for a while.
+			 */
+			lux = 32 + rand_get() % (LUX_MAX - 63);
+			if (rand_get() & 1) {
+				lux_set(n, lux, lux + rand_get() % 64 - 32);
+			} else {
+				lux_set(n, lux, rand_get() % (LUX_MAX + 1));
+			}
+		}
+
+		stepped = light_ctrl_reg_step(&reg, active);
+
+		for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+			bool expected = (active & BIT(n)) && ref_step(&ref[n]);
+
+			zassert_equal(!!(stepped & BIT(n)), expected,
+				      "Step %d: Instance %d %sstepped", step, n,
+				      expected ? "not " : "");
+			zassert_equal(reg.i[n], ref[n].i,
+				      "Step %d: Instance %d integral %u, not %u",
+				      step, n, reg.i[n], ref[n].i);
+			zassert_equal(reg.output[n], ref[n].output,
+				      "Step %d: Instance %d output %u, not %u",
+				      step, n, reg.output[n], ref[n].output);
+		}
+	}
+}
+
+static void test_dead_band(void)
+{
+	uint32_t stepped;
+
+	reg_init();
+	reg.accuracy[0] = 10;
+	reg.i[0] = 1000;
+	reg.output[0] = 1000;
+
+	/* The dead band is 5 % of the target both ways */
+	reg.target[0] = 1000;
+	reg.ambient[0] = 1030;
+	stepped = light_ctrl_reg_step(&reg, BIT(0));
+	zassert_equal(stepped, 0, "Stepped below the target");
+
+	reg.ambient[0] = 970;
+	stepped = light_ctrl_reg_step(&reg, BIT(0));
+	zassert_equal(stepped, 0, "Stepped above the target");
+	zassert_equal(reg.i[0], 1000, "Integral changed");
+	zassert_equal(reg.output[0], 1000, "Output changed");
+
+	/* Only the error outside of the dead band is regulated */
+	reg.kpu[0] = 1;
+	reg.kiu[0] = 0;
+	reg.ambient[0] = 900;
+	stepped = light_ctrl_reg_step(&reg, BIT(0));
+	zassert_equal(stepped, BIT(0), "Not stepped");
+	zassert_equal(reg.output[0], 1050, "Wrong output: %u", reg.output[0]);
+
+	reg.kpd[0] = 1;
+	reg.kid[0] = 0;
+	reg.ambient[0] = 1100;
+	stepped = light_ctrl_reg_step(&reg, BIT(0));
+	zassert_equal(stepped, BIT(0), "Not stepped");
+	zassert_equal(reg.output[0], 950, "Wrong output: %u", reg.output[0]);
+}
+
+static void test_inactive(void)
+{
+	struct light_ctrl_reg before;
+	uint32_t stepped;
+
+	reg_init();
+
+	for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+		lux_set(n, 1000, 0);
+	}
+
+	before = reg;
+	stepped = light_ctrl_reg_step(&reg, BIT(1) | BIT(30));
+
+	zassert_equal(stepped, BIT(1) | BIT(30), "Wrong instances stepped");
+
+	for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+		if (n == 1 || n == 30) {
+			continue;
+		}
+
+		zassert_equal(reg.i[n], before.i[n], "Instance %d changed", n);
+		zassert_equal(reg.output[n], before.output[n],
+			      "Instance %d changed", n);
+	}
+}
+
+static void test_saturation(void)
+{
+	reg_init();
+	reg.kiu[0] = UINT16_MAX;
+	reg.kpu[0] = UINT16_MAX;
+	reg.kid[1] = UINT16_MAX;
+	reg.kpd[1] = UINT16_MAX;
+	reg.accuracy[0] = 0;
+	reg.accuracy[1] = 0;
+	lux_set(0, LUX_MAX, 0);
+	lux_set(1, 0, LUX_MAX);
+	reg.i[1] = UINT16_MAX;
+
+	light_ctrl_reg_step(&reg, BIT(0) | BIT(1));
+
+	zassert_equal(reg.i[0], UINT16_MAX, "Integral overflow");
+	zassert_equal(reg.output[0], UINT16_MAX, "Output overflow");
+	zassert_equal(reg.i[1], 0, "Integral underflow");
+	zassert_equal(reg.output[1], 0, "Output underflow");
+}
+
+/* Benchmark. The cycle counter only advances in real time on hardware. */
+static void test_benchmark(void)
+{
+	uint32_t start;
+	uint32_t us;
+
+	seed = 2;
+	reg_init();
+
+	for (int n = 0; n < LIGHT_CTRL_REG_COUNT; n++) {
+		lux_set(n, rand_get() % 1000, rand_get() % 1000);
+	}
+
+	start = k_cycle_get_32();
+
+	for (int step = 0; step < BENCHMARK_STEPS; step++) {
+		light_ctrl_reg_step(&reg, UINT32_MAX);
+		/* Keep the regulators from settling */
+		reg.ambient[step % LIGHT_CTRL_REG_COUNT] = rand_get() % 1000;
+	}
+
+	us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	TC_PRINT("%d steps of %d instances in %u us: %u steps/ms\n",
+		 BENCHMARK_STEPS, LIGHT_CTRL_REG_COUNT, us,
+		 (uint32_t)((BENCHMARK_STEPS * 1000ULL) / MAX(us, 1)));
+}
+
+void test_main(void)
+{
+	ztest_test_suite(light_ctrl_reg_test,
+			 ztest_unit_test(test_conformance),
+			 ztest_unit_test(test_dead_band),
+			 ztest_unit_test(test_inactive),
+			 ztest_unit_test(test_saturation),
+			 ztest_unit_test(test_benchmark)
+			 );
+	ztest_run_test_suite(light_ctrl_reg_test);
+}
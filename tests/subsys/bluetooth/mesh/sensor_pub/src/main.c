@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+#include <bluetooth/mesh/models.h>
+
+#include "sensor.h"
+
+#define PUBS 30
+/* Length of the largest Sensor Status entry, the light level */
+#define ENTRY_LEN_MAX 5
+
+enum {
+	MOTION,
+	PEOPLE,
+	PRESENCE,
+	LIGHT,
+	TEMP,
+	TIME,
+	SENSOR_COUNT,
+};
+
+static struct {
+	int32_t value[SENSOR_COUNT];
+	uint32_t calls[SENSOR_COUNT];
+} gets;
+
+static int sensor_get(struct bt_mesh_sensor *sensor,
+		      struct bt_mesh_msg_ctx *ctx, struct sensor_value *rsp);
+
+/* Listed in the order of their IDs */
+static struct bt_mesh_sensor sensor_list[SENSOR_COUNT] = {
+	[MOTION] = {
+		.type = &bt_mesh_sensor_motion_sensed,
+		.get = sensor_get,
+	},
+	[PEOPLE] = {
+		.type = &bt_mesh_sensor_people_count,
+		.get = sensor_get,
+	},
+	[PRESENCE] = {
+		.type = &bt_mesh_sensor_presence_detected,
+		.get = sensor_get,
+	},
+	[LIGHT] = {
+		.type = &bt_mesh_sensor_present_amb_light_level,
+		.get = sensor_get,
+		.change_notify = true,
+	},
+	[TEMP] = {
+		.type = &bt_mesh_sensor_present_amb_temp,
+		.get = sensor_get,
+	},
+	[TIME] = {
+		.type = &bt_mesh_sensor_time_since_motion_sensed,
+		.get = sensor_get,
+	},
+};
+
+static struct bt_mesh_sensor *const sensors[] = {
+	&sensor_list[TIME],
+	&sensor_list[TEMP],
+	&sensor_list[LIGHT],
+	&sensor_list[PRESENCE],
+	&sensor_list[PEOPLE],
+	&sensor_list[MOTION],
+};
+
+static struct bt_mesh_sensor_srv srv =
+	BT_MESH_SENSOR_SRV_INIT(sensors, ARRAY_SIZE(sensors));
+
+static struct bt_mesh_model mod = {
+	.user_data = &srv,
+	.pub = &srv.pub,
+};
+
+static int sensor_get(struct bt_mesh_sensor *sensor,
+		      struct bt_mesh_msg_ctx *ctx, struct sensor_value *rsp)
+{
+	int idx = sensor - sensor_list;
+
+	gets.calls[idx]++;
+	rsp[0].val1 = gets.value[idx];
+	rsp[0].val2 = 0;
+
+	return 0;
+}
+
+static void fixture_setup(void)
+{
+	zassert_equal(_bt_mesh_sensor_srv_cb.init(&mod), 0, "Init failed");
+
+	srv.pub.period = BT_MESH_PUB_PERIOD_SEC(1);
+}
+
+static void test_reset(void)
+{
+	memset(&gets, 0, sizeof(gets));
+	srv.seq = 0;
+
+	for (int i = 0; i < SENSOR_COUNT; i++) {
+		sensor_list[i].state.seq = 0;
+		memset(&sensor_list[i].state.prev, 0,
+		       sizeof(sensor_list[i].state.prev));
+		atomic_clear(&sensor_list[i].state.changed);
+	}
+}
+
+/* Run a publication period with the given period divisor, check the
+ * publication, and return the published sensors as a bitfield.
+ */
+static uint32_t publish(uint8_t period_div)
+{
+	struct net_buf_simple buf;
+	uint32_t published = 0;
+	int prev_id = -1;
+	int err;
+
+	srv.pub.period_div = period_div;
+
+	err = _bt_mesh_sensor_srv_update_handler(&mod);
+	if (err) {
+		zassert_equal(err, -ENOENT, "Update failed (err: %d)", err);
+		return 0;
+	}
+
+	net_buf_simple_init_with_data(&buf, srv.pub.msg->data,
+				      srv.pub.msg->len);
+	zassert_equal(net_buf_simple_pull_u8(&buf), BT_MESH_SENSOR_OP_STATUS,
+		      "Wrong opcode");
+
+	zassert_true(buf.len <= CONFIG_BT_MESH_SENSOR_SRV_PUB_LEN,
+		     "Publication too long: %u", buf.len);
+
+	while (buf.len) {
+		uint16_t id;
+		uint8_t len;
+		int i;
+
+		sensor_status_id_decode(&buf, &len, &id);
+		net_buf_simple_pull(&buf, len);
+
+		zassert_true(id > prev_id, "Not sorted by ID");
+		prev_id = id;
+
+		for (i = 0; i < SENSOR_COUNT; i++) {
+			if (sensor_list[i].type->id == id) {
+				break;
+			}
+		}
+
+		zassert_true(i < SENSOR_COUNT, "Unknown sensor 0x%04x", id);
+		zassert_equal(len, sensor_value_len(sensor_list[i].type),
+			      "Wrong length for 0x%04x", id);
+		published |= BIT(i);
+	}
+
+	return published;
+}
+
+static void test_due_deferral(void)
+{
+	uint32_t last[SENSOR_COUNT] = {};
+	uint32_t total_calls = 0;
+	uint32_t total_pubs = 0;
+
+	test_reset();
+
+	/* Nothing is published until the minimum interval has passed */
+	zassert_equal(publish(0), 0, "Published before the min interval");
+
+	/* Every sensor is due in every period, but only some of them fit */
+	for (uint32_t seq = 1; seq <= PUBS; seq++) {
+		uint32_t published = publish(0);
+		uint32_t len = srv.pub.msg->len - 1;
+
+		zassert_true(len > CONFIG_BT_MESH_SENSOR_SRV_PUB_LEN -
+					   ENTRY_LEN_MAX,
+			     "Publication %u not filled: %u", seq, len);
+
+		for (int i = 0; i < SENSOR_COUNT; i++) {
+			if (!(published & BIT(i))) {
+				continue;
+			}
+
+			zassert_true(seq - last[i] <= SENSOR_COUNT,
+				     "Sensor %d starved for %u periods", i,
+				     seq - last[i]);
+			last[i] = seq;
+			total_pubs++;
+		}
+	}
+
+	for (int i = 0; i < SENSOR_COUNT; i++) {
+		zassert_true(PUBS - last[i] < SENSOR_COUNT,
+			     "Sensor %d starved", i);
+		total_calls += gets.calls[i];
+	}
+
+	/* Deferred sensors are not sampled */
+	zassert_equal(total_calls, total_pubs, "%u samples for %u values",
+		      total_calls, total_pubs);
+}
+
+static void test_change_notify(void)
+{
+	uint32_t published;
+
+	test_reset();
+
+	/* With a period divisor of 2, the sensors are due every 4 periods,
+	 * and checked against their delta threshold in between.
+	 */
+	zassert_equal(publish(2), 0, "Published before the min interval");
+	zassert_equal(publish(2), 0, "Published unchanged values");
+	zassert_equal(publish(2), 0, "Published unchanged values");
+
+	zassert_equal(gets.calls[LIGHT], 0, "Sampled without change");
+	zassert_equal(gets.calls[MOTION], 2, "Not sampled for threshold");
+
+	/* A reported change is sampled in the next period */
+	gets.value[LIGHT] = 100;
+	bt_mesh_sensor_srv_notify(&srv, &sensor_list[LIGHT]);
+
+	published = publish(2);
+	zassert_equal(published, BIT(LIGHT), "Change not published");
+	zassert_equal(gets.calls[LIGHT], 1, "Not sampled on change");
+
+	/* Not sampled again until the publication interval expires */
+	for (int i = 0; i < 3; i++) {
+		published = publish(2);
+		zassert_false(published & BIT(LIGHT), "Published again");
+	}
+
+	zassert_equal(gets.calls[LIGHT], 1, "Sampled without change");
+
+	published = publish(2);
+	zassert_true(published & BIT(LIGHT), "Not published on interval");
+	zassert_equal(gets.calls[LIGHT], 2, "Not sampled on interval");
+
+	/* A reported change is only sampled when there's room to publish it,
+	 * after the sensors that are due.
+	 */
+	bt_mesh_sensor_srv_notify(&srv, &sensor_list[LIGHT]);
+
+	for (int i = 0; i < 2; i++) {
+		published = publish(2);
+		zassert_false(published & BIT(LIGHT), "Published again");
+		zassert_equal(gets.calls[LIGHT], 2, "Sampled without room");
+	}
+
+	/* The value is within the delta threshold, and is not published */
+	published = publish(2);
+	zassert_false(published & BIT(LIGHT), "Unchanged value published");
+	zassert_equal(gets.calls[LIGHT], 3, "Change not sampled");
+}
+
+void test_main(void)
+{
+	fixture_setup();
+
+	ztest_test_suite(sensor_pub_test,
+			 ztest_unit_test(test_due_deferral),
+			 ztest_unit_test(test_change_notify)
+			 );
+	ztest_run_test_suite(sensor_pub_test);
+}
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+#include <bluetooth/mesh/models.h>
+
+#include "sensor.h"
+#include "sensor_series.h"
+
+#define LUX_COLUMNS 400
+#define LUX_WIDTH 10
+/* Fills the column index pool */
+#define CURRENT_COLUMNS CONFIG_BT_MESH_SENSOR_SRV_COLUMN_INDEX_SIZE
+#define VOLTAGE_COLUMNS 8
+#define MSGS_MAX 100
+#define RANGE_TESTS 200
+#define BENCHMARK_ROUNDS 10
+
+/* Histograms, sorted, reversed and searched linearly. */
+static struct bt_mesh_sensor_column lux_columns[LUX_COLUMNS];
+static struct bt_mesh_sensor_column current_columns[CURRENT_COLUMNS];
+static struct bt_mesh_sensor_column voltage_columns[VOLTAGE_COLUMNS];
+
+static struct {
+	uint32_t calls;
+	uint32_t columns;
+} gets;
+
+static uint32_t seed;
+
+static uint32_t rand_get(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 8;
+}
+
+static void column_values(const struct bt_mesh_sensor_column *col,
+			  uint32_t index, struct sensor_value *value)
+{
+	value[0].val1 = index % 101;
+	value[0].val2 = 0;
+	value[1] = col->start;
+	value[2] = col->end;
+}
+
+static int lux_get_range(
+	struct bt_mesh_sensor *sensor, struct bt_mesh_msg_ctx *ctx,
+	const struct bt_mesh_sensor_column *const *columns, uint32_t count,
+	struct sensor_value values[][CONFIG_BT_MESH_SENSOR_CHANNELS_MAX])
+{
+	gets.calls++;
+	gets.columns += count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		column_values(columns[i], columns[i] - lux_columns, values[i]);
+	}
+
+	return 0;
+}
+
+static int current_get(struct bt_mesh_sensor *sensor,
+		       struct bt_mesh_msg_ctx *ctx,
+		       const struct bt_mesh_sensor_column *column,
+		       struct sensor_value *value)
+{
+	gets.calls++;
+	gets.columns++;
+
+	column_values(column, column - current_columns, value);
+
+	return 0;
+}
+
+static int voltage_get(struct bt_mesh_sensor *sensor,
+		       struct bt_mesh_msg_ctx *ctx,
+		       const struct bt_mesh_sensor_column *column,
+		       struct sensor_value *value)
+{
+	gets.calls++;
+	gets.columns++;
+
+	column_values(column, column - voltage_columns, value);
+
+	return 0;
+}
+
+static struct bt_mesh_sensor lux_sensor = {
+	.type = &bt_mesh_sensor_rel_exposure_time_in_an_illuminance_range,
+	.series = {
+		.columns = lux_columns,
+		.column_count = ARRAY_SIZE(lux_columns),
+		.get_range = lux_get_range,
+	},
+};
+
+static struct bt_mesh_sensor current_sensor = {
+	.type = &bt_mesh_sensor_rel_runtime_in_an_input_current_range,
+	.series = {
+		.columns = current_columns,
+		.column_count = ARRAY_SIZE(current_columns),
+		.get = current_get,
+	},
+};
+
+static struct bt_mesh_sensor voltage_sensor = {
+	.type = &bt_mesh_sensor_rel_runtime_in_an_input_voltage_range,
+	.series = {
+		.columns = voltage_columns,
+		.column_count = ARRAY_SIZE(voltage_columns),
+		.get = voltage_get,
+	},
+};
+
+static struct bt_mesh_sensor *const sensors[] = {
+	&lux_sensor,
+	&current_sensor,
+	&voltage_sensor,
+};
+
+static struct bt_mesh_sensor_srv srv =
+	BT_MESH_SENSOR_SRV_INIT(sensors, ARRAY_SIZE(sensors));
+
+static struct bt_mesh_model mod = {
+	.user_data = &srv,
+};
+
+/* Captured responses */
+
+static struct {
+	uint8_t data[BT_MESH_TX_SDU_MAX];
+	uint16_t len;
+	uint16_t tailroom;
+} msgs[MSGS_MAX];
+static uint32_t msg_count;
+
+int __wrap_bt_mesh_model_send(struct bt_mesh_model *model,
+			      struct bt_mesh_msg_ctx *ctx,
+			      struct net_buf_simple *msg,
+			      const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+	zassert_true(msg_count < MSGS_MAX, "Too many messages");
+	zassert_true(msg->len <= sizeof(msgs[0].data), "Message too long");
+
+	memcpy(msgs[msg_count].data, msg->data, msg->len);
+	msgs[msg_count].len = msg->len;
+	msgs[msg_count].tailroom = net_buf_simple_tailroom(msg);
+	msg_count++;
+
+	return 0;
+}
+
+static void msg_recv(uint32_t opcode, struct net_buf_simple *buf)
+{
+	struct bt_mesh_msg_ctx ctx = { .addr = 0x0001 };
+	const struct bt_mesh_model_op *op;
+
+	msg_count = 0;
+	memset(&gets, 0, sizeof(gets));
+
+	for (op = _bt_mesh_sensor_srv_op; op->func; op++) {
+		if (op->opcode == opcode) {
+			op->func(&mod, &ctx, buf);
+			return;
+		}
+	}
+
+	zassert_unreachable("No handler for 0x%04x", opcode);
+}
+
+static int64_t micro(const struct sensor_value *val)
+{
+	return val->val1 * 1000000LL + val->val2;
+}
+
+/* Accounts for the resolution of the encoded values. */
+static bool value_equal(const struct sensor_value *a,
+			const struct sensor_value *b)
+{
+	int64_t diff = micro(a) - micro(b);
+
+	return diff > -100 && diff < 100;
+}
+
+static void fixture_setup(void)
+{
+	for (int i = 0; i < LUX_COLUMNS; i++) {
+		lux_columns[i].start.val1 = i * LUX_WIDTH;
+		lux_columns[i].end.val1 = (i + 1) * LUX_WIDTH;
+	}
+
+	for (int i = 0; i < CURRENT_COLUMNS; i++) {
+		current_columns[i].start.val1 = CURRENT_COLUMNS - 1 - i;
+		current_columns[i].end.val1 = CURRENT_COLUMNS - i;
+	}
+
+	for (int i = 0; i < VOLTAGE_COLUMNS; i++) {
+		voltage_columns[i].start.val1 = (VOLTAGE_COLUMNS - 1 - i) * 10;
+		voltage_columns[i].end.val1 = (VOLTAGE_COLUMNS - i) * 10;
+	}
+
+	zassert_equal(_bt_mesh_sensor_srv_cb.init(&mod), 0, "Init failed");
+}
+
+/* Check the Series Status responses, and return the number of columns. */
+static uint32_t series_status_check(const struct bt_mesh_sensor *sensor)
+{
+	const struct bt_mesh_sensor_format *col_format =
+		bt_mesh_sensor_column_format_get(sensor->type);
+	size_t col_len = 2 * col_format->size + sensor_value_len(sensor->type);
+	struct sensor_value value[CONFIG_BT_MESH_SENSOR_CHANNELS_MAX];
+	struct sensor_value start;
+	struct sensor_value width;
+	struct net_buf_simple buf;
+	int64_t prev = INT64_MIN;
+	uint32_t count = 0;
+	int err;
+
+	zassert_true(msg_count > 0, "No response");
+
+	for (uint32_t m = 0; m < msg_count; m++) {
+		net_buf_simple_init_with_data(&buf, msgs[m].data, msgs[m].len);
+
+		zassert_equal(net_buf_simple_pull_u8(&buf),
+			      BT_MESH_SENSOR_OP_SERIES_STATUS, "Wrong opcode");
+		zassert_equal(net_buf_simple_pull_le16(&buf), sensor->type->id,
+			      "Wrong sensor");
+		zassert_true(msgs[m].tailroom >= BT_MESH_MIC_SHORT,
+			     "No room for the MIC");
+
+		/* All but the last message are packed full */
+		if (m < msg_count - 1) {
+			zassert_true(msgs[m].tailroom <
+					     col_len + BT_MESH_MIC_SHORT,
+				     "Message %u not full", m);
+		}
+
+		while (buf.len) {
+			err = sensor_ch_decode(&buf, col_format, &start);
+			zassert_equal(err, 0, "Start decode failed");
+			err = sensor_ch_decode(&buf, col_format, &width);
+			zassert_equal(err, 0, "Width decode failed");
+			err = sensor_value_decode(&buf, sensor->type, value);
+			zassert_equal(err, 0, "Value decode failed");
+
+			zassert_true(micro(&start) > prev,
+				     "Columns out of order");
+			zassert_true(value_equal(&value[1], &start),
+				     "Wrong column values");
+			prev = micro(&start);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static void series_get(const struct bt_mesh_sensor *sensor,
+		       const struct bt_mesh_sensor_column *range)
+{
+	const struct bt_mesh_sensor_format *col_format =
+		bt_mesh_sensor_column_format_get(sensor->type);
+
+	NET_BUF_SIMPLE_DEFINE(buf, BT_MESH_SENSOR_MSG_MAXLEN_SERIES_GET);
+	net_buf_simple_add_le16(&buf, sensor->type->id);
+
+	if (range) {
+		sensor_ch_encode(&buf, col_format, &range->start);
+		sensor_ch_encode(&buf, col_format, &range->end);
+	}
+
+	msg_recv(BT_MESH_SENSOR_OP_SERIES_GET, &buf);
+}
+
+static void test_index(void)
+{
+	zassert_is_null(lux_sensor.state.col_index, "Sorted columns indexed");
+	zassert_false(lux_sensor.state.col_unsorted, "Columns not sorted");
+
+	zassert_not_null(current_sensor.state.col_index, "Not indexed");
+	zassert_false(current_sensor.state.col_unsorted, "Not indexed");
+
+	/* The pool is full */
+	zassert_is_null(voltage_sensor.state.col_index, "Indexed");
+	zassert_true(voltage_sensor.state.col_unsorted, "Not linear");
+
+	for (int i = 0; i < CURRENT_COLUMNS; i++) {
+		zassert_equal(sensor_series_column(&current_sensor, i)->start.val1,
+			      i, "Column %d out of order", i);
+	}
+}
+
+static void column_get_check(const struct bt_mesh_sensor *sensor)
+{
+	const struct bt_mesh_sensor_column *columns = sensor->series.columns;
+	struct sensor_value missing;
+
+	for (uint32_t i = 0; i < sensor->series.column_count; i++) {
+		zassert_equal_ptr(
+			sensor_series_column_get(sensor, &columns[i].start),
+			&columns[i], "Column %u not found", i);
+
+		missing = columns[i].start;
+		missing.val2 = 500000;
+		zassert_is_null(sensor_series_column_get(sensor, &missing),
+				"Column found between columns");
+	}
+
+	missing.val1 = -1;
+	missing.val2 = 0;
+	zassert_is_null(sensor_series_column_get(sensor, &missing),
+			"Column found before the columns");
+}
+
+static void test_column_get(void)
+{
+	struct sensor_value value[CONFIG_BT_MESH_SENSOR_CHANNELS_MAX];
+	const struct bt_mesh_sensor_format *col_format =
+		bt_mesh_sensor_column_format_get(current_sensor.type);
+	const struct bt_mesh_sensor_column *col = &current_columns[10];
+	struct sensor_value start;
+	struct sensor_value width;
+	struct net_buf_simple rsp;
+
+	column_get_check(&lux_sensor);
+	column_get_check(&current_sensor);
+	column_get_check(&voltage_sensor);
+
+	/* Through the Column Get message */
+	NET_BUF_SIMPLE_DEFINE(buf, BT_MESH_SENSOR_MSG_MAXLEN_COLUMN_GET);
+	net_buf_simple_add_le16(&buf, current_sensor.type->id);
+	sensor_ch_encode(&buf, col_format, &col->start);
+
+	msg_recv(BT_MESH_SENSOR_OP_COLUMN_GET, &buf);
+
+	zassert_equal(msg_count, 1, "Wrong response count");
+	zassert_equal(gets.calls, 1, "Wrong getter call count");
+
+	net_buf_simple_init_with_data(&rsp, msgs[0].data, msgs[0].len);
+	zassert_equal(net_buf_simple_pull_u8(&rsp),
+		      BT_MESH_SENSOR_OP_COLUMN_STATUS, "Wrong opcode");
+	zassert_equal(net_buf_simple_pull_le16(&rsp), current_sensor.type->id,
+		      "Wrong sensor");
+	zassert_equal(sensor_ch_decode(&rsp, col_format, &start), 0,
+		      "Start decode failed");
+	zassert_equal(sensor_ch_decode(&rsp, col_format, &width), 0,
+		      "Width decode failed");
+	zassert_equal(sensor_value_decode(&rsp, current_sensor.type, value),
+		      0, "Value decode failed");
+	zassert_true(value_equal(&start, &col->start), "Wrong column");
+	zassert_true(value_equal(&value[0], &(struct sensor_value){ 10 }),
+		     "Wrong value");
+}
+
+static void range_check(const struct bt_mesh_sensor *sensor,
+			const struct bt_mesh_sensor_column *range)
+{
+	static bool selected[LUX_COLUMNS];
+	const struct bt_mesh_sensor_column *col;
+	uint32_t first;
+	uint32_t count;
+	bool expected;
+
+	memset(selected, 0, sizeof(selected));
+
+	count = sensor_series_range(sensor, range, &first);
+	zassert_true(first + count <= sensor->series.column_count,
+		     "Range out of bounds");
+
+	for (uint32_t pos = first; pos < first + count; pos++) {
+		col = sensor_series_column(sensor, pos);
+		if (bt_mesh_sensor_value_in_column(&col->start, range)) {
+			selected[col - sensor->series.columns] = true;
+		} else {
+			/* Only columns searched linearly are checked */
+			zassert_true(sensor->state.col_unsorted,
+				     "Column outside of the range selected");
+		}
+	}
+
+	for (uint32_t i = 0; i < sensor->series.column_count; i++) {
+		col = &sensor->series.columns[i];
+		expected = bt_mesh_sensor_value_in_column(&col->start, range);
+		zassert_equal(selected[i], expected,
+			      "Column %u %sselected for %d.%06d - %d.%06d", i,
+			      expected ? "not " : "", range->start.val1,
+			      range->start.val2, range->end.val1,
+			      range->end.val2);
+	}
+}
+
+static void range_rand(struct bt_mesh_sensor_column *range, int32_t max)
+{
+	range->start.val1 = rand_get() % (max + 2) - 1;
+	range->end.val1 = rand_get() % (max + 2) - 1;
+	/* Mostly on column boundaries */
+	range->start.val2 = (rand_get() & 1) ? 0 : 500000;
+	range->end.val2 = (rand_get() & 1) ? 0 : 500000;
+}
+
+static void test_range(void)
+{
+	struct bt_mesh_sensor_column range;
+
+	seed = 1;
+
+	for (int i = 0; i < RANGE_TESTS; i++) {
+		range_rand(&range, LUX_COLUMNS * LUX_WIDTH);
+		range_check(&lux_sensor, &range);
+
+		range_rand(&range, CURRENT_COLUMNS);
+		range_check(&current_sensor, &range);
+
+		range_rand(&range, VOLTAGE_COLUMNS * 10);
+		range_check(&voltage_sensor, &range);
+	}
+}
+
+static void test_series_get(void)
+{
+	struct bt_mesh_sensor_column range = {
+		.start = { 100 * LUX_WIDTH },
+		.end = { 200 * LUX_WIDTH - 5 },
+	};
+
+	/* All columns, in bulk */
+	series_get(&lux_sensor, NULL);
+
+	zassert_equal(series_status_check(&lux_sensor), LUX_COLUMNS,
+		      "Wrong column count");
+	zassert_equal(gets.columns, LUX_COLUMNS, "Wrong columns fetched");
+	zassert_equal(gets.calls,
+		      ceiling_fraction(LUX_COLUMNS,
+				       CONFIG_BT_MESH_SENSOR_SRV_SERIES_BATCH),
+		      "Wrong getter call count: %u", gets.calls);
+
+	TC_PRINT("%d columns in %u Series Status messages\n", LUX_COLUMNS,
+		 msg_count);
+
+	/* A range only fetches the columns in the range */
+	series_get(&lux_sensor, &range);
+
+	zassert_equal(series_status_check(&lux_sensor), 100,
+		      "Wrong column count");
+	zassert_equal(gets.columns, 100, "Wrong columns fetched");
+
+	/* One column at a time, in order */
+	series_get(&current_sensor, NULL);
+
+	zassert_equal(series_status_check(&current_sensor), CURRENT_COLUMNS,
+		      "Wrong column count");
+	zassert_equal(gets.calls, CURRENT_COLUMNS, "Wrong getter call count");
+
+	/* Columns searched linearly, in the range */
+	range.start.val1 = 20;
+	range.end.val1 = 40;
+	series_get(&voltage_sensor, &range);
+
+	zassert_equal(series_status_check(&voltage_sensor), 3,
+		      "Wrong column count");
+	zassert_equal(gets.calls, 3, "Wrong getter call count");
+}
+
+/* Benchmark. The cycle counter only advances in real time on hardware. */
+static void test_benchmark(void)
+{
+	const struct bt_mesh_sensor_column *col;
+	uint32_t start;
+	uint32_t linear;
+	uint32_t indexed;
+
+	start = k_cycle_get_32();
+
+	for (int r = 0; r < BENCHMARK_ROUNDS; r++) {
+		for (int i = 0; i < LUX_COLUMNS; i++) {
+			/* As the columns used to be looked up */
+			for (int j = 0; j < LUX_COLUMNS; j++) {
+				col = &lux_columns[j];
+				if (col->start.val1 ==
+					    lux_columns[i].start.val1 &&
+				    col->start.val2 ==
+					    lux_columns[i].start.val2) {
+					break;
+				}
+			}
+		}
+	}
+
+	linear = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	start = k_cycle_get_32();
+
+	for (int r = 0; r < BENCHMARK_ROUNDS; r++) {
+		for (int i = 0; i < LUX_COLUMNS; i++) {
+			col = sensor_series_column_get(&lux_sensor,
+						       &lux_columns[i].start);
+			zassert_not_null(col, "Column not found");
+		}
+	}
+
+	indexed = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	TC_PRINT("%d column lookups: %u us linear, %u us indexed\n",
+		 BENCHMARK_ROUNDS * LUX_COLUMNS, linear, indexed);
+
+	start = k_cycle_get_32();
+	series_get(&lux_sensor, NULL);
+
+	TC_PRINT("Series Get of %d columns: %u us, %u getter calls\n",
+		 LUX_COLUMNS, k_cyc_to_us_floor32(k_cycle_get_32() - start),
+		 gets.calls);
+}
+
+void test_main(void)
+{
+	fixture_setup();
+
+	ztest_test_suite(sensor_series_test,
+			 ztest_unit_test(test_index),
+			 ztest_unit_test(test_column_get),
+			 ztest_unit_test(test_range),
+			 ztest_unit_test(test_series_get),
+			 ztest_unit_test(test_benchmark)
+			 );
+	ztest_run_test_suite(sensor_series_test);
+}
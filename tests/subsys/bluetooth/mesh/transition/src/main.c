@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <ztest.h>
+#include <bluetooth/mesh/transition.h>
+
+#include "transition_internal.h"
+
+#define TICK CONFIG_BT_MESH_TRANSITION_TICK
+#define TRANSITION_COUNT 64
+#define GROUP_SIZE 8
+
+struct trans_ctx {
+	struct bt_mesh_transition transition;
+	uint32_t steps;
+	uint32_t ends;
+	/* Tick the transition ended in, counted from the test start */
+	uint32_t end_tick;
+	int32_t prev;
+};
+
+static void step(struct bt_mesh_transition *transition, int32_t level);
+static void end(struct bt_mesh_transition *transition);
+
+static const struct bt_mesh_transition_cb cb = {
+	.step = step,
+	.end = end,
+};
+
+static struct trans_ctx ctx[TRANSITION_COUNT] = {
+	[0 ... (TRANSITION_COUNT - 1)] = {
+		.transition = BT_MESH_TRANSITION_INIT(&cb),
+	},
+};
+
+/* Simulated time, driving the transitions */
+static int64_t now;
+/* Tick of the simulated time at the test start */
+static uint32_t start_tick;
+static uint32_t ticks;
+static uint32_t ended_in_tick;
+static uint32_t seed;
+/* Called at the end of every transition, if set */
+static void (*end_hook)(struct trans_ctx *c);
+
+static int64_t now_get(void)
+{
+	return now;
+}
+
+static uint32_t rand_get(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 8;
+}
+
+static void step(struct bt_mesh_transition *transition, int32_t level)
+{
+	struct trans_ctx *c = CONTAINER_OF(transition, struct trans_ctx,
+					   transition);
+
+	zassert_equal(c->ends, 0, "Stepped after the end");
+
+	c->steps++;
+	c->prev = level;
+}
+
+static void end(struct bt_mesh_transition *transition)
+{
+	struct trans_ctx *c = CONTAINER_OF(transition, struct trans_ctx,
+					   transition);
+
+	zassert_equal(c->prev, bt_mesh_transition_target_get(transition),
+		      "Ended before reaching the target");
+	zassert_equal(bt_mesh_transition_remaining_get(transition), 0,
+		      "Ended with remaining time");
+
+	c->ends++;
+	c->end_tick = ticks;
+	ended_in_tick++;
+
+	if (end_hook) {
+		end_hook(c);
+	}
+}
+
+static void test_reset(void)
+{
+	for (int i = 0; i < TRANSITION_COUNT; i++) {
+		ctx[i].ends = 0;
+		bt_mesh_transition_stop(&ctx[i].transition);
+		bt_mesh_transition_start(&ctx[i].transition, 0, NULL);
+		ctx[i].steps = 0;
+		ctx[i].end_tick = 0;
+		ctx[i].prev = 0;
+	}
+
+	/* Start each test on a tick boundary, after the previous one */
+	now += 100 * TICK - (now % TICK);
+	start_tick = now / TICK;
+	ticks = 0;
+	end_hook = NULL;
+}
+
+/* Run the transition engine for the given number of ticks, and return the
+ * number of transitions that ended in the last tick.
+ */
+static uint32_t advance(uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		ended_in_tick = 0;
+		now += TICK;
+		ticks++;
+		transition_tick();
+	}
+
+	return ended_in_tick;
+}
+
+static void test_interpolation(void)
+{
+	struct bt_mesh_model_transition params = { .time = 100 * TICK };
+	struct trans_ctx *c = &ctx[0];
+	int32_t prev = 0;
+
+	test_reset();
+
+	bt_mesh_transition_start(&c->transition, 1000, &params);
+
+	zassert_equal(bt_mesh_transition_remaining_get(&c->transition),
+		      params.time, "Wrong remaining time");
+	zassert_equal(bt_mesh_transition_level_get(&c->transition), 0,
+		      "Level changed at start");
+
+	for (int i = 0; i < 50; i++) {
+		advance(1);
+		zassert_true(c->prev >= prev, "Level not increasing");
+		prev = c->prev;
+	}
+
+	zassert_within(bt_mesh_transition_level_get(&c->transition), 500,
+		       2000 / 100, "Wrong level halfway: %d",
+		       bt_mesh_transition_level_get(&c->transition));
+
+	advance(49);
+	zassert_equal(c->ends, 0, "Ended early");
+
+	/* Ends in the first tick at or after the transition time */
+	advance(2);
+	zassert_equal(c->ends, 1, "Not ended");
+	zassert_equal(bt_mesh_transition_level_get(&c->transition), 1000,
+		      "Target not reached");
+
+	advance(10);
+	zassert_equal(c->ends, 1, "Ended twice");
+}
+
+static void test_delay(void)
+{
+	struct bt_mesh_model_transition jump = { .delay = 10 * TICK };
+	struct bt_mesh_model_transition fade = {
+		.delay = 10 * TICK,
+		.time = 20 * TICK,
+	};
+
+	test_reset();
+
+	bt_mesh_transition_start(&ctx[0].transition, 100, &jump);
+	bt_mesh_transition_start(&ctx[1].transition, 100, &fade);
+
+	zassert_equal(bt_mesh_transition_remaining_get(&ctx[1].transition),
+		      fade.delay + fade.time, "Wrong remaining time");
+
+	advance(9);
+	zassert_equal(ctx[0].steps, 0, "Stepped during the delay");
+	zassert_equal(ctx[1].steps, 0, "Stepped during the delay");
+
+	advance(2);
+	zassert_equal(ctx[0].ends, 1, "Not ended after the delay");
+	zassert_equal(ctx[0].steps, 1, "Not jumped to the target");
+
+	advance(20);
+	zassert_equal(ctx[1].ends, 1, "Not ended");
+	zassert_true(ctx[1].steps > 1, "Not interpolated");
+}
+
+static void test_immediate(void)
+{
+	struct bt_mesh_model_transition params = {};
+
+	test_reset();
+
+	bt_mesh_transition_start(&ctx[0].transition, 100, NULL);
+	bt_mesh_transition_start(&ctx[1].transition, 200, &params);
+
+	zassert_equal(ctx[0].prev, 100, "Not set");
+	zassert_equal(ctx[1].prev, 200, "Not set");
+	zassert_equal(bt_mesh_transition_remaining_get(&ctx[0].transition), 0,
+		      "Remaining time without transition");
+
+	advance(10);
+	zassert_equal(ctx[0].ends + ctx[1].ends, 0, "Ended without transition");
+}
+
+static void test_restart_stop(void)
+{
+	struct bt_mesh_model_transition params = { .time = 20 * TICK };
+	struct trans_ctx *c = &ctx[0];
+	int32_t level;
+
+	test_reset();
+
+	bt_mesh_transition_start(&c->transition, 1000, &params);
+	advance(10);
+
+	/* Restarting continues from the current level */
+	level = bt_mesh_transition_level_get(&c->transition);
+	zassert_true(level > 0 && level < 1000, "Wrong level: %d", level);
+
+	bt_mesh_transition_start(&c->transition, -1000, &params);
+	zassert_equal(bt_mesh_transition_level_get(&c->transition), level,
+		      "Level changed on restart");
+	zassert_equal(c->transition.state.end_tick, start_tick + 30,
+		      "Wrong end tick on restart");
+	zassert_equal(bt_mesh_transition_remaining_get(&c->transition),
+		      params.time, "Wrong remaining time on restart");
+
+	advance(2);
+	zassert_true(c->prev < level, "Not moving towards the new target");
+	zassert_equal(bt_mesh_transition_remaining_get(&c->transition),
+		      params.time - 2 * TICK, "Wrong remaining time");
+
+	/* Stopping keeps the current level */
+	bt_mesh_transition_stop(&c->transition);
+	level = c->prev;
+
+	advance(30);
+	zassert_equal(c->prev, level, "Stepped after stop");
+	zassert_equal(c->ends, 0, "Ended after stop");
+	zassert_equal(bt_mesh_transition_remaining_get(&c->transition), 0,
+		      "Remaining time after stop");
+}
+
+static void test_wheel_turns(void)
+{
+	struct bt_mesh_model_transition short_params = { .time = 5 * TICK };
+	struct bt_mesh_model_transition long_params = {
+		.time = (5 + 2 * CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE) * TICK,
+	};
+
+	test_reset();
+
+	/* Ends in the same wheel slot as the short transition, two turns
+	 * later.
+	 */
+	bt_mesh_transition_start(&ctx[0].transition, 100, &short_params);
+	bt_mesh_transition_start(&ctx[1].transition, 100, &long_params);
+
+	zassert_equal(ctx[0].transition.state.end_tick %
+			      CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE,
+		      ctx[1].transition.state.end_tick %
+			      CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE,
+		      "Not in the same slot");
+
+	advance(6);
+	zassert_equal(ctx[0].ends, 1, "Short transition not ended");
+	zassert_equal(ctx[1].ends, 0, "Long transition ended early");
+
+	advance(2 * CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE);
+	zassert_equal(ctx[1].ends, 1, "Long transition not ended");
+}
+
+static void test_lag(void)
+{
+	struct bt_mesh_model_transition params = { .time = 5 * TICK };
+
+	test_reset();
+
+	bt_mesh_transition_start(&ctx[0].transition, 100, &params);
+	bt_mesh_transition_start(&ctx[1].transition, 100, &params);
+	params.time = 5 * CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE * TICK;
+	bt_mesh_transition_start(&ctx[2].transition, 100, &params);
+
+	/* Timer lagging behind by more than a full turn of the wheel */
+	now += 2 * CONFIG_BT_MESH_TRANSITION_WHEEL_SIZE * TICK;
+	transition_tick();
+
+	zassert_equal(ctx[0].ends + ctx[1].ends, 2, "Not ended after lag");
+	zassert_equal(ctx[2].ends, 0, "Ended early");
+	zassert_within(ctx[2].prev, 40, 2, "Wrong level after lag: %d",
+		       ctx[2].prev);
+
+	bt_mesh_transition_stop(&ctx[2].transition);
+}
+
+static void test_group_end(void)
+{
+	struct bt_mesh_model_transition params = { .time = 10 * TICK };
+	uint32_t ended;
+
+	test_reset();
+
+	for (int i = 0; i < GROUP_SIZE; i++) {
+		bt_mesh_transition_start(&ctx[i].transition, 100 * (i + 1),
+					 &params);
+	}
+
+	/* Still running while the group ends */
+	params.time = 20 * TICK;
+	bt_mesh_transition_start(&ctx[GROUP_SIZE].transition, 100, &params);
+
+	for (ended = 0; !ended; ended = advance(1)) {
+	}
+
+	/* All transitions that end in the same tick end in one pass */
+	for (int i = 0; i < GROUP_SIZE; i++) {
+		zassert_equal(ctx[i].ends, 1, "Transition %d not ended", i);
+		zassert_equal(ctx[i].transition.state.end_tick,
+			      ctx[0].transition.state.end_tick,
+			      "Not in the same tick");
+	}
+
+	zassert_equal(ended, GROUP_SIZE, "Group ended in %u transitions",
+		      ended);
+	zassert_equal(ctx[GROUP_SIZE].ends, 0, "Ended early");
+
+	advance(10);
+	zassert_equal(ctx[GROUP_SIZE].ends, 1, "Not ended");
+}
+
+static void group_restart(struct trans_ctx *c)
+{
+	struct bt_mesh_model_transition params = { .time = 10 * TICK };
+
+	if (c != &ctx[0]) {
+		return;
+	}
+
+	/* Both peers are still waiting for their end in the same group */
+	zassert_equal(ctx[1].ends + ctx[2].ends + ctx[3].ends, 0,
+		      "Peers ended first");
+	zassert_equal(ctx[1].prev, 200, "Peer not at its target");
+
+	bt_mesh_transition_start(&ctx[1].transition, 1000, &params);
+	bt_mesh_transition_stop(&ctx[2].transition);
+
+	/* Restarted in the tick the group ended in */
+	zassert_equal(ticks, 10, "Group ended in tick %u", ticks);
+	zassert_equal(ctx[1].transition.state.end_tick, start_tick + 20,
+		      "Wrong end tick on restart");
+	zassert_equal(bt_mesh_transition_remaining_get(&ctx[1].transition),
+		      params.time, "Wrong remaining time on restart");
+}
+
+static void test_group_restart(void)
+{
+	struct bt_mesh_model_transition params = { .time = 10 * TICK };
+	uint32_t ended;
+
+	test_reset();
+	end_hook = group_restart;
+
+	for (int i = 0; i < 4; i++) {
+		bt_mesh_transition_start(&ctx[i].transition, 100 * (i + 1),
+					 &params);
+	}
+
+	for (ended = 0; !ended; ended = advance(1)) {
+	}
+
+	zassert_equal(ended, 2, "Wrong number of ends in the group");
+
+	/* The restarted and stopped peers don't end, the rest of the group
+	 * does.
+	 */
+	zassert_equal(ctx[0].ends, 1, "Not ended");
+	zassert_equal(ctx[1].ends, 0, "Restarted peer ended");
+	zassert_equal(ctx[2].ends, 0, "Stopped peer ended");
+	zassert_equal(ctx[3].ends, 1, "Not ended");
+	zassert_equal(ctx[2].prev, 300, "Stopped peer not at its target");
+	zassert_true(ctx[1].transition.state.active, "Restart lost");
+
+	advance(9);
+	zassert_equal(ctx[1].ends, 0, "Restarted peer ended early");
+	zassert_equal(bt_mesh_transition_remaining_get(&ctx[1].transition),
+		      TICK, "Wrong remaining time");
+
+	advance(1);
+	zassert_equal(ctx[1].ends, 1, "Restarted peer not ended");
+	zassert_equal(ctx[1].end_tick, 20, "Restarted peer ended in tick %u",
+		      ctx[1].end_tick);
+	zassert_equal(ctx[1].prev, 1000, "Restarted peer not at its target");
+	zassert_equal(ctx[0].ends + ctx[2].ends + ctx[3].ends, 2,
+		      "Ended again");
+}
+
+static void test_benchmark(void)
+{
+	uint32_t max_ticks = 0;
+	uint32_t max_cycles = 0;
+	uint64_t total_cycles = 0;
+	uint32_t steps = 0;
+
+	test_reset();
+	seed = 1;
+
+	for (int i = 0; i < TRANSITION_COUNT; i++) {
+		struct bt_mesh_model_transition params = {
+			.time = (10 + rand_get() % 490) * TICK,
+			.delay = (rand_get() % 10) * TICK,
+		};
+
+		max_ticks = MAX(max_ticks, (params.time + params.delay) / TICK);
+		bt_mesh_transition_start(&ctx[i].transition,
+					 rand_get() % UINT16_MAX, &params);
+	}
+
+	for (uint32_t t = 0; t <= max_ticks; t++) {
+		uint32_t start = k_cycle_get_32();
+		uint32_t cycles;
+
+		advance(1);
+
+		cycles = k_cycle_get_32() - start;
+		total_cycles += cycles;
+		max_cycles = MAX(max_cycles, cycles);
+	}
+
+	for (int i = 0; i < TRANSITION_COUNT; i++) {
+		zassert_equal(ctx[i].ends, 1, "Transition %d not ended", i);
+		steps += ctx[i].steps;
+	}
+
+	TC_PRINT("%d transitions: %u ticks, %u level updates\n",
+		 TRANSITION_COUNT, max_ticks + 1, steps);
+	TC_PRINT("%u ns per tick on average, %u ns max\n",
+		 (uint32_t)(k_cyc_to_ns_floor64(total_cycles) /
+			    (max_ticks + 1)),
+		 (uint32_t)k_cyc_to_ns_floor64(max_cycles));
+}
+
+void test_main(void)
+{
+	transition_time_source_set(now_get);
+
+	ztest_test_suite(transition_test,
+			 ztest_unit_test(test_interpolation),
+			 ztest_unit_test(test_delay),
+			 ztest_unit_test(test_immediate),
+			 ztest_unit_test(test_restart_stop),
+			 ztest_unit_test(test_wheel_turns),
+			 ztest_unit_test(test_lag),
+			 ztest_unit_test(test_group_end),
+			 ztest_unit_test(test_group_restart),
+			 ztest_unit_test(test_benchmark)
+			 );
+	ztest_run_test_suite(transition_test);
+}
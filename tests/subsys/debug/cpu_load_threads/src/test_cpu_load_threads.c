@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <ztest.h>
+#include <kernel.h>
+#include <debug/cpu_load.h>
+
+#define FULL_LOAD 100000
+#define STACK_SIZE 1024
+#define BUSY_TIME_US 15000
+#define PERIOD_MS 20
+#define PERIODS 10
+
+K_THREAD_STACK_DEFINE(busy_stack, STACK_SIZE);
+static struct k_thread busy_thread;
+static K_SEM_DEFINE(busy_sem, 0, 1);
+
+struct result {
+	const struct k_thread *thread;
+	struct cpu_load_thread_info info;
+	bool found;
+};
+
+static void busy_fn(void *p1, void *p2, void *p3)
+{
+	while (true) {
+		k_sem_take(&busy_sem, K_FOREVER);
+		k_busy_wait(BUSY_TIME_US);
+	}
+}
+
+static void thread_find(const struct cpu_load_thread_info *info,
+			void *user_data)
+{
+	struct result *result = user_data;
+
+	if (info->thread == result->thread) {
+		result->info = *info;
+		result->found = true;
+	}
+}
+
+static struct result result_get(const struct k_thread *thread)
+{
+	struct result result = {
+		.thread = thread,
+	};
+
+	cpu_load_threads_foreach(thread_find, &result);
+
+	return result;
+}
+
+static void load_sum(const struct cpu_load_thread_info *info,
+		     void *user_data)
+{
+	uint32_t *sum = user_data;
+
+	*sum += info->load;
+}
+
+static void irq_load_sum(const struct cpu_load_irq_info *info,
+			 void *user_data)
+{
+	uint32_t *sum = user_data;
+
+	*sum += info->load;
+}
+
+static uint32_t latency_count(const struct cpu_load_thread_info *info)
+{
+	uint32_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(info->latency); i++) {
+		count += info->latency[i];
+	}
+
+	return count;
+}
+
+static void test_thread_load(void)
+{
+	struct result busy;
+	struct result self;
+	uint32_t total = 0;
+	uint32_t others;
+
+	k_thread_create(&busy_thread, busy_stack, STACK_SIZE, busy_fn,
+			NULL, NULL, NULL, K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+	k_thread_name_set(&busy_thread, "busy");
+
+	cpu_load_threads_reset();
+
+	for (size_t i = 0; i < PERIODS; i++) {
+		k_sem_give(&busy_sem);
+		k_sleep(K_MSEC(PERIOD_MS));
+	}
+
+	busy = result_get(&busy_thread);
+	self = result_get(k_current_get());
+	cpu_load_threads_foreach(load_sum, &total);
+	cpu_load_irqs_foreach(irq_load_sum, &total);
+
+	zassert_true(busy.found, "Busy thread not measured");
+	zassert_true(self.found, "Test thread not measured");
+
+	/* The busy thread runs most of every period, the idle thread and
+	 * the interrupts take most of the rest. The exact shares depend on
+	 * the platform, so only their order is checked.
+	 */
+	others = total - busy.info.load - self.info.load;
+	zassert_true(busy.info.load > others, "Unexpected load: %u of %u",
+		     busy.info.load, total);
+	zassert_true(self.info.load < others, "Unexpected load: %u of %u",
+		     self.info.load, total);
+	zassert_within(total, FULL_LOAD, FULL_LOAD / 20,
+		       "Unexpected total load: %u", total);
+	zassert_true(busy.info.switches > 0, "Switches not counted");
+	zassert_true(latency_count(&busy.info) <= busy.info.switches,
+		     "Latency recorded without a switch");
+
+	k_thread_abort(&busy_thread);
+}
+
+static void test_reset(void)
+{
+	struct result self;
+
+	k_busy_wait(BUSY_TIME_US);
+	cpu_load_threads_reset();
+
+	self = result_get(k_current_get());
+
+	zassert_true(self.found, "Running thread not measured after reset");
+	zassert_equal(self.info.switches, 0, "Switches not reset");
+	zassert_equal(latency_count(&self.info), 0, "Latency not reset");
+}
+
+static void irq_count(const struct cpu_load_irq_info *info, void *user_data)
+{
+	uint32_t *count = user_data;
+
+	zassert_true(info->load <= FULL_LOAD, "Unexpected load: %u", info->load);
+	*count += info->count;
+}
+
+static void test_irq_load(void)
+{
+	uint32_t count = 0;
+
+	cpu_load_threads_reset();
+
+	/* System clock interrupts wake the thread up. */
+	k_sleep(K_MSEC(PERIOD_MS));
+
+	cpu_load_irqs_foreach(irq_count, &count);
+	zassert_true(count > 0, "Interrupts not measured");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(cpu_load_threads_test,
+			 ztest_unit_test(test_thread_load),
+			 ztest_unit_test(test_reset),
+			 ztest_unit_test(test_irq_load)
+			 );
+
+	ztest_run_test_suite(cpu_load_threads_test);
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <dfu/flash_img.h>
+#include <settings/settings.h>
+#include <dfu_target.h>
+#include <dfu_target_mcuboot.h>
+
+#define FRAGMENT_SIZE 1024
+#define FRAGMENT_COUNT 32
+#define IMAGE_SIZE (FRAGMENT_SIZE * FRAGMENT_COUNT)
+
+/* Time to receive one fragment, and to program one fragment into flash. */
+#define RECEIVE_TIME_MS 10
+#define PROGRAM_TIME_MS 10
+
+static uint8_t image[IMAGE_SIZE];
+static uint8_t flash[IMAGE_SIZE];
+static size_t flash_written;
+/* Bytes programmed since the test started, not reset by flash_img_init(). */
+static size_t flash_programmed;
+static int write_retval;
+static int settings_saves;
+static int upgrade_requests;
+
+/* Simulated flash, where programming takes time in proportion to the
+ * amount of data.
+ */
+int flash_img_init(struct flash_img_context *ctx)
+{
+	flash_written = 0;
+	return 0;
+}
+
+size_t flash_img_bytes_written(struct flash_img_context *ctx)
+{
+	return flash_written;
+}
+
+int flash_img_buffered_write(struct flash_img_context *ctx, uint8_t *data,
+			     size_t len, bool flush)
+{
+	if (write_retval != 0) {
+		return write_retval;
+	}
+
+	zassert_true(flash_written + len <= sizeof(flash), "Flash overflow");
+
+	k_sleep(K_MSEC(PROGRAM_TIME_MS * len / FRAGMENT_SIZE));
+
+	memcpy(&flash[flash_written], data, len);
+	flash_written += len;
+	flash_programmed += len;
+
+	return 0;
+}
+
+int boot_request_upgrade(int permanent)
+{
+	upgrade_requests++;
+	return 0;
+}
+
+int settings_subsys_init(void)
+{
+	return 0;
+}
+
+int settings_register(struct settings_handler *cf)
+{
+	return 0;
+}
+
+int settings_load(void)
+{
+	return 0;
+}
+
+int settings_save_one(const char *name, const void *value, size_t val_len)
+{
+	settings_saves++;
+	return 0;
+}
+
+static void download(size_t fragment_size)
+{
+	int err;
+
+	for (size_t offset = 0; offset < IMAGE_SIZE; offset += fragment_size) {
+		/* Wait for the next fragment from the network. */
+		k_sleep(K_MSEC(RECEIVE_TIME_MS * fragment_size / FRAGMENT_SIZE));
+
+		err = dfu_target_mcuboot_write(&image[offset],
+					       MIN(fragment_size,
+						   IMAGE_SIZE - offset));
+		zassert_equal(err, 0, "Write failed: %d", err);
+	}
+}
+
+static void setup(void)
+{
+	int err;
+
+	for (size_t i = 0; i < sizeof(image); i++) {
+		image[i] = (uint8_t)(i * 7 + i / 256);
+	}
+
+	memset(flash, 0, sizeof(flash));
+	write_retval = 0;
+	settings_saves = 0;
+	upgrade_requests = 0;
+	flash_programmed = 0;
+
+	err = dfu_target_mcuboot_init(IMAGE_SIZE, NULL);
+	zassert_equal(err, 0, "Init failed: %d", err);
+
+	/* Ignore the checkpoint from the previous test. */
+	settings_saves = 0;
+}
+
+static void test_pipelined_write(void)
+{
+	struct dfu_target_mcuboot_stats stats;
+	int64_t start;
+	int64_t elapsed;
+	int err;
+
+	setup();
+
+	start = k_uptime_get();
+	download(FRAGMENT_SIZE);
+	err = dfu_target_mcuboot_done(true);
+	elapsed = k_uptime_get() - start;
+
+	zassert_equal(err, 0, "Done failed: %d", err);
+	zassert_equal(upgrade_requests, 1, "Upgrade not requested");
+	zassert_mem_equal(flash, image, sizeof(image), "Image corrupted");
+
+	err = dfu_target_mcuboot_stats_get(&stats);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(stats.bytes_written, IMAGE_SIZE, NULL);
+	zassert_true(stats.write_time_ms >= FRAGMENT_COUNT * PROGRAM_TIME_MS,
+		     "Write time not counted");
+
+	TC_PRINT("Wrote %d bytes in %d ms, %d ms spent in flash writes\n",
+		 IMAGE_SIZE, (int)elapsed, stats.write_time_ms);
+
+	/* Without the pipeline, receiving and programming add up. */
+	zassert_true(elapsed < FRAGMENT_COUNT *
+			       (RECEIVE_TIME_MS + PROGRAM_TIME_MS) * 3 / 4,
+		     "Flash writes did not overlap receiving: %d ms",
+		     (int)elapsed);
+}
+
+static void test_checkpoint_interval(void)
+{
+	int err;
+
+	setup();
+
+	/* Small fragments, which used to store the progress each time. */
+	download(FRAGMENT_SIZE / 4);
+
+	err = dfu_target_mcuboot_done(true);
+	zassert_equal(err, 0, "Done failed: %d", err);
+	zassert_mem_equal(flash, image, sizeof(image), "Image corrupted");
+
+	/* One checkpoint per interval, and one to reset the progress. */
+	zassert_equal(settings_saves,
+		      IMAGE_SIZE /
+		      CONFIG_DFU_TARGET_MCUBOOT_SAVE_PROGRESS_INTERVAL + 1,
+		      "Unexpected number of checkpoints: %d", settings_saves);
+}
+
+static void test_offset_includes_pending(void)
+{
+	size_t offset;
+	int err;
+
+	setup();
+
+	err = dfu_target_mcuboot_write(image, FRAGMENT_SIZE / 2);
+	zassert_equal(err, 0, NULL);
+
+	err = dfu_target_mcuboot_offset_get(&offset);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(offset, FRAGMENT_SIZE / 2,
+		      "Buffered data not included in offset");
+
+	err = dfu_target_mcuboot_done(false);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(upgrade_requests, 0, "Aborted upgrade requested");
+}
+
+static void test_write_error(void)
+{
+	int err;
+
+	setup();
+
+	write_retval = -EIO;
+
+	/* The error is reported by the first call after the writer thread
+	 * has seen it.
+	 */
+	err = dfu_target_mcuboot_write(image, FRAGMENT_SIZE);
+	if (err == 0) {
+		err = dfu_target_mcuboot_done(true);
+	} else {
+		(void)dfu_target_mcuboot_done(false);
+	}
+
+	zassert_equal(err, -EIO, "Write error not reported: %d", err);
+	zassert_equal(upgrade_requests, 0, "Upgrade requested after error");
+}
+
+static void test_write_error_sticky(void)
+{
+	int err;
+
+	setup();
+
+	write_retval = -EIO;
+
+	err = dfu_target_mcuboot_write(image, FRAGMENT_SIZE);
+	zassert_equal(err, 0, "Write failed before the flash write: %d", err);
+
+	/* Let the writer thread fail. */
+	k_sleep(K_MSEC(PROGRAM_TIME_MS));
+
+	/* Data after the failed write must not be written at its offset. */
+	write_retval = 0;
+	for (int i = 0; i < 2; i++) {
+		err = dfu_target_mcuboot_write(&image[FRAGMENT_SIZE],
+					       FRAGMENT_SIZE);
+		zassert_equal(err, -EIO, "Write error not kept: %d", err);
+	}
+
+	(void)dfu_target_mcuboot_done(false);
+	zassert_equal(flash_programmed, 0, "Data written after error");
+
+	/* A new upgrade starts without the error. */
+	setup();
+	download(FRAGMENT_SIZE);
+	err = dfu_target_mcuboot_done(true);
+	zassert_equal(err, 0, "Done failed: %d", err);
+	zassert_mem_equal(flash, image, sizeof(image), "Image corrupted");
+}
+
+static void test_init_discards_pending(void)
+{
+	size_t offset;
+	int err;
+
+	setup();
+
+	/* One full buffer is written, and half a buffer is pending. */
+	err = dfu_target_mcuboot_write(image, FRAGMENT_SIZE * 3 / 2);
+	zassert_equal(err, 0, NULL);
+
+	/* Restarted without finishing the upgrade */
+	err = dfu_target_mcuboot_init(IMAGE_SIZE, NULL);
+	zassert_equal(err, 0, "Init failed: %d", err);
+
+	err = dfu_target_mcuboot_offset_get(&offset);
+	zassert_equal(err, 0, NULL);
+	zassert_equal(offset, 0, "Pending data kept: %d", offset);
+	zassert_true(flash_programmed <= FRAGMENT_SIZE,
+		     "Pending data written: %d", flash_programmed);
+
+	download(FRAGMENT_SIZE);
+	err = dfu_target_mcuboot_done(true);
+	zassert_equal(err, 0, "Done failed: %d", err);
+	zassert_mem_equal(flash, image, sizeof(image), "Image corrupted");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(dfu_target_mcuboot_pipeline_test,
+			 ztest_unit_test(test_pipelined_write),
+			 ztest_unit_test(test_checkpoint_interval),
+			 ztest_unit_test(test_offset_includes_pending),
+			 ztest_unit_test(test_write_error),
+			 ztest_unit_test(test_write_error_sticky),
+			 ztest_unit_test(test_init_discards_pending)
+			 );
+
+	ztest_run_test_suite(dfu_target_mcuboot_pipeline_test);
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <errno.h>
+#include <ztest.h>
+
+#include "esb_fifo.h"
+
+#define MAX_LENGTH CONFIG_ESB_MAX_PAYLOAD_LENGTH
+#define RX_SIZE CONFIG_ESB_RX_FIFO_SIZE
+#define TX_SIZE CONFIG_ESB_TX_FIFO_SIZE
+
+/* DPL header with the acknowledgment flag set */
+#define S1_ACK(pid) (((pid) << 1) | 0x01)
+
+static struct payload_rx_fifo rx_fifo;
+static struct payload_tx_fifo tx_fifo;
+
+static void fifos_init(void)
+{
+	memset(&rx_fifo, 0, sizeof(rx_fifo));
+	memset(&tx_fifo, 0, sizeof(tx_fifo));
+
+	esb_rx_fifo_reset(&rx_fifo);
+	esb_tx_fifo_reset(&tx_fifo);
+	rx_fifo.radio_frame = &rx_fifo.drop_frame;
+}
+
+/* Simulate the radio receiving a DPL packet to the selected buffer. */
+static bool dpl_receive(uint8_t length, uint8_t pid, uint8_t value)
+{
+	uint8_t *packet = esb_rx_fifo_select(&rx_fifo);
+
+	packet[0] = length;
+	packet[1] = S1_ACK(pid);
+	memset(&packet[2], value, MIN(length, MAX_LENGTH));
+
+	return esb_rx_fifo_commit(&rx_fifo, true, 0, 1, pid, -40);
+}
+
+static struct esb_frame *tx_write(uint8_t pipe, uint8_t length, uint8_t value)
+{
+	struct esb_frame *frame = esb_tx_fifo_back(&tx_fifo);
+
+	zassert_not_null(frame, "TX FIFO full");
+
+	memset(&frame->packet[2], value, length);
+	frame->length = length;
+	frame->pipe = pipe;
+	frame->noack = false;
+	esb_tx_fifo_push(&tx_fifo);
+
+	return frame;
+}
+
+static void test_rx_fifo_full_drop(void)
+{
+	struct esb_frame *first;
+	uint8_t *packet;
+
+	fifos_init();
+
+	for (int i = 0; i < RX_SIZE; i++) {
+		zassert_true(dpl_receive(4, i & 0x03, i), "Packet dropped");
+	}
+
+	zassert_equal(rx_fifo.count, RX_SIZE, "Wrong count");
+
+	/* The radio receives to the drop frame when the FIFO is full */
+	packet = esb_rx_fifo_select(&rx_fifo);
+	zassert_equal_ptr(packet, rx_fifo.drop_frame.packet,
+			  "Received to a FIFO slot");
+	zassert_false(esb_rx_fifo_accepts(&rx_fifo), "Full FIFO accepts");
+	zassert_false(dpl_receive(4, 0, 0xff), "Packet not dropped");
+	zassert_equal(rx_fifo.count, RX_SIZE, "Wrong count");
+
+	/* Packets in the FIFO are not overwritten */
+	for (int i = 0; i < RX_SIZE; i++) {
+		zassert_equal(rx_fifo.frame[i].packet[2], i, "Slot overwritten");
+	}
+
+	/* Reading a packet frees its slot for the next one */
+	first = esb_rx_fifo_front(&rx_fifo);
+	esb_rx_fifo_pop(&rx_fifo);
+	packet = esb_rx_fifo_select(&rx_fifo);
+	zassert_equal_ptr(packet, first->packet, "Freed slot not reused");
+	zassert_true(esb_rx_fifo_accepts(&rx_fifo), "Free slot rejected");
+}
+
+static void test_rx_fifo_flush(void)
+{
+	fifos_init();
+
+	zassert_true(dpl_receive(4, 0, 0), "Packet dropped");
+
+	/* Flushed while the radio receives to the second slot */
+	esb_rx_fifo_select(&rx_fifo);
+	esb_rx_fifo_reset(&rx_fifo);
+
+	zassert_false(esb_rx_fifo_accepts(&rx_fifo), "Flushed slot accepted");
+	zassert_false(esb_rx_fifo_commit(&rx_fifo, true, 0, 0, 0, 0),
+		      "Packet committed after flush");
+	zassert_is_null(esb_rx_fifo_front(&rx_fifo), "FIFO not empty");
+}
+
+static void test_dpl_length(void)
+{
+	struct esb_frame *frame;
+	uint8_t *packet;
+
+	fifos_init();
+
+	/* Invalid length is dropped, and the slot is received to again */
+	packet = esb_rx_fifo_select(&rx_fifo);
+	zassert_false(dpl_receive(MAX_LENGTH + 1, 1, 0),
+		      "Too long packet accepted");
+	zassert_equal(rx_fifo.count, 0, "Too long packet counted");
+	zassert_equal_ptr(esb_rx_fifo_select(&rx_fifo), packet,
+			  "Dropped slot not reused");
+
+	zassert_true(dpl_receive(MAX_LENGTH, 2, 0xa5), "Packet dropped");
+	frame = esb_rx_fifo_front(&rx_fifo);
+	zassert_equal(frame->length, MAX_LENGTH, "Wrong length");
+	zassert_equal(frame->pid, 2, "Wrong PID");
+	zassert_equal(frame->rssi, -40, "Wrong RSSI");
+	zassert_false(frame->noack, "Wrong noack");
+	zassert_equal(frame->packet[2 + MAX_LENGTH - 1], 0xa5,
+		      "Wrong payload");
+
+	/* Empty packet, and no acknowledgment requested */
+	packet = esb_rx_fifo_select(&rx_fifo);
+	packet[0] = 0;
+	packet[1] = 3 << 1;
+	zassert_true(esb_rx_fifo_commit(&rx_fifo, true, 0, 0, 3, 0),
+		      "Empty packet dropped");
+	esb_rx_fifo_pop(&rx_fifo);
+	frame = esb_rx_fifo_front(&rx_fifo);
+	zassert_equal(frame->length, 0, "Wrong length");
+	zassert_true(frame->noack, "Wrong noack");
+
+	/* Without DPL, the length byte is not used */
+	packet = esb_rx_fifo_select(&rx_fifo);
+	packet[0] = 0xff;
+	zassert_true(esb_rx_fifo_commit(&rx_fifo, false, 8, 0, 0, 0),
+		      "Static length packet dropped");
+	esb_rx_fifo_pop(&rx_fifo);
+	zassert_equal(esb_rx_fifo_front(&rx_fifo)->length, 8,
+		      "Wrong static length");
+}
+
+static void test_ack_payload_slot_reuse(void)
+{
+	struct esb_frame *frames[TX_SIZE];
+	struct esb_frame *ack;
+
+	fifos_init();
+
+	for (int i = 0; i < TX_SIZE; i++) {
+		frames[i] = tx_write(0, i + 1, i);
+	}
+
+	zassert_is_null(esb_tx_fifo_back(&tx_fifo), "Full FIFO has a slot");
+
+	/* The ACK payload is sent from the TX FIFO slot, and the same slot
+	 * is sent again when the packet is retransmitted.
+	 */
+	for (int retransmit = 0; retransmit < 2; retransmit++) {
+		ack = esb_tx_fifo_front(&tx_fifo);
+		zassert_equal_ptr(ack, frames[0], "Wrong ACK payload slot");
+
+		esb_ack_header_set(ack->packet, true, ack->length, 0,
+				   S1_ACK(retransmit));
+		zassert_equal(ack->packet[0], 1, "Wrong ACK length");
+		zassert_equal(ack->packet[1], S1_ACK(retransmit),
+			      "Wrong ACK S1");
+		zassert_equal(ack->packet[2], 0, "Wrong ACK payload");
+	}
+
+	/* The next packet acknowledges the payload, and the slot is reused */
+	esb_tx_fifo_pop(&tx_fifo);
+	zassert_equal_ptr(esb_tx_fifo_front(&tx_fifo), frames[1],
+			  "Wrong next ACK payload");
+	zassert_equal_ptr(tx_write(0, 8, 0x55), frames[0],
+			  "Sent slot not reused");
+	zassert_equal_ptr(esb_tx_fifo_front(&tx_fifo), frames[1],
+			  "Written slot sent before older ones");
+
+	for (int i = 0; i < TX_SIZE; i++) {
+		esb_tx_fifo_pop(&tx_fifo);
+	}
+
+	zassert_is_null(esb_tx_fifo_front(&tx_fifo), "FIFO not empty");
+	esb_tx_fifo_pop(&tx_fifo);
+	zassert_equal(tx_fifo.count, 0, "Pop from an empty FIFO");
+}
+
+static void test_tx_flush_while_sending(void)
+{
+	struct esb_frame *sending;
+
+	fifos_init();
+
+	zassert_equal(esb_tx_fifo_remove(&tx_fifo, false), -ENODATA,
+		      "Removed from an empty FIFO");
+
+	for (int i = 0; i < TX_SIZE; i++) {
+		tx_write(0, 4, i);
+	}
+
+	/* The radio transmits from the first slot */
+	sending = esb_tx_fifo_front(&tx_fifo);
+
+	zassert_equal(esb_tx_fifo_flush(&tx_fifo, true), -EBUSY,
+		      "Flushed while sending");
+	zassert_equal(esb_tx_fifo_remove(&tx_fifo, true), -EBUSY,
+		      "Removed while sending");
+	zassert_equal(tx_fifo.count, TX_SIZE, "Wrong count");
+	zassert_equal_ptr(esb_tx_fifo_front(&tx_fifo), sending,
+			  "Sent slot released");
+	zassert_is_null(esb_tx_fifo_back(&tx_fifo), "Sent slot reused");
+	zassert_equal(sending->packet[2], 0, "Sent slot overwritten");
+
+	/* Transmission done */
+	esb_tx_fifo_pop(&tx_fifo);
+
+	zassert_equal(esb_tx_fifo_remove(&tx_fifo, false), 0, "Remove failed");
+	zassert_equal(esb_tx_fifo_front(&tx_fifo)->packet[2], 2,
+		      "Wrong slot removed");
+	zassert_equal(tx_fifo.count, TX_SIZE - 2, "Wrong count");
+
+	zassert_equal(esb_tx_fifo_flush(&tx_fifo, false), 0, "Flush failed");
+	zassert_is_null(esb_tx_fifo_front(&tx_fifo), "FIFO not empty");
+	zassert_not_null(esb_tx_fifo_back(&tx_fifo), "No free slot");
+}
+
+static void test_packet_format(void)
+{
+	struct esb_frame frame = {
+		.length = 5,
+		.pid = 2,
+	};
+	uint8_t ack[2];
+
+	esb_frame_header_set(&frame, false);
+	zassert_equal(frame.packet[0], 2, "Wrong ESB S0");
+	zassert_equal(frame.packet[1], 0, "Wrong ESB S1");
+
+	esb_frame_header_set(&frame, true);
+	zassert_equal(frame.packet[0], 5, "Wrong DPL length");
+	zassert_equal(frame.packet[1], S1_ACK(2), "Wrong DPL S1");
+
+	frame.noack = true;
+	esb_frame_header_set(&frame, true);
+	zassert_equal(frame.packet[1], 2 << 1, "Wrong DPL noack S1");
+
+	/* Empty acknowledgments echo the received header */
+	esb_ack_header_set(ack, false, 0, 3, S1_ACK(1));
+	zassert_equal(ack[0], 3, "Wrong ESB ACK S0");
+	zassert_equal(ack[1], 0, "Wrong ESB ACK S1");
+
+	esb_ack_header_set(ack, true, 0, 3, S1_ACK(1));
+	zassert_equal(ack[0], 0, "Wrong DPL ACK length");
+	zassert_equal(ack[1], S1_ACK(1), "Wrong DPL ACK S1");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(esb_test,
+			 ztest_unit_test(test_rx_fifo_full_drop),
+			 ztest_unit_test(test_rx_fifo_flush),
+			 ztest_unit_test(test_dpl_length),
+			 ztest_unit_test(test_ack_payload_slot_reuse),
+			 ztest_unit_test(test_tx_flush_while_sending),
+			 ztest_unit_test(test_packet_format)
+			 );
+	ztest_run_test_suite(esb_test);
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+#include <settings/settings.h>
+
+#include "aws_iot_queue.h"
+
+#define MAX_ENTRIES CONFIG_AWS_IOT_QUEUE_MAX_ENTRIES
+#define STORE_ENTRIES (2 * MAX_ENTRIES)
+#define KEY_LEN 24
+#define VALUE_LEN (CONFIG_AWS_IOT_QUEUE_ENTRY_MAX_SIZE + 4)
+#define PUBS_MAX 16
+
+#define APP_TOPIC "app/data"
+#define SHADOW_TOPIC "$aws/things/dev/shadow/update"
+
+/* Simulated settings storage */
+static struct {
+	char key[KEY_LEN];
+	uint8_t value[VALUE_LEN];
+	size_t len;
+} store[STORE_ENTRIES];
+
+static struct settings_handler *handler;
+static int loads;
+
+/* Published messages */
+static struct {
+	char topic[64];
+	char payload[128];
+	enum mqtt_qos qos;
+	uint16_t message_id;
+} pubs[PUBS_MAX];
+static int pub_count;
+static int publish_err;
+static uint16_t next_message_id = 1;
+
+static int store_find(const char *key)
+{
+	for (int i = 0; i < STORE_ENTRIES; i++) {
+		if (!strcmp(store[i].key, key)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int store_count(void)
+{
+	int count = 0;
+
+	for (int i = 0; i < STORE_ENTRIES; i++) {
+		if (store[i].key[0] != '\0') {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int settings_subsys_init(void)
+{
+	return 0;
+}
+
+int settings_register(struct settings_handler *cf)
+{
+	handler = cf;
+	return 0;
+}
+
+static ssize_t store_read(void *cb_arg, void *data, size_t len)
+{
+	int i = (intptr_t)cb_arg;
+
+	len = MIN(len, store[i].len);
+	memcpy(data, store[i].value, len);
+
+	return len;
+}
+
+int settings_load_subtree(const char *subtree)
+{
+	size_t prefix_len = strlen(subtree);
+
+	loads++;
+
+	/* Visit the entries in reverse, to not depend on storage order. */
+	for (int i = STORE_ENTRIES - 1; i >= 0; i--) {
+		if (strncmp(store[i].key, subtree, prefix_len) ||
+		    (store[i].key[prefix_len] != '/')) {
+			continue;
+		}
+
+		handler->h_set(&store[i].key[prefix_len + 1], store[i].len,
+			       store_read, (void *)(intptr_t)i);
+	}
+
+	return 0;
+}
+
+int settings_save_one(const char *name, const void *value, size_t val_len)
+{
+	int i = store_find(name);
+
+	if (i < 0) {
+		i = store_find("");
+	}
+
+	zassert_true(i >= 0, "Settings storage full");
+	zassert_true(val_len <= VALUE_LEN, "Value too long");
+
+	strncpy(store[i].key, name, KEY_LEN - 1);
+	memcpy(store[i].value, value, val_len);
+	store[i].len = val_len;
+
+	return 0;
+}
+
+int settings_delete(const char *name)
+{
+	int i = store_find(name);
+
+	if (i >= 0) {
+		memset(&store[i], 0, sizeof(store[i]));
+	}
+
+	return 0;
+}
+
+static int publish(const char *topic, size_t topic_len, enum mqtt_qos qos,
+		   const uint8_t *payload, size_t len, uint16_t *message_id)
+{
+	if (publish_err) {
+		return publish_err;
+	}
+
+	zassert_true(pub_count < PUBS_MAX, "Too many publications");
+	zassert_equal(strlen(topic), topic_len, "Topic not terminated");
+	zassert_true(len < sizeof(pubs[0].payload), "Payload too long");
+
+	strcpy(pubs[pub_count].topic, topic);
+	memcpy(pubs[pub_count].payload, payload, len);
+	pubs[pub_count].payload[len] = '\0';
+	pubs[pub_count].qos = qos;
+	pubs[pub_count].message_id = next_message_id;
+	*message_id = next_message_id++;
+	pub_count++;
+
+	return 0;
+}
+
+static void put(const char *topic, enum mqtt_qos qos, const char *payload)
+{
+	int err;
+
+	err = aws_iot_queue_put(topic, strlen(topic), qos, payload,
+				strlen(payload));
+	zassert_equal(err, 0, "Put failed: %d", err);
+}
+
+static void test_reset(void)
+{
+	memset(store, 0, sizeof(store));
+	memset(pubs, 0, sizeof(pubs));
+	pub_count = 0;
+	publish_err = 0;
+
+	zassert_equal(aws_iot_queue_init(publish), 0, "Init failed");
+	loads = 0;
+}
+
+static void test_single(void)
+{
+	test_reset();
+
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "hello");
+	zassert_true(aws_iot_queue_pending(), "Not pending");
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 1, "Not published");
+	zassert_equal(strcmp(pubs[0].topic, APP_TOPIC), 0, "Wrong topic");
+	zassert_equal(strcmp(pubs[0].payload, "hello"), 0, "Wrong payload");
+
+	/* QoS 0 messages are removed when published */
+	zassert_false(aws_iot_queue_pending(), "Still pending");
+	zassert_equal(store_count(), 0, "Still stored");
+}
+
+static void test_batch(void)
+{
+	test_reset();
+
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "{\"a\":1}");
+	put(SHADOW_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "{\"s\":1}");
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "{\"a\":2}");
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "text");
+	put(APP_TOPIC, MQTT_QOS_1_AT_LEAST_ONCE, "{\"a\":3}");
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "[3]");
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+
+	/* All entries are read in one pass */
+	zassert_equal(loads, 1, "Loaded %d times", loads);
+	zassert_equal(pub_count, 4, "Wrong number of publications: %d",
+		      pub_count);
+
+	zassert_equal(strcmp(pubs[0].payload, "[{\"a\":1},{\"a\":2},[3]]"), 0,
+		      "Wrong batch: %s", pubs[0].payload);
+	zassert_equal(strcmp(pubs[1].topic, SHADOW_TOPIC), 0,
+		      "Reserved topic batched");
+	zassert_equal(strcmp(pubs[1].payload, "{\"s\":1}"), 0,
+		      "Wrong payload");
+	zassert_equal(strcmp(pubs[2].payload, "text"), 0, "Text batched");
+	zassert_equal(pubs[3].qos, MQTT_QOS_1_AT_LEAST_ONCE,
+		      "QoS mixed in batch");
+}
+
+static void test_batch_size(void)
+{
+	/* 9 bytes each, 3 fit in a batch of 40 bytes */
+	static const char *const payloads[] = {
+		"{\"n\":100}", "{\"n\":101}", "{\"n\":102}", "{\"n\":103}",
+		"{\"n\":104}", "{\"n\":105}", "{\"n\":106}",
+	};
+
+	test_reset();
+
+	for (int i = 0; i < ARRAY_SIZE(payloads); i++) {
+		put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, payloads[i]);
+	}
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 3, "Wrong number of batches: %d",
+		      pub_count);
+
+	for (int i = 0; i < pub_count; i++) {
+		zassert_true(strlen(pubs[i].payload) <=
+				     CONFIG_AWS_IOT_QUEUE_BATCH_MAX_SIZE,
+			     "Batch too large: %s", pubs[i].payload);
+	}
+
+	zassert_equal(strcmp(pubs[2].payload, "{\"n\":106}"), 0,
+		      "Wrong order: %s", pubs[2].payload);
+}
+
+static void test_ack(void)
+{
+	test_reset();
+
+	put(APP_TOPIC, MQTT_QOS_1_AT_LEAST_ONCE, "{\"a\":1}");
+	put(APP_TOPIC, MQTT_QOS_1_AT_LEAST_ONCE, "{\"a\":2}");
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 1, "Not batched");
+	zassert_false(aws_iot_queue_pending(), "Published messages pending");
+	zassert_equal(store_count(), 2, "Removed before ack");
+
+	/* Published again after a reconnect */
+	aws_iot_queue_unacked_requeue();
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 2, "Not published again");
+
+	aws_iot_queue_ack(pubs[0].message_id);
+	zassert_equal(store_count(), 2, "Removed on stale ack");
+
+	aws_iot_queue_ack(pubs[1].message_id);
+	zassert_equal(store_count(), 0, "Not removed on ack");
+}
+
+static void test_publish_error(void)
+{
+	test_reset();
+
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "one");
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "two");
+
+	publish_err = -EAGAIN;
+	zassert_equal(aws_iot_queue_drain(), -EAGAIN, "Error not returned");
+	zassert_true(aws_iot_queue_pending(), "Messages lost");
+	zassert_equal(store_count(), 2, "Messages removed");
+
+	publish_err = 0;
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 2, "Not published");
+	zassert_equal(strcmp(pubs[0].payload, "one"), 0, "Wrong order");
+}
+
+static void test_reload(void)
+{
+	test_reset();
+
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "{\"a\":1}");
+	put(SHADOW_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "{\"s\":1}");
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "{\"a\":2}");
+
+	/* Reset */
+	zassert_equal(aws_iot_queue_init(publish), 0, "Init failed");
+	zassert_true(aws_iot_queue_pending(), "Queue not restored");
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 2, "Wrong number of publications");
+	zassert_equal(strcmp(pubs[0].payload, "[{\"a\":1},{\"a\":2}]"), 0,
+		      "Not batched after reload: %s", pubs[0].payload);
+}
+
+static void test_full(void)
+{
+	char payload[8];
+
+	test_reset();
+
+	for (int i = 0; i < MAX_ENTRIES + 2; i++) {
+		snprintf(payload, sizeof(payload), "m%d", i);
+		put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, payload);
+	}
+
+	zassert_equal(store_count(), MAX_ENTRIES, "Oldest not dropped");
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, MAX_ENTRIES, "Wrong number of publications");
+	zassert_equal(strcmp(pubs[0].payload, "m2"), 0, "Wrong oldest: %s",
+		      pubs[0].payload);
+}
+
+static void test_unreadable(void)
+{
+	int i;
+
+	test_reset();
+
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "bad");
+	put(APP_TOPIC, MQTT_QOS_0_AT_MOST_ONCE, "good");
+
+	i = store_find("aws_iot/q/0");
+	zassert_true(i >= 0, "Entry not stored");
+	store[i].len--;
+
+	zassert_equal(aws_iot_queue_drain(), 0, "Drain failed");
+	zassert_equal(pub_count, 1, "Wrong number of publications");
+	zassert_equal(strcmp(pubs[0].payload, "good"), 0, "Wrong payload");
+	zassert_equal(store_count(), 0, "Unreadable entry kept");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(aws_iot_queue_test,
+			 ztest_unit_test(test_single),
+			 ztest_unit_test(test_batch),
+			 ztest_unit_test(test_batch_size),
+			 ztest_unit_test(test_ack),
+			 ztest_unit_test(test_publish_error),
+			 ztest_unit_test(test_reload),
+			 ztest_unit_test(test_full),
+			 ztest_unit_test(test_unreadable)
+			 );
+	ztest_run_test_suite(aws_iot_queue_test);
+}
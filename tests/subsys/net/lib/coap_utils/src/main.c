@@ -0,0 +1,662 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/socket.h>
+#include <net/coap.h>
+#include <net/coap_utils.h>
+
+#define SERVER_PORT 5683
+#define SERVER_STACK_SIZE 2048
+#define SERVER_PRIORITY K_PRIO_PREEMPT(1)
+#define MSG_LEN 256
+
+#define LARGE_RESOURCE_LEN 100
+#define UPLOAD_LEN 100
+#define NOTIFICATIONS 3
+
+#define BENCHMARK_REQUESTS 200
+
+#define RESPONSE_WAIT K_SECONDS(5)
+
+static const char *const echo_path[] = { "echo", NULL };
+static const char *const drop_path[] = { "drop", NULL };
+static const char *const separate_path[] = { "separate", NULL };
+static const char *const large_path[] = { "large", NULL };
+static const char *const upload_path[] = { "upload", NULL };
+static const char *const obs_path[] = { "obs", NULL };
+
+static struct sockaddr_in6 server_addr = {
+	.sin6_family = AF_INET6,
+	.sin6_port = htons(SERVER_PORT),
+	.sin6_addr = IN6ADDR_LOOPBACK_INIT,
+};
+
+static K_THREAD_STACK_DEFINE(server_stack, SERVER_STACK_SIZE);
+static struct k_thread server_thread;
+static int server_sock;
+
+static uint8_t large_resource[LARGE_RESOURCE_LEN];
+static uint8_t upload_buf[UPLOAD_LEN];
+static size_t upload_len;
+static uint16_t dropped_id;
+static bool drop_valid;
+static uint16_t notification_id = 1000;
+static K_SEM_DEFINE(server_rst, 0, 1);
+
+/* Responses received by the client */
+static struct {
+	int result;
+	uint8_t code;
+	uint8_t body[LARGE_RESOURCE_LEN];
+	size_t body_len;
+	uint32_t callbacks;
+} client_rsp;
+static K_SEM_DEFINE(client_done, 0, 1);
+static K_SEM_DEFINE(client_notification, 0, NOTIFICATIONS);
+
+/* Test server */
+
+static int server_send(struct coap_packet *packet, struct sockaddr *addr,
+		       socklen_t addr_len)
+{
+	return sendto(server_sock, packet->data, packet->offset, 0, addr,
+		      addr_len);
+}
+
+static int response_init(struct coap_packet *response, uint8_t *buf,
+			 const struct coap_packet *request, uint8_t type,
+			 uint8_t code)
+{
+	uint8_t token[8];
+	uint8_t tkl = coap_header_get_token(request, token);
+	uint16_t id = coap_header_get_id(request);
+
+	if (type != COAP_TYPE_ACK) {
+		id = coap_next_id();
+	}
+
+	return coap_packet_init(response, buf, MSG_LEN, 1, type, tkl, token,
+				code, id);
+}
+
+static uint8_t response_type(const struct coap_packet *request)
+{
+	return (coap_header_get_type(request) == COAP_TYPE_CON) ?
+	       COAP_TYPE_ACK : COAP_TYPE_NON_CON;
+}
+
+static void payload_append(struct coap_packet *response,
+			   const uint8_t *payload, uint16_t len)
+{
+	if (len == 0) {
+		return;
+	}
+
+	coap_packet_append_payload_marker(response);
+	coap_packet_append_payload(response, (uint8_t *)payload, len);
+}
+
+static void server_echo(const struct coap_packet *request,
+			struct sockaddr *addr, socklen_t addr_len)
+{
+	struct coap_packet response;
+	uint8_t buf[MSG_LEN];
+	const uint8_t *payload;
+	uint16_t len = 0;
+
+	payload = coap_packet_get_payload(request, &len);
+
+	response_init(&response, buf, request, response_type(request),
+		      COAP_RESPONSE_CODE_CONTENT);
+	payload_append(&response, payload, len);
+	server_send(&response, addr, addr_len);
+}
+
+static void server_separate(const struct coap_packet *request,
+			    struct sockaddr *addr, socklen_t addr_len)
+{
+	struct coap_packet response;
+	uint8_t buf[MSG_LEN];
+
+	/* Empty acknowledgment, then a confirmable response */
+	coap_packet_init(&response, buf, MSG_LEN, 1, COAP_TYPE_ACK, 0, NULL,
+			 COAP_CODE_EMPTY, coap_header_get_id(request));
+	server_send(&response, addr, addr_len);
+
+	k_sleep(K_MSEC(10));
+
+	response_init(&response, buf, request, COAP_TYPE_CON,
+		      COAP_RESPONSE_CODE_CONTENT);
+	payload_append(&response, "separate", strlen("separate"));
+	server_send(&response, addr, addr_len);
+}
+
+static void server_large(const struct coap_packet *request,
+			 struct sockaddr *addr, socklen_t addr_len)
+{
+	struct coap_packet response;
+	uint8_t buf[MSG_LEN];
+	int block = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+	uint32_t num = 0;
+	uint8_t szx = 1; /* 32 bytes */
+	size_t size;
+	size_t offset;
+	size_t len;
+	bool more;
+
+	if (block >= 0) {
+		num = (uint32_t)block >> 4;
+		szx = MIN(block & 0x07, szx);
+	}
+
+	size = 1 << (szx + 4);
+	offset = num * size;
+	if (offset >= LARGE_RESOURCE_LEN) {
+		return;
+	}
+
+	len = MIN(size, LARGE_RESOURCE_LEN - offset);
+	more = (offset + len) < LARGE_RESOURCE_LEN;
+
+	response_init(&response, buf, request, response_type(request),
+		      COAP_RESPONSE_CODE_CONTENT);
+	coap_append_option_int(&response, COAP_OPTION_BLOCK2,
+			       (num << 4) | (more ? 0x08 : 0) | szx);
+	payload_append(&response, &large_resource[offset], len);
+	server_send(&response, addr, addr_len);
+}
+
+static void server_upload(const struct coap_packet *request,
+			  struct sockaddr *addr, socklen_t addr_len)
+{
+	struct coap_packet response;
+	uint8_t buf[MSG_LEN];
+	int block = coap_get_option_int(request, COAP_OPTION_BLOCK1);
+	const uint8_t *payload;
+	uint16_t len = 0;
+	size_t offset;
+	bool more;
+
+	if (block < 0) {
+		return;
+	}
+
+	offset = ((uint32_t)block >> 4) * (1 << ((block & 0x07) + 4));
+	more = (block & 0x08) != 0;
+
+	payload = coap_packet_get_payload(request, &len);
+	if (offset + len > sizeof(upload_buf)) {
+		return;
+	}
+	memcpy(&upload_buf[offset], payload, len);
+	upload_len = offset + len;
+
+	response_init(&response, buf, request, response_type(request),
+		      more ? COAP_RESPONSE_CODE_CONTINUE :
+			     COAP_RESPONSE_CODE_CHANGED);
+	coap_append_option_int(&response, COAP_OPTION_BLOCK1, block);
+	server_send(&response, addr, addr_len);
+}
+
+static void server_notify(const struct coap_packet *request,
+			  struct sockaddr *addr, socklen_t addr_len,
+			  uint32_t seq)
+{
+	struct coap_packet response;
+	uint8_t buf[MSG_LEN];
+	uint8_t token[8];
+	uint8_t tkl = coap_header_get_token(request, token);
+
+	coap_packet_init(&response, buf, MSG_LEN, 1, COAP_TYPE_NON_CON, tkl,
+			 token, COAP_RESPONSE_CODE_CONTENT, notification_id++);
+	coap_append_option_int(&response, COAP_OPTION_OBSERVE, seq);
+	payload_append(&response, (uint8_t *)&seq, sizeof(seq));
+	server_send(&response, addr, addr_len);
+}
+
+static void server_observe(const struct coap_packet *request,
+			   struct sockaddr *addr, socklen_t addr_len)
+{
+	struct coap_packet response;
+	uint8_t buf[MSG_LEN];
+
+	response_init(&response, buf, request, response_type(request),
+		      COAP_RESPONSE_CODE_CONTENT);
+	coap_append_option_int(&response, COAP_OPTION_OBSERVE, 0);
+	server_send(&response, addr, addr_len);
+
+	for (uint32_t seq = 1; seq < NOTIFICATIONS; seq++) {
+		k_sleep(K_MSEC(10));
+		server_notify(request, addr, addr_len, seq);
+	}
+
+	/* Notification after the client cancelled the observation */
+	if (k_sem_take(&client_done, RESPONSE_WAIT) != 0) {
+		return;
+	}
+	server_notify(request, addr, addr_len, NOTIFICATIONS);
+}
+
+static void server_run(void)
+{
+	static uint8_t buf[MSG_LEN];
+	struct coap_packet request;
+	struct coap_option path;
+	struct sockaddr addr;
+	socklen_t addr_len;
+	int len;
+
+	while (1) {
+		addr_len = sizeof(addr);
+		len = recvfrom(server_sock, buf, sizeof(buf), 0, &addr,
+			       &addr_len);
+		if (len <= 0) {
+			continue;
+		}
+
+		if (coap_packet_parse(&request, buf, len, NULL, 0) < 0) {
+			continue;
+		}
+
+		if (coap_header_get_type(&request) == COAP_TYPE_RESET) {
+			k_sem_give(&server_rst);
+			continue;
+		}
+
+		if (coap_header_get_code(&request) == COAP_CODE_EMPTY) {
+			/* Acknowledgment of a separate response */
+			continue;
+		}
+
+		if (coap_find_options(&request, COAP_OPTION_URI_PATH,
+				      &path, 1) != 1) {
+			continue;
+		}
+
+#define PATH_IS(str) \
+	(path.len == strlen(str) && memcmp(path.value, str, path.len) == 0)
+
+		if (PATH_IS("echo")) {
+			server_echo(&request, &addr, addr_len);
+		} else if (PATH_IS("drop")) {
+			/* Drop the first transmission of every message */
+			if (drop_valid &&
+			    dropped_id == coap_header_get_id(&request)) {
+				server_echo(&request, &addr, addr_len);
+			} else {
+				dropped_id = coap_header_get_id(&request);
+				drop_valid = true;
+			}
+		} else if (PATH_IS("separate")) {
+			server_separate(&request, &addr, addr_len);
+		} else if (PATH_IS("large")) {
+			server_large(&request, &addr, addr_len);
+		} else if (PATH_IS("upload")) {
+			server_upload(&request, &addr, addr_len);
+		} else if (PATH_IS("obs")) {
+			server_observe(&request, &addr, addr_len);
+		}
+	}
+}
+
+/* Client */
+
+static void response_cb(const struct coap_utils_response *response,
+			void *user_data)
+{
+	client_rsp.result = response->result;
+	client_rsp.code = response->code;
+	client_rsp.callbacks++;
+
+	if (response->payload_len > 0 &&
+	    response->offset + response->payload_len <=
+	    sizeof(client_rsp.body)) {
+		memcpy(&client_rsp.body[response->offset], response->payload,
+		       response->payload_len);
+		client_rsp.body_len = response->offset + response->payload_len;
+	}
+
+	if (!response->more) {
+		k_sem_give(&client_done);
+	}
+}
+
+static int request_start(enum coap_method method,
+			 const char *const *path, const uint8_t *payload,
+			 size_t payload_len, bool confirmable)
+{
+	struct coap_utils_request_params params = {
+		.method = method,
+		.addr = (struct sockaddr *)&server_addr,
+		.uri_path_options = path,
+		.payload = payload,
+		.payload_len = payload_len,
+		.confirmable = confirmable,
+		.cb = response_cb,
+	};
+	int ret;
+
+	memset(&client_rsp, 0, sizeof(client_rsp));
+	k_sem_reset(&client_done);
+
+	ret = coap_utils_request(&params);
+	zassert_true(ret >= 0, "Request failed: %d", ret);
+
+	return ret;
+}
+
+static void request_send(enum coap_method method,
+			 const char *const *path, const uint8_t *payload,
+			 size_t payload_len, bool confirmable)
+{
+	request_start(method, path, payload, payload_len, confirmable);
+
+	zassert_equal(k_sem_take(&client_done, RESPONSE_WAIT), 0,
+		      "No response");
+}
+
+static void test_con_request(void)
+{
+	request_send(COAP_METHOD_POST, echo_path, "ping", 4, true);
+
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_equal(client_rsp.code, COAP_RESPONSE_CODE_CONTENT,
+		      "Wrong code");
+	zassert_equal(client_rsp.body_len, 4, "Wrong length");
+	zassert_mem_equal(client_rsp.body, "ping", 4, "Wrong payload");
+}
+
+static void test_non_request(void)
+{
+	request_send(COAP_METHOD_POST, echo_path, "ping", 4, false);
+
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_mem_equal(client_rsp.body, "ping", 4, "Wrong payload");
+}
+
+static void test_retransmission(void)
+{
+	struct coap_utils_stats stats;
+
+	coap_utils_stats_reset();
+
+	request_send(COAP_METHOD_POST, drop_path, "ping", 4, true);
+
+	coap_utils_stats_get(&stats);
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_equal(stats.retransmissions, 1, "Not retransmitted");
+	zassert_true(stats.latency_min >= CONFIG_COAP_UTILS_ACK_TIMEOUT,
+		     "Response before the retransmission");
+}
+
+static void test_separate_response(void)
+{
+	request_send(COAP_METHOD_GET, separate_path, NULL, 0, true);
+
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_mem_equal(client_rsp.body, "separate", strlen("separate"),
+			  "Wrong payload");
+}
+
+static void test_block2(void)
+{
+	request_send(COAP_METHOD_GET, large_path, NULL, 0, true);
+
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_equal(client_rsp.callbacks,
+		      ceiling_fraction(LARGE_RESOURCE_LEN,
+				       CONFIG_COAP_UTILS_BLOCK_SIZE),
+		      "Wrong number of blocks");
+	zassert_equal(client_rsp.body_len, LARGE_RESOURCE_LEN,
+		      "Wrong length");
+	zassert_mem_equal(client_rsp.body, large_resource, LARGE_RESOURCE_LEN,
+			  "Wrong payload");
+}
+
+static void test_block1(void)
+{
+	static uint8_t payload[UPLOAD_LEN];
+
+	for (size_t i = 0; i < sizeof(payload); i++) {
+		payload[i] = i ^ 0x5a;
+	}
+
+	request_send(COAP_METHOD_PUT, upload_path, payload, sizeof(payload),
+		     true);
+
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_equal(client_rsp.code, COAP_RESPONSE_CODE_CHANGED,
+		      "Wrong code");
+	zassert_equal(upload_len, sizeof(payload), "Wrong upload length");
+	zassert_mem_equal(upload_buf, payload, sizeof(payload),
+			  "Wrong upload");
+}
+
+static void observe_cb(const struct coap_utils_response *response,
+		       void *user_data)
+{
+	client_rsp.result = response->result;
+	client_rsp.callbacks++;
+	k_sem_give(&client_notification);
+}
+
+static void test_observe(void)
+{
+	struct coap_utils_request_params params = {
+		.method = COAP_METHOD_GET,
+		.addr = (struct sockaddr *)&server_addr,
+		.uri_path_options = obs_path,
+		.confirmable = true,
+		.observe = true,
+		.cb = observe_cb,
+	};
+	int handle;
+
+	memset(&client_rsp, 0, sizeof(client_rsp));
+	k_sem_reset(&client_done);
+	k_sem_reset(&server_rst);
+
+	handle = coap_utils_request(&params);
+	zassert_true(handle >= 0, "Request failed: %d", handle);
+
+	for (int i = 0; i < NOTIFICATIONS; i++) {
+		zassert_equal(k_sem_take(&client_notification, RESPONSE_WAIT),
+			      0, "No notification");
+	}
+
+	zassert_equal(client_rsp.result, 0, "Observation failed");
+	zassert_equal(coap_utils_cancel(handle), 0, "Cancel failed");
+	k_sem_give(&client_done);
+
+	/* Notifications after cancellation are rejected */
+	zassert_equal(k_sem_take(&server_rst, RESPONSE_WAIT), 0,
+		      "Notification not rejected");
+	zassert_equal(client_rsp.callbacks, NOTIFICATIONS,
+		      "Callback after cancellation");
+}
+
+static void test_stale_cancel(void)
+{
+	int stale;
+	int handle;
+
+	stale = request_start(COAP_METHOD_POST, echo_path, "ping", 4, true);
+	zassert_equal(k_sem_take(&client_done, RESPONSE_WAIT), 0,
+		      "No response");
+	zassert_equal(coap_utils_cancel(stale), -ENOENT,
+		      "Completed request cancelled");
+
+	/* The new request reuses the exchange of the completed one */
+	handle = request_start(COAP_METHOD_GET, separate_path, NULL, 0, true);
+	zassert_not_equal(handle, stale, "Handle reused");
+	zassert_equal(coap_utils_cancel(stale), -ENOENT,
+		      "Stale handle cancelled a new request");
+
+	zassert_equal(k_sem_take(&client_done, RESPONSE_WAIT), 0,
+		      "No response");
+	zassert_equal(client_rsp.result, 0, "Request failed");
+	zassert_equal(coap_utils_cancel(handle), -ENOENT,
+		      "Completed request cancelled");
+}
+
+static void chained_cb(const struct coap_utils_response *response,
+		       void *user_data)
+{
+	struct coap_utils_request_params params = {
+		.method = COAP_METHOD_POST,
+		.addr = (struct sockaddr *)&server_addr,
+		.uri_path_options = echo_path,
+		.payload = "pong",
+		.payload_len = 4,
+		.confirmable = true,
+		.cb = response_cb,
+	};
+
+	client_rsp.callbacks++;
+	client_rsp.result = coap_utils_request(&params);
+}
+
+/* Response callbacks may start new requests. */
+static void test_request_from_cb(void)
+{
+	struct coap_utils_request_params params = {
+		.method = COAP_METHOD_POST,
+		.addr = (struct sockaddr *)&server_addr,
+		.uri_path_options = echo_path,
+		.payload = "ping",
+		.payload_len = 4,
+		.confirmable = true,
+		.cb = chained_cb,
+	};
+	int ret;
+
+	memset(&client_rsp, 0, sizeof(client_rsp));
+	k_sem_reset(&client_done);
+
+	ret = coap_utils_request(&params);
+	zassert_true(ret >= 0, "Request failed: %d", ret);
+
+	zassert_equal(k_sem_take(&client_done, RESPONSE_WAIT), 0,
+		      "No response to the chained request");
+	zassert_equal(client_rsp.result, 0, "Chained request failed");
+	zassert_equal(client_rsp.callbacks, 2, "Wrong number of callbacks");
+	zassert_mem_equal(client_rsp.body, "pong", 4, "Wrong payload");
+}
+
+static atomic_t benchmark_done;
+static atomic_t benchmark_failed;
+static K_SEM_DEFINE(benchmark_slots, CONFIG_COAP_UTILS_MAX_REQUESTS,
+		    CONFIG_COAP_UTILS_MAX_REQUESTS);
+
+static void benchmark_cb(const struct coap_utils_response *response,
+			 void *user_data)
+{
+	if (response->result) {
+		atomic_inc(&benchmark_failed);
+	}
+
+	atomic_inc(&benchmark_done);
+	k_sem_give(&benchmark_slots);
+}
+
+/* Request rate and latency with all requests outstanding at once. */
+static void test_benchmark(void)
+{
+	struct coap_utils_request_params params = {
+		.method = COAP_METHOD_POST,
+		.addr = (struct sockaddr *)&server_addr,
+		.uri_path_options = echo_path,
+		.payload = "benchmark",
+		.payload_len = strlen("benchmark"),
+		.confirmable = true,
+		.cb = benchmark_cb,
+	};
+	struct coap_utils_stats stats;
+	int64_t start;
+	uint32_t elapsed;
+	int ret;
+
+	coap_utils_stats_reset();
+	atomic_set(&benchmark_done, 0);
+	atomic_set(&benchmark_failed, 0);
+
+	start = k_uptime_get();
+
+	for (int i = 0; i < BENCHMARK_REQUESTS; i++) {
+		zassert_equal(k_sem_take(&benchmark_slots, RESPONSE_WAIT), 0,
+			      "Request did not complete");
+
+		ret = coap_utils_request(&params);
+		zassert_true(ret >= 0, "Request failed: %d", ret);
+	}
+
+	for (int i = 0; i < CONFIG_COAP_UTILS_MAX_REQUESTS; i++) {
+		zassert_equal(k_sem_take(&benchmark_slots, RESPONSE_WAIT), 0,
+			      "Request did not complete");
+	}
+
+	elapsed = MAX(k_uptime_get() - start, 1);
+
+	coap_utils_stats_get(&stats);
+	zassert_equal(atomic_get(&benchmark_done), BENCHMARK_REQUESTS,
+		      "Requests lost");
+	zassert_equal(atomic_get(&benchmark_failed), 0, "Requests failed");
+	zassert_equal(stats.completed, BENCHMARK_REQUESTS,
+		      "Wrong statistics");
+
+	TC_PRINT("%u requests in %u ms: %u requests/s\n",
+		 stats.completed, elapsed,
+		 stats.completed * MSEC_PER_SEC / elapsed);
+	TC_PRINT("latency min %u ms, avg %u ms, max %u ms, "
+		 "%u retransmissions\n",
+		 stats.latency_min,
+		 (uint32_t)(stats.latency_sum / stats.completed),
+		 stats.latency_max, stats.retransmissions);
+}
+
+static void server_start(void)
+{
+	int ret;
+
+	for (size_t i = 0; i < sizeof(large_resource); i++) {
+		large_resource[i] = i;
+	}
+
+	server_sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(server_sock >= 0, "Server socket failed");
+
+	ret = bind(server_sock, (struct sockaddr *)&server_addr,
+		   sizeof(server_addr));
+	zassert_equal(ret, 0, "Server bind failed");
+
+	k_thread_create(&server_thread, server_stack,
+			K_THREAD_STACK_SIZEOF(server_stack),
+			(k_thread_entry_t)server_run, NULL, NULL, NULL,
+			SERVER_PRIORITY, 0, K_NO_WAIT);
+}
+
+void test_main(void)
+{
+	server_start();
+	coap_init(AF_INET6);
+
+	ztest_test_suite(coap_utils_test,
+			 ztest_unit_test(test_con_request),
+			 ztest_unit_test(test_non_request),
+			 ztest_unit_test(test_retransmission),
+			 ztest_unit_test(test_separate_response),
+			 ztest_unit_test(test_block2),
+			 ztest_unit_test(test_block1),
+			 ztest_unit_test(test_observe),
+			 ztest_unit_test(test_stale_cancel),
+			 ztest_unit_test(test_request_from_cb),
+			 ztest_unit_test(test_benchmark)
+			 );
+	ztest_run_test_suite(coap_utils_test);
+}
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <ztest.h>
+#include <logging/log.h>
+
+/* Registered by download_client.c, which is not part of the test. */
+LOG_MODULE_REGISTER(download_client, CONFIG_DOWNLOAD_CLIENT_LOG_LEVEL);
+
+void test_http_suite(void);
+void test_coap_suite(void);
+
+void test_main(void)
+{
+	test_http_suite();
+	test_coap_suite();
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/socket.h>
+#include <net/coap.h>
+#include <net/download_client.h>
+
+#define SERVER_PORT 5683
+#define MSG_LEN 256
+#define MAX_REQUESTS 16
+#define MAX_ROUNDS 100
+#define REQUEST_WAIT_MS 50
+
+#define BLOCK_SIZE (16 << CONFIG_DOWNLOAD_CLIENT_COAP_BLOCK_SIZE)
+/* The window grows past the end of the file before the last block */
+#define FILE_LEN (12 * BLOCK_SIZE + BLOCK_SIZE / 2)
+
+#define BLOCK_NUM(val) ((uint32_t)(val) >> 4)
+
+int coap_block_init(struct download_client *client, size_t from);
+int coap_parse(struct download_client *client, size_t len);
+int coap_request_send(struct download_client *client);
+
+static struct sockaddr_in6 server_addr = {
+	.sin6_family = AF_INET6,
+	.sin6_port = htons(SERVER_PORT),
+	.sin6_addr = IN6ADDR_LOOPBACK_INIT,
+};
+
+static struct download_client client;
+static int server_sock = -1;
+
+static uint8_t file[FILE_LEN];
+static uint8_t received[FILE_LEN];
+
+/* Test server behavior */
+static struct {
+	/* Tell the size of the file in the first response. */
+	bool size2;
+	/* Answer the requests of a round in reverse order. */
+	bool reverse;
+	/* Response code for all requests, instead of the file. */
+	uint8_t error;
+} server;
+
+struct request {
+	uint8_t token[8];
+	uint8_t tkl;
+	uint16_t id;
+	uint32_t num;
+};
+
+static void sockets_open(void)
+{
+	int err;
+
+	if (server_sock < 0) {
+		server_sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+		zassert_true(server_sock >= 0, "Server socket failed");
+
+		err = bind(server_sock, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr));
+		zassert_equal(err, 0, "Bind failed: %d", errno);
+	}
+
+	client.fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(client.fd >= 0, "Client socket failed");
+
+	err = connect(client.fd, (struct sockaddr *)&server_addr,
+		      sizeof(server_addr));
+	zassert_equal(err, 0, "Connect failed: %d", errno);
+}
+
+static void download_init(void)
+{
+	memset(&client, 0, sizeof(client));
+	memset(received, 0, sizeof(received));
+
+	for (size_t i = 0; i < sizeof(file); i++) {
+		file[i] = (uint8_t)(i * 7 + i / 256);
+	}
+
+	sockets_open();
+
+	client.file = "coap://[::1]/file";
+	client.proto = IPPROTO_UDP;
+
+	zassert_equal(coap_block_init(&client, 0), 0, "Init failed");
+}
+
+static size_t requests_receive(struct request *requests, size_t max)
+{
+	struct pollfd fds = {
+		.fd = server_sock,
+		.events = POLLIN,
+	};
+	struct coap_packet packet;
+	uint8_t buf[MSG_LEN];
+	size_t count = 0;
+	int block2;
+	int len;
+
+	while (count < max && poll(&fds, 1, REQUEST_WAIT_MS) > 0) {
+		len = recv(server_sock, buf, sizeof(buf), 0);
+		zassert_true(len > 0, "Server receive failed");
+
+		if (coap_packet_parse(&packet, buf, len, NULL, 0) != 0 ||
+		    coap_header_get_code(&packet) != COAP_METHOD_GET) {
+			/* Empty ACK to a separate response */
+			continue;
+		}
+
+		block2 = coap_get_option_int(&packet, COAP_OPTION_BLOCK2);
+		zassert_true(block2 >= 0, "No Block2 option");
+
+		requests[count].tkl =
+			coap_header_get_token(&packet, requests[count].token);
+		requests[count].id = coap_header_get_id(&packet);
+		requests[count].num = BLOCK_NUM(block2);
+		count++;
+	}
+
+	return count;
+}
+
+/* Response as received by the client, at the receive offset. */
+static size_t response_build(const struct request *request)
+{
+	static const uint8_t etag[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	size_t offset = request->num * BLOCK_SIZE;
+	size_t len = MIN(BLOCK_SIZE, FILE_LEN - MIN(offset, FILE_LEN));
+	bool more = (offset + len < FILE_LEN);
+	struct coap_packet response;
+	uint8_t code;
+	int err;
+
+	if (server.error) {
+		code = server.error;
+	} else if (offset >= FILE_LEN) {
+		/* Block after the end of the file */
+		code = COAP_RESPONSE_CODE_BAD_OPTION;
+	} else {
+		code = COAP_RESPONSE_CODE_CONTENT;
+	}
+
+	err = coap_packet_init(&response,
+			       client.buf + client.coap.rx_offset,
+			       sizeof(client.buf) - client.coap.rx_offset,
+			       1, COAP_TYPE_ACK, request->tkl, request->token,
+			       code, request->id);
+	zassert_equal(err, 0, "Response init failed");
+
+	if (code != COAP_RESPONSE_CODE_CONTENT) {
+		return response.offset;
+	}
+
+	/* Options that take room in the receive buffer */
+	err = coap_packet_append_option(&response, COAP_OPTION_ETAG, etag,
+					sizeof(etag));
+	zassert_equal(err, 0, "ETag failed");
+	err = coap_append_option_int(&response, COAP_OPTION_MAX_AGE, 86400);
+	zassert_equal(err, 0, "Max-Age failed");
+	err = coap_append_option_int(&response, COAP_OPTION_BLOCK2,
+				     (request->num << 4) | (more << 3) |
+				     CONFIG_DOWNLOAD_CLIENT_COAP_BLOCK_SIZE);
+	zassert_equal(err, 0, "Block2 failed");
+
+	if (server.size2) {
+		err = coap_append_option_int(&response, COAP_OPTION_SIZE2,
+					     FILE_LEN);
+		zassert_equal(err, 0, "Size2 failed");
+	}
+
+	err = coap_packet_append_payload_marker(&response);
+	zassert_equal(err, 0, "Payload marker failed");
+	err = coap_packet_append_payload(&response, &file[offset], len);
+	zassert_equal(err, 0, "Payload failed");
+
+	return response.offset;
+}
+
+/* Run the download like the download thread does, returns the result of
+ * the last coap_parse().
+ */
+static int download(void)
+{
+	struct request requests[MAX_REQUESTS];
+	size_t count;
+	size_t len;
+	int rc = 0;
+
+	client.offset = 0;
+	zassert_equal(coap_request_send(&client), 0, "Request failed");
+
+	for (int round = 0; round < MAX_ROUNDS; round++) {
+		count = requests_receive(requests, ARRAY_SIZE(requests));
+		zassert_true(count > 0, "No requests");
+
+		for (size_t i = 0; i < count; i++) {
+			len = response_build(
+				&requests[server.reverse ? count - 1 - i : i]);
+
+			rc = coap_parse(&client, len);
+			if (rc < 0) {
+				return rc;
+			}
+
+			if (rc == 0) {
+				zassert_true(client.progress <= FILE_LEN,
+					     "Too much data");
+				memcpy(&received[client.progress -
+						 client.offset],
+				       client.buf, client.offset);
+			}
+
+			if (client.file_size &&
+			    client.progress == client.file_size) {
+				return 0;
+			}
+
+			client.offset = 0;
+			zassert_equal(coap_request_send(&client), 0,
+				      "Request failed");
+		}
+	}
+
+	zassert_unreachable("Download did not end");
+
+	return -1;
+}
+
+static void download_check(void)
+{
+	zassert_equal(download(), 0, "Download failed");
+	zassert_equal(client.file_size, FILE_LEN, "Wrong file size %zu",
+		      client.file_size);
+	zassert_equal(client.progress, FILE_LEN, "Wrong progress");
+	zassert_mem_equal(received, file, FILE_LEN, "Wrong data");
+	zassert_true(client.coap.window > 1, "Window did not grow");
+
+	close(client.fd);
+}
+
+static void test_coap_size2(void)
+{
+	server.size2 = true;
+	server.reverse = false;
+	server.error = 0;
+
+	download_init();
+	download_check();
+}
+
+static void test_coap_no_size2(void)
+{
+	server.size2 = false;
+	server.reverse = false;
+	server.error = 0;
+
+	download_init();
+	download_check();
+}
+
+static void test_coap_no_size2_reordered(void)
+{
+	/* Errors for the blocks after the end of the file arrive before
+	 * the last block.
+	 */
+	server.size2 = false;
+	server.reverse = true;
+	server.error = 0;
+
+	download_init();
+	download_check();
+}
+
+static void test_coap_error(void)
+{
+	server.size2 = false;
+	server.reverse = false;
+	server.error = COAP_RESPONSE_CODE_NOT_FOUND;
+
+	download_init();
+	zassert_true(download() < 0, "Error response not reported");
+
+	close(client.fd);
+}
+
+void test_coap_suite(void)
+{
+	ztest_test_suite(download_client_coap_test,
+			 ztest_unit_test(test_coap_size2),
+			 ztest_unit_test(test_coap_no_size2),
+			 ztest_unit_test(test_coap_no_size2_reordered),
+			 ztest_unit_test(test_coap_error)
+			 );
+
+	ztest_run_test_suite(download_client_coap_test);
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/socket.h>
+#include <net/download_client.h>
+
+#define FRAG_SIZE 16
+#define FILE_LEN 100
+#define MAX_ROUNDS 1000
+
+void http_init(struct download_client *client);
+int http_parse(struct download_client *client, size_t len);
+void http_fragment_consumed(struct download_client *client);
+
+static struct download_client client;
+
+static char file[FILE_LEN + 1];
+static char received[FILE_LEN];
+static size_t received_len;
+static bool closed;
+
+/* Requests are not tested here, the responses are fed directly. */
+int socket_send(const struct download_client *client, size_t off, size_t len)
+{
+	return 0;
+}
+
+static void download_init(int proto)
+{
+	memset(&client, 0, sizeof(client));
+	memset(received, 0, sizeof(received));
+	received_len = 0;
+	closed = false;
+
+	for (size_t i = 0; i < FILE_LEN; i++) {
+		file[i] = 'a' + (i % 26);
+	}
+
+	client.proto = proto;
+	client.config.frag_size_override = FRAG_SIZE;
+
+	http_init(&client);
+}
+
+/* Feed the response in receives of `step` bytes at most, handling the
+ * fragments like the download thread does. Returns the result of the last
+ * http_parse(), or 1 if all the data was parsed without completing the
+ * download.
+ */
+static int feed(const char *data, size_t step)
+{
+	size_t len = strlen(data);
+	size_t room;
+	size_t n;
+	int rc;
+
+	for (int round = 0; round < MAX_ROUNDS; round++) {
+		if (client.http.pending) {
+			client.http.pending = false;
+			n = 0;
+		} else if (len > 0) {
+			room = sizeof(client.buf) - client.offset;
+			zassert_true(room > 0, "Buffer full");
+
+			n = MIN(MIN(step, len), room);
+			memcpy(client.buf + client.offset, data, n);
+			data += n;
+			len -= n;
+		} else {
+			return 1;
+		}
+
+		rc = http_parse(&client, n);
+		if (rc > 0) {
+			continue;
+		}
+
+		if (rc < 0) {
+			return rc;
+		}
+
+		zassert_true(received_len + client.offset <= FILE_LEN,
+			     "Too much data");
+		zassert_equal(client.progress, received_len + client.offset,
+			      "Wrong progress");
+		memcpy(received + received_len, client.buf, client.offset);
+		received_len += client.offset;
+
+		if (client.file_size && client.progress == client.file_size) {
+			return 0;
+		}
+
+		if (client.http.connection_close) {
+			client.http.connection_close = false;
+			closed = true;
+		}
+
+		http_fragment_consumed(&client);
+	}
+
+	zassert_unreachable("Parsing did not end");
+
+	return -1;
+}
+
+static void download_check(size_t len)
+{
+	zassert_equal(client.file_size, len, "Wrong file size %zu",
+		      client.file_size);
+	zassert_equal(received_len, len, "Wrong length %zu", received_len);
+	zassert_mem_equal(received, file, len, "Wrong data");
+}
+
+static void test_http_header_split(void)
+{
+	char response[256];
+	size_t steps[] = { 1, 2, 7, sizeof(response) };
+
+	for (size_t i = 0; i < ARRAY_SIZE(steps); i++) {
+		download_init(IPPROTO_TCP);
+
+		snprintf(response, sizeof(response),
+			 "HTTP/1.1 200 OK\r\n"
+			 "Content-Type: application/octet-stream\r\n"
+			 "Content-Length: %d\r\n"
+			 "\r\n"
+			 "%s",
+			 FILE_LEN, file);
+
+		zassert_equal(feed(response, steps[i]), 0,
+			      "Download failed in steps of %zu", steps[i]);
+		download_check(FILE_LEN);
+		zassert_false(closed, "Connection closed");
+	}
+}
+
+static void test_http_chunked(void)
+{
+	static const char response[] =
+		"HTTP/1.1 200 OK\r\n"
+		"Transfer-Encoding: chunked\r\n"
+		"\r\n"
+		"1a;name=value\r\n"
+		"abcdefghijklmnopqrstuvwxyz\r\n"
+		"0000000003\r\n"
+		"abc\r\n"
+		"1\r\n"
+		"d\r\n";
+	static const char last_chunk[] =
+		"0\r\n"
+		"Trailer: ignored\r\n"
+		"\r\n";
+	size_t steps[] = { 1, 3, 5, sizeof(response) };
+
+	for (size_t i = 0; i < ARRAY_SIZE(steps); i++) {
+		download_init(IPPROTO_TCP);
+
+		/* Chunk size lines span the fragments */
+		zassert_equal(feed(response, steps[i]), 1,
+			      "Download ended in steps of %zu", steps[i]);
+		zassert_equal(client.file_size, 0, "Size known too early");
+
+		/* The last chunk tells the size of the file */
+		zassert_equal(feed(last_chunk, steps[i]), 0,
+			      "Download failed in steps of %zu", steps[i]);
+		download_check(30);
+	}
+}
+
+static void test_http_pipelined(void)
+{
+	char response[512];
+	size_t steps[] = { 1, 11, sizeof(response) };
+
+	for (size_t i = 0; i < ARRAY_SIZE(steps); i++) {
+		download_init(IPPROTO_TLS_1_2);
+		client.http.in_flight = 3;
+
+		/* All the responses are received at once */
+		snprintf(response, sizeof(response),
+			 "HTTP/1.1 206 Partial Content\r\n"
+			 "Content-Range: bytes 0-39/%d\r\n"
+			 "Content-Length: 40\r\n"
+			 "\r\n"
+			 "%.40s"
+			 "HTTP/1.1 206 Partial Content\r\n"
+			 "Content-Range: bytes 40-79/%d\r\n"
+			 "Content-Length: 40\r\n"
+			 "\r\n"
+			 "%.40s"
+			 "HTTP/1.1 206 Partial Content\r\n"
+			 "Content-Range: bytes 80-99/%d\r\n"
+			 "Content-Length: 20\r\n"
+			 "\r\n"
+			 "%.20s",
+			 FILE_LEN, file, FILE_LEN, file + 40,
+			 FILE_LEN, file + 80);
+
+		zassert_equal(feed(response, steps[i]), 0,
+			      "Download failed in steps of %zu", steps[i]);
+		download_check(FILE_LEN);
+		zassert_equal(client.http.in_flight, 0, "Responses not counted");
+	}
+}
+
+static void test_http_range_mismatch(void)
+{
+	char response[256];
+
+	download_init(IPPROTO_TLS_1_2);
+	client.progress = 40;
+
+	snprintf(response, sizeof(response),
+		 "HTTP/1.1 206 Partial Content\r\n"
+		 "Content-Range: bytes 0-39/%d\r\n"
+		 "Content-Length: 40\r\n"
+		 "\r\n"
+		 "%.40s",
+		 FILE_LEN, file);
+
+	zassert_true(feed(response, sizeof(response)) < 0,
+		     "Wrong range accepted");
+	zassert_equal(received_len, 0, "Data of the wrong range received");
+}
+
+static void test_http_connection_close(void)
+{
+	char response[256];
+
+	download_init(IPPROTO_TLS_1_2);
+	client.http.in_flight = 1;
+
+	snprintf(response, sizeof(response),
+		 "HTTP/1.1 206 Partial Content\r\n"
+		 "Content-Range: bytes 0-39/%d\r\n"
+		 "Content-Length: 40\r\n"
+		 "Connection: close\r\n"
+		 "\r\n"
+		 "%.40s",
+		 FILE_LEN, file);
+
+	zassert_equal(feed(response, 9), 1, "Download ended");
+	zassert_true(closed, "Connection close not reported");
+	zassert_equal(client.progress, 40, "Wrong progress");
+	zassert_equal(client.file_size, FILE_LEN, "Wrong file size");
+	zassert_mem_equal(received, file, 40, "Wrong data");
+}
+
+void test_http_suite(void)
+{
+	ztest_test_suite(download_client_http_test,
+			 ztest_unit_test(test_http_header_split),
+			 ztest_unit_test(test_http_chunked),
+			 ztest_unit_test(test_http_pipelined),
+			 ztest_unit_test(test_http_range_mismatch),
+			 ztest_unit_test(test_http_connection_close)
+			 );
+
+	ztest_run_test_suite(download_client_http_test);
+}
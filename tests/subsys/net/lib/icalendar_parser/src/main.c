@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+#include <net/icalendar_parser.h>
+
+#define MAX_EVENTS 8
+
+static const char calendar[] =
+	"BEGIN:VCALENDAR\r\n"
+	"VERSION:2.0\r\n"
+	"PRODID:-//Test//Calendar//EN\r\n"
+	"BEGIN:VEVENT\r\n"
+	"SUMMARY:Team mee\r\n"
+	" ting\r\n"
+	"LOCATION;ALTREP=\"cid:room;1@example.com\":Room 1\r\n"
+	"DESCRIPTION:Weekly\r\n"
+	"\t sync\r\n"
+	"DTSTART;TZID=Europe/Oslo:20200101T100000\r\n"
+	"DTEND;TZID=Europe/Oslo:20200101T110000\r\n"
+	"BEGIN:VALARM\r\n"
+	"DESCRIPTION:Reminder\r\n"
+	"END:VALARM\r\n"
+	"X-UNKNOWN;X-PARAM=\"a:b\":SUMMARY:ignored\r\n"
+	"END:VEVENT\r\n"
+	"BEGIN:VTODO\r\n"
+	"SUMMARY:Todo\r\n"
+	"END:VTODO\r\n"
+	"BEGIN:VEVENT\r\n"
+	"SUMMARY:This summary is longer than the buffer\r\n"
+	"LOCATION:Room 2\r\n"
+	"END:VEVENT\r\n"
+	"BEGIN:VEVENT\r\n"
+	"summary:Lower case\r\n"
+	"END:VEVENT\r\n"
+	"END:VCALENDAR\r\n";
+
+/* Offset after the first event */
+#define FIRST_EVENT_END \
+	(strstr(calendar, "BEGIN:VTODO") - calendar)
+
+static struct ical_parser_evt events[MAX_EVENTS];
+static size_t event_count;
+static size_t stop_after;
+
+static int event_cb(const struct ical_parser_evt *event)
+{
+	zassert_true(event_count < MAX_EVENTS, "Too many events");
+
+	events[event_count++] = *event;
+
+	return (stop_after && event_count >= stop_after) ? 1 : 0;
+}
+
+/* Feed the calendar in fragments, returns the number of parsed bytes. */
+static size_t parse(uint32_t props, size_t fragment)
+{
+	static struct icalendar_parser ical;
+	size_t parsed = 0;
+	size_t len;
+	size_t ret;
+
+	zassert_equal(ical_parser_init(&ical, event_cb), 0, "Init failed");
+	ical_parser_props_set(&ical, props);
+
+	memset(events, 0, sizeof(events));
+	event_count = 0;
+
+	while (parsed < strlen(calendar)) {
+		len = MIN(fragment, strlen(calendar) - parsed);
+		ret = ical_parser_parse(&ical, &calendar[parsed], len);
+		zassert_true(ret <= len, "Parsed more than given");
+
+		parsed += ret;
+		if (ret < len) {
+			/* Stopped, nothing is parsed after that */
+			zassert_equal(ical_parser_parse(&ical, &calendar[parsed],
+							len - ret),
+				      0, "Parsed after stop");
+			break;
+		}
+	}
+
+	return parsed;
+}
+
+static void events_check(void)
+{
+	const struct ical_component *com = &events[0].ical_com;
+
+	zassert_equal(event_count, 4, "Wrong number of events: %zu",
+		      event_count);
+
+	/* Folded lines, quoted parameters and a nested VALARM */
+	zassert_equal(events[0].id, ICAL_EVT_VEVENT, "Wrong event");
+	zassert_equal(events[0].error, ICAL_ERROR_NONE, "Wrong error");
+	zassert_true(!strcmp(com->summary, "Team meeting"),
+		     "Wrong summary: %s", com->summary);
+	zassert_true(!strcmp(com->location, "Room 1"),
+		     "Wrong location: %s", com->location);
+	zassert_true(!strcmp(com->description, "Weekly sync"),
+		     "Wrong description: %s", com->description);
+	zassert_true(!strcmp(com->dtstart, "20200101T100000"),
+		     "Wrong start: %s", com->dtstart);
+	zassert_true(!strcmp(com->dtend, "20200101T110000"),
+		     "Wrong end: %s", com->dtend);
+
+	zassert_equal(events[1].id, ICAL_EVT_VTODO, "Wrong event");
+	zassert_equal(events[1].error, ICAL_ERROR_COM_NOT_SUPPORTED,
+		      "Wrong error");
+
+	zassert_equal(events[2].id, ICAL_EVT_VEVENT, "Wrong event");
+	zassert_equal(events[2].error, ICAL_ERROR_SUMMARY, "Wrong error");
+
+	zassert_true(!strcmp(events[3].ical_com.summary, "Lower case"),
+		     "Wrong summary: %s", events[3].ical_com.summary);
+}
+
+static void test_fragments(void)
+{
+	for (size_t fragment = 1; fragment <= strlen(calendar); fragment++) {
+		zassert_equal(parse(ICAL_PROP_ALL, fragment), strlen(calendar),
+			      "Not all data parsed");
+		events_check();
+	}
+}
+
+static void test_unselected_props(void)
+{
+	const struct ical_component *com = &events[0].ical_com;
+
+	parse(ICAL_PROP_SUMMARY | ICAL_PROP_DTSTART, 7);
+
+	zassert_equal(event_count, 4, "Wrong number of events");
+	zassert_true(!strcmp(com->summary, "Team meeting"), "Wrong summary");
+	zassert_true(!strcmp(com->dtstart, "20200101T100000"), "Wrong start");
+	zassert_equal(com->location[0], '\0', "Unselected location stored");
+	zassert_equal(com->description[0], '\0',
+		      "Unselected description stored");
+	zassert_equal(com->dtend[0], '\0', "Unselected end stored");
+
+	/* Unselected values do not overflow */
+	parse(ICAL_PROP_LOCATION, 7);
+	zassert_equal(events[2].error, ICAL_ERROR_NONE, "Wrong error");
+	zassert_true(!strcmp(events[2].ical_com.location, "Room 2"),
+		     "Wrong location");
+}
+
+static void test_callback_stop(void)
+{
+	stop_after = 1;
+
+	for (size_t fragment = 1; fragment <= strlen(calendar); fragment++) {
+		zassert_equal(parse(ICAL_PROP_ALL, fragment), FIRST_EVENT_END,
+			      "Wrong number of parsed bytes");
+		zassert_equal(event_count, 1, "Event after stop");
+	}
+
+	stop_after = 0;
+}
+
+void test_main(void)
+{
+	ztest_test_suite(icalendar_parser_test,
+			 ztest_unit_test(test_fragments),
+			 ztest_unit_test(test_unselected_props),
+			 ztest_unit_test(test_callback_stop)
+			 );
+	ztest_run_test_suite(icalendar_parser_test);
+}
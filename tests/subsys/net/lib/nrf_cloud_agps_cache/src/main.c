@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <ztest.h>
+#include <date_time.h>
+#include <settings/settings.h>
+
+#include "nrf_cloud_agps_cache.h"
+
+#define MSEC_PER_MIN (60LL * MSEC_PER_SEC)
+#define MSEC_PER_DAY (24LL * 60LL * MSEC_PER_MIN)
+#define EPHEMERIS_VALIDITY_MS \
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_EPHEMERIS_VALIDITY * MSEC_PER_MIN)
+
+#define STORE_ENTRIES 80
+#define KEY_LEN 16
+#define VALUE_LEN 128
+
+/* Simulated settings storage */
+static struct {
+	char key[KEY_LEN];
+	uint8_t value[VALUE_LEN];
+	size_t len;
+} store[STORE_ENTRIES];
+
+static struct settings_handler *handler;
+static int saves;
+static int deletes;
+
+static int64_t time_ms = 1600000000000LL;
+static bool time_known = true;
+
+int date_time_now(int64_t *unix_time_ms)
+{
+	if (!time_known) {
+		return -ENODATA;
+	}
+
+	*unix_time_ms = time_ms;
+	return 0;
+}
+
+static int store_find(const char *key)
+{
+	for (int i = 0; i < STORE_ENTRIES; i++) {
+		if (!strcmp(store[i].key, key)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int settings_subsys_init(void)
+{
+	return 0;
+}
+
+int settings_register(struct settings_handler *cf)
+{
+	handler = cf;
+	return 0;
+}
+
+static ssize_t store_read(void *cb_arg, void *data, size_t len)
+{
+	int i = (intptr_t)cb_arg;
+
+	len = MIN(len, store[i].len);
+	memcpy(data, store[i].value, len);
+
+	return len;
+}
+
+int settings_load_subtree(const char *subtree)
+{
+	size_t prefix_len = strlen(subtree) + 1;
+
+	for (int i = 0; i < STORE_ENTRIES; i++) {
+		if (strncmp(store[i].key, subtree, prefix_len - 1) ||
+		    (store[i].key[prefix_len - 1] != '/')) {
+			continue;
+		}
+
+		handler->h_set(&store[i].key[prefix_len], store[i].len,
+			       store_read, (void *)(intptr_t)i);
+	}
+
+	return 0;
+}
+
+int settings_save_one(const char *name, const void *value, size_t val_len)
+{
+	int i = store_find(name);
+
+	if (i < 0) {
+		i = store_find("");
+	}
+
+	zassert_true(i >= 0, "Settings storage full");
+	zassert_true(val_len <= VALUE_LEN, "Value too long");
+
+	strncpy(store[i].key, name, KEY_LEN - 1);
+	memcpy(store[i].value, value, val_len);
+	store[i].len = val_len;
+	saves++;
+
+	return 0;
+}
+
+int settings_delete(const char *name)
+{
+	int i = store_find(name);
+
+	if (i >= 0) {
+		memset(&store[i], 0, sizeof(store[i]));
+		deletes++;
+	}
+
+	return 0;
+}
+
+int settings_name_steq(const char *name, const char *key, const char **next)
+{
+	size_t len = strlen(key);
+
+	if (next) {
+		*next = NULL;
+	}
+
+	if (strncmp(name, key, len)) {
+		return 0;
+	}
+
+	if (name[len] == '/' && next) {
+		*next = &name[len + 1];
+		return 1;
+	}
+
+	return name[len] == '\0' || name[len] == '=';
+}
+
+int settings_name_next(const char *name, const char **next)
+{
+	int len = 0;
+
+	while (name[len] != '\0' && name[len] != '/') {
+		len++;
+	}
+
+	*next = (name[len] == '/') ? &name[len + 1] : NULL;
+
+	return len;
+}
+
+static void test_reset(void)
+{
+	time_known = true;
+	zassert_equal(agps_cache_clear(), 0, "Clear failed");
+	saves = 0;
+	deletes = 0;
+}
+
+static void ephemeris_store(uint8_t sv, int16_t af1)
+{
+	struct nrf_cloud_agps_ephemeris ephemeris = {
+		.sv_id = sv,
+		.af1 = af1,
+	};
+	struct nrf_cloud_apgs_element element = {
+		.type = NRF_CLOUD_AGPS_EPHEMERIDES,
+		.ephemeris = &ephemeris,
+	};
+
+	zassert_equal(agps_cache_store(&element), 0, "Store failed");
+}
+
+static void klobuchar_store(void)
+{
+	struct nrf_cloud_agps_klobuchar klobuchar = {
+		.alpha0 = 1,
+	};
+	struct nrf_cloud_apgs_element element = {
+		.type = NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION,
+		.ion_correction.klobuchar = &klobuchar,
+	};
+
+	zassert_equal(agps_cache_store(&element), 0, "Store failed");
+}
+
+static int visits[NRF_CLOUD_AGPS_INTEGRITY + 1];
+
+static int visit(struct nrf_cloud_apgs_element *element)
+{
+	visits[element->type]++;
+	return 0;
+}
+
+static void test_restore(void)
+{
+	struct {
+		int64_t stored_ms;
+		struct nrf_cloud_agps_utc data;
+	} __packed utc = {
+		.stored_ms = time_ms - MSEC_PER_DAY,
+	};
+	enum gps_agps_type types[] = { GPS_AGPS_UTC_PARAMETERS };
+
+	settings_save_one("agps/utc", &utc, sizeof(utc));
+
+	zassert_equal(agps_cache_init(), 0, "Init failed");
+	zassert_equal(agps_cache_filter_types(types, ARRAY_SIZE(types)), 0,
+		      "Stored UTC parameters not restored");
+}
+
+static void test_filter(void)
+{
+	enum gps_agps_type types[] = {
+		GPS_AGPS_UTC_PARAMETERS,
+		GPS_AGPS_EPHEMERIDES,
+		GPS_AGPS_KLOBUCHAR_CORRECTION,
+		GPS_AGPS_LOCATION,
+	};
+	size_t count;
+
+	test_reset();
+
+	count = agps_cache_filter_types(types, ARRAY_SIZE(types));
+	zassert_equal(count, ARRAY_SIZE(types), "Filtered from empty cache");
+
+	ephemeris_store(1, 1);
+	ephemeris_store(2, 1);
+	klobuchar_store();
+
+	count = agps_cache_filter_types(types, ARRAY_SIZE(types));
+	zassert_equal(count, 2, "Wrong number of types: %zu", count);
+	zassert_equal(types[0], GPS_AGPS_UTC_PARAMETERS, "Wrong type");
+	zassert_equal(types[1], GPS_AGPS_LOCATION, "Wrong type");
+
+	/* Identical data is not written again */
+	zassert_equal(saves, 3, "Wrong number of saves: %d", saves);
+	klobuchar_store();
+	zassert_equal(saves, 3, "Unchanged data saved");
+}
+
+static void test_no_time(void)
+{
+	enum gps_agps_type types[] = {
+		GPS_AGPS_EPHEMERIDES,
+		GPS_AGPS_KLOBUCHAR_CORRECTION,
+	};
+
+	test_reset();
+
+	time_known = false;
+	klobuchar_store();
+	zassert_equal(saves, 0, "Saved without time");
+
+	time_known = true;
+	klobuchar_store();
+	ephemeris_store(1, 1);
+
+	time_known = false;
+	zassert_equal(agps_cache_filter_types(types, ARRAY_SIZE(types)),
+		      ARRAY_SIZE(types), "Filtered without time");
+
+	time_known = true;
+}
+
+static void test_expiry(void)
+{
+	enum gps_agps_type types[] = { GPS_AGPS_EPHEMERIDES };
+
+	test_reset();
+
+	ephemeris_store(1, 1);
+	ephemeris_store(2, 1);
+
+	time_ms += EPHEMERIS_VALIDITY_MS;
+
+	/* Expired data is requested, but kept until new data arrives */
+	zassert_equal(agps_cache_filter_types(types, ARRAY_SIZE(types)), 1,
+		      "Expired type not requested");
+	zassert_equal(deletes, 0, "Deleted when filtering");
+	zassert_true(store_find("agps/eph/2") >= 0, "Expired entry deleted");
+
+	/* New data drops the expired satellites that weren't updated */
+	ephemeris_store(1, 2);
+	zassert_equal(deletes, 2, "Expired entries not deleted");
+	zassert_equal(store_find("agps/eph/2"), -1, "Expired entry kept");
+	zassert_true(store_find("agps/eph/1") >= 0, "New entry not stored");
+
+	zassert_equal(agps_cache_filter_types(types, ARRAY_SIZE(types)), 0,
+		      "Updated type requested");
+}
+
+static void test_foreach_types(void)
+{
+	enum gps_agps_type types[] = { GPS_AGPS_EPHEMERIDES };
+
+	test_reset();
+
+	ephemeris_store(1, 1);
+	ephemeris_store(3, 1);
+	klobuchar_store();
+
+	memset(visits, 0, sizeof(visits));
+	zassert_equal(agps_cache_foreach(types, ARRAY_SIZE(types), visit), 0,
+		      "Iteration failed");
+	zassert_equal(visits[NRF_CLOUD_AGPS_EPHEMERIDES], 2,
+		      "Wrong number of ephemerides");
+	zassert_equal(visits[NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION], 0,
+		      "Visited unselected type");
+
+	memset(visits, 0, sizeof(visits));
+	zassert_equal(agps_cache_foreach(NULL, 0, visit), 0,
+		      "Iteration failed");
+	zassert_equal(visits[NRF_CLOUD_AGPS_EPHEMERIDES], 2,
+		      "Wrong number of ephemerides");
+	zassert_equal(visits[NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION], 1,
+		      "Klobuchar correction not visited");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(nrf_cloud_agps_cache_test,
+			 ztest_unit_test(test_restore),
+			 ztest_unit_test(test_filter),
+			 ztest_unit_test(test_no_time),
+			 ztest_unit_test(test_expiry),
+			 ztest_unit_test(test_foreach_types)
+			 );
+	ztest_run_test_suite(nrf_cloud_agps_cache_test);
+}